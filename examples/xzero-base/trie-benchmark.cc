@@ -0,0 +1,81 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+// Compares prefix lookups of PrefixTree and RadixTree on URL prefixes.
+//
+// Usage: trie-benchmark [PATTERN_COUNT [LOOKUP_COUNT]]
+
+#include <xzero-base/PrefixTree.h>
+#include <xzero-base/RadixTree.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace xzero;
+
+static std::string randomPath(std::mt19937& rng, int maxDepth) {
+  static const char* segments[] = {
+      "api", "v1", "v2", "users", "groups", "static", "images", "css", "js",
+      "blog", "2014", "2015", "archive", "download", "assets", "fonts"};
+  std::string path;
+  for (int i = 0, e = 1 + rng() % maxDepth; i < e; ++i) {
+    path += "/";
+    path += segments[rng() % (sizeof(segments) / sizeof(*segments))];
+    if (rng() % 4 == 0)
+      path += std::to_string(rng() % 100);
+  }
+  return path;
+}
+
+template <typename Tree>
+static void run(const char* name, const Tree& tree,
+                const std::vector<std::string>& inputs) {
+  auto start = std::chrono::steady_clock::now();
+  size_t hits = 0;
+  for (const std::string& input : inputs) {
+    int value;
+    if (tree.lookup(input, &value))
+      hits++;
+  }
+  auto duration = std::chrono::steady_clock::now() - start;
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration);
+
+  printf("%-12s %8.1f ns/lookup (%zu hits)\n", name,
+         static_cast<double>(ns.count()) / inputs.size(), hits);
+}
+
+int main(int argc, const char* argv[]) {
+  const int patternCount = argc > 1 ? atoi(argv[1]) : 5000;
+  const int lookupCount = argc > 2 ? atoi(argv[2]) : 1000000;
+
+  std::mt19937 rng(1);
+  PrefixTree<std::string, int> prefixTree;
+  RadixTree<std::string, int> radixTree;
+
+  for (int i = 1; i <= patternCount; ++i) {
+    std::string pattern = randomPath(rng, 3);
+    prefixTree.insert(pattern, i);
+    radixTree.insert(pattern, i);
+  }
+  radixTree.build();
+
+  std::vector<std::string> inputs;
+  inputs.reserve(lookupCount);
+  for (int i = 0; i < lookupCount; ++i)
+    inputs.push_back(randomPath(rng, 6));
+
+  printf("%d patterns, %d lookups, %zu radix tree nodes\n", patternCount,
+         lookupCount, radixTree.nodeCount());
+
+  run("PrefixTree", prefixTree, inputs);
+  run("RadixTree", radixTree, inputs);
+
+  return 0;
+}
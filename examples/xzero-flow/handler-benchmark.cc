@@ -0,0 +1,225 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+// Measures the time it takes to run a request handler of a typical
+// routing configuration through the Flow VM.
+//
+// Usage: handler-benchmark [-O LEVEL] [-T] [REQUEST_COUNT]
+
+#include <xzero-flow/FlowParser.h>
+#include <xzero-flow/IRGenerator.h>
+#include <xzero-flow/TargetCodeGenerator.h>
+#include <xzero-flow/ir/IRProgram.h>
+#include <xzero-flow/ir/PassManager.h>
+#include <xzero-flow/transform/ConstantFoldingPass.h>
+#include <xzero-flow/transform/EmptyBlockElimination.h>
+#include <xzero-flow/transform/InstructionElimination.h>
+#include <xzero-flow/transform/UnusedBlockPass.h>
+#include <xzero-flow/vm/Handler.h>
+#include <xzero-flow/vm/NativeCallback.h>
+#include <xzero-flow/vm/Program.h>
+#include <xzero-flow/vm/Runner.h>
+#include <xzero-flow/vm/Runtime.h>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace xzero;
+using namespace xzero::flow;
+
+static const char* config =
+    "handler main {\n"
+    "  if req.host == 'static.example.com' {\n"
+    "    respond 200;\n"
+    "  }\n"
+    "  if req.method != 'GET' and req.method != 'HEAD' {\n"
+    "    if req.path =^ '/api/' {\n"
+    "      respond 202;\n"
+    "    }\n"
+    "    respond 405;\n"
+    "  }\n"
+    "  if req.port != 443 {\n"
+    "    if req.path == '/login' {\n"
+    "      respond 301;\n"
+    "    }\n"
+    "  }\n"
+    "  if req.path == '/' {\n"
+    "    respond 200;\n"
+    "  }\n"
+    "  if req.path == '/favicon.ico' {\n"
+    "    respond 204;\n"
+    "  }\n"
+    "  if req.path =^ '/api/' {\n"
+    "    if req.port == 8080 {\n"
+    "      respond 403;\n"
+    "    }\n"
+    "    if req.host != 'api.example.com' {\n"
+    "      respond 421;\n"
+    "    }\n"
+    "    respond 200;\n"
+    "  }\n"
+    "  if req.path =$ '.php' {\n"
+    "    respond 403;\n"
+    "  }\n"
+    "  if req.host == 'www.example.com' {\n"
+    "    respond 200;\n"
+    "  }\n"
+    "  respond 404;\n"
+    "}\n";
+
+struct Request {
+  FlowString method;
+  FlowString host;
+  FlowString path;
+  FlowNumber port;
+  FlowNumber status;
+};
+
+class Router : public vm::Runtime {
+ public:
+  Router() {
+    registerFunction("req.method", FlowType::String)
+        .bind(&Router::req_method);
+    registerFunction("req.host", FlowType::String)
+        .bind(&Router::req_host);
+    registerFunction("req.path", FlowType::String)
+        .bind(&Router::req_path);
+    registerFunction("req.port", FlowType::Number)
+        .bind(&Router::req_port);
+    registerHandler("respond")
+        .param<FlowNumber>("status")
+        .bind(&Router::respond);
+  }
+
+  bool import(const std::string& name, const std::string& path,
+              std::vector<vm::NativeCallback*>* builtins) override {
+    return false;
+  }
+
+ private:
+  static Request* request(vm::Params& args) {
+    return static_cast<Request*>(args.caller()->userdata());
+  }
+
+  void req_method(vm::Params& args) { args.setResult(request(args)->method); }
+  void req_host(vm::Params& args) { args.setResult(request(args)->host); }
+  void req_path(vm::Params& args) { args.setResult(request(args)->path); }
+  void req_port(vm::Params& args) { args.setResult(request(args)->port); }
+
+  void respond(vm::Params& args) {
+    request(args)->status = args.getInt(1);
+    args.setResult(true);
+  }
+};
+
+static std::unique_ptr<vm::Program> compile(Router* router, int level) {
+  FlowParser parser(router);
+  std::unique_ptr<std::istream> source(new std::istringstream(config));
+  if (!parser.open("<config>", std::move(source)))
+    return nullptr;
+
+  std::unique_ptr<Unit> unit = parser.parse();
+  if (!unit)
+    return nullptr;
+
+  std::unique_ptr<IRProgram> ir = IRGenerator::generate(unit.get(), {});
+  if (!ir)
+    return nullptr;
+
+  PassManager pm;
+  pm.registerPass(std::make_unique<UnusedBlockPass>());
+  if (level >= 1) {
+    pm.registerPass(std::make_unique<ConstantFoldingPass>());
+    pm.registerPass(std::make_unique<EmptyBlockElimination>());
+    pm.registerPass(std::make_unique<InstructionElimination>());
+  }
+  pm.run(ir.get());
+
+  if (!router->verify(ir.get()))
+    return nullptr;
+
+  std::unique_ptr<vm::Program> program = TargetCodeGenerator().generate(
+      ir.get());
+  if (!program || !program->link(router))
+    return nullptr;
+
+  return program;
+}
+
+int main(int argc, char* argv[]) {
+  int level = 1;
+  bool dump = false;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "O:T")) != -1) {
+    switch (opt) {
+      case 'O':
+        level = atoi(optarg);
+        break;
+      case 'T':
+        dump = true;
+        break;
+      default:
+        fprintf(stderr, "usage: %s [-O LEVEL] [-T] [REQUEST_COUNT]\n",
+                argv[0]);
+        return 1;
+    }
+  }
+
+  const int requestCount = optind < argc ? atoi(argv[optind]) : 1000000;
+
+  Router router;
+  std::unique_ptr<vm::Program> program = compile(&router, level);
+  if (!program) {
+    fprintf(stderr, "Failed to compile the configuration.\n");
+    return 1;
+  }
+
+  if (dump)
+    program->dump();
+
+  vm::Handler* main = program->findHandler("main");
+
+  std::vector<Request> requests = {
+      {"GET", "www.example.com", "/", 443, 0},
+      {"GET", "www.example.com", "/index.html", 443, 0},
+      {"GET", "static.example.com", "/css/site.css", 443, 0},
+      {"POST", "api.example.com", "/api/v1/users", 443, 0},
+      {"GET", "api.example.com", "/api/v1/users/42", 443, 0},
+      {"GET", "www.example.com", "/api/v1/users", 443, 0},
+      {"GET", "www.example.com", "/login", 80, 0},
+      {"GET", "www.example.com", "/favicon.ico", 443, 0},
+      {"DELETE", "www.example.com", "/", 443, 0},
+      {"GET", "www.example.com", "/wp-login.php", 443, 0},
+      {"HEAD", "other.example.com", "/robots.txt", 8080, 0},
+      {"GET", "api.example.com", "/api/internal", 8080, 0},
+  };
+
+  FlowNumber checksum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < requestCount; ++i) {
+    Request& request = requests[i % requests.size()];
+    vm::RunnerPtr runner = main->createRunner();
+    runner->setUserData(&request);
+    runner->run();
+    checksum += request.status;
+  }
+  auto duration = std::chrono::steady_clock::now() - start;
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration);
+
+  printf("%d requests, %zu instructions: %.1f ns/request (checksum %lld)\n",
+         requestCount, main->code().size(),
+         static_cast<double>(ns.count()) / requestCount,
+         static_cast<long long>(checksum));
+
+  return 0;
+}
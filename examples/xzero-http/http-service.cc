@@ -116,6 +116,8 @@ class MyHandler : public xzero::HttpService::Handler {
     }
 
     if (request->path() == "/welcome") {
+      // pushed on HTTP/2, announced by 103 Early Hints on HTTP/1.1
+      response->pushResource("/base.css");
       response->setStatus(xzero::HttpStatus::Ok);
       response->addHeader("Content-Type", "text/html");
       response->output()->write("<html>\n"
@@ -143,6 +145,7 @@ int main(int argc, const char* argv[]) {
                             xzero::TimeSpan::fromSeconds(10),
                             xzero::TimeSpan::Zero,
                             xzero::IPAddress("0.0.0.0"), 3000);
+  httpService.enableHttp2();
   httpService.addHandler(&myHandler);
   httpService.addHandler(&builtinAssets);
 
@@ -21,6 +21,7 @@
 #include <xzero-http/HttpOutput.h>
 #include <xzero-http/HttpOutputCompressor.h>
 #include <xzero-http/HttpFileHandler.h>
+#include <xzero-http/HttpFileCache.h>
 #include <xzero-http/http1/Http1ConnectionFactory.h>
 
 #include <iostream>
@@ -75,7 +76,12 @@ int main(int argc, const char* argv[]) {
 
   xzero::MimeTypes mimetypes("/etc/mime.types", "application/octet-stream");
   xzero::LocalFileRepository localFiles(mimetypes, "/", true, true, true);
+  localFiles.setCache(1024, xzero::TimeSpan::fromSeconds(60));
   xzero::HttpFileHandler fileHandler(localFiles);
+  fileHandler.setPrecompressed(true);
+
+  xzero::HttpFileCache fileCache(64 * 1024 * 1024, 64 * 1024);
+  fileHandler.setCache(&fileCache);
 
   http->setHandler([&](xzero::HttpRequest* request, xzero::HttpResponse* response) {
     if (!fileHandler.handle(request, response, docroot)) {
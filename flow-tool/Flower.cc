@@ -19,11 +19,13 @@
 #include <xzero-flow/ir/ConstantArray.h>
 #include <xzero-flow/ir/ConstantValue.h>
 #include <xzero-flow/ir/PassManager.h>
+#include <xzero-flow/transform/ConstantFoldingPass.h>
 #include <xzero-flow/transform/EmptyBlockElimination.h>
 #include <xzero-flow/transform/InstructionElimination.h>
 #include <xzero-flow/transform/UnusedBlockPass.h>
 #include <xzero-flow/vm/Runtime.h>
 #include <xzero-flow/vm/NativeCallback.h>
+#include <xzero-flow/vm/ProgramImage.h>
 #include <xzero-flow/vm/Runner.h>
 #include <fstream>
 #include <memory>
@@ -57,7 +59,8 @@ Flower::Flower()
       totalFailed_(0),
       dumpAST_(false),
       dumpIR_(false),
-      dumpTarget_(false) {
+      dumpTarget_(false),
+      optimizationLevel_(1) {
 
   // properties
   registerFunction("cwd", flow::FlowType::String)
@@ -185,7 +188,7 @@ bool Flower::onParseComplete(flow::Unit* unit) {
   return true;
 }
 
-int Flower::runAll(const char* fileName) {
+std::unique_ptr<flow::Unit> Flower::parse(const char* fileName) {
   filename_ = fileName;
 
   flow::FlowParser parser(this);
@@ -193,7 +196,7 @@ int Flower::runAll(const char* fileName) {
   parser.importHandler = [&](const std::string& name,
                              const std::string& basedir,
                              std::vector<flow::vm::NativeCallback*>*)
-                             ->bool {
+                             -> bool {
     fprintf(stderr, "parser.importHandler('%s', '%s')\n", name.c_str(),
             basedir.c_str());
     return false;
@@ -201,13 +204,13 @@ int Flower::runAll(const char* fileName) {
 
   if (!parser.open(fileName)) {
     fprintf(stderr, "Failed to open file: %s\n", fileName);
-    return -1;
+    return nullptr;
   }
 
   std::unique_ptr<flow::Unit> unit = parser.parse();
   if (!unit) {
     fprintf(stderr, "Failed to parse file: %s\n", fileName);
-    return -1;
+    return nullptr;
   }
 
   onParseComplete(unit.get());
@@ -215,6 +218,13 @@ int Flower::runAll(const char* fileName) {
   if (dumpAST_)
     flow::ASTPrinter::print(unit.get());
 
+  return unit;
+}
+
+int Flower::runAll(const char* fileName) {
+  std::unique_ptr<flow::Unit> unit = parse(fileName);
+  if (!unit) return -1;
+
   if (!compile(unit.get())) return -1;
 
   for (auto handler : program_->handlers()) {
@@ -273,7 +283,8 @@ bool Flower::compile(flow::Unit* unit) {
     pm.registerPass(std::make_unique<flow::UnusedBlockPass>());
 
     // optional optimization passes
-    if (1) {
+    if (optimizationLevel_ >= 1) {
+      pm.registerPass(std::make_unique<flow::ConstantFoldingPass>());
       pm.registerPass(std::make_unique<flow::EmptyBlockElimination>());
       pm.registerPass(std::make_unique<flow::InstructionElimination>());
     }
@@ -314,44 +325,72 @@ int Flower::run(const char* fileName, const char* handlerName) {
     return -1;
   }
 
-  filename_ = fileName;
+  std::unique_ptr<flow::Unit> unit = parse(fileName);
+  if (!unit) return -1;
 
-  flow::FlowParser parser(this);
+  flow::Handler* handlerSym = unit->findHandler(handlerName);
+  if (!handlerSym) {
+    fprintf(stderr, "No handler with name '%s' found in unit '%s'.\n",
+            handlerName, fileName);
+    return -1;
+  }
 
-  parser.importHandler = [&](const std::string& name,
-                             const std::string& basedir,
-                             std::vector<flow::vm::NativeCallback*>*)
-                             -> bool {
-    fprintf(stderr, "parser.importHandler('%s', '%s')\n", name.c_str(),
-            basedir.c_str());
-    return false;
-  };
+  if (!compile(unit.get())) return -1;
 
-  if (!parser.open(fileName)) {
-    fprintf(stderr, "Failed to open file: %s\n", fileName);
+  return runHandler(handlerName);
+}
+
+int Flower::save(const char* fileName, const char* imageName) {
+  std::unique_ptr<flow::Unit> unit = parse(fileName);
+  if (!unit) return -1;
+
+  if (!compile(unit.get())) return -1;
+
+  std::string errorMessage;
+  if (!flow::vm::ProgramImage::save(*program_, imageName, &errorMessage)) {
+    fprintf(stderr, "Failed to write program image %s: %s\n", imageName,
+            errorMessage.c_str());
     return -1;
   }
 
-  std::unique_ptr<flow::Unit> unit = parser.parse();
-  if (!unit) {
-    fprintf(stderr, "Failed to parse file: %s\n", fileName);
+  return 0;
+}
+
+int Flower::runImage(const char* imageName, const char* handlerName) {
+  filename_ = imageName;
+
+  std::string errorMessage;
+  program_ = flow::vm::ProgramImage::load(imageName, &errorMessage);
+  if (!program_) {
+    fprintf(stderr, "Failed to load program image %s: %s\n", imageName,
+            errorMessage.c_str());
     return -1;
   }
 
-  onParseComplete(unit.get());
+  if (!program_->link(this)) {
+    fprintf(stderr, "Program linking failed. Aborting.\n");
+    return -1;
+  }
 
-  if (dumpAST_)
-    flow::ASTPrinter::print(unit.get());
+  if (dumpTarget_) {
+    program_->dump();
+  }
 
-  flow::Handler* handlerSym = unit->findHandler(handlerName);
-  if (!handlerSym) {
-    fprintf(stderr, "No handler with name '%s' found in unit '%s'.\n",
-            handlerName, fileName);
+  if (!handlerName || !*handlerName) {
+    printf("No handler specified.\n");
     return -1;
   }
 
-  if (!compile(unit.get())) return -1;
+  if (!program_->findHandler(handlerName)) {
+    fprintf(stderr, "No handler with name '%s' found in image '%s'.\n",
+            handlerName, imageName);
+    return -1;
+  }
+
+  return runHandler(handlerName);
+}
 
+int Flower::runHandler(const char* handlerName) {
   flow::vm::Handler* handler = program_->findHandler(handlerName);
   assert(handler != nullptr);
 
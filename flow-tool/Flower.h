@@ -36,6 +36,7 @@ class Flower : public flow::vm::Runtime {
   bool dumpAST_;
   bool dumpIR_;
   bool dumpTarget_;
+  int optimizationLevel_;
 
  public:
   Flower();
@@ -44,8 +45,8 @@ class Flower : public flow::vm::Runtime {
   virtual bool import(const std::string& name, const std::string& path,
                       std::vector<flow::vm::NativeCallback*>* builtins);
 
-  int optimizationLevel() { return 0; }
-  void setOptimizationLevel(int val) {}
+  int optimizationLevel() { return optimizationLevel_; }
+  void setOptimizationLevel(int val) { optimizationLevel_ = val; }
 
   void setDumpAST(bool value) { dumpAST_ = value; }
   void setDumpIR(bool value) { dumpIR_ = value; }
@@ -53,11 +54,15 @@ class Flower : public flow::vm::Runtime {
 
   int run(const char* filename, const char* handler);
   int runAll(const char* filename);
+  int save(const char* filename, const char* imageName);
+  int runImage(const char* imageName, const char* handler);
   void dump();
 
  private:
+  std::unique_ptr<flow::Unit> parse(const char* filename);
   bool onParseComplete(flow::Unit* unit);
   bool compile(flow::Unit* unit);
+  int runHandler(const char* handler);
 
   // functions
   void flow_print(flow::vm::Params& args);
@@ -10,6 +10,8 @@
 #include <xzero-flow/ASTPrinter.h>
 #include <xzero-flow/FlowLexer.h>
 #include <xzero-flow/FlowParser.h>
+#include <xzero-flow/vm/Handler.h>
+#include <xzero-flow/sysconfig.h>
 #include <fstream>
 #include <memory>
 #include <cstdio>
@@ -21,8 +23,8 @@ using namespace flow;
 
 int usage(const char* program) {
   printf(
-      "usage: %s [-h] [-t] [-l] [-s] [-L] [-A] [-I] [-T] [-e entry_point] "
-      "filename\n"
+      "usage: %s [-h] [-t] [-l] [-s] [-L] [-A] [-I] [-T] [-c image] "
+      "[-j runs] [-e entry_point] filename\n"
       "\n"
       "    -h      prints this help\n"
       "    -L      Dump lexical output and exit\n"
@@ -34,6 +36,10 @@ int usage(const char* program) {
       "    -On     set optimization level, with n ranging from 0 (no "
       "optimization) to 4 (maximum).\n"
       "    -t      enables unit-test mode\n"
+      "    -c      compile filename into the given program image and exit\n"
+      "    -l      load filename as program image instead of compiling it\n"
+      "    -j      compile handlers to native code after the given number of "
+      "runs\n"
       "\n",
       program);
   return 0;
@@ -99,6 +105,8 @@ int main(int argc, const char* argv[]) {
   Flower flower;
   bool testMode = false;
   bool lexMode = false;
+  bool imageMode = false;
+  const char* imageName = NULL;
   int opt;
   int rv = 0;
 
@@ -112,7 +120,7 @@ int main(int argc, const char* argv[]) {
   }
 #endif
 
-  while ((opt = getopt(argc, (char**)argv, "tO:hAILTe:")) != -1) {
+  while ((opt = getopt(argc, (char**)argv, "tO:hAILTc:lj:e:")) != -1) {
     switch (opt) {
       case 'h':
         usage(argv[0]);
@@ -135,6 +143,20 @@ int main(int argc, const char* argv[]) {
       case 'O':
         flower.setOptimizationLevel(atoi(optarg));
         break;
+      case 'c':
+        imageName = optarg;
+        break;
+      case 'l':
+        imageMode = true;
+        break;
+      case 'j':
+#if defined(ENABLE_FLOW_JIT)
+        vm::Handler::setJitThreshold(atoi(optarg));
+#else
+        fprintf(stderr, "Warning: JIT compilation is not supported by this "
+                        "build. Ignoring -j.\n");
+#endif
+        break;
       case 'e':
         handlerName = optarg;
         break;
@@ -156,9 +178,13 @@ int main(int argc, const char* argv[]) {
 
     if (lexMode) return lexdump(fileName);
 
+    if (imageName) return flower.save(fileName, imageName) == 0 ? 0 : 1;
+
     if (testMode) {
       printf("%s:\n", fileName);
       rv = flower.runAll(fileName);
+    } else if (imageMode) {
+      flower.runImage(fileName, handlerName);
     } else {
       flower.run(fileName, handlerName);
     }
@@ -124,6 +124,19 @@ TEST(BufferBase, toBool) {
   ASSERT_TRUE(!BufferRef("BLAH").toBool());
 }
 
+TEST(BufferBase, ordering) {
+  ASSERT_TRUE(BufferRef("abc") < BufferRef("abd"));
+  ASSERT_TRUE(BufferRef("ab") < BufferRef("abc"));
+  ASSERT_TRUE(BufferRef("") < BufferRef("a"));
+  ASSERT_FALSE(BufferRef("abc") < BufferRef("abc"));
+  ASSERT_FALSE(BufferRef("abd") < BufferRef("abc"));
+
+  ASSERT_TRUE(BufferRef("abd") > BufferRef("abc"));
+  ASSERT_TRUE(BufferRef("abc") <= BufferRef("abc"));
+  ASSERT_TRUE(BufferRef("abc") >= BufferRef("abc"));
+  ASSERT_FALSE(BufferRef("abc") >= BufferRef("abd"));
+}
+
 TEST(BufferBase, iterator) {
   BufferRef b("Hello");
   BufferRef::iterator i = b.begin();
@@ -11,6 +11,7 @@
 
 #include <xzero-base/Api.h>
 #include <xzero-base/sysconfig.h>
+#include <algorithm>
 #include <cstddef>
 #include <climits>
 #include <cstring>
@@ -260,6 +261,22 @@ template <typename T, typename PodType, std::size_t N>
 bool operator!=(PodType (&b)[N], const BufferBase<T>& a) {
   return !(a == b);
 }
+
+template <typename T>
+bool operator<(const BufferBase<T>& a, const BufferBase<T>& b);
+
+template <typename T>
+bool operator>(const BufferBase<T>& a, const BufferBase<T>& b) {
+  return b < a;
+}
+template <typename T>
+bool operator<=(const BufferBase<T>& a, const BufferBase<T>& b) {
+  return !(b < a);
+}
+template <typename T>
+bool operator>=(const BufferBase<T>& a, const BufferBase<T>& b) {
+  return !(a < b);
+}
 // }}}
 // {{{ BufferRef
 /**
@@ -1148,6 +1165,17 @@ inline bool operator==(PodType (&a)[N], const BufferBase<T>& b) {
   return equals<T, PodType, N>(b, a);
 }
 
+/**
+ * Compares the bytes of @p a and @p b lexicographically, like
+ * std::string's ordering.
+ */
+template <typename T>
+inline bool operator<(const BufferBase<T>& a, const BufferBase<T>& b) {
+  const size_t n = std::min(a.size(), b.size());
+  const int rc = n != 0 ? std::memcmp(a.data(), b.data(), n) : 0;
+  return rc < 0 || (rc == 0 && a.size() < b.size());
+}
+
 inline void immutableEnsure(void* self, size_t size) {
   MutableBuffer<immutableEnsure>* buffer =
       (MutableBuffer<immutableEnsure>*)self;
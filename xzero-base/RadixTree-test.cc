@@ -0,0 +1,126 @@
+// This file is part of the "libxzero" project
+//   (c) 2009-2015 Christian Parpart <https://github.com/christianparpart>
+//   (c) 2014-2015 Paul Asmuth <https://github.com/paulasmuth>
+//
+// libxzero is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Affero General Public License v3.0.
+// You should have received a copy of the GNU Affero General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include <xzero-base/RadixTree.h>
+#include <xzero-base/PrefixTree.h>
+#include <xzero-base/SuffixTree.h>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace xzero;
+
+TEST(RadixTree, LongestPrefix) {
+  RadixTree<std::string, int> tree;
+  tree.insert("/", 1);
+  tree.insert("/api", 2);
+  tree.insert("/api/v2/", 3);
+  tree.insert("/about", 4);
+  tree.build();
+
+  int value = 0;
+  EXPECT_TRUE(tree.lookup("/api/v2/users", &value));
+  EXPECT_EQ(3, value);
+  EXPECT_TRUE(tree.lookup("/api/v1/users", &value));
+  EXPECT_EQ(2, value);
+  EXPECT_TRUE(tree.lookup("/abo", &value));
+  EXPECT_EQ(1, value);
+  EXPECT_TRUE(tree.lookup("/about", &value));
+  EXPECT_EQ(4, value);
+  EXPECT_FALSE(tree.lookup("api", &value));
+  EXPECT_FALSE(tree.lookup("", &value));
+}
+
+TEST(RadixTree, LongestSuffix) {
+  RadixTree<std::string, int, true> tree;
+  tree.insert(".gz", 1);
+  tree.insert(".tar.gz", 2);
+  tree.insert(".html", 3);
+  tree.build();
+
+  int value = 0;
+  EXPECT_TRUE(tree.lookup("foo.tar.gz", &value));
+  EXPECT_EQ(2, value);
+  EXPECT_TRUE(tree.lookup("foo.gz", &value));
+  EXPECT_EQ(1, value);
+  EXPECT_TRUE(tree.lookup("index.html", &value));
+  EXPECT_EQ(3, value);
+  EXPECT_FALSE(tree.lookup("index.htm", &value));
+}
+
+TEST(RadixTree, ReinsertReplaces) {
+  RadixTree<std::string, int> tree;
+  tree.insert("/a", 1);
+  tree.insert("/a", 2);
+  tree.build();
+
+  int value = 0;
+  EXPECT_TRUE(tree.lookup("/ab", &value));
+  EXPECT_EQ(2, value);
+}
+
+TEST(RadixTree, Empty) {
+  RadixTree<std::string, int> tree;
+  int value = 0;
+  EXPECT_FALSE(tree.lookup("/", &value));
+
+  tree.build();
+  EXPECT_FALSE(tree.lookup("/", &value));
+  EXPECT_EQ(1, tree.nodeCount());
+}
+
+static std::string randomPath(std::mt19937& rng) {
+  static const char* segments[] = {"api", "v1", "v2", "users", "static",
+                                   "img", "css", "js", "a", "ab", "abc"};
+  std::string path;
+  for (int i = 0, e = 1 + rng() % 5; i < e; ++i) {
+    path += "/";
+    path += segments[rng() % (sizeof(segments) / sizeof(*segments))];
+  }
+  if (rng() % 2)
+    path += "/";
+  return path;
+}
+
+TEST(RadixTree, SameAsPrefixAndSuffixTree) {
+  std::mt19937 rng(42);
+  PrefixTree<std::string, int> prefixTree;
+  SuffixTree<std::string, int> suffixTree;
+  RadixTree<std::string, int> prefixRadix;
+  RadixTree<std::string, int, true> suffixRadix;
+
+  for (int i = 1; i <= 2000; ++i) {
+    std::string key = randomPath(rng);
+    prefixTree.insert(key, i);
+    suffixTree.insert(key, i);
+    prefixRadix.insert(key, i);
+    suffixRadix.insert(key, i);
+  }
+  prefixRadix.build();
+  suffixRadix.build();
+
+  for (int i = 0; i < 5000; ++i) {
+    std::string input = randomPath(rng);
+    int expected = 0;
+    int actual = 0;
+
+    bool found = prefixTree.lookup(input, &expected);
+    ASSERT_EQ(found, prefixRadix.lookup(input, &actual)) << input;
+    if (found) {
+      ASSERT_EQ(expected, actual) << input;
+    }
+
+    found = suffixTree.lookup(input, &expected);
+    ASSERT_EQ(found, suffixRadix.lookup(input, &actual)) << input;
+    if (found) {
+      ASSERT_EQ(expected, actual) << input;
+    }
+  }
+}
@@ -0,0 +1,230 @@
+// This file is part of the "libxzero" project
+//   (c) 2009-2015 Christian Parpart <https://github.com/christianparpart>
+//   (c) 2014-2015 Paul Asmuth <https://github.com/paulasmuth>
+//
+// libxzero is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Affero General Public License v3.0.
+// You should have received a copy of the GNU Affero General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace xzero {
+
+/**
+ * Immutable, path-compressed trie of byte strings for longest-match lookups.
+ *
+ * Keys are first collected by insert() and then compiled into flat arrays
+ * by build(), after which lookup() can be used:
+ *
+ * <ul>
+ *   <li>every node's edge label is a slice of one shared label string,</li>
+ *   <li>the children of a node are stored next to each other, sorted by the
+ *       first byte of their label, and</li>
+ *   <li>those first bytes are also kept in a separate contiguous array, so
+ *       that a child is found by a single @c memchr() over a few bytes.</li>
+ * </ul>
+ *
+ * This replaces chasing one heap allocated node and hash map per character,
+ * as PrefixTree and SuffixTree do, by a few cache-friendly array scans.
+ *
+ * @param K key type, a contiguous sequence of bytes such as BufferRef.
+ * @param V value type.
+ * @param Reverse whether keys are matched from their end (suffix matching)
+ *                rather than from their beginning (prefix matching).
+ */
+template <typename K, typename V, bool Reverse = false>
+class RadixTree {
+ public:
+  typedef K Key;
+  typedef V Value;
+
+  RadixTree();
+
+  /**
+   * Adds @p key to the set of keys to be built.
+   *
+   * Inserting a key again replaces its value. Empty keys never match.
+   */
+  void insert(const Key& key, const Value& value);
+
+  /**
+   * Compiles the inserted keys for lookup.
+   *
+   * Keys inserted afterwards are only seen after building again.
+   */
+  void build();
+
+  /**
+   * Finds the longest inserted key that is a prefix (or suffix, if
+   * @p Reverse) of @p key.
+   *
+   * @retval true a key matched and its value was stored in @p value.
+   * @retval false no key matched.
+   */
+  bool lookup(const Key& key, Value* value) const;
+
+  /** Number of nodes in the built tree, including the root. */
+  size_t nodeCount() const { return nodes_.size(); }
+
+ private:
+  struct Node {
+    uint32_t label;       //!< offset of the edge label into labels_
+    uint32_t length;      //!< length of the edge label
+    uint32_t firstChild;  //!< index of the first child into nodes_
+    uint32_t childCount;  //!< number of children
+    int32_t value;        //!< index into values_, or -1
+  };
+
+  static char at(const char* data, size_t size, size_t i) {
+    return Reverse ? data[size - 1 - i] : data[i];
+  }
+
+ private:
+  std::map<std::string, Value> pending_;  //!< inserted keys, in match order
+  std::vector<Node> nodes_;
+  std::vector<char> edges_;  //!< first label byte of each node, by index
+  std::string labels_;
+  std::vector<Value> values_;
+};
+
+// {{{
+template <typename K, typename V, bool Reverse>
+RadixTree<K, V, Reverse>::RadixTree()
+    : pending_(), nodes_(), edges_(), labels_(), values_() {
+}
+
+template <typename K, typename V, bool Reverse>
+void RadixTree<K, V, Reverse>::insert(const Key& key, const Value& value) {
+  if (key.size() == 0)
+    return;
+
+  std::string s(key.data(), key.size());
+  if (Reverse)
+    std::reverse(s.begin(), s.end());
+
+  pending_[s] = value;
+}
+
+template <typename K, typename V, bool Reverse>
+void RadixTree<K, V, Reverse>::build() {
+  std::vector<std::pair<std::string, Value>> keys(pending_.begin(),
+                                                  pending_.end());
+  nodes_.clear();
+  edges_.clear();
+  labels_.clear();
+  values_.clear();
+
+  // Nodes are laid out breadth first, so that siblings are adjacent.
+  // Each node covers the sorted range of keys [begin, end), all sharing
+  // the first `depth` bytes, which were consumed by its ancestors.
+  struct Range {
+    size_t begin;
+    size_t end;
+    size_t depth;
+  };
+
+  std::vector<Range> ranges;
+  nodes_.push_back(Node{0, 0, 0, 0, -1});
+  edges_.push_back('\0');
+  ranges.push_back(Range{0, keys.size(), 0});
+
+  for (size_t n = 0; n < nodes_.size(); ++n) {
+    const Range range = ranges[n];
+    size_t depth = range.depth;
+
+    // the root has no label, all other nodes span the common prefix of
+    // their keys
+    if (n != 0) {
+      const std::string& first = keys[range.begin].first;
+      const std::string& last = keys[range.end - 1].first;
+      size_t end = depth + 1;
+      while (end < first.size() && end < last.size() &&
+             first[end] == last[end])
+        ++end;
+
+      nodes_[n].label = static_cast<uint32_t>(labels_.size());
+      nodes_[n].length = static_cast<uint32_t>(end - depth);
+      labels_.append(first, depth, end - depth);
+      depth = end;
+    }
+
+    size_t i = range.begin;
+    if (i != range.end && keys[i].first.size() == depth) {
+      nodes_[n].value = static_cast<int32_t>(values_.size());
+      values_.push_back(keys[i].second);
+      ++i;
+    }
+
+    nodes_[n].firstChild = static_cast<uint32_t>(nodes_.size());
+    while (i != range.end) {
+      const char edge = keys[i].first[depth];
+      size_t k = i + 1;
+      while (k != range.end && keys[k].first[depth] == edge)
+        ++k;
+
+      nodes_.push_back(Node{0, 0, 0, 0, -1});
+      edges_.push_back(edge);
+      ranges.push_back(Range{i, k, depth});
+      nodes_[n].childCount++;
+      i = k;
+    }
+  }
+}
+
+template <typename K, typename V, bool Reverse>
+bool RadixTree<K, V, Reverse>::lookup(const Key& key, Value* value) const {
+  if (nodes_.empty())
+    return false;  // not built yet
+
+  const char* data = key.data();
+  const size_t size = key.size();
+  const Node* node = &nodes_[0];
+  size_t pos = 0;
+  int32_t found = -1;
+
+  for (;;) {
+    if (node->length > size - pos)
+      break;
+
+    const char* label = labels_.data() + node->label;
+    size_t i = 0;
+    while (i != node->length && label[i] == at(data, size, pos + i))
+      ++i;
+
+    if (i != node->length)
+      break;
+
+    pos += node->length;
+
+    if (node->value >= 0)
+      found = node->value;
+
+    if (pos == size || node->childCount == 0)
+      break;
+
+    const char* edges = edges_.data() + node->firstChild;
+    const void* edge = memchr(edges, at(data, size, pos), node->childCount);
+    if (!edge)
+      break;
+
+    const size_t child = static_cast<const char*>(edge) - edges;
+    node = &nodes_[node->firstChild + child];
+  }
+
+  if (found < 0)
+    return false;
+
+  *value = values_[found];
+  return true;
+}
+// }}}
+
+}  // namespace xzero
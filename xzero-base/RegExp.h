@@ -41,6 +41,9 @@ class XZERO_API RegExp {
   bool match(const char* cstring, Result* result = nullptr) const;
 
   const std::string& pattern() const { return pattern_; }
+
+  /** Tests whether the pattern compiled, and thus can match anything. */
+  bool isValid() const { return re_ != nullptr; }
   const char* c_str() const;
 
   operator const std::string&() const { return pattern_; }
@@ -0,0 +1,108 @@
+// This file is part of the "libxzero" project
+//   (c) 2009-2015 Christian Parpart <https://github.com/christianparpart>
+//   (c) 2014-2015 Paul Asmuth <https://github.com/paulasmuth>
+//
+// libxzero is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Affero General Public License v3.0.
+// You should have received a copy of the GNU Affero General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include <xzero-base/RegExpSet.h>
+#include <cstring>
+#include <string>
+
+using namespace xzero;
+
+static int match(const RegExpSet& set, const char* input,
+                 RegExp::Result* result = nullptr) {
+  return set.match(input, strlen(input), result);
+}
+
+static std::string group(const RegExp::Result& result, size_t i) {
+  return std::string(result[i].first, result[i].second);
+}
+
+TEST(RegExpSet, FirstMatchWins) {
+  RegExpSet set({"^/api/", "\\.php$", "/api/v2", "."});
+  ASSERT_TRUE(set.isCombined());
+
+  EXPECT_EQ(0, match(set, "/api/v2/index.php"));
+  EXPECT_EQ(1, match(set, "/index.php"));
+  EXPECT_EQ(2, match(set, "/old/api/v2"));
+  EXPECT_EQ(3, match(set, "/"));
+  EXPECT_EQ(-1, match(set, ""));
+}
+
+TEST(RegExpSet, EarlierPatternMatchingLaterInInput) {
+  // sequential semantics: "b" matches even though "a" matches further left
+  RegExpSet set({"b", "a"});
+  ASSERT_TRUE(set.isCombined());
+
+  RegExp::Result result;
+  EXPECT_EQ(0, match(set, "ab", &result));
+  ASSERT_EQ(1, result.size());
+  EXPECT_EQ("b", group(result, 0));
+}
+
+TEST(RegExpSet, CaptureGroups) {
+  RegExpSet set({"^/user/(\\d+)$", "^/([a-z]+)/(\\d+)(x)?"});
+  ASSERT_TRUE(set.isCombined());
+
+  RegExp::Result result;
+  EXPECT_EQ(0, match(set, "/user/42", &result));
+  ASSERT_EQ(2, result.size());
+  EXPECT_EQ("/user/42", group(result, 0));
+  EXPECT_EQ("42", group(result, 1));
+
+  EXPECT_EQ(1, match(set, "/blog/7/", &result));
+  ASSERT_EQ(3, result.size());
+  EXPECT_EQ("/blog/7", group(result, 0));
+  EXPECT_EQ("blog", group(result, 1));
+  EXPECT_EQ("7", group(result, 2));
+
+  EXPECT_EQ(-1, match(set, "nope", &result));
+  ASSERT_EQ(1, result.size());
+  EXPECT_EQ(0, result[0].second);
+}
+
+TEST(RegExpSet, SameResultAsRegExp) {
+  const char* patterns[] = {"^(a)(b)?(c)", "(x)|(y)", "  z  # comment"};
+  RegExpSet set({patterns[0], patterns[1], patterns[2]});
+  ASSERT_TRUE(set.isCombined());
+
+  for (const char* input : {"ac", "abc", "y", "xy", "z", "-"}) {
+    RegExp::Result expected;
+    int expectedIndex = -1;
+    for (int i = 0; i < 3 && expectedIndex < 0; ++i)
+      if (RegExp(patterns[i]).match(input, &expected))
+        expectedIndex = i;
+
+    RegExp::Result actual;
+    EXPECT_EQ(expectedIndex, match(set, input, &actual)) << input;
+    ASSERT_EQ(expected.size(), actual.size()) << input;
+    for (size_t i = 0; i < expected.size(); ++i) {
+      EXPECT_EQ(expected[i].second, actual[i].second) << input;
+      if (expected[i].second) {
+        EXPECT_EQ(expected[i].first, actual[i].first) << input;
+      }
+    }
+  }
+}
+
+TEST(RegExpSet, BackReferencesFallBack) {
+  RegExpSet set({"^(a)\\1$", "b"});
+  EXPECT_FALSE(set.isCombined());
+
+  EXPECT_EQ(0, match(set, "aa"));
+  EXPECT_EQ(1, match(set, "ab"));
+  EXPECT_EQ(-1, match(set, "a"));
+}
+
+TEST(RegExpSet, InlineOptionsStayCombined) {
+  RegExpSet set({"(?-i)^A$", "^a$"});
+  EXPECT_TRUE(set.isCombined());
+
+  EXPECT_EQ(0, match(set, "A"));
+  EXPECT_EQ(1, match(set, "a"));
+}
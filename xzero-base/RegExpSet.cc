@@ -0,0 +1,185 @@
+// This file is part of the "libxzero" project
+//   (c) 2009-2015 Christian Parpart <https://github.com/christianparpart>
+//   (c) 2014-2015 Paul Asmuth <https://github.com/paulasmuth>
+//
+// libxzero is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Affero General Public License v3.0.
+// You should have received a copy of the GNU Affero General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <xzero-base/RegExpSet.h>
+#include <xzero-base/Buffer.h>
+#include <algorithm>
+#include <cctype>
+#include <memory>
+#include <pcre.h>
+
+namespace xzero {
+
+RegExpSet::RegExpSet(const std::vector<std::string>& patterns)
+    : patterns_(),
+      branches_(),
+      groupCount_(0),
+      re_(nullptr) {
+  patterns_.reserve(patterns.size());
+  for (const std::string& pattern: patterns)
+    patterns_.emplace_back(pattern);
+
+  if (!compile())
+    branches_.clear();
+}
+
+RegExpSet::~RegExpSet() {
+  pcre_free(re_);
+}
+
+/**
+ * Tests whether @p pattern still works when its capture groups get
+ * renumbered, i.e. whether it does not refer to any group by number.
+ */
+bool RegExpSet::isRelocatable(const std::string& pattern) {
+  for (size_t i = 0, e = pattern.size(); i + 1 < e; ++i) {
+    const char c = pattern[i];
+    const char next = pattern[i + 1];
+
+    if (c == '\\') {
+      if ((next >= '1' && next <= '9') || next == 'g')
+        return false;  // back reference
+
+      ++i;  // skip escaped character
+    } else if (c == '(' && next == '?' && i + 2 < e) {
+      const char kind = pattern[i + 2];
+      const char arg = i + 3 < e ? pattern[i + 3] : '\0';
+      if (std::isdigit(kind) || kind == 'R' || kind == '(' ||
+          ((kind == '+' || kind == '-') && std::isdigit(arg)))
+        return false;  // subroutine call, recursion, or condition
+    }
+  }
+  return true;
+}
+
+bool RegExpSet::compile() {
+  if (patterns_.empty())
+    return false;
+
+  const int options = PCRE_CASELESS | PCRE_EXTENDED;
+  const char* errMsg = "";
+  int errOfs = 0;
+
+  std::string combined = "\\A(?:";
+  int group = 0;
+
+  for (const RegExp& pattern: patterns_) {
+    if (!isRelocatable(pattern.pattern()))
+      return false;
+
+    pcre* re = pcre_compile(pattern.c_str(), options, &errMsg, &errOfs, 0);
+    if (!re)
+      return false;
+
+    int groupCount = 0;
+    int rc = pcre_fullinfo(re, nullptr, PCRE_INFO_CAPTURECOUNT, &groupCount);
+    pcre_free(re);
+    if (rc != 0)
+      return false;
+
+    if (group != 0)
+      combined += "|";
+
+    // the newline terminates a trailing comment in extended mode
+    combined += "[\\s\\S]*?(";
+    combined += pattern.pattern();
+    combined += "\n)";
+
+    branches_.push_back(Branch{group + 1, groupCount});
+    group += 1 + groupCount;
+  }
+  combined += ")";
+
+  re_ = pcre_compile(combined.c_str(), options, &errMsg, &errOfs, 0);
+  if (!re_)
+    return false;
+
+  // a pattern might still have escaped its branch, e.g. by an open \Q
+  if (pcre_fullinfo(re_, nullptr, PCRE_INFO_CAPTURECOUNT, &groupCount_) != 0
+      || groupCount_ != group) {
+    pcre_free(re_);
+    re_ = nullptr;
+    return false;
+  }
+
+  return true;
+}
+
+int RegExpSet::match(const char* buffer, size_t size,
+                     RegExp::Result* result) const {
+  if (!re_)
+    return matchEach(buffer, size, result);
+
+  // avoid the heap for the common case of few capture groups
+  const size_t ovCount = 3 * (groupCount_ + 1);
+  int ovStack[3 * 36];
+  std::unique_ptr<int[]> ovHeap;
+  int* ov = ovStack;
+  if (ovCount > sizeof(ovStack) / sizeof(*ovStack)) {
+    ovHeap.reset(new int[ovCount]);
+    ov = ovHeap.get();
+  }
+
+  int rc = pcre_exec(re_, nullptr, buffer, size, 0, 0, ov, ovCount);
+
+  if (rc == PCRE_ERROR_NOMATCH) {
+    if (result) {
+      result->clear();
+      result->push_back(std::make_pair("", 0));
+    }
+    return -1;
+  }
+
+  // the combined pattern may fail where its parts would not, e.g. by
+  // hitting PCRE's match or recursion limit, so fall back to them
+  if (rc <= 0)
+    return matchEach(buffer, size, result);
+
+  // the first branch whose wrapping group is set is the one that matched
+  int index = 0;
+  while (branches_[index].group >= rc || ov[2 * branches_[index].group] < 0)
+    ++index;
+
+  if (result) {
+    const Branch& branch = branches_[index];
+    const int last = std::min(rc - 1, branch.group + branch.groupCount);
+
+    result->clear();
+    for (int i = branch.group; i <= last; ++i) {
+      if (ov[2 * i] >= 0) {
+        result->push_back(std::make_pair(buffer + ov[2 * i],
+                                         ov[2 * i + 1] - ov[2 * i]));
+      } else {
+        result->push_back(std::make_pair("", 0));
+      }
+    }
+  }
+
+  return index;
+}
+
+int RegExpSet::match(const BufferRef& buffer, RegExp::Result* result) const {
+  return match(buffer.data(), buffer.size(), result);
+}
+
+int RegExpSet::matchEach(const char* buffer, size_t size,
+                         RegExp::Result* result) const {
+  for (size_t i = 0, e = patterns_.size(); i != e; ++i)
+    if (patterns_[i].match(buffer, size, result))
+      return static_cast<int>(i);
+
+  if (result && patterns_.empty()) {
+    result->clear();
+    result->push_back(std::make_pair("", 0));
+  }
+
+  return -1;
+}
+
+}  // namespace xzero
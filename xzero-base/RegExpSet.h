@@ -0,0 +1,87 @@
+// This file is part of the "libxzero" project
+//   (c) 2009-2015 Christian Parpart <https://github.com/christianparpart>
+//   (c) 2014-2015 Paul Asmuth <https://github.com/paulasmuth>
+//
+// libxzero is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Affero General Public License v3.0.
+// You should have received a copy of the GNU Affero General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <xzero-base/Api.h>
+#include <xzero-base/RegExp.h>
+#include <pcre.h>
+#include <string>
+#include <vector>
+
+namespace xzero {
+
+class BufferRef;
+
+/**
+ * Ordered set of regular expressions, matched against an input at once.
+ *
+ * All patterns are compiled into a single PCRE alternation, where each
+ * branch is anchored at the start of the subject and lazily skips ahead to
+ * the pattern's own leftmost match:
+ *
+ * @code
+ *   \A(?: [\s\S]*?(p0) | [\s\S]*?(p1) | ... )
+ * @endcode
+ *
+ * Since PCRE tries the branches in order, this yields the same result as
+ * matching the patterns one after another and stopping at the first match,
+ * in a single @c pcre_exec() call. The matching branch is identified by its
+ * wrapping capture group, and the pattern's own capture groups are mapped
+ * back to their original numbers.
+ *
+ * Patterns referring to groups by number (such as back references) cannot
+ * be relocated into the alternation. Sets containing such patterns fall back
+ * to matching each pattern on its own.
+ */
+class XZERO_API RegExpSet {
+ public:
+  explicit RegExpSet(const std::vector<std::string>& patterns);
+  RegExpSet(const RegExpSet&) = delete;
+  RegExpSet& operator=(const RegExpSet&) = delete;
+  ~RegExpSet();
+
+  /** Number of patterns in this set. */
+  size_t size() const { return patterns_.size(); }
+
+  /** Whether the patterns are matched by one combined expression. */
+  bool isCombined() const { return re_ != nullptr; }
+
+  /**
+   * Finds the first pattern in this set matching the given input.
+   *
+   * @param buffer input to match against.
+   * @param size number of bytes in @p buffer.
+   * @param result optional output for the matching pattern's capture groups,
+   *               as RegExp::match() would fill it in.
+   *
+   * @return index of the first matching pattern, or @c -1 if none matches.
+   */
+  int match(const char* buffer, size_t size,
+            RegExp::Result* result = nullptr) const;
+  int match(const BufferRef& buffer, RegExp::Result* result = nullptr) const;
+
+ private:
+  struct Branch {
+    int group;       //!< number of the capture group wrapping this pattern
+    int groupCount;  //!< number of capture groups in the pattern itself
+  };
+
+  static bool isRelocatable(const std::string& pattern);
+  bool compile();
+  int matchEach(const char* buffer, size_t size, RegExp::Result* result) const;
+
+ private:
+  std::vector<RegExp> patterns_;
+  std::vector<Branch> branches_;
+  int groupCount_;  //!< total number of capture groups in re_
+  pcre* re_;
+};
+
+}  // namespace xzero
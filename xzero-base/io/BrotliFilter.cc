@@ -0,0 +1,62 @@
+// This file is part of the "libxzero" project
+//   (c) 2009-2015 Christian Parpart <https://github.com/christianparpart>
+//   (c) 2014-2015 Paul Asmuth <https://github.com/paulasmuth>
+//
+// libxzero is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Affero General Public License v3.0.
+// You should have received a copy of the GNU Affero General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <xzero-base/io/BrotliFilter.h>
+#include <xzero-base/Buffer.h>
+#include <xzero-base/sysconfig.h>
+#include <stdexcept>
+
+#if defined(HAVE_BROTLI_ENCODE_H)
+namespace xzero {
+
+BrotliFilter::BrotliFilter(int quality)
+    : state_(BrotliEncoderCreateInstance(nullptr, nullptr, nullptr)) {
+  if (!state_)
+    throw std::runtime_error("BrotliEncoderCreateInstance failed.");
+
+  if (!BrotliEncoderSetParameter(state_, BROTLI_PARAM_QUALITY, quality)) {
+    BrotliEncoderDestroyInstance(state_);
+    throw std::runtime_error("Invalid Brotli compression quality.");
+  }
+}
+
+BrotliFilter::~BrotliFilter() {
+  BrotliEncoderDestroyInstance(state_);
+}
+
+void BrotliFilter::filter(const BufferRef& input, Buffer* output, bool last) {
+  const BrotliEncoderOperation op = last ? BROTLI_OPERATION_FINISH
+                                         : BROTLI_OPERATION_FLUSH;
+
+  size_t availableIn = input.size();
+  const uint8_t* nextIn = reinterpret_cast<const uint8_t*>(input.data());
+
+  output->reserve(output->size() + input.size() + 64);
+
+  for (;;) {
+    size_t availableOut = output->capacity() - output->size();
+    uint8_t* nextOut = reinterpret_cast<uint8_t*>(output->end());
+
+    if (!BrotliEncoderCompressStream(state_, op, &availableIn, &nextIn,
+                                     &availableOut, &nextOut, nullptr))
+      throw std::runtime_error("Brotli compression failed.");
+
+    output->resize(output->capacity() - availableOut);
+
+    if (availableIn == 0 && !BrotliEncoderHasMoreOutput(state_) &&
+        (!last || BrotliEncoderIsFinished(state_)))
+      break;
+
+    if (output->size() == output->capacity())
+      output->reserve(output->capacity() + Buffer::CHUNK_SIZE);
+  }
+}
+
+} // namespace xzero
+#endif
@@ -0,0 +1,39 @@
+// This file is part of the "libxzero" project
+//   (c) 2009-2015 Christian Parpart <https://github.com/christianparpart>
+//   (c) 2014-2015 Paul Asmuth <https://github.com/paulasmuth>
+//
+// libxzero is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Affero General Public License v3.0.
+// You should have received a copy of the GNU Affero General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <xzero-base/Api.h>
+#include <xzero-base/io/Filter.h>
+#include <xzero-base/sysconfig.h>
+
+#if defined(HAVE_BROTLI_ENCODE_H)
+#include <brotli/encode.h>
+
+namespace xzero {
+
+/**
+ * Brotli encoding filter (RFC 7932).
+ */
+class XZERO_API BrotliFilter : public Filter {
+ public:
+  /**
+   * @param quality compression quality, from 0 (fastest) to 11 (best).
+   */
+  explicit BrotliFilter(int quality);
+  ~BrotliFilter();
+
+  void filter(const BufferRef& input, Buffer* output, bool last) override;
+
+ private:
+  BrotliEncoderState* state_;
+};
+
+} // namespace xzero
+#endif
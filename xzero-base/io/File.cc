@@ -8,6 +8,7 @@
 // along with this program. If not, see <http://www.gnu.org/licenses/>.
 
 #include <xzero-base/io/File.h>
+#include <xzero-base/io/FileDescriptor.h>
 #include <xzero-base/Buffer.h>
 #include <xzero-base/logging.h>
 #include <xzero-base/sysconfig.h>
@@ -62,6 +63,14 @@ const std::string& File::lastModified() const {
   return lastModified_;
 }
 
+std::shared_ptr<FileDescriptor> File::sharedHandle() {
+  int fd = createPosixChannel(Read | NonBlocking);
+  if (fd < 0)
+    return nullptr;
+
+  return std::make_shared<FileDescriptor>(fd);
+}
+
 int File::to_posix(OpenFlags oflags) {
   int flags = 0;
 
@@ -20,6 +20,7 @@
 namespace xzero {
 
 class MemoryMap;
+class FileDescriptor;
 
 /**
  * HTTP servable file.
@@ -78,6 +79,16 @@ class XZERO_API File {
    */
   virtual int createPosixChannel(OpenFlags oflags) = 0;
 
+  /**
+   * Retrieves a read-only file handle, that may be shared with other
+   * readers of this file.
+   *
+   * The default implementation opens a new one for each call.
+   *
+   * @return the handle, or @c nullptr with @c errno set on failure.
+   */
+  virtual std::shared_ptr<FileDescriptor> sharedHandle();
+
   /** Creates an input stream for given file. */
   virtual std::unique_ptr<std::istream> createInputChannel() = 0;
 
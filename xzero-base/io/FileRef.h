@@ -12,7 +12,9 @@
 #include <xzero-base/Api.h>
 #include <xzero-base/sysconfig.h>
 #include <xzero-base/Buffer.h>
+#include <xzero-base/io/FileDescriptor.h>
 #include <cstdint>
+#include <memory>
 #include <unistd.h>
 
 namespace xzero {
@@ -25,6 +27,8 @@ namespace xzero {
  *
  * If the FileRef was initialized with auto-close set to on, its
  * underlying resource file descriptor will be automatically closed.
+ * Alternatively, it can share ownership of a file descriptor with other
+ * FileRefs, which then gets closed along with the last of them.
  */
 class XZERO_API FileRef {
  private:
@@ -37,7 +41,8 @@ class XZERO_API FileRef {
       : fd_(ref.fd_),
         offset_(ref.offset_),
         size_(ref.size_),
-        close_(ref.close_) {
+        close_(ref.close_),
+        shared_(std::move(ref.shared_)) {
     ref.fd_ = -1;
     ref.close_ = false;
   }
@@ -48,6 +53,7 @@ class XZERO_API FileRef {
     offset_ = ref.offset_;
     size_ = ref.size_;
     close_ = ref.close_;
+    shared_ = std::move(ref.shared_);
 
     ref.fd_ = -1;
     ref.close_ = false;
@@ -65,7 +71,24 @@ class XZERO_API FileRef {
    *              object destruction.
    */
   FileRef(int fd, off_t offset, size_t size, bool close)
-      : fd_(fd), offset_(offset), size_(size), close_(close) {}
+      : fd_(fd), offset_(offset), size_(size), close_(close), shared_() {}
+
+  /**
+   * Initializes given FileRef with shared ownership of its file descriptor.
+   *
+   * The file descriptor must only be read from by positional I/O, such
+   * as @c pread() or @c sendfile() with an explicit offset.
+   *
+   * @param fd Underlying resource file descriptor.
+   * @param offset The offset to start reading from.
+   * @param size Number of bytes to read.
+   */
+  FileRef(std::shared_ptr<FileDescriptor> fd, off_t offset, size_t size)
+      : fd_(fd->get()),
+        offset_(offset),
+        size_(size),
+        close_(false),
+        shared_(std::move(fd)) {}
 
   /**
    * Conditionally closes the underlying resource file descriptor.
@@ -91,6 +114,7 @@ class XZERO_API FileRef {
   off_t offset_;
   size_t size_;
   bool close_;
+  std::shared_ptr<FileDescriptor> shared_;
 };
 
 } // namespace xzero
@@ -0,0 +1,258 @@
+// This file is part of the "libxzero" project
+//   (c) 2009-2015 Christian Parpart <https://github.com/christianparpart>
+//   (c) 2014-2015 Paul Asmuth <https://github.com/paulasmuth>
+//
+// libxzero is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Affero General Public License v3.0.
+// You should have received a copy of the GNU Affero General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include <xzero-base/io/GzipFilter.h>
+#include <xzero-base/io/BrotliFilter.h>
+#include <xzero-base/io/ZstdFilter.h>
+#include <xzero-base/Buffer.h>
+#include <xzero-base/sysconfig.h>
+#include <chrono>
+#include <cstdio>
+#include <zlib.h>
+
+#if defined(HAVE_BROTLI_ENCODE_H)
+#include <brotli/decode.h>
+#endif
+
+using namespace xzero;
+
+/**
+ * Builds a text corpus resembling typical web payloads (JSON and markup).
+ */
+static Buffer corpus(size_t size) {
+  static const char* words[] = {
+    "alpha", "beta", "gamma", "delta", "request", "response", "header",
+    "stream", "content", "encoding", "window", "frame", "value", "label",
+  };
+  Buffer result;
+  for (unsigned i = 0; result.size() < size; ++i) {
+    result.printf("{\"id\": %u, \"name\": \"%s %s\", \"weight\": %u},\n", i,
+                  words[i % 14], words[(i * 7) % 13], (i * 31) % 1000);
+    if (i % 8 == 0)
+      result.printf("<li class=\"item-%u\">%s</li>\n", i % 5, words[i % 11]);
+  }
+  result.resize(size);
+  return result;
+}
+
+/**
+ * Passes @p input through @p filter in chunks of @p chunkSize bytes.
+ */
+static Buffer encode(Filter* filter, const Buffer& input, size_t chunkSize) {
+  Buffer output;
+  for (size_t offset = 0; offset < input.size(); offset += chunkSize) {
+    size_t n = std::min(chunkSize, input.size() - offset);
+    bool last = offset + n == input.size();
+    filter->filter(input.ref(offset, n), &output, last);
+  }
+  return output;
+}
+
+static Buffer gunzip(const Buffer& input) {
+  z_stream z = {};
+  inflateInit2(&z, 15 + 16);
+  z.next_in = (Bytef*) input.data();
+  z.avail_in = input.size();
+
+  Buffer output;
+  int rv;
+  do {
+    output.reserve(output.size() + 65536);
+    z.next_out = (Bytef*) output.end();
+    z.avail_out = output.capacity() - output.size();
+    rv = inflate(&z, Z_NO_FLUSH);
+    output.resize(output.capacity() - z.avail_out);
+  } while (rv == Z_OK);
+  inflateEnd(&z);
+
+  EXPECT_EQ(Z_STREAM_END, rv);
+  return output;
+}
+
+TEST(GzipFilter, roundtrip) {
+  Buffer input = corpus(300 * 1024);
+  GzipFilter filter(9);
+  Buffer output = encode(&filter, input, 16 * 1024);
+
+  ASSERT_LT(output.size(), input.size());
+  ASSERT_EQ(input, gunzip(output));
+}
+
+TEST(GzipFilter, pooledContexts) {
+  Buffer input = corpus(64 * 1024);
+  size_t pooled = GzipFilter::pooledContexts();
+
+  for (int i = 0; i < 3; ++i) {
+    // a reset context must encode just like a fresh one
+    GzipFilter filter(6);
+    Buffer output = encode(&filter, input, 4096);
+    ASSERT_EQ(input, gunzip(output));
+  }
+
+  ASSERT_EQ(pooled + 1, GzipFilter::pooledContexts());
+
+  {
+    GzipFilter a(6);
+    GzipFilter b(6);
+    GzipFilter c(1);
+  }
+  ASSERT_EQ(pooled + 3, GzipFilter::pooledContexts());
+}
+
+/**
+ * A small JSON response and a dictionary made up of its shape, as it would
+ * have been trained on previous responses.
+ */
+static const char smallResponse[] =
+    "{\"id\": 4711, \"name\": \"request\", \"status\": \"active\", "
+    "\"created_at\": \"2015-03-12T11:29:02Z\", \"tags\": [\"http\"]}";
+
+static const char dictionary[] =
+    "{\"id\": , \"name\": \"\", \"status\": \"active\", "
+    "\"status\": \"inactive\", \"created_at\": \"2015-03-12T00:00:00Z\", "
+    "\"updated_at\": \"\", \"tags\": [\"request\", \"http\"]}";
+
+TEST(GzipFilter, dictionary) {
+  Buffer input(smallResponse);
+
+  GzipFilter plain(9);
+  Buffer plainOutput;
+  plain.filter(input.ref(), &plainOutput, true);
+
+  GzipFilter filter(9, BufferRef(dictionary));
+  Buffer output;
+  filter.filter(input.ref(), &output, true);
+
+  ASSERT_LT(output.size() * 2, plainOutput.size());
+
+  z_stream z = {};
+  inflateInit(&z);
+  char decoded[256];
+  z.next_in = (Bytef*) output.data();
+  z.avail_in = output.size();
+  z.next_out = (Bytef*) decoded;
+  z.avail_out = sizeof(decoded);
+  ASSERT_EQ(Z_NEED_DICT, inflate(&z, Z_FINISH));
+  ASSERT_EQ(Z_OK, inflateSetDictionary(&z, (const Bytef*) dictionary,
+                                       sizeof(dictionary) - 1));
+  ASSERT_EQ(Z_STREAM_END, inflate(&z, Z_FINISH));
+  inflateEnd(&z);
+
+  ASSERT_EQ(input, BufferRef(decoded, sizeof(decoded) - z.avail_out));
+}
+
+#if defined(HAVE_BROTLI_ENCODE_H)
+TEST(BrotliFilter, roundtrip) {
+  Buffer input = corpus(300 * 1024);
+  BrotliFilter filter(5);
+  Buffer output = encode(&filter, input, 16 * 1024);
+  ASSERT_LT(output.size(), input.size());
+
+  Buffer decoded;
+  decoded.reserve(input.size());
+  size_t decodedSize = decoded.capacity();
+  ASSERT_EQ(BROTLI_DECODER_RESULT_SUCCESS,
+            BrotliDecoderDecompress(output.size(), (uint8_t*) output.data(),
+                                    &decodedSize, (uint8_t*) decoded.data()));
+  decoded.resize(decodedSize);
+  ASSERT_EQ(input, decoded);
+}
+
+TEST(BrotliFilter, emptyLast) {
+  // the final call may come without any data, e.g. on end of response
+  Buffer input = corpus(1000);
+  BrotliFilter filter(5);
+  Buffer output;
+  filter.filter(input.ref(), &output, false);
+  filter.filter(BufferRef(), &output, true);
+
+  uint8_t decoded[2000];
+  size_t decodedSize = sizeof(decoded);
+  ASSERT_EQ(BROTLI_DECODER_RESULT_SUCCESS,
+            BrotliDecoderDecompress(output.size(), (uint8_t*) output.data(),
+                                    &decodedSize, decoded));
+  ASSERT_EQ(input, BufferRef((char*) decoded, decodedSize));
+}
+#endif
+
+#if defined(HAVE_ZSTD_H)
+TEST(ZstdFilter, roundtrip) {
+  Buffer input = corpus(300 * 1024);
+  ZstdFilter filter(3);
+  Buffer output = encode(&filter, input, 16 * 1024);
+  ASSERT_LT(output.size(), input.size());
+
+  Buffer decoded;
+  decoded.reserve(input.size());
+  size_t rv = ZSTD_decompress(decoded.data(), decoded.capacity(),
+                              output.data(), output.size());
+  ASSERT_FALSE(ZSTD_isError(rv));
+  decoded.resize(rv);
+  ASSERT_EQ(input, decoded);
+}
+
+TEST(ZstdFilter, dictionary) {
+  Buffer input(smallResponse);
+
+  ZstdFilter plain(3);
+  Buffer plainOutput;
+  plain.filter(input.ref(), &plainOutput, true);
+
+  ZstdFilter filter(3, BufferRef(dictionary));
+  Buffer output;
+  filter.filter(input.ref(), &output, true);
+  ASSERT_LT(output.size() * 2, plainOutput.size());
+
+  char decoded[256];
+  ZSTD_DCtx* dctx = ZSTD_createDCtx();
+  size_t rv = ZSTD_decompress_usingDict(dctx, decoded, sizeof(decoded),
+                                        output.data(), output.size(),
+                                        dictionary, sizeof(dictionary) - 1);
+  ZSTD_freeDCtx(dctx);
+  ASSERT_FALSE(ZSTD_isError(rv));
+  ASSERT_EQ(input, BufferRef(decoded, rv));
+}
+#endif
+
+template<typename T>
+static void benchmark(const char* label, int level, const Buffer& input) {
+  const int rounds = 10;
+  size_t outputSize = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; ++i) {
+    T filter(level);
+    outputSize = encode(&filter, input, 64 * 1024).size();
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  double micros = std::chrono::duration_cast<std::chrono::microseconds>(
+      end - start).count();
+  printf("%-6s level %2d: %7.1f MB/s, ratio %.3f\n",
+         label, level, input.size() * rounds / micros,
+         (double) outputSize / input.size());
+}
+
+TEST(Filter, DISABLED_benchmarkCorpus) {
+  Buffer input = corpus(4 * 1024 * 1024);
+
+  for (int level: {1, 6, 9})
+    benchmark<GzipFilter>("gzip", level, input);
+
+#if defined(HAVE_BROTLI_ENCODE_H)
+  for (int level: {1, 5, 9})
+    benchmark<BrotliFilter>("br", level, input);
+#endif
+
+#if defined(HAVE_ZSTD_H)
+  for (int level: {1, 3, 9})
+    benchmark<ZstdFilter>("zstd", level, input);
+#endif
+}
@@ -11,6 +11,7 @@
 #include <xzero-base/io/FileRef.h>
 #include <xzero-base/Buffer.h>
 #include <xzero-base/sysconfig.h>
+#include <algorithm>
 #include <stdexcept>
 #include <system_error>
 
@@ -41,13 +42,32 @@ void Filter::applyFilters(
     const std::list<std::shared_ptr<Filter>>& filters,
     const FileRef& file, Buffer* output, bool last) {
 
+  // feed the filters one window at a time rather than the file as a whole
+  static const size_t WindowSize = 64 * 1024;
+
   Buffer input;
-  file.fill(&input);
+  Buffer filtered;
+  size_t offset = 0;
+
+  do {
+    const size_t n = std::min(WindowSize, file.size() - offset);
+    const bool final = offset + n == file.size();
+
+    input.clear();
+    if (n > 0) {
+      FileRef window(file.handle(), file.offset() + offset, n, false);
+      window.fill(&input);
+
+      if (input.size() != n)
+        throw std::runtime_error("Could not read full input file.");
+    }
 
-  if (input.size() != file.size())
-    throw std::runtime_error("Could not read full input file.");
+    filtered.clear();
+    Filter::applyFilters(filters, input.ref(), &filtered, last && final);
+    output->push_back(filtered);
 
-  Filter::applyFilters(filters, input, output, last);
+    offset += n;
+  } while (offset < file.size());
 }
 
 } // namespace xzero
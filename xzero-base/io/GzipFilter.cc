@@ -11,34 +11,126 @@
 #include <xzero-base/Buffer.h>
 #include <xzero-base/sysconfig.h>
 #include <stdexcept>
+#include <unordered_map>
+#include <memory>
+#include <vector>
 #include <system_error>
 #include <zlib.h>
 
 namespace xzero {
 
-GzipFilter::GzipFilter(int level) {
-  z_.total_in = 0;
-  z_.total_out = 0;
-  z_.zalloc = Z_NULL;
-  z_.zfree = Z_NULL;
-  z_.opaque = Z_NULL;
+namespace {
+
+/**
+ * Per-thread free-list of reset zlib compression states, keyed by
+ * window bits and compression level.
+ */
+class ContextPool {
+ public:
+  ~ContextPool();
+
+  z_stream* acquire(int key);
+  void release(int key, z_stream* z);
+  size_t size() const;
+
+ private:
+  std::unordered_map<int, std::vector<z_stream*>> free_;
+};
+
+ContextPool::~ContextPool() {
+  for (auto& entry: free_) {
+    for (z_stream* z: entry.second) {
+      deflateEnd(z);
+      delete z;
+    }
+  }
+}
 
-  int wbits = 15 + 16;
+z_stream* ContextPool::acquire(int key) {
+  auto i = free_.find(key);
+  if (i == free_.end() || i->second.empty())
+    return nullptr;
 
-  int rv = deflateInit2(&z_,
+  z_stream* z = i->second.back();
+  i->second.pop_back();
+  return z;
+}
+
+void ContextPool::release(int key, z_stream* z) {
+  std::vector<z_stream*>& list = free_[key];
+  if (list.size() < GzipFilter::MaxPoolSize && deflateReset(z) == Z_OK) {
+    list.push_back(z);
+  } else {
+    deflateEnd(z);
+    delete z;
+  }
+}
+
+size_t ContextPool::size() const {
+  size_t n = 0;
+  for (const auto& entry: free_)
+    n += entry.second.size();
+  return n;
+}
+
+thread_local ContextPool contextPool;
+
+/**
+ * Retrieves a compression state for given window bits and level, either
+ * from the pool or newly initialized.
+ *
+ * Note, a z_stream must not move in memory once initialized, hence the
+ * heap allocation.
+ */
+z_stream* acquireContext(int key, int wbits, int level) {
+  if (z_stream* z = contextPool.acquire(key))
+    return z;
+
+  std::unique_ptr<z_stream> z(new z_stream);
+  z->total_in = 0;
+  z->total_out = 0;
+  z->zalloc = Z_NULL;
+  z->zfree = Z_NULL;
+  z->opaque = Z_NULL;
+
+  int rv = deflateInit2(z.get(),
                         level,        // compression level
                         Z_DEFLATED,   // method
-                        wbits,        // window bits (15=gzip compression,
+                        wbits,        // window bits (15=zlib compression,
                                       // 16=simple header, -15=raw deflate)
                         level,        // memory level (1..9)
                         Z_FILTERED);  // strategy
 
   if (rv != Z_OK)
     throw std::runtime_error("deflateInit2 failed.");
+
+  return z.release();
+}
+
+} // namespace
+
+GzipFilter::GzipFilter(int level)
+    : key_(((15 + 16) << 8) | level),
+      z_(acquireContext(key_, 15 + 16, level)) {
+}
+
+GzipFilter::GzipFilter(int level, const BufferRef& dictionary)
+    : key_((15 << 8) | level),
+      z_(acquireContext(key_, 15, level)) {
+  int rv = deflateSetDictionary(z_, (const Bytef*) dictionary.data(),
+                                dictionary.size());
+  if (rv != Z_OK) {
+    contextPool.release(key_, z_);
+    throw std::runtime_error("deflateSetDictionary failed.");
+  }
 }
 
 GzipFilter::~GzipFilter() {
-  deflateEnd(&z_);
+  contextPool.release(key_, z_);
+}
+
+size_t GzipFilter::pooledContexts() {
+  return contextPool.size();
 }
 
 std::string GzipFilter::z_code(int code) const {
@@ -81,23 +173,21 @@ void GzipFilter::filter(const BufferRef& input, Buffer* output, bool last) {
     expectedResult = Z_OK;
   }
 
-  z_.next_in = (Bytef*)input.cbegin();
-  z_.avail_in = input.size();
+  z_->next_in = (Bytef*)input.cbegin();
+  z_->avail_in = input.size();
 
   output->reserve(output->size() + input.size() * 1.1 + 12 + 18);
-  z_.next_out = (Bytef*)output->end();
-  z_.avail_out = output->capacity() - output->size();
-
-  do {
-    if (output->size() > output->capacity() / 2) {
-      output->reserve(output->capacity() + Buffer::CHUNK_SIZE);
-      z_.next_out = (Bytef*)output->end();
-      z_.avail_out = output->capacity() - output->size();
-    }
 
-    const int rv = deflate(&z_, mode);
+  for (;;) {
+    z_->next_out = (Bytef*)output->end();
+    z_->avail_out = output->capacity() - output->size();
+
+    const int rv = deflate(z_, mode);
 
-    if (rv != expectedResult) {
+    output->resize(output->capacity() - z_->avail_out);
+
+    // no progress possible on an already flushed stream is no error
+    if (rv != expectedResult && !(rv == Z_BUF_ERROR && z_->avail_in == 0)) {
       switch (rv) {
         case Z_NEED_DICT:
           throw std::runtime_error("zlib dictionary needed.");
@@ -117,11 +207,15 @@ void GzipFilter::filter(const BufferRef& input, Buffer* output, bool last) {
           throw std::runtime_error("Unknown Zlib deflate() error.");
       }
     }
-  } while (z_.avail_out == 0);
 
-  assert(z_.avail_in == 0);
+    if (z_->avail_out != 0)
+      break;
+
+    // output space exhausted, there may be more pending
+    output->reserve(output->capacity() + Buffer::CHUNK_SIZE);
+  }
 
-  output->resize(output->capacity() - z_.avail_out);
+  assert(z_->avail_in == 0);
 }
 
 } // namespace xzero
@@ -18,19 +18,45 @@ namespace xzero {
 
 /**
  * Gzip encoding filter.
+ *
+ * The zlib compression state is taken from a per-thread pool and reset
+ * rather than destroyed when done, sparing the allocation and
+ * initialization of it for every compressed response.
  */
 class XZERO_API GzipFilter : public Filter {
  public:
+  /** Maximum number of idle compression states kept per thread and level. */
+  static const size_t MaxPoolSize = 16;
+
   explicit GzipFilter(int level);
+
+  /**
+   * Initializes a zlib (RFC 1950) encoder with a preset dictionary.
+   *
+   * Preset dictionaries let small payloads refer to content the decoder
+   * knows beforehand, such as common keys of JSON responses. As the gzip
+   * format cannot carry one, the output is in zlib format, and the
+   * decoder needs to provide the very same dictionary.
+   *
+   * @param level compression level.
+   * @param dictionary the dictionary, of which at most the last 32 KB are
+   *                   used. It is copied into the compression state.
+   */
+  GzipFilter(int level, const BufferRef& dictionary);
+
   ~GzipFilter();
 
   void filter(const BufferRef& input, Buffer* output, bool last) override;
 
+  /** Retrieves the number of idle compression states of this thread. */
+  static size_t pooledContexts();
+
  private:
   std::string z_code(int code) const;
 
  private:
-  z_stream z_;
+  int key_;
+  z_stream* z_;
 };
 
 } // namespace xzero
@@ -30,7 +30,8 @@ LocalFile::LocalFile(LocalFileRepository& repo,
     : File(path, mimetype),
       repo_(repo),
       stat_(),
-      etag_() {
+      etag_(),
+      handle_() {
   update();
 }
 
@@ -96,6 +97,40 @@ int LocalFile::createPosixChannel(OpenFlags oflags) {
   return ::open(path().c_str(), to_posix(oflags));
 }
 
+std::shared_ptr<FileDescriptor> LocalFile::sharedHandle() {
+  if (handle_)
+    return handle_;
+
+  return File::sharedHandle();
+}
+
+bool LocalFile::openShared() {
+  int fd = createPosixChannel(Read | NonBlocking);
+  if (fd < 0)
+    return false;
+
+  auto handle = std::make_shared<FileDescriptor>(fd);
+  if (fstat(fd, &stat_) < 0 || !S_ISREG(stat_.st_mode))
+    return false;
+
+  handle_ = std::move(handle);
+  etag();
+  lastModified();
+  return true;
+}
+
+bool LocalFile::isUnchanged() const {
+  struct stat current;
+  if (stat(path().c_str(), &current) < 0)
+    return false;
+
+  return current.st_ino == stat_.st_ino
+      && current.st_dev == stat_.st_dev
+      && current.st_size == stat_.st_size
+      && current.st_mtime == stat_.st_mtime
+      && current.st_mode == stat_.st_mode;
+}
+
 std::unique_ptr<std::istream> LocalFile::createInputChannel() {
   return std::unique_ptr<std::istream>(
       new std::ifstream(path(), std::ios::binary));
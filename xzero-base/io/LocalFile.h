@@ -14,6 +14,7 @@
 #include <string>
 #include <functional>
 #include <unordered_map>
+#include <memory>
 #include <sys/stat.h>
 
 namespace xzero {
@@ -33,16 +34,39 @@ class XZERO_API LocalFile : public File {
   size_t inode() const XZERO_NOEXCEPT override;
   bool isRegular() const XZERO_NOEXCEPT override;
   int createPosixChannel(OpenFlags flags) override;
+  std::shared_ptr<FileDescriptor> sharedHandle() override;
   std::unique_ptr<std::istream> createInputChannel() override;
   std::unique_ptr<std::ostream> createOutputChannel() override;
   std::unique_ptr<MemoryMap> createMemoryMap(bool rw = true) override;
 
   void update();
 
+ private:
+  friend class LocalFileRepository;
+
+  /**
+   * Opens the file for sharing its handle across all readers and
+   * precomputes the response meta data, so that the object can be shared
+   * across threads.
+   *
+   * The file status gets refreshed from the opened file, so that it
+   * matches the contents being served.
+   *
+   * @retval true the file is open and ready to be shared.
+   * @retval false the file could not be opened.
+   */
+  bool openShared();
+
+  /**
+   * Tests whether the file at path() still is the one opened.
+   */
+  bool isUnchanged() const;
+
  private:
   LocalFileRepository& repo_;
   struct stat stat_;
   mutable std::string etag_;
+  std::shared_ptr<FileDescriptor> handle_;
 };
 
 } // namespace xzero
@@ -0,0 +1,139 @@
+// This file is part of the "libxzero" project
+//   (c) 2009-2015 Christian Parpart <https://github.com/christianparpart>
+//   (c) 2014-2015 Paul Asmuth <https://github.com/paulasmuth>
+//
+// libxzero is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Affero General Public License v3.0.
+// You should have received a copy of the GNU Affero General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <gtest/gtest.h>
+#include <xzero-base/io/LocalFileRepository.h>
+#include <xzero-base/io/FileDescriptor.h>
+#include <xzero-base/io/FileUtil.h>
+#include <xzero-base/io/File.h>
+#include <xzero-base/MimeTypes.h>
+#include <xzero-base/sysconfig.h>
+#include <unistd.h>
+#include <utime.h>
+
+using namespace xzero;
+
+class LocalFileRepositoryTest : public ::testing::Test {
+ public:
+  LocalFileRepositoryTest()
+      : path_(FileUtil::createTempDirectory()),
+        mimetypes_("", "application/octet-stream"),
+        repo_(mimetypes_, "/", true, true, true) {
+  }
+
+  ~LocalFileRepositoryTest() {
+    FileUtil::ls(path_, [](const std::string& filename) -> bool {
+      FileUtil::rm(filename);
+      return true;
+    });
+    ::rmdir(path_.c_str());
+  }
+
+  void write(const std::string& name, const std::string& content) {
+    FileUtil::write(path_ + name, Buffer(content));
+  }
+
+  std::shared_ptr<File> get(const std::string& name) {
+    return repo_.getFile(name, path_);
+  }
+
+ protected:
+  std::string path_;
+  MimeTypes mimetypes_;
+  LocalFileRepository repo_;
+};
+
+TEST_F(LocalFileRepositoryTest, uncached) {
+  write("/a.txt", "hello");
+
+  auto a = get("/a.txt");
+  auto b = get("/a.txt");
+  ASSERT_NE(a.get(), b.get());
+  ASSERT_NE(a->sharedHandle().get(), a->sharedHandle().get());
+  ASSERT_EQ(0, repo_.cacheSize());
+}
+
+TEST_F(LocalFileRepositoryTest, cached) {
+  repo_.setCache(16, TimeSpan::Zero);
+  write("/a.txt", "hello");
+
+  auto a = get("/a.txt");
+  auto b = get("/a.txt");
+  ASSERT_EQ(a.get(), b.get());
+  ASSERT_EQ(5, b->size());
+  ASSERT_FALSE(b->lastModified().empty());
+
+  auto fd = a->sharedHandle();
+  ASSERT_TRUE(fd != nullptr);
+  ASSERT_EQ(fd.get(), b->sharedHandle().get());
+  ASSERT_EQ(1, repo_.cacheSize());
+
+  // missing files and directories are not cached
+  ASSERT_NE(0, get("/missing.txt")->errorCode());
+  ASSERT_FALSE(get("/")->isRegular());
+  ASSERT_EQ(1, repo_.cacheSize());
+}
+
+TEST_F(LocalFileRepositoryTest, evictLeastRecentlyUsed) {
+  repo_.setCache(2, TimeSpan::Zero);
+  write("/a.txt", "a");
+  write("/b.txt", "b");
+  write("/c.txt", "c");
+
+  auto a = get("/a.txt");
+  get("/b.txt");
+  get("/a.txt");
+  get("/c.txt");  // evicts b.txt
+
+  ASSERT_EQ(2, repo_.cacheSize());
+  ASSERT_EQ(a.get(), get("/a.txt").get());
+
+  // handles stay valid for those still holding the file
+  repo_.clearCache();
+  ASSERT_EQ(0, repo_.cacheSize());
+  char c;
+  ASSERT_EQ(1, pread(*a->sharedHandle(), &c, 1, 0));
+  ASSERT_EQ('a', c);
+}
+
+TEST_F(LocalFileRepositoryTest, revalidateAfterTTL) {
+  repo_.setCache(16, TimeSpan(0.01));
+  write("/a.txt", "hello");
+
+  auto a = get("/a.txt");
+
+  // replace the file by a different one behind the cache's back
+  write("/b.txt", "hello, world");
+  ASSERT_EQ(0, ::rename((path_ + "/b.txt").c_str(),
+                        (path_ + "/a.txt").c_str()));
+  usleep(20000);
+
+  auto b = get("/a.txt");
+  ASSERT_NE(a.get(), b.get());
+  ASSERT_EQ(12, b->size());
+}
+
+#if defined(HAVE_INOTIFY_INIT1)
+TEST_F(LocalFileRepositoryTest, invalidateOnChange) {
+  repo_.setCache(16, TimeSpan::Zero);
+  write("/a.txt", "hello");
+  auto a = get("/a.txt");
+
+  write("/a.txt", "hello, world");
+
+  auto b = get("/a.txt");
+  ASSERT_NE(a.get(), b.get());
+  ASSERT_EQ(12, b->size());
+  ASSERT_NE(a->etag(), b->etag());
+
+  ::unlink((path_ + "/a.txt").c_str());
+  ASSERT_EQ(ENOENT, get("/a.txt")->errorCode());
+  ASSERT_EQ(0, repo_.cacheSize());
+}
+#endif
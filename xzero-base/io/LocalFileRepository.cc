@@ -11,9 +11,222 @@
 #include <xzero-base/io/LocalFile.h>
 #include <xzero-base/io/FileUtil.h>
 #include <xzero-base/MimeTypes.h>
+#include <xzero-base/WallClock.h>
+#include <xzero-base/DateTime.h>
+#include <xzero-base/sysconfig.h>
+#include <unordered_map>
+#include <vector>
+#include <list>
+#include <algorithm>
+#include <mutex>
+#include <unistd.h>
+
+#if defined(HAVE_SYS_INOTIFY_H)
+#include <sys/inotify.h>
+#endif
 
 namespace xzero {
 
+// {{{ LocalFileRepository::Cache
+/**
+ * Bounded LRU cache of opened files, keyed by path.
+ *
+ * Directories of cached files are watched by inotify, and any change to a
+ * directory entry drops the cached file of that name.
+ */
+class LocalFileRepository::Cache {
+ public:
+  Cache(size_t maxEntries, TimeSpan ttl);
+  ~Cache();
+
+  std::shared_ptr<LocalFile> get(const std::string& path);
+  void put(const std::string& path, std::shared_ptr<LocalFile> file);
+  size_t size() const;
+  void clear();
+
+ private:
+  struct Entry {
+    std::shared_ptr<LocalFile> file;
+    DateTime validated;
+    std::list<std::string>::iterator lru;
+  };
+
+  void watch(const std::string& path);
+  void processEvents();
+  void invalidate(const std::string& path);
+  void invalidateDirectory(const std::string& directory);
+
+ private:
+  size_t maxEntries_;
+  TimeSpan ttl_;
+  mutable std::mutex lock_;
+  std::unordered_map<std::string, Entry> entries_;
+  std::list<std::string> lru_;  // most recently used first
+  int inotify_;
+
+  // the directory names a watch was added by, as the same directory may be
+  // reached by different paths.
+  std::unordered_map<int, std::vector<std::string>> watches_;
+};
+
+LocalFileRepository::Cache::Cache(size_t maxEntries, TimeSpan ttl)
+    : maxEntries_(maxEntries),
+      ttl_(ttl),
+      lock_(),
+      entries_(),
+      lru_(),
+      inotify_(-1),
+      watches_() {
+#if defined(HAVE_INOTIFY_INIT1)
+  inotify_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+LocalFileRepository::Cache::~Cache() {
+  if (inotify_ >= 0)
+    ::close(inotify_);
+}
+
+std::shared_ptr<LocalFile> LocalFileRepository::Cache::get(
+    const std::string& path) {
+  std::lock_guard<std::mutex> _l(lock_);
+
+  processEvents();
+
+  auto i = entries_.find(path);
+  if (i == entries_.end())
+    return nullptr;
+
+  Entry& entry = i->second;
+
+  if (ttl_) {
+    DateTime now = WallClock::monotonic()->get();
+    if (now - entry.validated > ttl_) {
+      if (!entry.file->isUnchanged()) {
+        lru_.erase(entry.lru);
+        entries_.erase(i);
+        return nullptr;
+      }
+      entry.validated = now;
+    }
+  }
+
+  lru_.splice(lru_.begin(), lru_, entry.lru);
+  return entry.file;
+}
+
+void LocalFileRepository::Cache::put(const std::string& path,
+                                     std::shared_ptr<LocalFile> file) {
+  std::lock_guard<std::mutex> _l(lock_);
+
+  invalidate(path);
+  watch(path);
+
+  lru_.push_front(path);
+  entries_[path] = Entry{std::move(file), WallClock::monotonic()->get(),
+                         lru_.begin()};
+
+  while (entries_.size() > maxEntries_) {
+    entries_.erase(lru_.back());
+    lru_.pop_back();
+  }
+}
+
+size_t LocalFileRepository::Cache::size() const {
+  std::lock_guard<std::mutex> _l(lock_);
+  return entries_.size();
+}
+
+void LocalFileRepository::Cache::clear() {
+  std::lock_guard<std::mutex> _l(lock_);
+  entries_.clear();
+  lru_.clear();
+}
+
+void LocalFileRepository::Cache::watch(const std::string& path) {
+#if defined(HAVE_SYS_INOTIFY_H)
+  if (inotify_ < 0)
+    return;
+
+  const std::string directory = path.substr(0, path.rfind('/'));
+  const uint32_t mask = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_DELETE |
+                        IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF |
+                        IN_MOVE_SELF;
+
+  int wd = inotify_add_watch(inotify_,
+                             directory.empty() ? "/" : directory.c_str(),
+                             mask);
+  if (wd < 0)
+    return;
+
+  std::vector<std::string>& names = watches_[wd];
+  if (std::find(names.begin(), names.end(), directory) == names.end())
+    names.push_back(directory);
+#endif
+}
+
+void LocalFileRepository::Cache::processEvents() {
+#if defined(HAVE_SYS_INOTIFY_H)
+  if (inotify_ < 0)
+    return;
+
+  alignas(struct inotify_event) char buf[4096];
+  for (;;) {
+    ssize_t n = ::read(inotify_, buf, sizeof(buf));
+    if (n <= 0)
+      break;
+
+    for (char* p = buf; p < buf + n; ) {
+      const struct inotify_event* event = (const struct inotify_event*) p;
+      p += sizeof(struct inotify_event) + event->len;
+
+      if (event->mask & IN_Q_OVERFLOW) {
+        entries_.clear();
+        lru_.clear();
+        continue;
+      }
+
+      auto w = watches_.find(event->wd);
+      if (w == watches_.end())
+        continue;
+
+      if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+        for (const std::string& directory: w->second)
+          invalidateDirectory(directory);
+
+        if (event->mask & IN_IGNORED)
+          watches_.erase(w);
+      } else if (event->len > 0) {
+        for (const std::string& directory: w->second)
+          invalidate(directory + "/" + event->name);
+      }
+    }
+  }
+#endif
+}
+
+void LocalFileRepository::Cache::invalidate(const std::string& path) {
+  auto i = entries_.find(path);
+  if (i != entries_.end()) {
+    lru_.erase(i->second.lru);
+    entries_.erase(i);
+  }
+}
+
+void LocalFileRepository::Cache::invalidateDirectory(
+    const std::string& directory) {
+  const std::string prefix = directory + "/";
+  for (auto i = entries_.begin(); i != entries_.end(); ) {
+    if (i->first.compare(0, prefix.size(), prefix) == 0) {
+      lru_.erase(i->second.lru);
+      i = entries_.erase(i);
+    } else {
+      ++i;
+    }
+  }
+}
+// }}}
+
 LocalFileRepository::LocalFileRepository(MimeTypes& mt,
                                                  const std::string& basedir,
                                                  bool etagMtime,
@@ -23,7 +236,11 @@ LocalFileRepository::LocalFileRepository(MimeTypes& mt,
       basedir_(FileUtil::realpath(basedir)),
       etagConsiderMTime_(etagMtime),
       etagConsiderSize_(etagSize),
-      etagConsiderINode_(etagInode) {
+      etagConsiderINode_(etagInode),
+      cache_() {
+}
+
+LocalFileRepository::~LocalFileRepository() {
 }
 
 std::shared_ptr<File> LocalFileRepository::getFile(
@@ -32,8 +249,18 @@ std::shared_ptr<File> LocalFileRepository::getFile(
 
   std::string path = basedir_ + docroot + requestPath;
 
-  return std::shared_ptr<File>(new LocalFile(
+  if (cache_) {
+    if (std::shared_ptr<LocalFile> file = cache_->get(path))
+      return file;
+  }
+
+  std::shared_ptr<LocalFile> file(new LocalFile(
         *this, path, mimetypes_.getMimeType(requestPath)));
+
+  if (cache_ && file->isRegular() && file->openShared())
+    cache_->put(path, file);
+
+  return file;
 }
 
 void LocalFileRepository::listFiles(
@@ -63,6 +290,23 @@ void LocalFileRepository::configureETag(bool mtime, bool size, bool inode) {
   etagConsiderMTime_ = mtime;
   etagConsiderSize_ = size;
   etagConsiderINode_ = inode;
+  clearCache();
+}
+
+void LocalFileRepository::setCache(size_t maxEntries, TimeSpan ttl) {
+  if (maxEntries != 0)
+    cache_.reset(new Cache(maxEntries, ttl));
+  else
+    cache_.reset();
+}
+
+size_t LocalFileRepository::cacheSize() const {
+  return cache_ ? cache_->size() : 0;
+}
+
+void LocalFileRepository::clearCache() {
+  if (cache_)
+    cache_->clear();
 }
 
 }  // namespace xzero
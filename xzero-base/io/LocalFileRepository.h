@@ -11,7 +11,9 @@
 
 #include <xzero-base/Api.h>
 #include <xzero-base/io/FileRepository.h>
+#include <xzero-base/TimeSpan.h>
 #include <functional>
+#include <memory>
 #include <string>
 
 namespace xzero {
@@ -35,6 +37,8 @@ class XZERO_API LocalFileRepository : public FileRepository {
       const std::string& basedir,
       bool etagMtime, bool etagSize, bool etagInode);
 
+  ~LocalFileRepository();
+
   const std::string baseDirectory() const { return basedir_; }
 
   std::shared_ptr<File> getFile(
@@ -54,7 +58,31 @@ class XZERO_API LocalFileRepository : public FileRepository {
    */
   void configureETag(bool mtime, bool size, bool inode);
 
+  /**
+   * Enables caching of opened regular files along with their status and
+   * response meta data, keyed by their path.
+   *
+   * A cached file is returned to all requests for it, sharing a single
+   * read-only file handle. Entries are invalidated by inotify on changes
+   * to their directory, if available, and revalidated by @c stat() once
+   * their @p ttl has passed. The least recently used entry gets dropped
+   * when the cache is full.
+   *
+   * @param maxEntries maximum number of files to keep open, or 0 to
+   *                   disable caching.
+   * @param ttl time after which an entry is revalidated, or
+   *            TimeSpan::Zero to rely on inotify alone.
+   */
+  void setCache(size_t maxEntries, TimeSpan ttl);
+
+  /** Retrieves the number of files currently cached. */
+  size_t cacheSize() const;
+
+  /** Drops all cached files. */
+  void clearCache();
+
  private:
+  class Cache;
   friend class LocalFile;
 
   MimeTypes& mimetypes_;
@@ -62,6 +90,7 @@ class XZERO_API LocalFileRepository : public FileRepository {
   bool etagConsiderMTime_;
   bool etagConsiderSize_;
   bool etagConsiderINode_;
+  std::unique_ptr<Cache> cache_;
 };
 
 }  // namespace xzero
@@ -0,0 +1,69 @@
+// This file is part of the "libxzero" project
+//   (c) 2009-2015 Christian Parpart <https://github.com/christianparpart>
+//   (c) 2014-2015 Paul Asmuth <https://github.com/paulasmuth>
+//
+// libxzero is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Affero General Public License v3.0.
+// You should have received a copy of the GNU Affero General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <xzero-base/io/ZstdFilter.h>
+#include <xzero-base/Buffer.h>
+#include <xzero-base/sysconfig.h>
+#include <stdexcept>
+
+#if defined(HAVE_ZSTD_H)
+namespace xzero {
+
+ZstdFilter::ZstdFilter(int level)
+    : context_(ZSTD_createCCtx()) {
+  if (!context_)
+    throw std::runtime_error("ZSTD_createCCtx failed.");
+
+  size_t rv = ZSTD_CCtx_setParameter(context_, ZSTD_c_compressionLevel,
+                                     level);
+  if (ZSTD_isError(rv)) {
+    ZSTD_freeCCtx(context_);
+    throw std::runtime_error(ZSTD_getErrorName(rv));
+  }
+}
+
+ZstdFilter::ZstdFilter(int level, const BufferRef& dictionary)
+    : ZstdFilter(level) {
+  size_t rv = ZSTD_CCtx_loadDictionary(context_, dictionary.data(),
+                                       dictionary.size());
+  // fully constructed by now, so the destructor frees the context
+  if (ZSTD_isError(rv))
+    throw std::runtime_error(ZSTD_getErrorName(rv));
+}
+
+ZstdFilter::~ZstdFilter() {
+  ZSTD_freeCCtx(context_);
+}
+
+void ZstdFilter::filter(const BufferRef& input, Buffer* output, bool last) {
+  const ZSTD_EndDirective mode = last ? ZSTD_e_end : ZSTD_e_flush;
+  ZSTD_inBuffer in = { input.data(), input.size(), 0 };
+
+  output->reserve(output->size() + ZSTD_compressBound(input.size()));
+
+  for (;;) {
+    ZSTD_outBuffer out = { output->end(),
+                           output->capacity() - output->size(), 0 };
+
+    // number of bytes still to be flushed, or an error code
+    const size_t remaining = ZSTD_compressStream2(context_, &out, &in, mode);
+    if (ZSTD_isError(remaining))
+      throw std::runtime_error(ZSTD_getErrorName(remaining));
+
+    output->resize(output->size() + out.pos);
+
+    if (remaining == 0)
+      break;
+
+    output->reserve(output->capacity() + Buffer::CHUNK_SIZE);
+  }
+}
+
+} // namespace xzero
+#endif
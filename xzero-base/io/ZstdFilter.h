@@ -0,0 +1,51 @@
+// This file is part of the "libxzero" project
+//   (c) 2009-2015 Christian Parpart <https://github.com/christianparpart>
+//   (c) 2014-2015 Paul Asmuth <https://github.com/paulasmuth>
+//
+// libxzero is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Affero General Public License v3.0.
+// You should have received a copy of the GNU Affero General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <xzero-base/Api.h>
+#include <xzero-base/io/Filter.h>
+#include <xzero-base/sysconfig.h>
+
+#if defined(HAVE_ZSTD_H)
+#include <zstd.h>
+
+namespace xzero {
+
+/**
+ * Zstandard encoding filter (RFC 8878).
+ */
+class XZERO_API ZstdFilter : public Filter {
+ public:
+  /**
+   * @param level compression level, from 1 (fastest) to 19 (best), or
+   *              negative for even faster ones.
+   */
+  explicit ZstdFilter(int level);
+
+  /**
+   * Initializes an encoder with a dictionary, either a raw content prefix
+   * or one trained by @c zstd --train on typical payloads.
+   *
+   * The decoder needs to provide the very same dictionary.
+   *
+   * @param level compression level.
+   * @param dictionary the dictionary, copied into the compression context.
+   */
+  ZstdFilter(int level, const BufferRef& dictionary);
+  ~ZstdFilter();
+
+  void filter(const BufferRef& input, Buffer* output, bool last) override;
+
+ private:
+  ZSTD_CCtx* context_;
+};
+
+} // namespace xzero
+#endif
@@ -29,7 +29,10 @@ ByteArrayEndPoint::ByteArrayEndPoint(LocalConnector* connector)
       input_(),
       readPos_(0),
       output_(),
-      closed_(false) {
+      writeCount_(0),
+      closed_(false),
+      corking_(false),
+      tcpNoDelay_(false) {
 }
 
 ByteArrayEndPoint::~ByteArrayEndPoint() {
@@ -92,12 +95,14 @@ size_t ByteArrayEndPoint::flush(const BufferRef& source) {
     return 0;
   }
 
+  writeCount_++;
   size_t n = output_.size();
   output_.push_back(source);
   return output_.size() - n;
 }
 
 size_t ByteArrayEndPoint::flush(int fd, off_t offset, size_t size) {
+  writeCount_++;
   output_.reserve(output_.size() + size);
 
   ssize_t n = pread(fd, output_.end(), size, offset);
@@ -109,6 +114,17 @@ size_t ByteArrayEndPoint::flush(int fd, off_t offset, size_t size) {
   return n;
 }
 
+size_t ByteArrayEndPoint::flush(const BufferRef* sources, size_t count) {
+  TRACE("%p flush: %zu buffers", this, count);
+
+  // flushes each buffer separately, but counts them as one write
+  const size_t writeCount = writeCount_;
+  const size_t n = EndPoint::flush(sources, count);
+  writeCount_ = writeCount + 1;
+
+  return n;
+}
+
 void ByteArrayEndPoint::wantFill() {
   if (connection()) {
     TRACE("%p wantFill.", this);
@@ -158,10 +174,19 @@ void ByteArrayEndPoint::setBlocking(bool enable) {
 }
 
 bool ByteArrayEndPoint::isCorking() const {
-  return false;
+  return corking_;
+}
+
+void ByteArrayEndPoint::setCorking(bool enable) {
+  corking_ = enable;
+}
+
+bool ByteArrayEndPoint::isTcpNoDelay() const {
+  return tcpNoDelay_;
 }
 
-void ByteArrayEndPoint::setCorking(bool /*enable*/) {
+void ByteArrayEndPoint::setTcpNoDelay(bool enable) {
+  tcpNoDelay_ = enable;
 }
 
 } // namespace xzero
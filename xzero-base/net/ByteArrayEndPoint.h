@@ -53,6 +53,12 @@ class XZERO_API ByteArrayEndPoint : public EndPoint {
    */
   const Buffer& output() const;
 
+  /**
+   * Retrieves the number of write operations, single or gathered, that
+   * produced the output.
+   */
+  size_t writeCount() const XZERO_NOEXCEPT { return writeCount_; }
+
   // overrides
   void close() override;
   bool isOpen() const override;
@@ -60,6 +66,7 @@ class XZERO_API ByteArrayEndPoint : public EndPoint {
   size_t fill(Buffer*) override;
   size_t flush(const BufferRef&) override;
   size_t flush(int fd, off_t offset, size_t size) override;
+  size_t flush(const BufferRef* sources, size_t count) override;
   void wantFill() override;
   void wantFlush() override;
   TimeSpan idleTimeout() override;
@@ -68,13 +75,18 @@ class XZERO_API ByteArrayEndPoint : public EndPoint {
   void setBlocking(bool enable) override;
   bool isCorking() const override;
   void setCorking(bool enable) override;
+  bool isTcpNoDelay() const override;
+  void setTcpNoDelay(bool enable) override;
 
  private:
   LocalConnector* connector_;
   Buffer input_;
   size_t readPos_;
   Buffer output_;
+  size_t writeCount_;
   bool closed_;
+  bool corking_;
+  bool tcpNoDelay_;
 };
 
 } // namespace xzero
@@ -72,6 +72,20 @@ bool Connection::onReadTimeout() {
   return true;
 }
 
+void Connection::release() {
+  delete this;
+}
+
+void Connection::reattach(EndPoint* endpoint, Executor* executor) {
+  endpoint_ = endpoint;
+  executor_ = executor;
+  listeners_.clear();
+
+  if (endpoint_) {
+    endpoint_->setConnection(this);
+  }
+}
+
 // {{{ ConnectionListener impl
 ConnectionListener::~ConnectionListener() {
 }
@@ -120,6 +120,22 @@ class XZERO_API Connection {
    */
   virtual bool onReadTimeout();
 
+  /**
+   * Releases this connection, invoked by its EndPoint upon destruction.
+   *
+   * The default implementation deletes the connection. Derived classes may
+   * override this to keep the object around for reuse with another endpoint.
+   */
+  virtual void release();
+
+ protected:
+  /**
+   * Rebinds this connection to the given @p endpoint and @p executor.
+   *
+   * Registered listeners are dropped.
+   */
+  void reattach(EndPoint* endpoint, Executor* executor);
+
  private:
   EndPoint* endpoint_;
   Executor* executor_;
@@ -9,6 +9,7 @@
 
 #include <xzero-base/net/EndPoint.h>
 #include <xzero-base/net/Connection.h>
+#include <xzero-base/Buffer.h>
 #include <cassert>
 
 namespace xzero {
@@ -18,7 +19,9 @@ EndPoint::EndPoint() XZERO_NOEXCEPT
 }
 
 EndPoint::~EndPoint() {
-  delete connection_;
+  if (connection_) {
+    connection_->release();
+  }
 }
 
 void EndPoint::setConnection(Connection* connection) {
@@ -26,4 +29,22 @@ void EndPoint::setConnection(Connection* connection) {
   connection_ = connection;
 }
 
+void EndPoint::detachConnection() {
+  connection_ = nullptr;
+}
+
+size_t EndPoint::flush(const BufferRef* sources, size_t count) {
+  size_t total = 0;
+
+  for (size_t i = 0; i < count; ++i) {
+    const size_t n = flush(sources[i]);
+    total += n;
+
+    if (n < sources[i].size())
+      break;
+  }
+
+  return total;
+}
+
 }  // namespace xzero
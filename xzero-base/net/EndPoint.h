@@ -55,6 +55,13 @@ class EndPoint : public RefCounted {
    */
   void setConnection(Connection* connection);
 
+  /**
+   * Dissociates the current Connection without releasing it, so that
+   * another Connection can take over this EndPoint, e.g. on a protocol
+   * switch. The caller becomes responsible for releasing the old one.
+   */
+  void detachConnection();
+
   /**
    * Tests whether or not this endpoint is still connected.
    */
@@ -100,6 +107,20 @@ class EndPoint : public RefCounted {
    */
   virtual size_t flush(int fd, off_t offset, size_t size) = 0;
 
+  /**
+   * Flushes given buffers @p sources into this endpoint, in one gathered
+   * write if supported by the underlying transport.
+   *
+   * @param sources array of buffers to flush into this endpoint.
+   * @param count number of buffers in @p sources.
+   *
+   * @return Number of actual bytes flushed.
+   *
+   * The default implementation flushes each buffer separately and stops
+   * at the first partial write.
+   */
+  virtual size_t flush(const BufferRef* sources, size_t count);
+
   /**
    * Registers an interest on reading input data.
    *
@@ -154,6 +175,16 @@ class EndPoint : public RefCounted {
    */
   virtual void setCorking(bool enable) = 0;
 
+  /**
+   * Retrieves @c TCP_NODELAY state.
+   */
+  virtual bool isTcpNoDelay() const = 0;
+
+  /**
+   * Sets whether to @c TCP_NODELAY or not.
+   */
+  virtual void setTcpNoDelay(bool enable) = 0;
+
   /**
    * String representation of the object for introspection.
    */
@@ -0,0 +1,156 @@
+// This file is part of the "libxzero" project
+//   (c) 2009-2015 Christian Parpart <https://github.com/christianparpart>
+//   (c) 2014-2015 Paul Asmuth <https://github.com/paulasmuth>
+//
+// libxzero is free software: you can redistribute it and/or modify it under
+// the terms of the GNU Affero General Public License v3.0.
+// You should have received a copy of the GNU Affero General Public License
+// along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+#include <xzero-base/net/EndPointWriter.h>
+#include <xzero-base/net/ByteArrayEndPoint.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+
+using namespace xzero;
+
+class GatheringEndPoint : public ByteArrayEndPoint {
+ public:
+  GatheringEndPoint() : ByteArrayEndPoint(nullptr), flushCount(0) {}
+
+  using ByteArrayEndPoint::flush;
+
+  size_t flush(const BufferRef& source) override {
+    flushCount++;
+    return ByteArrayEndPoint::flush(source);
+  }
+
+  size_t flush(const BufferRef* sources, size_t count) override {
+    flushCount++;
+    size_t n = 0;
+    for (size_t i = 0; i < count; ++i)
+      n += ByteArrayEndPoint::flush(sources[i]);
+    return n;
+  }
+
+  size_t flushCount;
+};
+
+TEST(EndPointWriter, gathersConsecutiveBuffers) {
+  GatheringEndPoint ep;
+  EndPointWriter writer;
+
+  writer.write(Buffer("foo"));
+  writer.write(BufferRef(" "));
+  writer.write(Buffer("bar"));
+
+  ASSERT_TRUE(writer.flush(&ep));
+  ASSERT_TRUE(writer.empty());
+  ASSERT_EQ(1, ep.flushCount);
+  ASSERT_EQ("foo bar", ep.output());
+}
+
+TEST(EndPointWriter, singleBuffer) {
+  GatheringEndPoint ep;
+  EndPointWriter writer;
+
+  writer.write(Buffer("foo"));
+
+  ASSERT_TRUE(writer.flush(&ep));
+  ASSERT_EQ(1, ep.flushCount);
+  ASSERT_EQ("foo", ep.output());
+}
+
+TEST(EndPointWriter, detach) {
+  GatheringEndPoint ep;
+  EndPointWriter writer;
+
+  {
+    Buffer temp("foo bar");
+    writer.write(temp.ref());
+    ASSERT_TRUE(writer.detach(7));
+    temp.clear();
+    temp.push_back("XXXXXXX");
+  }
+
+  ASSERT_TRUE(writer.flush(&ep));
+  ASSERT_EQ("foo bar", ep.output());
+}
+
+TEST(EndPointWriter, detachBeyondLimit) {
+  GatheringEndPoint ep;
+  EndPointWriter writer;
+
+  Buffer temp("foo bar");
+  writer.write(Buffer("owned "));
+  writer.write(temp.ref());
+  writer.write(BufferRef("2\r\n"), temp.ref(0, 2), BufferRef("\r\n"));
+  ASSERT_EQ(20, writer.size());
+
+  // nothing gets copied, so the writer still refers to temp
+  ASSERT_FALSE(writer.detach(8));
+  temp.clear();
+  temp.push_back("XXXXXXX");
+
+  ASSERT_TRUE(writer.flush(&ep));
+  ASSERT_EQ("owned XXXXXXX2\r\nXX\r\n", ep.output());
+  ASSERT_EQ(0, writer.size());
+}
+
+TEST(EndPointWriter, framed) {
+  GatheringEndPoint ep;
+  EndPointWriter writer;
+
+  writer.write(BufferRef("3\r\n"), Buffer("foo"), BufferRef("\r\n"));
+  writer.write(BufferRef("3\r\n"), BufferRef("bar"), BufferRef("\r\n"));
+
+  ASSERT_TRUE(writer.flush(&ep));
+  ASSERT_EQ(1, ep.flushCount);
+  ASSERT_EQ("3\r\nfoo\r\n3\r\nbar\r\n", ep.output());
+}
+
+class PartialEndPoint : public ByteArrayEndPoint {
+ public:
+  explicit PartialEndPoint(size_t limit)
+      : ByteArrayEndPoint(nullptr), limit_(limit) {}
+
+  using ByteArrayEndPoint::flush;
+
+  size_t flush(const BufferRef& source) override {
+    return ByteArrayEndPoint::flush(source.ref(0, std::min(limit_, source.size())));
+  }
+
+ private:
+  size_t limit_;
+};
+
+TEST(EndPointWriter, framedPartial) {
+  PartialEndPoint ep(2);
+  EndPointWriter writer;
+
+  writer.write(BufferRef("3\r\n"), Buffer("foo"), BufferRef("\r\n"));
+
+  // one range per flush, at most 2 bytes each
+  while (!writer.flush(&ep))
+    ;
+
+  ASSERT_TRUE(writer.empty());
+  ASSERT_EQ("3\r\nfoo\r\n", ep.output());
+}
+
+TEST(EndPointWriter, copy) {
+  GatheringEndPoint ep;
+  EndPointWriter writer;
+
+  {
+    char buf[] = "5\r\n";
+    writer.copy(BufferRef(buf, 3));
+    buf[0] = 'X';
+  }
+  writer.write(BufferRef("hello\r\n"));
+  ASSERT_EQ(10, writer.size());
+
+  ASSERT_TRUE(writer.flush(&ep));
+  ASSERT_EQ(1, ep.flushCount);
+  ASSERT_EQ("5\r\nhello\r\n", ep.output());
+}
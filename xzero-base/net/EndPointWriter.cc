@@ -9,12 +9,18 @@
 
 #include <xzero-base/net/EndPointWriter.h>
 #include <xzero-base/net/EndPoint.h>
+#include <cassert>
+#include <cstring>
 #include <unistd.h>
 
 namespace xzero {
 
+const size_t EndPointWriter::MaxFrameSize;
+const size_t EndPointWriter::MaxGatherCount;
+
 EndPointWriter::EndPointWriter()
-    : chunks_() {
+    : chunks_(),
+      gather_() {
 }
 
 EndPointWriter::~EndPointWriter() {
@@ -29,13 +35,73 @@ void EndPointWriter::write(Buffer&& chunk) {
         new BufferChunk(std::forward<Buffer>(chunk))));
 }
 
+void EndPointWriter::copy(const BufferRef& data) {
+  chunks_.emplace_back(std::unique_ptr<Chunk>(new InlineChunk(data)));
+}
+
 void EndPointWriter::write(FileRef&& chunk) {
   chunks_.emplace_back(std::unique_ptr<Chunk>(
         new FileChunk(std::forward<FileRef>(chunk))));
 }
 
+void EndPointWriter::write(const BufferRef& prefix,
+                           Buffer&& data,
+                           const BufferRef& suffix) {
+  chunks_.emplace_back(std::unique_ptr<Chunk>(
+        new FramedChunk(prefix, std::forward<Buffer>(data), suffix)));
+}
+
+void EndPointWriter::write(const BufferRef& prefix,
+                           const BufferRef& data,
+                           const BufferRef& suffix) {
+  chunks_.emplace_back(std::unique_ptr<Chunk>(
+        new FramedChunk(prefix, data, suffix)));
+}
+
+bool EndPointWriter::detach(size_t maxCopy) {
+  size_t referenced = 0;
+  for (const std::unique_ptr<Chunk>& chunk: chunks_) {
+    if (BufferRefChunk* ref = dynamic_cast<BufferRefChunk*>(chunk.get())) {
+      referenced += ref->size();
+    } else if (FramedChunk* framed = dynamic_cast<FramedChunk*>(chunk.get())) {
+      referenced += framed->referencedSize();
+    }
+  }
+
+  if (referenced > maxCopy)
+    return false;
+
+  if (referenced == 0)
+    return true;
+
+  for (std::unique_ptr<Chunk>& chunk: chunks_) {
+    if (BufferRefChunk* ref = dynamic_cast<BufferRefChunk*>(chunk.get())) {
+      chunk.reset(new BufferChunk(Buffer(ref->data())));
+    } else if (FramedChunk* framed = dynamic_cast<FramedChunk*>(chunk.get())) {
+      framed->detach();
+    }
+  }
+
+  return true;
+}
+
+size_t EndPointWriter::size() const {
+  size_t total = 0;
+  for (const std::unique_ptr<Chunk>& chunk: chunks_)
+    total += chunk->size();
+
+  return total;
+}
+
 bool EndPointWriter::flush(EndPoint* sink) {
   while (!chunks_.empty()) {
+    if (isGatherable()) {
+      if (!gatherTo(sink))
+        return false;
+
+      continue;
+    }
+
     if (!chunks_.front()->transferTo(sink))
       return false;
 
@@ -45,6 +111,56 @@ bool EndPointWriter::flush(EndPoint* sink) {
   return true;
 }
 
+bool EndPointWriter::isGatherable() const {
+  // worth it if the front chunk is in-memory and consists of multiple
+  // ranges itself or is followed by another in-memory chunk
+  const size_t n = chunks_.front()->pending(gather_, MaxGatherCount);
+
+  if (n > 1)
+    return true;
+
+  return n == 1 && chunks_.size() > 1 &&
+         chunks_[1]->pending(gather_, MaxGatherCount) > 0;
+}
+
+bool EndPointWriter::gatherTo(EndPoint* sink) {
+  BufferRef* vec = gather_;
+  size_t sizes[MaxGatherCount];
+  size_t count = 0;
+  size_t chunkCount = 0;
+  size_t total = 0;
+
+  while (chunkCount < chunks_.size()) {
+    const size_t n = chunks_[chunkCount]->pending(vec + count,
+                                                  MaxGatherCount - count);
+    if (n == 0)
+      break;
+
+    sizes[chunkCount] = 0;
+    for (size_t i = count; i < count + n; ++i)
+      sizes[chunkCount] += vec[i].size();
+
+    total += sizes[chunkCount];
+    count += n;
+    chunkCount++;
+  }
+
+  size_t n = sink->flush(vec, count);
+  const bool complete = n == total;
+
+  for (size_t i = 0; i < chunkCount; ++i) {
+    if (n < sizes[i]) {
+      chunks_.front()->advance(n);
+      break;
+    }
+
+    n -= sizes[i];
+    chunks_.pop_front();
+  }
+
+  return complete;
+}
+
 // {{{ EndPointWriter::BufferChunk
 bool EndPointWriter::BufferChunk::transferTo(EndPoint* sink) {
   size_t n = sink->flush(data_.ref(offset_));
@@ -55,6 +171,15 @@ bool EndPointWriter::BufferChunk::transferTo(EndPoint* sink) {
 
   return offset_ == data_.size();
 }
+
+size_t EndPointWriter::BufferChunk::pending(BufferRef* result,
+                                            size_t count) const {
+  if (count < 1)
+    return 0;
+
+  *result = data_.ref(offset_);
+  return 1;
+}
 // }}}
 // {{{ EndPointWriter::BufferRefChunk
 bool EndPointWriter::BufferRefChunk::transferTo(EndPoint* sink) {
@@ -64,6 +189,123 @@ bool EndPointWriter::BufferRefChunk::transferTo(EndPoint* sink) {
   offset_ += n;
   return offset_ == data_.size();
 }
+
+size_t EndPointWriter::BufferRefChunk::pending(BufferRef* result,
+                                               size_t count) const {
+  if (count < 1)
+    return 0;
+
+  *result = data_.ref(offset_);
+  return 1;
+}
+// }}}
+// {{{ EndPointWriter::InlineChunk
+EndPointWriter::InlineChunk::InlineChunk(const BufferRef& data)
+    : size_(data.size()),
+      offset_(0) {
+  assert(data.size() <= MaxFrameSize);
+  memcpy(data_, data.data(), data.size());
+}
+
+bool EndPointWriter::InlineChunk::transferTo(EndPoint* sink) {
+  size_t n = sink->flush(BufferRef(data_ + offset_, size_ - offset_));
+
+  offset_ += n;
+  return offset_ == size_;
+}
+
+size_t EndPointWriter::InlineChunk::pending(BufferRef* result,
+                                            size_t count) const {
+  if (count < 1)
+    return 0;
+
+  *result = BufferRef(data_ + offset_, size_ - offset_);
+  return 1;
+}
+// }}}
+// {{{ EndPointWriter::FramedChunk
+EndPointWriter::FramedChunk::FramedChunk(const BufferRef& prefix,
+                                         Buffer&& data,
+                                         const BufferRef& suffix)
+    : prefixSize_(prefix.size()),
+      suffixSize_(suffix.size()),
+      data_(std::forward<Buffer>(data)),
+      ref_(data_.ref()),
+      offset_(0) {
+  assert(prefix.size() <= MaxFrameSize && suffix.size() <= MaxFrameSize);
+  // an empty frame may come without any data pointer
+  if (prefix.size() != 0)
+    memcpy(prefix_, prefix.data(), prefix.size());
+  if (suffix.size() != 0)
+    memcpy(suffix_, suffix.data(), suffix.size());
+}
+
+EndPointWriter::FramedChunk::FramedChunk(const BufferRef& prefix,
+                                         const BufferRef& data,
+                                         const BufferRef& suffix)
+    : prefixSize_(prefix.size()),
+      suffixSize_(suffix.size()),
+      data_(),
+      ref_(data),
+      offset_(0) {
+  assert(prefix.size() <= MaxFrameSize && suffix.size() <= MaxFrameSize);
+  // an empty frame may come without any data pointer
+  if (prefix.size() != 0)
+    memcpy(prefix_, prefix.data(), prefix.size());
+  if (suffix.size() != 0)
+    memcpy(suffix_, suffix.data(), suffix.size());
+}
+
+void EndPointWriter::FramedChunk::detach() {
+  if (data_.empty() && !ref_.empty()) {
+    data_ = ref_;
+    ref_ = data_.ref();
+  }
+}
+
+bool EndPointWriter::FramedChunk::transferTo(EndPoint* sink) {
+  BufferRef vec[3];
+  const size_t count = pending(vec, 3);
+
+  size_t total = 0;
+  for (size_t i = 0; i < count; ++i)
+    total += vec[i].size();
+
+  const size_t n = sink->flush(vec, count);
+  offset_ += n;
+
+  return n == total;
+}
+
+size_t EndPointWriter::FramedChunk::pending(BufferRef* result,
+                                            size_t count) const {
+  if (count < 3)
+    return 0;
+
+  // skip what has been transferred already
+  size_t skip = offset_;
+  size_t n = 0;
+
+  const BufferRef parts[3] = {
+    BufferRef(prefix_, prefixSize_),
+    ref_,
+    BufferRef(suffix_, suffixSize_)
+  };
+
+  for (const BufferRef& part: parts) {
+    if (skip >= part.size()) {
+      skip -= part.size();
+    } else {
+      result[n++] = part.ref(skip);
+      skip = 0;
+    }
+  }
+
+  if (n == 0)
+    result[n++] = BufferRef();
+
+  return n;
+}
 // }}}
 // {{{ EndPointWriter::FileChunk
 EndPointWriter::FileChunk::~FileChunk() {
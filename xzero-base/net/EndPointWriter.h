@@ -25,7 +25,8 @@ class EndPoint;
 /**
  * Composable EndPoint Writer API.
  *
- * @todo 2 consecutive buffer writes should merge.
+ * Consecutive in-memory chunks are transferred with one gathered write.
+ *
  * @todo consider managing its own BufferPool
  */
 class XZERO_API EndPointWriter {
@@ -43,6 +44,12 @@ class XZERO_API EndPointWriter {
    */
   void write(Buffer&& data);
 
+  /**
+   * Appends a copy of given small @p data (at most MaxFrameSize bytes),
+   * e.g. framing bytes that live on the caller's stack.
+   */
+  void copy(const BufferRef& data);
+
   /**
    * Appends given chunk represented by given file descriptor and range.
    *
@@ -50,6 +57,45 @@ class XZERO_API EndPointWriter {
    */
   void write(FileRef&& file);
 
+  /**
+   * Appends given @p data, framed by a small @p prefix and @p suffix.
+   *
+   * The framing bytes (at most MaxFrameSize each) are copied into the
+   * queued chunk itself rather than separately allocated, and go out
+   * within the same gathered write as @p data.
+   */
+  void write(const BufferRef& prefix, Buffer&& data, const BufferRef& suffix);
+  void write(const BufferRef& prefix, const BufferRef& data,
+             const BufferRef& suffix);
+
+  /**
+   * Maximum number of bytes of a prefix or suffix of a framed write, or of
+   * a copied write.
+   */
+  static const size_t MaxFrameSize = 24;
+
+  /**
+   * Replaces all pending BufferRef chunks with owned copies, unless they
+   * refer to more than @p maxCopy bytes in total.
+   *
+   * Use this when the memory referenced by previous writes may be released
+   * before this writer is flushed.
+   *
+   * @retval true no pending chunk refers to foreign memory anymore.
+   * @retval false nothing has been copied, as it would exceed @p maxCopy.
+   */
+  bool detach(size_t maxCopy);
+
+  /**
+   * Tests whether there is no data pending to be transferred.
+   */
+  bool empty() const XZERO_NOEXCEPT { return chunks_.empty(); }
+
+  /**
+   * Retrieves the number of bytes pending to be transferred.
+   */
+  size_t size() const;
+
   /**
    * Transfers as much data as possible into the given EndPoint @p sink.
    *
@@ -58,13 +104,25 @@ class XZERO_API EndPointWriter {
    */
   bool flush(EndPoint* sink);
 
+ private:
+  bool isGatherable() const;
+  bool gatherTo(EndPoint* sink);
+
  private:
   class Chunk;
   class BufferChunk;
   class BufferRefChunk;
+  class InlineChunk;
+  class FramedChunk;
   class FileChunk;
 
+  //! maximum number of byte ranges transferred within one gathered write
+  static const size_t MaxGatherCount = 64;
+
   std::deque<std::unique_ptr<Chunk>> chunks_;
+
+  //! scratch space for the byte ranges of a gathered write
+  mutable BufferRef gather_[MaxGatherCount];
 };
 
 // {{{ Chunk API
@@ -73,6 +131,27 @@ class XZERO_API EndPointWriter::Chunk {
   virtual ~Chunk() {}
 
   virtual bool transferTo(EndPoint* sink) = 0;
+
+  /**
+   * Retrieves the number of bytes not yet transferred.
+   */
+  virtual size_t size() const = 0;
+
+  /**
+   * Retrieves the pending bytes of an in-memory chunk.
+   *
+   * @param result array to store the pending byte ranges into.
+   * @param count number of entries available in @p result.
+   *
+   * @return number of ranges stored into @p result, or 0 if this chunk
+   *         cannot be part of a gathered write (of @p count ranges).
+   */
+  virtual size_t pending(BufferRef* result, size_t count) const { return 0; }
+
+  /**
+   * Marks the first @p n pending bytes as transferred.
+   */
+  virtual void advance(size_t n) {}
 };
 
 class XZERO_API EndPointWriter::BufferChunk : public Chunk {
@@ -87,6 +166,9 @@ class XZERO_API EndPointWriter::BufferChunk : public Chunk {
       : data_(copy), offset_(0) {}
 
   bool transferTo(EndPoint* sink) override;
+  size_t size() const override { return data_.size() - offset_; }
+  size_t pending(BufferRef* result, size_t count) const override;
+  void advance(size_t n) override { offset_ += n; }
 
  private:
   Buffer data_;
@@ -99,12 +181,62 @@ class XZERO_API EndPointWriter::BufferRefChunk : public Chunk {
       : data_(buffer), offset_(0) {}
 
   bool transferTo(EndPoint* sink) override;
+  size_t size() const override { return data_.size() - offset_; }
+  size_t pending(BufferRef* result, size_t count) const override;
+  void advance(size_t n) override { offset_ += n; }
+
+  /** Retrieves the pending bytes, which this chunk does not own. */
+  BufferRef data() const { return data_.ref(offset_); }
 
  private:
   BufferRef data_;
   size_t offset_;
 };
 
+class XZERO_API EndPointWriter::InlineChunk : public Chunk {
+ public:
+  explicit InlineChunk(const BufferRef& data);
+
+  bool transferTo(EndPoint* sink) override;
+  size_t size() const override { return size_ - offset_; }
+  size_t pending(BufferRef* result, size_t count) const override;
+  void advance(size_t n) override { offset_ += n; }
+
+ private:
+  char data_[MaxFrameSize];
+  unsigned char size_;
+  unsigned char offset_;
+};
+
+class XZERO_API EndPointWriter::FramedChunk : public Chunk {
+ public:
+  FramedChunk(const BufferRef& prefix, Buffer&& data, const BufferRef& suffix);
+  FramedChunk(const BufferRef& prefix, const BufferRef& data,
+              const BufferRef& suffix);
+
+  /** Retrieves the size of the payload if not owned by this chunk. */
+  size_t referencedSize() const { return data_.empty() ? ref_.size() : 0; }
+
+  /** Replaces a referenced payload with an owned copy. */
+  void detach();
+
+  bool transferTo(EndPoint* sink) override;
+  size_t size() const override {
+    return prefixSize_ + ref_.size() + suffixSize_ - offset_;
+  }
+  size_t pending(BufferRef* result, size_t count) const override;
+  void advance(size_t n) override { offset_ += n; }
+
+ private:
+  char prefix_[MaxFrameSize];
+  char suffix_[MaxFrameSize];
+  unsigned char prefixSize_;
+  unsigned char suffixSize_;
+  Buffer data_;
+  BufferRef ref_;
+  size_t offset_;
+};
+
 class XZERO_API EndPointWriter::FileChunk : public Chunk {
  public:
   explicit FileChunk(FileRef&& ref)
@@ -113,6 +245,7 @@ class XZERO_API EndPointWriter::FileChunk : public Chunk {
   ~FileChunk();
 
   bool transferTo(EndPoint* sink) override;
+  size_t size() const override { return file_.size(); }
 
  private:
   FileRef file_;
@@ -18,6 +18,7 @@
 #include <xzero-base/RefPtr.h>
 #include <stdexcept>
 #include <netinet/tcp.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
@@ -36,6 +37,9 @@ namespace xzero {
 #define TRACE(msg...) do {} while (0)
 #endif
 
+// maximum number of buffers passed to a single writev() call
+static const size_t MaxGatherCount = 64;
+
 InetEndPoint::InetEndPoint(int socket,
                            InetConnector* connector,
                            Scheduler* scheduler)
@@ -43,9 +47,11 @@ InetEndPoint::InetEndPoint(int socket,
       connector_(connector),
       scheduler_(scheduler),
       idleTimeout_(connector->clock(), connector->scheduler()),
-      io_(),
+      readIo_(),
+      writeIo_(),
       handle_(socket),
-      isCorking_(false) {
+      isCorking_(false),
+      isTcpNoDelay_(false) {
 
   idleTimeout_.setCallback(std::bind(&InetEndPoint::onTimeout, this));
   idleTimeout_.setTimeout(connector->idleTimeout());
@@ -179,6 +185,20 @@ void InetEndPoint::setCorking(bool enable) {
 #endif
 }
 
+bool InetEndPoint::isTcpNoDelay() const {
+  return isTcpNoDelay_;
+}
+
+void InetEndPoint::setTcpNoDelay(bool enable) {
+  if (isTcpNoDelay_ != enable) {
+    int flag = enable ? 1 : 0;
+    if (setsockopt(handle_, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag)) < 0)
+      RAISE_ERRNO(errno);
+
+    isTcpNoDelay_ = enable;
+  }
+}
+
 std::string InetEndPoint::toString() const {
   char buf[32];
   snprintf(buf, sizeof(buf), "InetEndPoint(%d)@%p", handle(), this);
@@ -238,6 +258,25 @@ size_t InetEndPoint::flush(int fd, off_t offset, size_t size) {
 #endif
 }
 
+size_t InetEndPoint::flush(const BufferRef* sources, size_t count) {
+  iovec vec[MaxGatherCount];
+
+  if (count > MaxGatherCount)
+    count = MaxGatherCount;
+
+  for (size_t i = 0; i < count; ++i) {
+    vec[i].iov_base = const_cast<char*>(sources[i].data());
+    vec[i].iov_len = sources[i].size();
+  }
+
+  ssize_t rv = writev(handle(), vec, static_cast<int>(count));
+
+  if (rv < 0)
+    RAISE_ERRNO(errno);
+
+  return rv;
+}
+
 void InetEndPoint::onReadable() XZERO_NOEXCEPT {
   RefPtr<EndPoint> _guard(this);
 
@@ -271,8 +310,8 @@ void InetEndPoint::wantFill() {
   // TODO: abstract away the logic of TCP_DEFER_ACCEPT
 
   //idleTimeout_.activate();
-  if (!io_) {
-    io_ = scheduler_->executeOnReadable(
+  if (!readIo_) {
+    readIo_ = scheduler_->executeOnReadable(
         handle(),
         std::bind(&InetEndPoint::fillable, this));
   }
@@ -282,7 +321,7 @@ void InetEndPoint::fillable() {
   RefPtr<EndPoint> _guard(this);
 
   try {
-    io_.reset();
+    readIo_.reset();
     connection()->onFillable();
   } catch (const std::exception& e) {
     connection()->onInterestFailure(e);
@@ -294,11 +333,11 @@ void InetEndPoint::fillable() {
 }
 
 void InetEndPoint::wantFlush() {
-  TRACE("%p wantFlush() %s", this, io_.get() ? "again" : "first time");
+  TRACE("%p wantFlush() %s", this, writeIo_.get() ? "again" : "first time");
   //idleTimeout_.activate();
 
-  if (!io_) {
-    io_ = scheduler_->executeOnWritable(
+  if (!writeIo_) {
+    writeIo_ = scheduler_->executeOnWritable(
         handle(),
         std::bind(&InetEndPoint::flushable, this));
   }
@@ -308,7 +347,7 @@ void InetEndPoint::flushable() {
   RefPtr<EndPoint> _guard(this);
 
   try {
-    io_.reset();
+    writeIo_.reset();
     connection()->onFlushable();
   } catch (const std::exception& e) {
     connection()->onInterestFailure(e);
@@ -47,10 +47,13 @@ class XZERO_API InetEndPoint : public EndPoint {
   void setBlocking(bool enable) override;
   bool isCorking() const override;
   void setCorking(bool enable) override;
+  bool isTcpNoDelay() const override;
+  void setTcpNoDelay(bool enable) override;
   std::string toString() const override;
   size_t fill(Buffer* result) override;
   size_t flush(const BufferRef& source) override;
   size_t flush(int fd, off_t offset, size_t size) override;
+  size_t flush(const BufferRef* sources, size_t count) override;
   void wantFill() override;
   void wantFlush() override;
   TimeSpan idleTimeout() override;
@@ -68,9 +71,11 @@ class XZERO_API InetEndPoint : public EndPoint {
   InetConnector* connector_;
   Scheduler* scheduler_;
   IdleTimeout idleTimeout_;
-  Scheduler::HandleRef io_;
+  Scheduler::HandleRef readIo_;
+  Scheduler::HandleRef writeIo_;
   int handle_;
   bool isCorking_;
+  bool isTcpNoDelay_;
 };
 
 } // namespace xzero
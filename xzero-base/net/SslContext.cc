@@ -10,6 +10,7 @@
 #include <xzero-base/net/SslConnector.h>
 #include <xzero-base/net/SslContext.h>
 #include <xzero-base/net/Connection.h>
+#include <xzero-base/net/ConnectionFactory.h>
 #include <xzero-base/sysconfig.h>
 #include <xzero-base/RuntimeError.h>
 #include <openssl/bio.h>
@@ -174,31 +175,46 @@ SslContext::~SslContext() {
   SSL_CTX_free(ctx_);
 }
 
-#define NPN_HTTP_1_1 "\x08http/1.1"
-#define NPN_BLAH_1_0 "\x08" "blah/1.0"
-
+/**
+ * ALPN-callback invoked to select the protocol to speak from the list of
+ * protocols offered by the client.
+ *
+ * Prefers HTTP/2 ("h2") and otherwise picks the first protocol offered by
+ * the client that has a connection factory registered at the connector.
+ */
 int SslContext::onAppLayerProtoNegotiation(SSL* ssl,
     const unsigned char **out, unsigned char *outlen,
     const unsigned char *in, unsigned int inlen, void *pself) {
 #ifdef TLSEXT_TYPE_application_layer_protocol_negotiation
   TRACE("SSL ALPN callback");
+  SslContext* self = static_cast<SslContext*>(pself);
 
-  for (int i = 0; i < inlen; i += in[i] + 1) {
-    std::string proto((char*)&in[i + 1], in[i]);
-    printf("SSL ALPN client support [%d]: (%d) %s\n", i, in[i], proto.c_str());
-  }
+  const unsigned char* selected = nullptr;
+  unsigned char selectedLength = 0;
 
-  const unsigned char* srv = (const unsigned char*) NPN_HTTP_1_1;
-  unsigned int srvlen = sizeof(NPN_HTTP_1_1) - 1;
+  for (unsigned int i = 0; i < inlen; i += in[i] + 1) {
+    std::string proto((const char*) &in[i + 1],
+                      std::min<unsigned int>(in[i], inlen - i - 1));
+    TRACE("SSL ALPN client support: \"%s\"", proto.c_str());
 
-  int rv = SSL_select_next_proto(
-      (unsigned char**) out, outlen,
-      srv, srvlen,
-      in, inlen);
+    if (!self->connector_->connectionFactory(proto))
+      continue;
 
-  if (rv != OPENSSL_NPN_NEGOTIATED)
+    if (proto == "h2" || !selected) {
+      selected = &in[i + 1];
+      selectedLength = in[i];
+      if (proto == "h2") {
+        break;
+      }
+    }
+  }
+
+  if (!selected)
     return SSL_TLSEXT_ERR_NOACK;
 
+  *out = selected;
+  *outlen = selectedLength;
+
   TRACE("SSL ALPN selected: \"%*s\"", *outlen, *out);
 
   return SSL_TLSEXT_ERR_OK;
@@ -215,9 +231,21 @@ int SslContext::onNextProtosAdvertised(SSL* ssl,
     const unsigned char** out, unsigned int* outlen, void* pself) {
 #ifdef TLSEXT_TYPE_next_proto_neg
   TRACE("%p NPN callback", pself);
+  SslContext* self = static_cast<SslContext*>(pself);
+
+  if (self->nextProtos_.empty()) {
+    for (const auto& factory: self->connector_->connectionFactories()) {
+      const std::string& name = factory->protocolName();
+      if (name.empty() || name.size() > 255)
+        continue;
+
+      self->nextProtos_.push_back(static_cast<char>(name.size()));
+      self->nextProtos_.append(name);
+    }
+  }
 
-  *out = (const unsigned char*) NPN_BLAH_1_0 NPN_HTTP_1_1;
-  *outlen = sizeof(NPN_BLAH_1_0 NPN_HTTP_1_1) - 1;
+  *out = (const unsigned char*) self->nextProtos_.data();
+  *outlen = self->nextProtos_.size();
 
   return SSL_TLSEXT_ERR_OK;
 #else
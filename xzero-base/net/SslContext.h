@@ -46,6 +46,7 @@ class XZERO_API SslContext {
   SslConnector* connector_;
   SSL_CTX* ctx_;
   std::vector<std::string> dnsNames_;
+  std::string nextProtos_;
 };
 
 inline SSL_CTX* SslContext::get() const {
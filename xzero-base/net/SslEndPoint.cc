@@ -16,6 +16,7 @@
 #include <xzero-base/RuntimeError.h>
 #include <openssl/ssl.h>
 #include <openssl/err.h>
+#include <netinet/tcp.h>
 #include <fcntl.h>
 #include <unistd.h>
 
@@ -40,11 +41,13 @@ SslEndPoint::SslEndPoint(
     int socket, SslConnector* connector, Scheduler* scheduler)
     : handle_(socket),
       isCorking_(false),
+      isTcpNoDelay_(false),
       connector_(connector),
       scheduler_(scheduler),
       ssl_(nullptr),
       bioDesire_(Desire::None),
-      io_(),
+      readIo_(),
+      writeIo_(),
       idleTimeout_(connector->clock(), scheduler) {
   TRACE("%p SslEndPoint() ctor", this);
 
@@ -90,12 +93,12 @@ void SslEndPoint::shutdown() {
   } else {
     switch (SSL_get_error(ssl_, rv)) {
       case SSL_ERROR_WANT_READ:
-        io_ = scheduler_->executeOnReadable(
+        readIo_ = scheduler_->executeOnReadable(
             handle(),
             std::bind(&SslEndPoint::shutdown, this));
         break;
       case SSL_ERROR_WANT_WRITE:
-        io_ = scheduler_->executeOnWritable(
+        writeIo_ = scheduler_->executeOnWritable(
             handle(),
             std::bind(&SslEndPoint::shutdown, this));
         break;
@@ -205,7 +208,7 @@ size_t SslEndPoint::flush(int fd, off_t offset, size_t size) {
 }
 
 void SslEndPoint::wantFill() {
-  if (io_) {
+  if (readIo_) {
     TRACE("%p wantFill: ignored due to active io", this);
     return;
   }
@@ -214,13 +217,13 @@ void SslEndPoint::wantFill() {
     case Desire::None:
     case Desire::Read:
       TRACE("%p wantFill: read", this);
-      io_ = scheduler_->executeOnReadable(
+      readIo_ = scheduler_->executeOnReadable(
           handle(),
           std::bind(&SslEndPoint::fillable, this));
       break;
     case Desire::Write:
       TRACE("%p wantFill: write", this);
-      io_ = scheduler_->executeOnWritable(
+      readIo_ = scheduler_->executeOnWritable(
           handle(),
           std::bind(&SslEndPoint::fillable, this));
       break;
@@ -231,7 +234,7 @@ void SslEndPoint::fillable() {
   TRACE("%p fillable()", this);
   RefPtr<EndPoint> _guard(this);
   try {
-    io_.reset();
+    readIo_.reset();
     bioDesire_ = Desire::None;
     connection()->onFillable();
   } catch (const std::exception& e) {
@@ -244,7 +247,7 @@ void SslEndPoint::fillable() {
 }
 
 void SslEndPoint::wantFlush() {
-  if (io_) {
+  if (writeIo_) {
     TRACE("%p wantFlush: ignored due to active io", this);
     return;
   }
@@ -252,14 +255,14 @@ void SslEndPoint::wantFlush() {
   switch (bioDesire_) {
     case Desire::Read:
       TRACE("%p wantFlush: read", this);
-      io_ = scheduler_->executeOnReadable(
+      writeIo_ = scheduler_->executeOnReadable(
           handle(),
           std::bind(&SslEndPoint::flushable, this));
       break;
     case Desire::None:
     case Desire::Write:
       TRACE("%p wantFlush: write", this);
-      io_ = scheduler_->executeOnWritable(
+      writeIo_ = scheduler_->executeOnWritable(
           handle(),
           std::bind(&SslEndPoint::flushable, this));
       break;
@@ -310,6 +313,20 @@ void SslEndPoint::setCorking(bool enable) {
 #endif
 }
 
+bool SslEndPoint::isTcpNoDelay() const {
+  return isTcpNoDelay_;
+}
+
+void SslEndPoint::setTcpNoDelay(bool enable) {
+  if (isTcpNoDelay_ != enable) {
+    int flag = enable ? 1 : 0;
+    if (setsockopt(handle(), IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag)) < 0)
+      RAISE_ERRNO(errno);
+
+    isTcpNoDelay_ = enable;
+  }
+}
+
 std::string SslEndPoint::toString() const {
   char buf[64];
   int n = snprintf(buf, sizeof(buf), "SslEndPoint(fd=%d)", handle());
@@ -362,7 +379,7 @@ void SslEndPoint::flushable() {
   TRACE("%p flushable()", this);
   RefPtr<EndPoint> _guard(this);
   try {
-    io_.reset();
+    writeIo_.reset();
     bioDesire_ = Desire::None;
     connection()->onFlushable();
   } catch (const std::exception& e) {
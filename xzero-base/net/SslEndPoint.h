@@ -74,6 +74,8 @@ class XZERO_API SslEndPoint : public EndPoint {
   void setBlocking(bool enable) override;
   bool isCorking() const override;
   void setCorking(bool enable) override;
+  bool isTcpNoDelay() const override;
+  void setTcpNoDelay(bool enable) override;
   std::string toString() const override;
 
   /**
@@ -102,11 +104,13 @@ class XZERO_API SslEndPoint : public EndPoint {
  private:
   int handle_;
   bool isCorking_;
+  bool isTcpNoDelay_;
   SslConnector* connector_;
   Scheduler* scheduler_;
   SSL* ssl_;
   Desire bioDesire_;
-  Scheduler::HandleRef io_;
+  Scheduler::HandleRef readIo_;
+  Scheduler::HandleRef writeIo_;
   IdleTimeout idleTimeout_;
 };
 
@@ -61,6 +61,8 @@
 /* #undef HAVE_LIBAIO_H */
 #define HAVE_ZLIB_H
 /* #undef HAVE_BZLIB_H */
+/* #undef HAVE_BROTLI_ENCODE_H */
+/* #undef HAVE_ZSTD_H */
 /* #undef HAVE_GNUTLS_H */
 /* #undef HAVE_LUA_H */
 /* #undef HAVE_PCRE_H */
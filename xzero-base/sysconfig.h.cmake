@@ -61,6 +61,8 @@
 #cmakedefine HAVE_LIBAIO_H
 #cmakedefine HAVE_ZLIB_H
 #cmakedefine HAVE_BZLIB_H
+#cmakedefine HAVE_BROTLI_ENCODE_H
+#cmakedefine HAVE_ZSTD_H
 #cmakedefine HAVE_GNUTLS_H
 #cmakedefine HAVE_LUA_H
 #cmakedefine HAVE_PCRE_H
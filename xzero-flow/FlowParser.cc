@@ -245,10 +245,10 @@ vm::Opcode makeOperator(FlowToken token, Expr* left, Expr* right) {
            {FlowToken::BitXor, Opcode::NXOR},
            {FlowToken::Equal, Opcode::NCMPEQ},
            {FlowToken::UnEqual, Opcode::NCMPNE},
-           {FlowToken::LessOrEqual, Opcode::NCMPLT},
-           {FlowToken::GreaterOrEqual, Opcode::NCMPGT},
-           {FlowToken::Less, Opcode::NCMPLE},
-           {FlowToken::Greater, Opcode::NCMPGE}, }},
+           {FlowToken::LessOrEqual, Opcode::NCMPLE},
+           {FlowToken::GreaterOrEqual, Opcode::NCMPGE},
+           {FlowToken::Less, Opcode::NCMPLT},
+           {FlowToken::Greater, Opcode::NCMPGT}, }},
          {OpSig::StringString,
           {{FlowToken::Plus, Opcode::SADD},
            {FlowToken::Equal, Opcode::SCMPEQ},
@@ -0,0 +1,479 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#include <gtest/gtest.h>
+#include <xzero-flow/mock/MockRuntime.h>
+#include <xzero-flow/sysconfig.h>
+#include <xzero-flow/vm/Handler.h>
+#include <xzero-flow/vm/Instruction.h>
+#include <xzero-flow/vm/Program.h>
+#include <limits>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace xzero;
+using namespace xzero::flow;
+
+// Runs the handler "main" of @p program and returns what it emitted.
+//
+// With the JIT compiler available, the handler runs interpreted as well as
+// compiled to native code, which must emit the same.
+static std::vector<std::string> execute(MockRuntime* runtime,
+                                        vm::Program* program) {
+#if defined(ENABLE_FLOW_JIT)
+  const unsigned threshold = vm::Handler::jitThreshold();
+  vm::Handler::setJitThreshold(std::numeric_limits<unsigned>::max());
+#endif
+
+  runtime->clear();
+  runtime->run(program, "main");
+  const std::vector<std::string> output = runtime->output();
+
+#if defined(ENABLE_FLOW_JIT)
+  // setting the code anew gets it compiled on its next run
+  vm::Handler* handler = program->findHandler("main");
+  handler->setCode(std::vector<vm::Instruction>(handler->code()));
+  vm::Handler::setJitThreshold(0);
+
+  runtime->clear();
+  runtime->run(program, "main");
+  EXPECT_TRUE(handler->jitEntry() != nullptr)
+      << "Could not compile to native code.";
+  EXPECT_EQ(output, runtime->output()) << "as native code";
+
+  vm::Handler::setJitThreshold(threshold);
+#endif
+
+  return output;
+}
+
+// Runs the handler "main" of @p source, compiled at @p optimizationLevel,
+// and returns what it emitted. @p registerCount receives the number of
+// registers the handler needs.
+static std::vector<std::string> run(const std::string& source,
+                                    int optimizationLevel,
+                                    size_t* registerCount = nullptr) {
+  MockRuntime runtime;
+  std::unique_ptr<vm::Program> program = runtime.compile(source,
+                                                         optimizationLevel);
+  if (!program) {
+    ADD_FAILURE() << "Could not compile:\n" << source;
+    return {};
+  }
+
+  if (registerCount)
+    *registerCount = program->findHandler("main")->registerCount();
+
+  return execute(&runtime, program.get());
+}
+
+// Runs the handler "main" of @p source like run(), with concatenation
+// chains enabled or disabled by @p concatChains. @p multiCount receives the
+// number of SADDMULTI instructions in the handler.
+static std::vector<std::string> runConcat(const std::string& source,
+                                          int optimizationLevel,
+                                          bool concatChains,
+                                          size_t* multiCount) {
+  MockRuntime runtime;
+  runtime.setConcatChainsEnabled(concatChains);
+
+  std::unique_ptr<vm::Program> program = runtime.compile(source,
+                                                         optimizationLevel);
+  if (!program) {
+    ADD_FAILURE() << "Could not compile:\n" << source;
+    return {};
+  }
+
+  *multiCount = 0;
+  for (vm::Instruction instr : program->findHandler("main")->code())
+    if (vm::opcode(instr) == vm::Opcode::SADDMULTI)
+      ++*multiCount;
+
+  return execute(&runtime, program.get());
+}
+
+// Tests that @p source emits @p expected with and without optimizations and
+// with concatenation chains disabled, and that enabling them lowers
+// @p chainCount chains to SADDMULTI.
+static void testConcat(const std::string& source,
+                       const std::vector<std::string>& expected,
+                       size_t chainCount) {
+  for (int level = 0; level <= 1; ++level) {
+    size_t multiCount = 0;
+
+    EXPECT_EQ(expected, runConcat(source, level, false, &multiCount))
+        << "without chains at -O" << level;
+    EXPECT_EQ(0u, multiCount);
+
+    EXPECT_EQ(expected, runConcat(source, level, true, &multiCount))
+        << "with chains at -O" << level;
+    EXPECT_EQ(chainCount, multiCount) << "at -O" << level;
+  }
+}
+
+// Runs the handler "main" of @p source like run(). @p ops receives the
+// opcodes used in the handler's code.
+static std::vector<std::string> runJumps(const std::string& source,
+                                         int optimizationLevel,
+                                         std::set<vm::Opcode>* ops) {
+  MockRuntime runtime;
+  std::unique_ptr<vm::Program> program = runtime.compile(source,
+                                                         optimizationLevel);
+  if (!program) {
+    ADD_FAILURE() << "Could not compile:\n" << source;
+    return {};
+  }
+
+  ops->clear();
+  for (vm::Instruction instr : program->findHandler("main")->code())
+    ops->insert(vm::opcode(instr));
+
+  return execute(&runtime, program.get());
+}
+
+// Tests that branching on @p condition follows @p taken, once with the
+// then-block right after the jump, jumping by @p inverted if the condition
+// does not hold, and once with the else-block right after it, which the
+// optimizer turns into jumping by @p direct if the condition holds.
+static void testJump(const std::string& condition, bool taken,
+                     vm::Opcode direct, vm::Opcode inverted) {
+  const std::string source =
+      "handler main {\n"
+      "  if " + condition + " {\n"
+      "    emit('then');\n"
+      "  }\n"
+      "  if " + condition + " {\n"
+      "  } else {\n"
+      "    emit('else');\n"
+      "  }\n"
+      "}\n";
+  const std::vector<std::string> expected = {taken ? "then" : "else"};
+
+  for (int level = 0; level <= 1; ++level) {
+    std::set<vm::Opcode> ops;
+    EXPECT_EQ(expected, runJumps(source, level, &ops))
+        << condition << " at -O" << level;
+
+    EXPECT_EQ(1u, ops.count(inverted)) << condition << " at -O" << level;
+    if (level > 0) {
+      EXPECT_EQ(1u, ops.count(direct)) << condition << " at -O" << level;
+    }
+
+    EXPECT_EQ(0u, ops.count(vm::Opcode::JN) + ops.count(vm::Opcode::JZ))
+        << condition << " at -O" << level;
+  }
+}
+
+// An operator with its compare-and-jump instructions, and whether it holds
+// for 3, 4 and 5 compared with 4, or for 'a', 'b' and 'c' compared with 'b'.
+struct CompareJump {
+  std::string op;
+  vm::Opcode direct;
+  vm::Opcode inverted;
+  std::vector<bool> holds;
+};
+
+// Repeats @p text @p count times.
+static std::string repeat(const std::string& text, size_t count) {
+  std::string result;
+  for (size_t i = 0; i != count; ++i)
+    result += text;
+  return result;
+}
+
+// {{{ register allocation
+TEST(TargetCodeGenerator, reusesRegistersOfTemporaries) {
+  const std::string stmt =
+      "  emit(str('a') + str('b') + string(num(1) + num(2)));\n";
+
+  for (int level = 0; level <= 1; ++level) {
+    size_t once = 0;
+    size_t often = 0;
+
+    EXPECT_EQ(std::vector<std::string>({"ab3"}),
+              run("handler main {\n" + stmt + "}\n", level, &once));
+    EXPECT_EQ(std::vector<std::string>(10, "ab3"),
+              run("handler main {\n" + repeat(stmt, 10) + "}\n", level,
+                  &often));
+
+    EXPECT_EQ(once, often) << "at -O" << level;
+  }
+}
+
+TEST(TargetCodeGenerator, reusesRegistersAcrossBranches) {
+  const std::string stmt =
+      "  if boolean(true) {\n"
+      "    emit(str('a') + str('b'));\n"
+      "  } else {\n"
+      "    emit(string(num(1) * num(2)));\n"
+      "  }\n";
+
+  for (int level = 0; level <= 1; ++level) {
+    size_t once = 0;
+    size_t often = 0;
+
+    EXPECT_EQ(std::vector<std::string>({"ab"}),
+              run("handler main {\n" + stmt + "}\n", level, &once));
+    EXPECT_EQ(std::vector<std::string>(8, "ab"),
+              run("handler main {\n" + repeat(stmt, 8) + "}\n", level,
+                  &often));
+
+    EXPECT_EQ(once, often) << "at -O" << level;
+  }
+}
+
+TEST(TargetCodeGenerator, reusesRegistersOfInlinedHandlers) {
+  // source handlers get inlined into their caller, so calling one
+  // repeatedly unrolls its code like a loop
+  const std::string step =
+      "handler step {\n"
+      "  if str('x') + string(num(1)) == 'x1' {\n"
+      "    emit(str('y') + 'z');\n"
+      "  }\n"
+      "}\n";
+
+  for (int level = 0; level <= 1; ++level) {
+    size_t once = 0;
+    size_t often = 0;
+
+    EXPECT_EQ(std::vector<std::string>({"yz"}),
+              run(step + "handler main {\n  step;\n}\n", level, &once));
+    EXPECT_EQ(std::vector<std::string>(6, "yz"),
+              run(step + "handler main {\n" + repeat("  step;\n", 6) + "}\n",
+                  level, &often));
+
+    EXPECT_EQ(once, often) << "at -O" << level;
+  }
+}
+
+TEST(TargetCodeGenerator, keepsVariablesAcrossBranches) {
+  // the values merged into s and n after each condition must survive the
+  // temporaries allocated in between
+  const std::string source =
+      "handler main {\n"
+      "  var s = str('x');\n"
+      "  var n = num(1);\n"
+      "  if boolean(COND) {\n"
+      "    s = s + str('a');\n"
+      "    n = n + num(1);\n"
+      "  } else {\n"
+      "    s = str('b');\n"
+      "    n = num(10);\n"
+      "  }\n"
+      "  emit(str('t1') + str('t2') + string(num(3) * num(4)));\n"
+      "  if n > 1 and n < 10 {\n"
+      "    s = s + string(n);\n"
+      "  }\n"
+      "  emit(s);\n"
+      "  emit(n);\n"
+      "}\n";
+
+  for (int level = 0; level <= 1; ++level) {
+    std::string taken = source;
+    taken.replace(taken.find("COND"), 4, "true");
+    EXPECT_EQ(std::vector<std::string>({"t1t212", "xa2", "2"}),
+              run(taken, level)) << "at -O" << level;
+
+    std::string notTaken = source;
+    notTaken.replace(notTaken.find("COND"), 4, "false");
+    EXPECT_EQ(std::vector<std::string>({"t1t212", "b", "10"}),
+              run(notTaken, level)) << "at -O" << level;
+  }
+}
+
+TEST(TargetCodeGenerator, keepsValuesAcrossMatchCases) {
+  const std::string source =
+      "handler main {\n"
+      "  var prefix = str('p');\n"
+      "  match str(PATH) {\n"
+      "    on '/a' {\n"
+      "      prefix = prefix + str('a');\n"
+      "    }\n"
+      "    on '/b' {\n"
+      "      emit(str('b') + string(num(2)));\n"
+      "    }\n"
+      "    else {\n"
+      "      prefix = str('e');\n"
+      "    }\n"
+      "  }\n"
+      "  emit(prefix + str('!'));\n"
+      "}\n";
+
+  const std::vector<std::pair<std::string, std::vector<std::string>>> cases =
+      {{"'/a'", {"pa!"}}, {"'/b'", {"b2", "p!"}}, {"'/c'", {"e!"}}};
+
+  for (int level = 0; level <= 1; ++level) {
+    for (const auto& one : cases) {
+      std::string program = source;
+      program.replace(program.find("PATH"), 4, one.first);
+      EXPECT_EQ(one.second, run(program, level))
+          << one.first << " at -O" << level;
+    }
+  }
+}
+// }}}
+
+// {{{ concatenation chains
+TEST(TargetCodeGenerator, concatConstantsAndVariables) {
+  testConcat(
+      "handler main {\n"
+      "  var a = str('a');\n"
+      "  var n = num(7);\n"
+      "  emit(a + '-' + str('b') + '-' + string(n) + '!');\n"
+      "}\n",
+      {"a-b-7!"}, 1);
+}
+
+TEST(TargetCodeGenerator, concatCastOperands) {
+  testConcat(
+      "handler main {\n"
+      "  emit(string(num(1)) + string(num(2) * num(10)) + string(num(3)));\n"
+      "  emit(string(ip(10.0.0.1)) + ' in ' + string(cidr(10.0.0.0/8)));\n"
+      "}\n",
+      {"1203", "10.0.0.1 in 10.0.0.0/8"}, 2);
+}
+
+TEST(TargetCodeGenerator, concatReassignedVariables) {
+  // each assignment ends a chain, while the new value is read by the next
+  testConcat(
+      "handler main {\n"
+      "  var s = str('a');\n"
+      "  s = s + '-' + str('b');\n"
+      "  s = s + '-' + string(num(3));\n"
+      "  emit(s + '!' + s);\n"
+      "  s = str('c');\n"
+      "  emit(s + '!' + s);\n"
+      "}\n",
+      {"a-b-3!a-b-3", "c!c"}, 4);
+}
+
+TEST(TargetCodeGenerator, concatSharedOperand) {
+  // a concatenation used more than once is not folded into its users
+  testConcat(
+      "handler main {\n"
+      "  var ab = str('a') + str('b');\n"
+      "  emit(ab + ab + str('c') + ab);\n"
+      "}\n",
+      {"ababcab"}, 1);
+}
+
+TEST(TargetCodeGenerator, concatAcrossBlocks) {
+  testConcat(
+      "handler main {\n"
+      "  var p = str('p') + str('q') + str('r');\n"
+      "  if boolean(true) {\n"
+      "    emit(p + str('s') + 't');\n"
+      "  } else {\n"
+      "    emit(p + str('x') + 'y');\n"
+      "  }\n"
+      "  emit(p + p);\n"
+      "}\n",
+      {"pqrst", "pqrpqr"}, 3);
+}
+
+TEST(TargetCodeGenerator, concatLongChain) {
+  std::string source = "handler main {\n  emit(str('0')";
+  std::string expected = "0";
+  for (int i = 1; i < 40; ++i) {
+    source += " + string(num(" + std::to_string(i) + "))";
+    expected += std::to_string(i);
+  }
+  source += ");\n}\n";
+
+  testConcat(source, {expected}, 1);
+}
+// }}}
+
+// {{{ compare-and-jump
+TEST(TargetCodeGenerator, numberCompareJumps) {
+  const std::vector<CompareJump> compares = {
+      {"==", vm::Opcode::NJEQ, vm::Opcode::NJNE, {false, true, false}},
+      {"!=", vm::Opcode::NJNE, vm::Opcode::NJEQ, {true, false, true}},
+      {"<=", vm::Opcode::NJLE, vm::Opcode::NJGT, {true, true, false}},
+      {">=", vm::Opcode::NJGE, vm::Opcode::NJLT, {false, true, true}},
+      {"<", vm::Opcode::NJLT, vm::Opcode::NJGE, {true, false, false}},
+      {">", vm::Opcode::NJGT, vm::Opcode::NJLE, {false, false, true}},
+  };
+
+  for (const CompareJump& compare : compares)
+    for (int i = 0; i < 3; ++i)
+      testJump("num(" + std::to_string(3 + i) + ") " + compare.op + " num(4)",
+               compare.holds[i], compare.direct, compare.inverted);
+}
+
+TEST(TargetCodeGenerator, immediateCompareJumps) {
+  const std::vector<CompareJump> compares = {
+      {"==", vm::Opcode::NIJEQ, vm::Opcode::NIJNE, {false, true, false}},
+      {"!=", vm::Opcode::NIJNE, vm::Opcode::NIJEQ, {true, false, true}},
+      {"<=", vm::Opcode::NIJLE, vm::Opcode::NIJGT, {true, true, false}},
+      {">=", vm::Opcode::NIJGE, vm::Opcode::NIJLT, {false, true, true}},
+      {"<", vm::Opcode::NIJLT, vm::Opcode::NIJGE, {true, false, false}},
+      {">", vm::Opcode::NIJGT, vm::Opcode::NIJLE, {false, false, true}},
+  };
+
+  for (const CompareJump& compare : compares)
+    for (int i = 0; i < 3; ++i)
+      testJump("num(" + std::to_string(3 + i) + ") " + compare.op + " 4",
+               compare.holds[i], compare.direct, compare.inverted);
+}
+
+TEST(TargetCodeGenerator, stringCompareJumps) {
+  const std::vector<CompareJump> compares = {
+      {"==", vm::Opcode::SJEQ, vm::Opcode::SJNE, {false, true, false}},
+      {"!=", vm::Opcode::SJNE, vm::Opcode::SJEQ, {true, false, true}},
+  };
+  const std::vector<std::string> strings = {"'a'", "'b'", "'c'"};
+
+  for (const CompareJump& compare : compares)
+    for (int i = 0; i < 3; ++i)
+      testJump("str(" + strings[i] + ") " + compare.op + " str('b')",
+               compare.holds[i], compare.direct, compare.inverted);
+}
+
+TEST(TargetCodeGenerator, stringConstantCompareJumps) {
+  const std::vector<CompareJump> compares = {
+      {"==", vm::Opcode::SIJEQ, vm::Opcode::SIJNE, {false, true, false}},
+      {"!=", vm::Opcode::SIJNE, vm::Opcode::SIJEQ, {true, false, true}},
+  };
+  const std::vector<std::string> strings = {"'a'", "'b'", "'c'"};
+
+  for (const CompareJump& compare : compares) {
+    for (int i = 0; i < 3; ++i) {
+      testJump("str(" + strings[i] + ") " + compare.op + " 'b'",
+               compare.holds[i], compare.direct, compare.inverted);
+      testJump("'b' " + compare.op + " str(" + strings[i] + ")",
+               compare.holds[i], compare.direct, compare.inverted);
+    }
+  }
+}
+
+TEST(TargetCodeGenerator, keepsStringConstantsUsedAfterJumps) {
+  // the constant compared against is still needed after the comparison
+  const std::string source =
+      "handler main {\n"
+      "  var s = 'b';\n"
+      "  if str(PATH) == s {\n"
+      "    emit(s + '!');\n"
+      "  }\n"
+      "  emit(s);\n"
+      "}\n";
+
+  for (int level = 0; level <= 1; ++level) {
+    std::string taken = source;
+    taken.replace(taken.find("PATH"), 4, "'b'");
+    EXPECT_EQ(std::vector<std::string>({"b!", "b"}), run(taken, level))
+        << "at -O" << level;
+
+    std::string notTaken = source;
+    notTaken.replace(notTaken.find("PATH"), 4, "'a'");
+    EXPECT_EQ(std::vector<std::string>({"b"}), run(notTaken, level))
+        << "at -O" << level;
+  }
+}
+// }}}
@@ -18,6 +18,8 @@
 #include <xzero-flow/ir/IRBuiltinFunction.h>
 #include <xzero-flow/FlowType.h>
 #include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
 
 namespace xzero {
 namespace flow {
@@ -34,6 +36,15 @@ std::vector<T> convert(const std::vector<Constant*>& source) {
   return target;
 }
 
+/**
+ * Tests whether given constant can be encoded as immediate operand.
+ *
+ * Immediate operands are unsigned and 16 bits wide.
+ */
+static bool isImmediate(ConstantInt* value) {
+  return value && value->get() == ImmOperand(value->get());
+}
+
 TargetCodeGenerator::TargetCodeGenerator()
     : errors_(),
       conditionalJumps_(),
@@ -41,7 +52,14 @@ TargetCodeGenerator::TargetCodeGenerator()
       handlerId_(0),
       code_(),
       variables_(),
-      allocations_() {
+      allocations_(),
+      position_(0),
+      liveRanges_(),
+      liveAhead_(),
+      active_(),
+      temporaries_(),
+      concatChainsEnabled_(true),
+      concatChains_() {
   // preserve r0, so it'll never be used.
   allocations_.push_back(true);
 }
@@ -63,11 +81,23 @@ void TargetCodeGenerator::generate(IRHandler* handler) {
 
   std::unordered_map<BasicBlock*, size_t> basicBlockEntryPoints;
 
+  if (concatChainsEnabled_)
+    findConcatChains(handler);
+
+  computeLiveness(handler);
+
   // generate code for all basic blocks, sequentially
   for (BasicBlock* bb : handler->basicBlocks()) {
     basicBlockEntryPoints[bb] = getInstructionPointer();
     for (Instr* instr : bb->instructions()) {
+      scan();
       instr->accept(*this);
+
+      for (const auto& temporary : temporaries_)
+        free(temporary.first, temporary.second);
+      temporaries_.clear();
+
+      ++position_;
     }
   }
 
@@ -75,8 +105,13 @@ void TargetCodeGenerator::generate(IRHandler* handler) {
   for (const auto& target : conditionalJumps_) {
     size_t targetPC = basicBlockEntryPoints[target.first];
     for (const auto& source : target.second) {
-      code_[source.pc] =
-          makeInstruction(source.opcode, source.condition, targetPC);
+      if (operandSignature(source.opcode) == InstructionSig::RI) {
+        code_[source.pc] =
+            makeInstruction(source.opcode, source.condition, targetPC);
+      } else {
+        code_[source.pc] = makeInstruction(source.opcode, source.condition,
+                                           source.operand, targetPC);
+      }
     }
   }
   conditionalJumps_.clear();
@@ -110,8 +145,13 @@ void TargetCodeGenerator::generate(IRHandler* handler) {
   cp_.getHandler(handlerId_).second = std::move(code_);
 
   // cleanup remaining handler-local work vars
-  allocations_.clear();
+  allocations_.assign(1, true);
   variables_.clear();
+  position_ = 0;
+  liveRanges_.clear();
+  liveAhead_.clear();
+  active_.clear();
+  concatChains_.clear();
 }
 
 /**
@@ -157,14 +197,16 @@ size_t TargetCodeGenerator::emitBinaryAssoc(Instr& instr, Opcode rr,
 
   Register a = allocate(1, instr);
 
-  if (auto i = dynamic_cast<ConstantInt*>(instr.operand(1))) {
+  auto i = dynamic_cast<ConstantInt*>(instr.operand(1));
+  if (isImmediate(i)) {
     Register b = getRegister(instr.operand(0));
     return emit(ri, a, b, i->get());
   }
 
-  if (auto i = dynamic_cast<ConstantInt*>(instr.operand(0))) {
+  auto j = dynamic_cast<ConstantInt*>(instr.operand(0));
+  if (isImmediate(j)) {
     Register b = getRegister(instr.operand(1));
-    return emit(ri, a, b, i->get());
+    return emit(ri, a, b, j->get());
   }
 
   Register b = getRegister(instr.operand(0));
@@ -178,7 +220,8 @@ size_t TargetCodeGenerator::emitBinary(Instr& instr, Opcode rr, Opcode ri) {
 
   Register a = allocate(1, instr);
 
-  if (auto i = dynamic_cast<ConstantInt*>(instr.operand(1))) {
+  auto i = dynamic_cast<ConstantInt*>(instr.operand(1));
+  if (isImmediate(i)) {
     Register b = getRegister(instr.operand(0));
     return emit(ri, a, b, i->get());
   }
@@ -197,20 +240,265 @@ size_t TargetCodeGenerator::emitUnary(Instr& instr, vm::Opcode r) {
   return emit(r, a, b);
 }
 
+/**
+ * Retrieves the value owning the register that given \p value is kept in.
+ *
+ * Loads and casts to the same type do not get a register on their own but
+ * refer to the register of their operand.
+ */
+static Value* registerOwner(Value* value) {
+  if (auto load = dynamic_cast<LoadInstr*>(value))
+    return registerOwner(load->variable());
+
+  if (auto cast = dynamic_cast<CastInstr*>(value))
+    if (cast->type() == cast->source()->type() &&
+        dynamic_cast<Instr*>(cast->source()))
+      return registerOwner(cast->source());
+
+  return value;
+}
+
+void TargetCodeGenerator::computeLiveness(IRHandler* handler) {
+  struct BlockInfo {
+    size_t begin;
+    size_t end;
+    std::unordered_set<Value*> uses;  // used before being defined
+    std::unordered_set<Value*> defs;
+    std::unordered_set<Value*> liveIn;
+    std::unordered_set<Value*> liveOut;
+  };
+
+  std::unordered_map<BasicBlock*, BlockInfo> blocks;
+  std::unordered_map<Value*, size_t> definitions;
+
+  auto extend = [&](Value* value, size_t position) {
+    auto i = liveRanges_.find(value);
+    if (i == liveRanges_.end()) {
+      liveRanges_[value] = {position, position};
+    } else {
+      i->second.begin = std::min(i->second.begin, position);
+      i->second.end = std::max(i->second.end, position);
+    }
+  };
+
+  // operands of folded concatenations are read by their chain's root
+  std::unordered_map<Value*, size_t> positions;
+  size_t position = 0;
+  for (BasicBlock* bb : handler->basicBlocks())
+    for (Instr* instr : bb->instructions())
+      positions[instr] = position++;
+
+  position = 0;
+  for (BasicBlock* bb : handler->basicBlocks()) {
+    BlockInfo& info = blocks[bb];
+    info.begin = position;
+
+    for (Instr* instr : bb->instructions()) {
+      const bool folded = concatChains_.count(instr) != 0;
+      const size_t usePosition =
+          folded ? positions[concatRoot(instr)] : position;
+
+      for (Value* operand : instr->operands()) {
+        if (!dynamic_cast<Instr*>(operand) || concatChains_.count(operand))
+          continue;
+
+        Value* owner = registerOwner(operand);
+        extend(owner, usePosition);
+        if (!info.defs.count(owner))
+          info.uses.insert(owner);
+      }
+
+      if (!folded && registerOwner(instr) == instr) {
+        extend(instr, position);
+        info.defs.insert(instr);
+        definitions[instr] = position;
+      }
+
+      ++position;
+    }
+
+    info.end = position - 1;
+  }
+
+  // propagate liveness backwards through the control flow graph
+  for (bool changed = true; changed;) {
+    changed = false;
+    for (auto i = handler->basicBlocks().rbegin(),
+              e = handler->basicBlocks().rend();
+         i != e; ++i) {
+      BlockInfo& info = blocks[*i];
+
+      for (BasicBlock* successor : (*i)->successors())
+        for (Value* value : blocks[successor].liveIn)
+          info.liveOut.insert(value);
+
+      for (Value* value : info.uses)
+        if (info.liveIn.insert(value).second)
+          changed = true;
+
+      for (Value* value : info.liveOut)
+        if (!info.defs.count(value) && info.liveIn.insert(value).second)
+          changed = true;
+    }
+  }
+
+  // values live across a block boundary are live through the whole block
+  for (const auto& block : blocks) {
+    for (Value* value : block.second.liveIn)
+      extend(value, block.second.begin);
+
+    for (Value* value : block.second.liveOut)
+      extend(value, block.second.end);
+  }
+
+  for (const auto& definition : definitions) {
+    const LiveRange& range = liveRanges_[definition.first];
+    if (range.begin < definition.second)
+      liveAhead_.emplace(range.begin, definition.first);
+  }
+}
+
+void TargetCodeGenerator::findConcatChains(IRHandler* handler) {
+  for (BasicBlock* bb : handler->basicBlocks()) {
+    // a store in between might change a variable the folded
+    // concatenation reads, so chains must not span across stores
+    std::unordered_map<Value*, size_t> stores;
+    size_t storeCount = 0;
+
+    for (Instr* instr : bb->instructions()) {
+      if (dynamic_cast<StoreInstr*>(instr))
+        ++storeCount;
+
+      stores[instr] = storeCount;
+
+      for (Value* operand : instr->operands()) {
+        if (!dynamic_cast<SAddInstr*>(instr) ||
+            !dynamic_cast<SAddInstr*>(operand) ||
+            operand->uses().size() != 1 ||
+            static_cast<Instr*>(operand)->parent() != bb ||
+            stores[operand] != storeCount)
+          continue;
+
+        concatChains_[operand] = instr;
+      }
+    }
+  }
+}
+
+Value* TargetCodeGenerator::concatRoot(Value* value) const {
+  for (;;) {
+    auto i = concatChains_.find(value);
+    if (i == concatChains_.end())
+      return value;
+
+    value = i->second;
+  }
+}
+
+void TargetCodeGenerator::collectConcatOperands(
+    Value* value, std::vector<Value*>* operands) {
+  if (concatChains_.count(value)) {
+    for (Value* operand : static_cast<Instr*>(value)->operands()) {
+      collectConcatOperands(operand, operands);
+    }
+  } else {
+    operands->push_back(value);
+  }
+}
+
+void TargetCodeGenerator::scan() {
+  while (!active_.empty() && active_.begin()->first < position_) {
+    free(active_.begin()->second.first, active_.begin()->second.second);
+    active_.erase(active_.begin());
+  }
+
+  auto ahead = liveAhead_.equal_range(position_);
+  for (auto i = ahead.first; i != ahead.second; ++i)
+    allocate(1, i->second);
+}
+
 size_t TargetCodeGenerator::allocate(size_t count, Value& alias) {
-  int rbase = allocate(count);
-  variables_[&alias] = rbase;
+  // values live ahead of their definition got their register already
+  auto i = variables_.find(&alias);
+  if (i != variables_.end()) {
+    assert(count == 1);
+    return i->second;
+  }
+
+  Register rbase = allocate(count);
+  temporaries_.pop_back();
+  assign(alias, rbase, count);
+
   return rbase;
 }
 
 size_t TargetCodeGenerator::allocate(size_t count) {
-  for (size_t i = 0; i < count; ++i) allocations_.push_back(true);
+  // first fit
+  size_t rbase = 0;
+  size_t available = 0;
+  for (size_t i = 0, e = allocations_.size(); i != e && available < count;
+       ++i) {
+    if (allocations_[i]) {
+      rbase = i + 1;
+      available = 0;
+    } else {
+      ++available;
+    }
+  }
+
+  if (allocations_.size() < rbase + count)
+    allocations_.resize(rbase + count, false);
+
+  for (size_t i = rbase; i != rbase + count; ++i)
+    allocations_[i] = true;
+
+  temporaries_.push_back(std::make_pair(rbase, count));
 
-  return allocations_.size() - count;
+  return rbase;
+}
+
+/**
+ * Keeps temporary register \p reg as the register of \p value.
+ */
+void TargetCodeGenerator::adopt(Value& value, Register reg) {
+  auto i = variables_.find(&value);
+  if (i != variables_.end()) {
+    emit(Opcode::MOV, i->second, reg);
+    return;
+  }
+
+  for (auto t = temporaries_.begin(), e = temporaries_.end(); t != e; ++t) {
+    Register base = t->first;
+    size_t count = t->second;
+    if (reg < base || reg >= base + count)
+      continue;
+
+    temporaries_.erase(t);
+    if (reg > base)
+      temporaries_.push_back(std::make_pair(base, reg - base));
+    if (reg + 1 < base + count)
+      temporaries_.push_back(std::make_pair(reg + 1, base + count - reg - 1));
+
+    assign(value, reg, 1);
+    return;
+  }
+
+  variables_[&value] = reg;
+}
+
+/**
+ * Assigns registers to \p value until the end of its live range.
+ */
+void TargetCodeGenerator::assign(Value& value, Register rbase, size_t count) {
+  variables_[&value] = rbase;
+
+  auto range = liveRanges_.find(&value);
+  size_t end = range != liveRanges_.end() ? range->second.end : position_;
+  active_.emplace(end, std::make_pair(rbase, count));
 }
 
 void TargetCodeGenerator::free(size_t base, size_t count) {
-  for (int i = base, e = base + count; i != e; ++i) {
+  for (size_t i = base, e = base + count; i != e; ++i) {
     allocations_[i] = false;
   }
 }
@@ -244,7 +532,7 @@ void TargetCodeGenerator::visit(StoreInstr& instr) {
   // const int
   if (auto integer = dynamic_cast<ConstantInt*>(rhs)) {
     FlowNumber number = integer->get();
-    if (number == int16_t(number)) {  // limit to 16bit signed width
+    if (number == ImmOperand(number)) {  // limit to 16bit unsigned width
       emit(Opcode::IMOV, lhsReg, number);
     } else {
       emit(Opcode::NCONST, lhsReg, cp_.makeInteger(number));
@@ -334,7 +622,7 @@ void TargetCodeGenerator::visit(LoadInstr& instr) {
 
 Register TargetCodeGenerator::emitCallArgs(Instr& instr) {
   int argc = instr.operands().size();
-  Register rbase = allocate(argc, instr);
+  Register rbase = allocate(argc);
 
   for (int i = 1; i < argc; ++i) {
     Register tmp = getRegister(instr.operands()[i]);
@@ -360,9 +648,7 @@ void TargetCodeGenerator::visit(CallInstr& instr) {
   Register nativeId = makeNativeFunction(instr.callee());
   emit(Opcode::CALL, nativeId, argc, rbase);
 
-  variables_[&instr] = rbase;
-
-  free(rbase + 1, argc - 1);
+  adopt(instr, rbase);
 }
 
 void TargetCodeGenerator::visit(HandlerCallInstr& instr) {
@@ -374,9 +660,7 @@ void TargetCodeGenerator::visit(HandlerCallInstr& instr) {
   Register nativeId = makeNativeHandler(instr.callee());
   emit(Opcode::HANDLER, nativeId, argc, rbase);
 
-  variables_[&instr] = rbase;
-
-  free(rbase + 1, argc - 1);
+  adopt(instr, rbase);
 }
 
 vm::Operand TargetCodeGenerator::getConstantInt(Value* value) {
@@ -396,7 +680,7 @@ vm::Operand TargetCodeGenerator::getRegister(Value* value) {
     // entry block
     Register reg = allocate(1);
     FlowNumber number = integer->get();
-    if (number == int16_t(number)) {  // limit to 16bit signed width
+    if (number == ImmOperand(number)) {  // limit to 16bit unsigned width
       emit(Opcode::IMOV, reg, number);
     } else {
       emit(Opcode::NCONST, reg, cp_.makeInteger(number));
@@ -476,13 +760,96 @@ void TargetCodeGenerator::visit(PhiNode& instr) {
   assert(!"Should never reach here, as PHI instruction nodes should have been replaced by target registers.");
 }
 
+/**
+ * Retrieves the compare-and-jump instruction jumping if \p compare yields
+ * \p branchIf, or NOP if there is none.
+ */
+static Opcode fusedJump(Opcode compare, bool branchIf) {
+  switch (compare) {
+    case Opcode::NCMPEQ: return branchIf ? Opcode::NJEQ : Opcode::NJNE;
+    case Opcode::NCMPNE: return branchIf ? Opcode::NJNE : Opcode::NJEQ;
+    case Opcode::NCMPLE: return branchIf ? Opcode::NJLE : Opcode::NJGT;
+    case Opcode::NCMPGE: return branchIf ? Opcode::NJGE : Opcode::NJLT;
+    case Opcode::NCMPLT: return branchIf ? Opcode::NJLT : Opcode::NJGE;
+    case Opcode::NCMPGT: return branchIf ? Opcode::NJGT : Opcode::NJLE;
+    case Opcode::NICMPEQ: return branchIf ? Opcode::NIJEQ : Opcode::NIJNE;
+    case Opcode::NICMPNE: return branchIf ? Opcode::NIJNE : Opcode::NIJEQ;
+    case Opcode::NICMPLE: return branchIf ? Opcode::NIJLE : Opcode::NIJGT;
+    case Opcode::NICMPGE: return branchIf ? Opcode::NIJGE : Opcode::NIJLT;
+    case Opcode::NICMPLT: return branchIf ? Opcode::NIJLT : Opcode::NIJGE;
+    case Opcode::NICMPGT: return branchIf ? Opcode::NIJGT : Opcode::NIJLE;
+    case Opcode::SCMPEQ: return branchIf ? Opcode::SJEQ : Opcode::SJNE;
+    case Opcode::SCMPNE: return branchIf ? Opcode::SJNE : Opcode::SJEQ;
+    default: return Opcode::NOP;
+  }
+}
+
+/**
+ * Tests whether the last instruction emitted loads the string constant
+ * \p value into \p reg, a temporary register of the instruction using it.
+ */
+bool TargetCodeGenerator::isStringConstantLoad(Value* value, Register reg) {
+  auto string = dynamic_cast<ConstantString*>(value);
+  if (!string || code_.empty() || allocations_[reg])
+    return false;
+
+  return code_.back() == makeInstruction(Opcode::SCONST, reg,
+                                         cp_.makeString(string->get()));
+}
+
+void TargetCodeGenerator::emitCondJump(CondBrInstr& instr, bool branchIf,
+                                       BasicBlock* bb) {
+  Value* condition = instr.condition();
+  Opcode jump = branchIf ? Opcode::JN : Opcode::JZ;
+  Register cond = getRegister(condition);
+
+  // the comparison must be the last instruction emitted, within this block
+  // as nothing may jump in between, and its result not be used elsewhere
+  Instr* compare = dynamic_cast<Instr*>(condition);
+  Opcode fused = Opcode::NOP;
+  if (compare && compare->parent() == instr.parent() && !code_.empty() &&
+      operandA(code_.back()) == cond && condition->uses().size() == 1 &&
+      registerOwner(condition) == condition)
+    fused = fusedJump(opcode(code_.back()), branchIf);
+
+  if (fused == Opcode::NOP) {
+    emit(jump, cond, bb);
+    return;
+  }
+
+  Operand a = operandB(code_.back());
+  Operand b = operandC(code_.back());
+  code_.pop_back();
+
+  // compare against a string constant by its index, if it was only loaded
+  // into a temporary register for this comparison
+  if (fused == Opcode::SJEQ || fused == Opcode::SJNE) {
+    Value* lhs = compare->operand(0);
+    Value* rhs = compare->operand(1);
+
+    if (a != b && isStringConstantLoad(lhs, a)) {
+      std::swap(a, b);
+      std::swap(lhs, rhs);
+    }
+
+    if (a != b && isStringConstantLoad(rhs, b)) {
+      fused = fused == Opcode::SJEQ ? Opcode::SIJEQ : Opcode::SIJNE;
+      b = operandB(code_.back());
+      code_.pop_back();
+    }
+  }
+
+  size_t pc = emit(Opcode::NOP);
+  conditionalJumps_[bb].push_back({pc, fused, a, b});
+}
+
 void TargetCodeGenerator::visit(CondBrInstr& instr) {
   if (instr.parent()->isAfter(instr.trueBlock())) {
-    emit(Opcode::JZ, getRegister(instr.condition()), instr.falseBlock());
+    emitCondJump(instr, false, instr.falseBlock());
   } else if (instr.parent()->isAfter(instr.falseBlock())) {
-    emit(Opcode::JN, getRegister(instr.condition()), instr.trueBlock());
+    emitCondJump(instr, true, instr.trueBlock());
   } else {
-    emit(Opcode::JN, getRegister(instr.condition()), instr.trueBlock());
+    emitCondJump(instr, true, instr.trueBlock());
     emit(Opcode::JMP, instr.falseBlock());
   }
 }
@@ -549,11 +916,15 @@ void TargetCodeGenerator::visit(CastInstr& instr) {
          {FlowType::IPAddress, Opcode::P2S},
          {FlowType::Cidr, Opcode::C2S},
          {FlowType::RegExp, Opcode::R2S}, }},
-       {FlowType::Number, {{FlowType::String, Opcode::I2S}, }}, };
+       {FlowType::Number, {{FlowType::String, Opcode::S2I}, }}, };
 
   // just alias same-type casts
   if (instr.type() == instr.source()->type()) {
-    variables_[&instr] = getRegister(instr.source());
+    Register reg = getRegister(instr.source());
+    if (dynamic_cast<Constant*>(instr.source()))
+      adopt(instr, reg);
+    else
+      variables_[&instr] = reg;
     return;
   }
 
@@ -660,7 +1031,7 @@ void TargetCodeGenerator::visit(BAndInstr& instr) {
 }
 
 void TargetCodeGenerator::visit(BOrInstr& instr) {
-  emitBinary(instr, Opcode::BAND);
+  emitBinary(instr, Opcode::BOR);
 }
 
 void TargetCodeGenerator::visit(BXorInstr& instr) {
@@ -676,7 +1047,31 @@ void TargetCodeGenerator::visit(SIsEmptyInstr& instr) {
 }
 
 void TargetCodeGenerator::visit(SAddInstr& instr) {
-  emitBinary(instr, Opcode::SADD);
+  // emitted as part of the concatenation using it
+  if (concatChains_.count(&instr))
+    return;
+
+  std::vector<Value*> operands;
+  for (Value* operand : instr.operands())
+    collectConcatOperands(operand, &operands);
+
+  if (operands.size() == 2) {
+    emitBinary(instr, Opcode::SADD);
+    return;
+  }
+
+  Register a = allocate(1, instr);
+  Register rbase = allocate(operands.size());
+
+  for (size_t i = 0, e = operands.size(); i != e; ++i) {
+    if (auto str = dynamic_cast<ConstantString*>(operands[i])) {
+      emit(Opcode::SCONST, rbase + i, cp_.makeString(str->get()));
+    } else {
+      emit(Opcode::MOV, rbase + i, getRegister(operands[i]));
+    }
+  }
+
+  emit(Opcode::SADDMULTI, a, rbase, operands.size());
 }
 
 void TargetCodeGenerator::visit(SSubStrInstr& instr) {
@@ -18,6 +18,8 @@
 #include <string>
 #include <vector>
 #include <list>
+#include <map>
+#include <unordered_map>
 #include <utility>
 #include <memory>
 
@@ -46,6 +48,15 @@ class XZERO_FLOW_API TargetCodeGenerator : public InstructionVisitor {
 
   std::unique_ptr<vm::Program> generate(IRProgram* program);
 
+  /**
+   * Enables or disables emitting chains of string concatenations as a
+   * single SADDMULTI, which is enabled by default.
+   *
+   * @see findConcatChains()
+   */
+  void setConcatChainsEnabled(bool enabled) { concatChainsEnabled_ = enabled; }
+  bool concatChainsEnabled() const { return concatChainsEnabled_; }
+
  protected:
   void generate(IRHandler* handler);
   size_t handlerRef(IRHandler* handler);
@@ -92,6 +103,17 @@ class XZERO_FLOW_API TargetCodeGenerator : public InstructionVisitor {
    */
   size_t emit(vm::Opcode opcode, BasicBlock* bb);
 
+  /**
+   * Emits a conditional jump to \p bb, taken if the condition of \p instr
+   * equals \p branchIf.
+   *
+   * If the condition is a comparison emitted right before within the same
+   * block and used by this jump only, both are fused into a single
+   * compare-and-jump instruction.
+   */
+  void emitCondJump(CondBrInstr& instr, bool branchIf, BasicBlock* bb);
+  bool isStringConstantLoad(Value* value, Register reg);
+
   size_t emitBinaryAssoc(Instr& instr, vm::Opcode rr, vm::Opcode ri);
   size_t emitBinary(Instr& instr, vm::Opcode rr, vm::Opcode ri);
   size_t emitBinary(Instr& instr, vm::Opcode rr);
@@ -105,6 +127,21 @@ class XZERO_FLOW_API TargetCodeGenerator : public InstructionVisitor {
    */
   Register emitCallArgs(Instr& instr);
 
+  /**
+   * Finds string concatenations that are only used as the left or right
+   * hand side of another concatenation within the same basic block.
+   *
+   * These are not emitted on their own, but as part of the outermost
+   * concatenation of their chain, which then emits a single SADDMULTI.
+   */
+  void findConcatChains(IRHandler* handler);
+
+  /** Retrieves the outermost concatenation \p value is folded into. */
+  Value* concatRoot(Value* value) const;
+
+  /** Collects the operands of the concatenation chain \p value. */
+  void collectConcatOperands(Value* value, std::vector<Value*>* operands);
+
   vm::Operand getRegister(Value* value);
   vm::Operand getConstantInt(Value* value);
   size_t getInstructionPointer() const { return code_.size(); }
@@ -114,8 +151,26 @@ class XZERO_FLOW_API TargetCodeGenerator : public InstructionVisitor {
   }
   size_t allocate(size_t count, Value& alias);
   size_t allocate(size_t count);
+  void adopt(Value& value, Register reg);
+  void assign(Value& value, Register rbase, size_t count);
   void free(size_t base, size_t count);
 
+  /**
+   * Computes the live range of every value in given \p handler.
+   *
+   * Instructions are numbered in the order they are emitted. A value's live
+   * range spans from the first to the last of these positions it must be
+   * kept in its register at, including all blocks it is live through.
+   */
+  void computeLiveness(IRHandler* handler);
+
+  /**
+   * Frees the registers of all values whose live range ended before the
+   * current instruction, and assigns registers to values becoming live
+   * ahead of their definition.
+   */
+  void scan();
+
   void visit(NopInstr& instr) override;
 
   // storage
@@ -190,6 +245,7 @@ class XZERO_FLOW_API TargetCodeGenerator : public InstructionVisitor {
     size_t pc;
     vm::Opcode opcode;
     Register condition;
+    vm::Operand operand;  //!< compared operand of compare-and-jumps
   };
 
   struct UnconditionalJump {
@@ -211,6 +267,27 @@ class XZERO_FLOW_API TargetCodeGenerator : public InstructionVisitor {
                                                     //assignment-map
   std::vector<bool> allocations_;  //!< register allocation map (primitive)
 
+  struct LiveRange {
+    size_t begin;
+    size_t end;
+  };
+
+  size_t position_;  //!< position of the instruction being emitted
+  std::unordered_map<Value*, LiveRange> liveRanges_;
+  std::multimap<size_t, Value*> liveAhead_;  //!< values used before their
+                                             //definition, by begin
+  std::multimap<size_t, std::pair<Register, size_t>> active_;  //!< assigned
+                                                               //registers,
+                                                               //by end
+  std::vector<std::pair<Register, size_t>> temporaries_;  //!< registers
+                                                          //freed after the
+                                                          //current
+                                                          //instruction
+  bool concatChainsEnabled_;
+  std::unordered_map<Value*, Value*> concatChains_;  //!< folded
+                                                     //concatenations, to
+                                                     //their user
+
   // target program output
   vm::ConstantPool cp_;
 };
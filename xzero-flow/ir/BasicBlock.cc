@@ -93,7 +93,12 @@ void BasicBlock::merge_back(BasicBlock* bb) {
   assert(getTerminator() == nullptr);
 
   for (Instr* i : bb->code_) {
-    push_back(i->clone());
+    Instr* instr = i->clone();
+    push_back(instr);
+
+    // let users refer to the merged instruction, as the original goes away
+    // along with its basic block
+    i->replaceAllUsesWith(instr);
   }
 }
 
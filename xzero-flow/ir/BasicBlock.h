@@ -78,7 +78,8 @@ class XZERO_FLOW_API BasicBlock : public Value {
   /**
    * Merges given basic block's instructions into this ones end.
    *
-   * The passed basic block's instructions will not be touched.
+   * The passed basic block's instructions will not be touched, but all their
+   * users will refer to the merged instructions instead.
    */
   void merge_back(BasicBlock* bb);
 
@@ -10,6 +10,7 @@
 #include <xzero-flow/ir/BasicBlock.h>
 #include <xzero-flow/ir/ConstantValue.h>
 #include <xzero-flow/ir/Instructions.h>
+#include <xzero-base/Buffer.h>
 #include <assert.h>
 #include <inttypes.h>
 #include <math.h>
@@ -185,7 +186,7 @@ Value* IRBuilder::createBXor(Value* lhs, Value* rhs, const std::string& name) {
     if (auto b = dynamic_cast<ConstantBoolean*>(rhs))
       return getBoolean(a->get() ^ b->get());
 
-  return insert(new BAndInstr(lhs, rhs, makeName(name)));
+  return insert(new BXorInstr(lhs, rhs, makeName(name)));
 }
 // }}}
 // {{{ numerical ops
@@ -628,7 +629,8 @@ Value* IRBuilder::createR2S(Value* rhs, const std::string& name) {
 Value* IRBuilder::createS2I(Value* rhs, const std::string& name) {
   assert(rhs->type() == FlowType::String);
 
-  if (auto ip = dynamic_cast<ConstantString*>(rhs)) return get(stoi(ip->get()));
+  if (auto ip = dynamic_cast<ConstantString*>(rhs))
+    return get(static_cast<int64_t>(BufferRef(ip->get()).toInt()));
 
   return insert(new CastInstr(FlowType::Number, rhs, makeName(name)));
 }
@@ -0,0 +1,271 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#include <xzero-flow/mock/MockRuntime.h>
+#include <xzero-flow/FlowParser.h>
+#include <xzero-flow/IRGenerator.h>
+#include <xzero-flow/TargetCodeGenerator.h>
+#include <xzero-flow/ir/IRProgram.h>
+#include <xzero-flow/ir/PassManager.h>
+#include <xzero-flow/transform/ConstantFoldingPass.h>
+#include <xzero-flow/transform/EmptyBlockElimination.h>
+#include <xzero-flow/transform/InstructionElimination.h>
+#include <xzero-flow/transform/UnusedBlockPass.h>
+#include <xzero-flow/vm/Handler.h>
+#include <xzero-flow/vm/NativeCallback.h>
+#include <xzero-flow/vm/Program.h>
+#include <xzero-flow/vm/Runner.h>
+#include <xzero-base/net/Cidr.h>
+#include <xzero-base/net/IPAddress.h>
+#include <sstream>
+#include <stdexcept>
+#include <stdio.h>
+
+namespace xzero {
+namespace flow {
+
+MockRuntime::MockRuntime()
+    : output_(),
+      suspendCount_(0),
+      concatChainsEnabled_(true) {
+  registerFunction("emit", FlowType::Void)
+      .params(FlowType::String)
+      .bind(&MockRuntime::flow_emit_S);
+
+  registerFunction("emit", FlowType::Void)
+      .params(FlowType::Number)
+      .bind(&MockRuntime::flow_emit_I);
+
+  registerFunction("emit", FlowType::Void)
+      .params(FlowType::Boolean)
+      .bind(&MockRuntime::flow_emit_B);
+
+  registerFunction("emit", FlowType::Void)
+      .params(FlowType::IPAddress)
+      .bind(&MockRuntime::flow_emit_P);
+
+  registerFunction("emit", FlowType::Void)
+      .params(FlowType::Cidr)
+      .bind(&MockRuntime::flow_emit_C);
+
+  registerFunction("emit", FlowType::Void)
+      .params(FlowType::IntArray)
+      .bind(&MockRuntime::flow_emit_IA);
+
+  registerFunction("emit", FlowType::Void)
+      .params(FlowType::StringArray)
+      .bind(&MockRuntime::flow_emit_SA);
+
+  registerFunction("emit", FlowType::Void)
+      .params(FlowType::IPAddrArray)
+      .bind(&MockRuntime::flow_emit_PA);
+
+  registerFunction("emit", FlowType::Void)
+      .params(FlowType::CidrArray)
+      .bind(&MockRuntime::flow_emit_CA);
+
+  registerFunction("num", FlowType::Number)
+      .params(FlowType::Number)
+      .bind(&MockRuntime::flow_num);
+
+  registerFunction("str", FlowType::String)
+      .params(FlowType::String)
+      .bind(&MockRuntime::flow_str);
+
+  registerFunction("boolean", FlowType::Boolean)
+      .params(FlowType::Boolean)
+      .bind(&MockRuntime::flow_boolean);
+
+  registerFunction("ip", FlowType::IPAddress)
+      .params(FlowType::IPAddress)
+      .bind(&MockRuntime::flow_ip);
+
+  registerFunction("cidr", FlowType::Cidr)
+      .params(FlowType::Cidr)
+      .bind(&MockRuntime::flow_cidr);
+
+  registerFunction("suspend", FlowType::Void)
+      .bind(&MockRuntime::flow_suspend);
+
+  registerFunction("raise", FlowType::Void)
+      .params(FlowType::String)
+      .bind(&MockRuntime::flow_raise);
+
+  registerHandler("respond")
+      .param<FlowNumber>("status")
+      .bind(&MockRuntime::flow_respond);
+
+  registerHandler("handled")
+      .param<bool>("result")
+      .bind(&MockRuntime::flow_handled);
+}
+
+MockRuntime::~MockRuntime() {
+}
+
+bool MockRuntime::import(const std::string& name, const std::string& path,
+                         std::vector<vm::NativeCallback*>* builtins) {
+  return false;
+}
+
+std::unique_ptr<vm::Program> MockRuntime::compile(const std::string& source,
+                                                  int optimizationLevel) {
+  bool failed = false;
+  FlowParser parser(this);
+  parser.errorHandler = [&](const std::string& message) {
+    fprintf(stderr, "%s\n", message.c_str());
+    failed = true;
+  };
+
+  if (!parser.open("<mock>", std::unique_ptr<std::istream>(
+                                 new std::istringstream(source))))
+    return nullptr;
+
+  std::unique_ptr<Unit> unit = parser.parse();
+  if (!unit || failed)
+    return nullptr;
+
+  std::unique_ptr<IRProgram> ir = IRGenerator::generate(unit.get(), {});
+  if (!ir)
+    return nullptr;
+
+  PassManager pm;
+  pm.registerPass(std::make_unique<UnusedBlockPass>());
+  if (optimizationLevel >= 1) {
+    pm.registerPass(std::make_unique<ConstantFoldingPass>());
+    pm.registerPass(std::make_unique<EmptyBlockElimination>());
+    pm.registerPass(std::make_unique<InstructionElimination>());
+  }
+  pm.run(ir.get());
+
+  if (!verify(ir.get()))
+    return nullptr;
+
+  TargetCodeGenerator generator;
+  generator.setConcatChainsEnabled(concatChainsEnabled_);
+
+  std::unique_ptr<vm::Program> program = generator.generate(ir.get());
+  if (!program || !program->link(this))
+    return nullptr;
+
+  return program;
+}
+
+bool MockRuntime::run(vm::Program* program, const std::string& name) {
+  vm::Handler* handler = program->findHandler(name);
+  if (!handler)
+    return false;
+
+  vm::RunnerPtr runner = handler->createRunner();
+  bool result = runner->run();
+  while (runner->isSuspended())
+    result = runner->resume();
+
+  return result;
+}
+
+void MockRuntime::clear() {
+  output_.clear();
+  suspendCount_ = 0;
+}
+
+void MockRuntime::flow_emit_S(vm::Params& args) {
+  output_.push_back(args.getString(1).str());
+}
+
+void MockRuntime::flow_emit_I(vm::Params& args) {
+  output_.push_back(std::to_string(args.getInt(1)));
+}
+
+void MockRuntime::flow_emit_B(vm::Params& args) {
+  output_.push_back(args.getBool(1) ? "true" : "false");
+}
+
+void MockRuntime::flow_emit_P(vm::Params& args) {
+  output_.push_back(args.getIPAddress(1).str());
+}
+
+void MockRuntime::flow_emit_C(vm::Params& args) {
+  output_.push_back(args.getCidr(1).str());
+}
+
+// Joins the elements of @p array by a comma, as formatted by @p str.
+template <typename T, typename Format>
+static std::string join(const std::vector<T>& array, Format str) {
+  std::string result;
+  for (const T& element : array) {
+    if (!result.empty())
+      result += ",";
+    result += str(element);
+  }
+  return result;
+}
+
+void MockRuntime::flow_emit_IA(vm::Params& args) {
+  output_.push_back(join(args.getIntArray(1), [](FlowNumber n) {
+    return std::to_string(n);
+  }));
+}
+
+void MockRuntime::flow_emit_SA(vm::Params& args) {
+  output_.push_back(join(args.getStringArray(1), [](const FlowString& s) {
+    return s.str();
+  }));
+}
+
+void MockRuntime::flow_emit_PA(vm::Params& args) {
+  output_.push_back(join(args.getIPAddressArray(1), [](const IPAddress& ip) {
+    return ip.str();
+  }));
+}
+
+void MockRuntime::flow_emit_CA(vm::Params& args) {
+  output_.push_back(join(args.getCidrArray(1), [](const Cidr& cidr) {
+    return cidr.str();
+  }));
+}
+
+void MockRuntime::flow_num(vm::Params& args) {
+  args.setResult(args.getInt(1));
+}
+
+void MockRuntime::flow_str(vm::Params& args) {
+  args.setResult(&args.getString(1));
+}
+
+void MockRuntime::flow_boolean(vm::Params& args) {
+  args.setResult(args.getBool(1));
+}
+
+void MockRuntime::flow_ip(vm::Params& args) {
+  args.setResult(&args.getIPAddress(1));
+}
+
+void MockRuntime::flow_cidr(vm::Params& args) {
+  args.setResult(&args.getCidr(1));
+}
+
+void MockRuntime::flow_suspend(vm::Params& args) {
+  suspendCount_++;
+  args.caller()->suspend();
+}
+
+void MockRuntime::flow_raise(vm::Params& args) {
+  throw std::runtime_error(args.getString(1).str());
+}
+
+void MockRuntime::flow_respond(vm::Params& args) {
+  output_.push_back("respond " + std::to_string(args.getInt(1)));
+  args.setResult(true);
+}
+
+void MockRuntime::flow_handled(vm::Params& args) {
+  args.setResult(args.getBool(1));
+}
+
+}  // namespace flow
+}  // namespace xzero
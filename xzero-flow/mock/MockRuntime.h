@@ -0,0 +1,114 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <xzero-flow/vm/Runtime.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace xzero {
+namespace flow {
+
+namespace vm {
+class Program;
+}
+
+/**
+ * Mock Flow runtime, used to compile and run handlers from source.
+ *
+ * Besides the @c respond(status) handler, which always handles the request,
+ * and @c handled(result), which handles it if @p result is @c true, it
+ * provides the following functions:
+ *
+ * <ul>
+ *   <li>@c emit(value) records a value of any basic or array type into
+ *       output(), joining array elements by a comma,
+ *   <li>@c num(n), @c str(s), @c boolean(b), @c ip(p) and @c cidr(c) return
+ *       their argument, hiding the value from the compiler,
+ *   <li>@c suspend() suspends the running handler,
+ *   <li>@c raise(message) throws a @c std::runtime_error with @p message.
+ * </ul>
+ *
+ * It is built into the test-flow binary only, and not part of the library.
+ *
+ * @note This object is not thread safe.
+ */
+class MockRuntime : public vm::Runtime {
+ public:
+  MockRuntime();
+  ~MockRuntime();
+
+  bool import(const std::string& name, const std::string& path,
+              std::vector<vm::NativeCallback*>* builtins) override;
+
+  /**
+   * Compiles given Flow @p source.
+   *
+   * @param source Flow source code.
+   * @param optimizationLevel 0 for no optimizations, or 1 for constant
+   *                          folding and dead code elimination.
+   *
+   * @return the linked program, or @c nullptr on error.
+   */
+  std::unique_ptr<vm::Program> compile(const std::string& source,
+                                       int optimizationLevel);
+
+  /**
+   * Enables or disables emitting concatenation chains as a single SADDMULTI
+   * in programs compiled afterwards.
+   *
+   * @see TargetCodeGenerator::setConcatChainsEnabled()
+   */
+  void setConcatChainsEnabled(bool enabled) { concatChainsEnabled_ = enabled; }
+
+  /**
+   * Runs the handler @p name of @p program to its end, resuming it
+   * whenever it got suspended.
+   *
+   * @return the handler's result, i.e. whether the request got handled.
+   */
+  bool run(vm::Program* program, const std::string& name);
+
+  /** Retrieves the values recorded by @c emit and the handlers. */
+  const std::vector<std::string>& output() const { return output_; }
+
+  /** Retrieves the number of times the handler got suspended. */
+  size_t suspendCount() const { return suspendCount_; }
+
+  /** Forgets output() and suspendCount(). */
+  void clear();
+
+ private:
+  void flow_emit_S(vm::Params& args);
+  void flow_emit_I(vm::Params& args);
+  void flow_emit_B(vm::Params& args);
+  void flow_emit_P(vm::Params& args);
+  void flow_emit_C(vm::Params& args);
+  void flow_emit_IA(vm::Params& args);
+  void flow_emit_SA(vm::Params& args);
+  void flow_emit_PA(vm::Params& args);
+  void flow_emit_CA(vm::Params& args);
+  void flow_num(vm::Params& args);
+  void flow_str(vm::Params& args);
+  void flow_boolean(vm::Params& args);
+  void flow_ip(vm::Params& args);
+  void flow_cidr(vm::Params& args);
+  void flow_suspend(vm::Params& args);
+  void flow_raise(vm::Params& args);
+  void flow_respond(vm::Params& args);
+  void flow_handled(vm::Params& args);
+
+ private:
+  std::vector<std::string> output_;
+  size_t suspendCount_;
+  bool concatChainsEnabled_;
+};
+
+}  // namespace flow
+}  // namespace xzero
@@ -7,4 +7,4 @@
 
 #pragma once
 
-// ...
+#cmakedefine ENABLE_FLOW_JIT
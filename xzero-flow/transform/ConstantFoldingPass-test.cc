@@ -0,0 +1,343 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#include <gtest/gtest.h>
+#include <xzero-flow/mock/MockRuntime.h>
+#include <xzero-flow/sysconfig.h>
+#include <xzero-flow/vm/Handler.h>
+#include <xzero-flow/vm/Instruction.h>
+#include <xzero-flow/vm/Program.h>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace xzero;
+using namespace xzero::flow;
+
+// Runs the handler "main" of @p program and returns what it emitted.
+//
+// With the JIT compiler available, the handler runs interpreted as well as
+// compiled to native code, which must emit the same.
+static std::vector<std::string> execute(MockRuntime* runtime,
+                                        vm::Program* program) {
+#if defined(ENABLE_FLOW_JIT)
+  const unsigned threshold = vm::Handler::jitThreshold();
+  vm::Handler::setJitThreshold(std::numeric_limits<unsigned>::max());
+#endif
+
+  runtime->clear();
+  runtime->run(program, "main");
+  const std::vector<std::string> output = runtime->output();
+
+#if defined(ENABLE_FLOW_JIT)
+  // setting the code anew gets it compiled on its next run
+  vm::Handler* handler = program->findHandler("main");
+  handler->setCode(std::vector<vm::Instruction>(handler->code()));
+  vm::Handler::setJitThreshold(0);
+
+  runtime->clear();
+  runtime->run(program, "main");
+  EXPECT_TRUE(handler->jitEntry() != nullptr)
+      << "Could not compile to native code.";
+  EXPECT_EQ(output, runtime->output()) << "as native code";
+
+  vm::Handler::setJitThreshold(threshold);
+#endif
+
+  return output;
+}
+
+// Runs the handler "main" of @p source, compiled at @p optimizationLevel,
+// and returns what it emitted. @p folded receives whether no instruction
+// of the opcodes @p ops is left in its code.
+static std::vector<std::string> run(const std::string& source,
+                                    int optimizationLevel,
+                                    const std::vector<vm::Opcode>& ops = {},
+                                    bool* folded = nullptr) {
+  MockRuntime runtime;
+  std::unique_ptr<vm::Program> program = runtime.compile(source,
+                                                         optimizationLevel);
+  if (!program) {
+    ADD_FAILURE() << "Could not compile:\n" << source;
+    return {};
+  }
+
+  if (folded) {
+    *folded = true;
+    for (vm::Instruction instr : program->findHandler("main")->code())
+      for (vm::Opcode op : ops)
+        if (vm::opcode(instr) == op)
+          *folded = false;
+  }
+
+  return execute(&runtime, program.get());
+}
+
+// Tests that @p source emits @p expected with and without optimizations,
+// and that constant folding removed all instructions of the opcodes @p ops.
+static void testFolding(const std::string& source,
+                        const std::vector<std::string>& expected,
+                        const std::vector<vm::Opcode>& ops) {
+  bool unfolded = true;
+  EXPECT_EQ(expected, run(source, 0, ops, &unfolded));
+  EXPECT_FALSE(unfolded);
+
+  bool folded = false;
+  EXPECT_EQ(expected, run(source, 1, ops, &folded));
+  EXPECT_TRUE(folded);
+}
+
+TEST(ConstantFoldingPass, integers) {
+  testFolding(
+      "handler main {\n"
+      "  var a = 6;\n"
+      "  var b = 20;\n"
+      "  emit(a + b);\n"
+      "  emit(a - b);\n"
+      "  emit(a * b);\n"
+      "  emit(b / a);\n"
+      "  emit(b % a);\n"
+      "  emit(a ** 3);\n"
+      "  emit(a shl 2);\n"
+      "  emit(b shr 2);\n"
+      "  emit(-a);\n"
+      "  emit(~a);\n"
+      "}\n",
+      {"26", "-14", "120", "3", "2", "216", "24", "5", "-6",
+       "-7"},
+      {vm::Opcode::NADD, vm::Opcode::NSUB, vm::Opcode::NMUL,
+       vm::Opcode::NDIV, vm::Opcode::NREM, vm::Opcode::NPOW,
+       vm::Opcode::NSHL, vm::Opcode::NSHR, vm::Opcode::NNEG,
+       vm::Opcode::NNOT});
+}
+
+TEST(ConstantFoldingPass, integerCompares) {
+  testFolding(
+      "handler main {\n"
+      "  var a = 6;\n"
+      "  var b = 20;\n"
+      "  emit(a == b);\n"
+      "  emit(a != b);\n"
+      "  emit(a <= b);\n"
+      "  emit(a >= b);\n"
+      "  emit(a < b);\n"
+      "  emit(a > b);\n"
+      "  emit(a <= a);\n"
+      "  emit(a < a);\n"
+      "}\n",
+      {"false", "true", "true", "false", "true", "false", "true", "false"},
+      {vm::Opcode::NCMPEQ, vm::Opcode::NCMPNE, vm::Opcode::NCMPLE,
+       vm::Opcode::NCMPGE, vm::Opcode::NCMPLT, vm::Opcode::NCMPGT});
+}
+
+TEST(ConstantFoldingPass, divisionByZeroIsNotFolded) {
+  EXPECT_EQ(std::vector<std::string>({"0"}),
+            run("handler main {\n"
+                "  var a = 0;\n"
+                "  if a != 0 {\n"
+                "    emit(1 / a);\n"
+                "  }\n"
+                "  emit(a);\n"
+                "}\n",
+                1));
+}
+
+TEST(ConstantFoldingPass, strings) {
+  testFolding(
+      "handler main {\n"
+      "  var a = 'abc';\n"
+      "  var b = 'abd';\n"
+      "  emit(a + b);\n"
+      "  emit(a == b);\n"
+      "  emit(a != b);\n"
+      "  emit(a <= b);\n"
+      "  emit(a >= b);\n"
+      "  emit(a < b);\n"
+      "  emit(a > b);\n"
+      "  emit(a =^ 'ab');\n"
+      "  emit(a =$ 'bd');\n"
+      "  emit(a in 'bc');\n"
+      "  emit(a in 'x');\n"
+      "}\n",
+      {"abcabd", "false", "true", "true", "false", "true", "false", "true",
+       "false", "true", "false"},
+      {vm::Opcode::SADD, vm::Opcode::SCMPEQ, vm::Opcode::SCMPNE,
+       vm::Opcode::SCMPLE, vm::Opcode::SCMPGE, vm::Opcode::SCMPLT,
+       vm::Opcode::SCMPGT, vm::Opcode::SCMPBEG, vm::Opcode::SCMPEND,
+       vm::Opcode::SCONTAINS});
+}
+
+TEST(ConstantFoldingPass, booleans) {
+  testFolding(
+      "handler main {\n"
+      "  var t = true;\n"
+      "  var f = false;\n"
+      "  emit(t and f);\n"
+      "  emit(t or f);\n"
+      "  emit(t xor f);\n"
+      "  emit(t xor t);\n"
+      "  emit(not t);\n"
+      "}\n",
+      {"false", "true", "true", "false", "false"},
+      {vm::Opcode::BAND, vm::Opcode::BOR, vm::Opcode::BXOR,
+       vm::Opcode::BNOT});
+}
+
+TEST(ConstantFoldingPass, ipAddresses) {
+  testFolding(
+      "handler main {\n"
+      "  var a = 192.168.1.1;\n"
+      "  var b = 10.0.0.1;\n"
+      "  var net = 192.168.0.0/16;\n"
+      "  emit(a == b);\n"
+      "  emit(a != b);\n"
+      "  emit(a in net);\n"
+      "  emit(b in net);\n"
+      "}\n",
+      {"false", "true", "true", "false"},
+      {vm::Opcode::PCMPEQ, vm::Opcode::PCMPNE, vm::Opcode::PINCIDR});
+}
+
+TEST(ConstantFoldingPass, casts) {
+  testFolding(
+      "handler main {\n"
+      "  var n = 42;\n"
+      "  var s = '17';\n"
+      "  var bad = 'abc';\n"
+      "  var a = 192.168.1.1;\n"
+      "  var net = 192.168.0.0/16;\n"
+      "  emit(string(n));\n"
+      "  emit(int(s) + 1);\n"
+      "  emit(int(bad));\n"
+      "  emit(string(a));\n"
+      "  emit(string(net));\n"
+      "}\n",
+      {"42", "18", "0", "192.168.1.1", "192.168.0.0/16"},
+      {vm::Opcode::I2S, vm::Opcode::S2I, vm::Opcode::P2S, vm::Opcode::C2S});
+}
+
+TEST(ConstantFoldingPass, castsOfLiterals) {
+  // literals are already cast by the IR builder, at any optimization level
+  const std::string source =
+      "handler main {\n"
+      "  emit(int('17') + 1);\n"
+      "  emit(int('12abc'));\n"
+      "  emit(int('abc'));\n"
+      "}\n";
+  const std::vector<std::string> expected = {"18", "12", "0"};
+
+  EXPECT_EQ(expected, run(source, 0));
+  EXPECT_EQ(expected, run(source, 1));
+}
+
+TEST(ConstantFoldingPass, castsAtRuntime) {
+  const std::string source =
+      "handler main {\n"
+      "  emit(int(str('17')) + 1);\n"
+      "  emit(int(str('abc')));\n"
+      "  emit(string(num(42)));\n"
+      "}\n";
+  const std::vector<std::string> expected = {"18", "0", "42"};
+
+  EXPECT_EQ(expected, run(source, 0));
+  EXPECT_EQ(expected, run(source, 1));
+}
+
+TEST(ConstantFoldingPass, propagatesSingleStoreOnly) {
+  const std::string source =
+      "handler main {\n"
+      "  var ten = 10;\n"
+      "  var once = 2;\n"
+      "  var twice = 3;\n"
+      "  twice = num(4);\n"
+      "  emit(once + ten);\n"
+      "  emit(twice * ten);\n"
+      "}\n";
+  const std::vector<std::string> expected = {"12", "40"};
+
+  bool folded = false;
+  EXPECT_EQ(expected, run(source, 1, {vm::Opcode::NADD, vm::Opcode::NIADD},
+                          &folded));
+  EXPECT_TRUE(folded);
+
+  // the product with the variable assigned twice must stay
+  EXPECT_EQ(expected, run(source, 1, {vm::Opcode::NMUL, vm::Opcode::NIMUL},
+                          &folded));
+  EXPECT_FALSE(folded);
+
+  EXPECT_EQ(expected, run(source, 0));
+}
+
+TEST(ConstantFoldingPass, propagatesIntoFollowingStores) {
+  testFolding(
+      "handler main {\n"
+      "  var a = 5;\n"
+      "  var b = a * 2;\n"
+      "  var c = b + a;\n"
+      "  emit(string(c) + '!');\n"
+      "}\n",
+      {"15!"},
+      {vm::Opcode::NMUL, vm::Opcode::NADD, vm::Opcode::I2S,
+       vm::Opcode::SADD});
+}
+
+TEST(ConstantFoldingPass, foldedConditions) {
+  testFolding(
+      "handler main {\n"
+      "  var debug = false;\n"
+      "  var level = 3;\n"
+      "  if debug {\n"
+      "    emit('debug');\n"
+      "  } else {\n"
+      "    emit('release');\n"
+      "  }\n"
+      "  if level > 2 and not debug {\n"
+      "    emit('verbose');\n"
+      "  }\n"
+      "  emit('done');\n"
+      "}\n",
+      {"release", "verbose", "done"},
+      {vm::Opcode::NCMPGT, vm::Opcode::BNOT, vm::Opcode::BAND});
+}
+
+TEST(ConstantFoldingPass, mergesBlocksWithUsedValues) {
+  // folding the condition merges the then-block and the block after it into
+  // their predecessor, while the values defined in them are still in use
+  testFolding(
+      "handler main {\n"
+      "  var enabled = true;\n"
+      "  var s = str('a') + str('b');\n"
+      "  if enabled {\n"
+      "    emit(string(num(7)) + 'x');\n"
+      "  }\n"
+      "  emit(s + s);\n"
+      "  emit(s);\n"
+      "}\n",
+      {"7x", "abab", "ab"},
+      {vm::Opcode::JZ, vm::Opcode::JN});
+}
+
+TEST(ConstantFoldingPass, relinksAllPredecessors) {
+  // every case of the match jumps to the same empty block, which must be
+  // unlinked from all of them
+  const std::string source =
+      "handler main {\n"
+      "  if boolean(true) {\n"
+      "    match str('c') {\n"
+      "      on 'a' emit('a');\n"
+      "      on 'b' emit('b');\n"
+      "      on 'c' emit('c');\n"
+      "    }\n"
+      "  }\n"
+      "  emit('done');\n"
+      "}\n";
+  const std::vector<std::string> expected = {"c", "done"};
+
+  EXPECT_EQ(expected, run(source, 0));
+  EXPECT_EQ(expected, run(source, 1));
+}
@@ -0,0 +1,271 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#include <xzero-flow/transform/ConstantFoldingPass.h>
+#include <xzero-flow/ir/BasicBlock.h>
+#include <xzero-flow/ir/ConstantValue.h>
+#include <xzero-flow/ir/Instructions.h>
+#include <xzero-flow/ir/IRHandler.h>
+#include <xzero-flow/ir/IRProgram.h>
+#include <xzero-base/Buffer.h>
+#include <vector>
+#include <math.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+namespace xzero {
+namespace flow {
+
+bool ConstantFoldingPass::run(IRHandler* handler) {
+  IRProgram* program = handler->parent();
+  bool changed = false;
+
+  std::vector<AllocaInstr*> vars;
+  for (BasicBlock* bb : handler->basicBlocks())
+    for (Instr* instr : bb->instructions())
+      if (auto var = dynamic_cast<AllocaInstr*>(instr))
+        vars.push_back(var);
+
+  for (AllocaInstr* var : vars)
+    if (propagate(var))
+      changed = true;
+
+  for (BasicBlock* bb : handler->basicBlocks()) {
+    // iterate over a copy, as folded instructions are removed on the fly
+    std::vector<Instr*> code = bb->instructions();
+    for (Instr* instr : code) {
+      if (Constant* result = fold(instr, program)) {
+        instr->replaceAllUsesWith(result);
+        delete bb->remove(instr);
+        changed = true;
+      }
+    }
+  }
+
+  return changed;
+}
+
+/*
+ * Replaces all loads of a variable by its value, if it is only ever assigned
+ * a single constant, and eliminates the variable.
+ *
+ * Flow has no loops and a variable cannot be used before its declaration,
+ * so every load is reached by that one store.
+ */
+bool ConstantFoldingPass::propagate(AllocaInstr* var) {
+  auto size = dynamic_cast<ConstantInt*>(var->arraySize());
+  if (!size || size->get() != 1)
+    return false;
+
+  StoreInstr* store = nullptr;
+  std::vector<LoadInstr*> loads;
+
+  for (Instr* user : var->uses()) {
+    if (auto s = dynamic_cast<StoreInstr*>(user)) {
+      if (store || s->variable() != var || s->index()->get() != 0)
+        return false;
+      store = s;
+    } else if (auto load = dynamic_cast<LoadInstr*>(user)) {
+      loads.push_back(load);
+    } else {
+      return false;
+    }
+  }
+
+  if (!store)
+    return false;
+
+  Constant* value = dynamic_cast<Constant*>(store->expression());
+  if (!value)
+    return false;
+
+  for (LoadInstr* load : loads) {
+    load->replaceAllUsesWith(value);
+    delete load->parent()->remove(load);
+  }
+
+  delete store->parent()->remove(store);
+  delete var->parent()->remove(var);
+
+  return true;
+}
+
+Constant* ConstantFoldingPass::fold(Instr* instr, IRProgram* program) {
+  if (instr->operands().empty())
+    return nullptr;
+
+  for (Value* operand : instr->operands())
+    if (!dynamic_cast<Constant*>(operand))
+      return nullptr;
+
+  if (dynamic_cast<CastInstr*>(instr))
+    return foldCast(instr, program);
+
+  switch (instr->operands().size()) {
+    case 1:
+      return foldUnary(instr, program);
+    case 2:
+      return foldBinary(instr, program);
+    default:
+      return nullptr;
+  }
+}
+
+Constant* ConstantFoldingPass::foldUnary(Instr* instr, IRProgram* program) {
+  Value* op = instr->operand(0);
+
+  if (auto a = dynamic_cast<ConstantInt*>(op)) {
+    if (dynamic_cast<INegInstr*>(instr)) return program->get(-a->get());
+    if (dynamic_cast<INotInstr*>(instr)) return program->get(~a->get());
+  }
+
+  if (auto a = dynamic_cast<ConstantBoolean*>(op)) {
+    if (dynamic_cast<BNotInstr*>(instr)) return program->getBoolean(!a->get());
+  }
+
+  if (auto a = dynamic_cast<ConstantString*>(op)) {
+    if (dynamic_cast<SLenInstr*>(instr))
+      return program->get(static_cast<int64_t>(a->get().size()));
+    if (dynamic_cast<SIsEmptyInstr*>(instr))
+      return program->getBoolean(a->get().empty());
+  }
+
+  return nullptr;
+}
+
+Constant* ConstantFoldingPass::foldBinary(Instr* instr, IRProgram* program) {
+  Value* lhs = instr->operand(0);
+  Value* rhs = instr->operand(1);
+
+  auto ia = dynamic_cast<ConstantInt*>(lhs);
+  auto ib = dynamic_cast<ConstantInt*>(rhs);
+  if (ia && ib) {
+    int64_t a = ia->get();
+    int64_t b = ib->get();
+
+    if (dynamic_cast<IAddInstr*>(instr)) return program->get(a + b);
+    if (dynamic_cast<ISubInstr*>(instr)) return program->get(a - b);
+    if (dynamic_cast<IMulInstr*>(instr)) return program->get(a * b);
+    if (dynamic_cast<IPowInstr*>(instr))
+      return program->get(static_cast<int64_t>(powl(a, b)));
+    if (dynamic_cast<IAndInstr*>(instr)) return program->get(a & b);
+    if (dynamic_cast<IOrInstr*>(instr)) return program->get(a | b);
+    if (dynamic_cast<IXorInstr*>(instr)) return program->get(a ^ b);
+    if (dynamic_cast<IShlInstr*>(instr)) return program->get(a << b);
+    if (dynamic_cast<IShrInstr*>(instr)) return program->get(a >> b);
+    if (dynamic_cast<ICmpEQInstr*>(instr)) return program->getBoolean(a == b);
+    if (dynamic_cast<ICmpNEInstr*>(instr)) return program->getBoolean(a != b);
+    if (dynamic_cast<ICmpLEInstr*>(instr)) return program->getBoolean(a <= b);
+    if (dynamic_cast<ICmpGEInstr*>(instr)) return program->getBoolean(a >= b);
+    if (dynamic_cast<ICmpLTInstr*>(instr)) return program->getBoolean(a < b);
+    if (dynamic_cast<ICmpGTInstr*>(instr)) return program->getBoolean(a > b);
+
+    // leave division by zero to fail at runtime
+    if (b != 0) {
+      if (dynamic_cast<IDivInstr*>(instr)) return program->get(a / b);
+      if (dynamic_cast<IRemInstr*>(instr)) return program->get(a % b);
+    }
+
+    return nullptr;
+  }
+
+  auto ba = dynamic_cast<ConstantBoolean*>(lhs);
+  auto bb = dynamic_cast<ConstantBoolean*>(rhs);
+  if (ba && bb) {
+    bool a = ba->get();
+    bool b = bb->get();
+
+    if (dynamic_cast<BAndInstr*>(instr)) return program->getBoolean(a && b);
+    if (dynamic_cast<BOrInstr*>(instr)) return program->getBoolean(a || b);
+    if (dynamic_cast<BXorInstr*>(instr)) return program->getBoolean(a ^ b);
+
+    return nullptr;
+  }
+
+  auto sa = dynamic_cast<ConstantString*>(lhs);
+  auto sb = dynamic_cast<ConstantString*>(rhs);
+  if (sa && sb) {
+    const std::string a = sa->get();
+    const std::string b = sb->get();
+
+    if (dynamic_cast<SAddInstr*>(instr)) return program->get(a + b);
+    if (dynamic_cast<SCmpEQInstr*>(instr)) return program->getBoolean(a == b);
+    if (dynamic_cast<SCmpNEInstr*>(instr)) return program->getBoolean(a != b);
+    if (dynamic_cast<SCmpLEInstr*>(instr)) return program->getBoolean(a <= b);
+    if (dynamic_cast<SCmpGEInstr*>(instr)) return program->getBoolean(a >= b);
+    if (dynamic_cast<SCmpLTInstr*>(instr)) return program->getBoolean(a < b);
+    if (dynamic_cast<SCmpGTInstr*>(instr)) return program->getBoolean(a > b);
+    if (dynamic_cast<SCmpBegInstr*>(instr))
+      return program->getBoolean(BufferRef(a).begins(b));
+    if (dynamic_cast<SCmpEndInstr*>(instr))
+      return program->getBoolean(BufferRef(a).ends(b));
+    if (dynamic_cast<SInInstr*>(instr))
+      return program->getBoolean(a.find(b) != std::string::npos);
+
+    return nullptr;
+  }
+
+  auto pa = dynamic_cast<ConstantIP*>(lhs);
+  if (pa) {
+    if (auto pb = dynamic_cast<ConstantIP*>(rhs)) {
+      if (dynamic_cast<PCmpEQInstr*>(instr))
+        return program->getBoolean(pa->get() == pb->get());
+      if (dynamic_cast<PCmpNEInstr*>(instr))
+        return program->getBoolean(pa->get() != pb->get());
+    }
+
+    if (auto cb = dynamic_cast<ConstantCidr*>(rhs)) {
+      if (dynamic_cast<PInCidrInstr*>(instr))
+        return program->getBoolean(cb->get().contains(pa->get()));
+    }
+  }
+
+  return nullptr;
+}
+
+Constant* ConstantFoldingPass::foldCast(Instr* instr, IRProgram* program) {
+  Value* source = static_cast<CastInstr*>(instr)->source();
+
+  switch (instr->type()) {
+    case FlowType::String:
+      if (auto b = dynamic_cast<ConstantBoolean*>(source))
+        return program->get(std::string(b->get() ? "true" : "false"));
+
+      if (auto i = dynamic_cast<ConstantInt*>(source)) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%" PRIi64 "", i->get());
+        return program->get(std::string(buf));
+      }
+
+      if (auto ip = dynamic_cast<ConstantIP*>(source))
+        return program->get(ip->get().str());
+
+      if (auto cidr = dynamic_cast<ConstantCidr*>(source))
+        return program->get(cidr->get().str());
+
+      if (auto re = dynamic_cast<ConstantRegExp*>(source))
+        return program->get(re->get().pattern());
+
+      if (auto s = dynamic_cast<ConstantString*>(source))
+        return s;
+
+      return nullptr;
+    case FlowType::Number:
+      if (auto s = dynamic_cast<ConstantString*>(source))
+        return program->get(static_cast<int64_t>(BufferRef(s->get()).toInt()));
+
+      if (auto i = dynamic_cast<ConstantInt*>(source))
+        return i;
+
+      return nullptr;
+    default:
+      return nullptr;
+  }
+}
+
+}  // namespace flow
+}  // namespace xzero
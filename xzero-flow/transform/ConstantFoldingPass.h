@@ -0,0 +1,47 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <xzero-flow/Api.h>
+#include <xzero-flow/ir/HandlerPass.h>
+
+namespace xzero {
+namespace flow {
+
+class Instr;
+class AllocaInstr;
+class Constant;
+class IRProgram;
+
+/**
+ * Evaluates instructions on constant operands at compile time.
+ *
+ * Variables that are assigned a constant exactly once are replaced by that
+ * constant, and unary, binary and cast instructions on constant operands are
+ * replaced by their result, so that their computation does not happen on
+ * every handler invocation anymore.
+ *
+ * Branches on conditions folded this way are left to
+ * InstructionElimination.
+ */
+class XZERO_FLOW_API ConstantFoldingPass : public HandlerPass {
+ public:
+  ConstantFoldingPass() : HandlerPass("ConstantFoldingPass") {}
+
+  bool run(IRHandler* handler) override;
+
+ private:
+  bool propagate(AllocaInstr* var);
+  Constant* fold(Instr* instr, IRProgram* program);
+  Constant* foldUnary(Instr* instr, IRProgram* program);
+  Constant* foldBinary(Instr* instr, IRProgram* program);
+  Constant* foldCast(Instr* instr, IRProgram* program);
+};
+
+}  // namespace flow
+}  // namespace xzero
@@ -10,6 +10,7 @@
 #include <xzero-flow/ir/IRHandler.h>
 #include <xzero-flow/ir/Instructions.h>
 #include <list>
+#include <vector>
 
 namespace xzero {
 namespace flow {
@@ -27,7 +28,9 @@ bool EmptyBlockElimination::run(IRHandler* handler) {
         handler->setEntryBlock(bb);
         break;
       } else {
-        for (BasicBlock* pred : bb->predecessors()) {
+        // relinking alters the list of predecessors, so iterate over a copy
+        std::vector<BasicBlock*> preds = bb->predecessors();
+        for (BasicBlock* pred : preds) {
           pred->getTerminator()->replaceOperand(bb, newSuccessor);
         }
       }
@@ -19,6 +19,8 @@ namespace xzero {
 namespace flow {
 namespace vm {
 
+class ProgramImage;
+
 /**
  * Provides a pool of constant that can be built dynamically during code
  *generation and accessed effeciently at runtime.
@@ -109,6 +111,8 @@ struct XZERO_FLOW_API ConstantPool {
   void dump() const;
 
  private:
+  friend class ProgramImage;
+
   // constant primitives
   std::vector<FlowNumber> numbers_;
   std::vector<Buffer> strings_;
@@ -0,0 +1,161 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#include <gtest/gtest.h>
+#include <xzero-flow/mock/MockRuntime.h>
+#include <xzero-flow/vm/Handler.h>
+#include <xzero-flow/vm/Program.h>
+#include <xzero-flow/vm/Runner.h>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace xzero;
+using namespace xzero::flow;
+using namespace xzero::flow::vm;
+
+// Compiles @p source, to create Runners of its handler "main" from.
+static std::unique_ptr<Program> compile(MockRuntime* runtime,
+                                        const std::string& source) {
+  std::unique_ptr<Program> program = runtime->compile(source, 0);
+  EXPECT_TRUE(program != nullptr) << "Could not compile:\n" << source;
+  return program;
+}
+
+TEST(Handler, reusesRunners) {
+  MockRuntime runtime;
+  std::unique_ptr<Program> program = compile(&runtime, "handler main {}\n");
+  Handler* handler = program->findHandler("main");
+
+  RunnerPtr runner = handler->createRunner();
+  Runner* first = runner.get();
+  EXPECT_EQ(handler, runner->handler());
+  EXPECT_EQ(0u, handler->pooledRunnerCount());
+
+  runner.reset();
+  EXPECT_EQ(1u, handler->pooledRunnerCount());
+
+  runner = handler->createRunner();
+  EXPECT_EQ(first, runner.get());
+  EXPECT_EQ(0u, handler->pooledRunnerCount());
+}
+
+TEST(Handler, runnerPoolIsCapped) {
+  MockRuntime runtime;
+  std::unique_ptr<Program> program = compile(&runtime, "handler main {}\n");
+  Handler* handler = program->findHandler("main");
+
+  std::vector<RunnerPtr> runners;
+  std::set<Runner*> created;
+  for (size_t i = 0; i != Handler::MaxPooledRunners + 1; ++i) {
+    runners.push_back(handler->createRunner());
+    created.insert(runners.back().get());
+  }
+
+  runners.clear();
+  EXPECT_EQ(Handler::MaxPooledRunners, handler->pooledRunnerCount());
+
+  for (size_t i = 0; i != Handler::MaxPooledRunners; ++i) {
+    runners.push_back(handler->createRunner());
+    EXPECT_EQ(1u, created.count(runners.back().get()));
+  }
+  EXPECT_EQ(0u, handler->pooledRunnerCount());
+}
+
+TEST(Handler, resetsRecycledRunners) {
+  MockRuntime runtime;
+  std::unique_ptr<Program> program = compile(&runtime,
+      "handler main {\n"
+      "  var s = str('abc');\n"
+      "  var n = num(7);\n"
+      "  emit(s + string(n));\n"
+      "}\n");
+  Handler* handler = program->findHandler("main");
+  int userdata = 0;
+
+  RunnerPtr runner = handler->createRunner();
+  Runner* first = runner.get();
+  runner->setUserData(&userdata);
+  EXPECT_FALSE(runner->run());
+  EXPECT_EQ(std::vector<std::string>({"abc7"}), runtime.output());
+
+  bool dirty = false;
+  for (size_t i = 0; i != handler->registerCount(); ++i)
+    dirty |= runner->data()[i] != 0;
+  EXPECT_TRUE(dirty);
+
+  runner.reset();
+  runner = handler->createRunner();
+  ASSERT_EQ(first, runner.get());
+  EXPECT_TRUE(runner->isInactive());
+  EXPECT_EQ(nullptr, runner->userdata());
+  for (size_t i = 0; i != handler->registerCount(); ++i)
+    EXPECT_EQ(0u, runner->data()[i]) << "register " << i;
+
+  // and it runs as good as new
+  runtime.clear();
+  EXPECT_FALSE(runner->run());
+  EXPECT_EQ(std::vector<std::string>({"abc7"}), runtime.output());
+}
+
+TEST(Handler, destroysSuspendedRunners) {
+  MockRuntime runtime;
+  std::unique_ptr<Program> program = compile(&runtime,
+      "handler main {\n"
+      "  suspend;\n"
+      "  emit('resumed');\n"
+      "}\n");
+  Handler* handler = program->findHandler("main");
+
+  RunnerPtr runner = handler->createRunner();
+  runner->run();
+  ASSERT_TRUE(runner->isSuspended());
+  runner.reset();
+  EXPECT_EQ(0u, handler->pooledRunnerCount());
+
+  // finished ones are pooled
+  runner = handler->createRunner();
+  runner->run();
+  runner->resume();
+  ASSERT_TRUE(runner->isInactive());
+  runner.reset();
+  EXPECT_EQ(1u, handler->pooledRunnerCount());
+  EXPECT_EQ(std::vector<std::string>({"resumed"}), runtime.output());
+}
+
+TEST(Handler, runnerOutlivesHandler) {
+  MockRuntime runtime;
+  std::unique_ptr<Program> program = compile(&runtime, "handler main {}\n");
+
+  RunnerPtr runner = program->findHandler("main")->createRunner();
+  runner->run();
+
+  // releasing it must not touch the destroyed handler
+  program.reset();
+  runner.reset();
+}
+
+TEST(Handler, runnerOutlivesCode) {
+  MockRuntime runtime;
+  std::unique_ptr<Program> program = compile(&runtime, "handler main {}\n");
+  Handler* handler = program->findHandler("main");
+
+  RunnerPtr pooled = handler->createRunner();
+  RunnerPtr running = handler->createRunner();
+  pooled.reset();
+  EXPECT_EQ(1u, handler->pooledRunnerCount());
+
+  // Runners of the previous code are neither handed out nor pooled
+  handler->setCode(std::vector<Instruction>(handler->code()));
+  EXPECT_EQ(0u, handler->pooledRunnerCount());
+  running.reset();
+  EXPECT_EQ(0u, handler->pooledRunnerCount());
+
+  handler->createRunner().reset();
+  EXPECT_EQ(1u, handler->pooledRunnerCount());
+}
@@ -9,20 +9,154 @@
 #include <xzero-flow/vm/Runner.h>
 #include <xzero-flow/vm/Instruction.h>
 #include <xzero-base/sysconfig.h>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
 
 namespace xzero {
 namespace flow {
 namespace vm {
 
-Handler::Handler() {
+namespace {
+
+/**
+ * Thread-local cache of finished Runners, by the id of their handler.
+ *
+ * Every list remembers the handle of its handler, so lists of handlers
+ * that got destroyed, or changed their code, on other threads are purged
+ * when the next handler pools its first Runner here.
+ */
+class RunnerPool {
+ public:
+  ~RunnerPool();
+
+  Runner* acquire(unsigned long handlerId);
+  bool release(unsigned long handlerId, const std::shared_ptr<Handler>& handle,
+               Runner* runner);
+  void clear(unsigned long handlerId);
+  size_t size(unsigned long handlerId) const;
+
+ private:
+  struct Entry {
+    std::weak_ptr<Handler> handle;
+    std::vector<Runner*> runners;
+  };
+
+  void purge();
+
+ private:
+  std::unordered_map<unsigned long, Entry> free_;
+};
+
+RunnerPool::~RunnerPool() {
+  for (auto& entry: free_)
+    for (Runner* runner: entry.second.runners)
+      delete runner;
+}
+
+Runner* RunnerPool::acquire(unsigned long handlerId) {
+  auto i = free_.find(handlerId);
+  if (i == free_.end() || i->second.runners.empty())
+    return nullptr;
+
+  Runner* runner = i->second.runners.back();
+  i->second.runners.pop_back();
+  return runner;
+}
+
+bool RunnerPool::release(unsigned long handlerId,
+                         const std::shared_ptr<Handler>& handle,
+                         Runner* runner) {
+  auto i = free_.find(handlerId);
+  if (i == free_.end()) {
+    purge();
+    i = free_.emplace(handlerId, Entry{handle, {}}).first;
+  }
+
+  std::vector<Runner*>& list = i->second.runners;
+  if (list.size() >= Handler::MaxPooledRunners)
+    return false;
+
+  list.push_back(runner);
+  return true;
+}
+
+void RunnerPool::clear(unsigned long handlerId) {
+  auto i = free_.find(handlerId);
+  if (i == free_.end())
+    return;
+
+  for (Runner* runner: i->second.runners)
+    delete runner;
+
+  free_.erase(i);
+}
+
+size_t RunnerPool::size(unsigned long handlerId) const {
+  auto i = free_.find(handlerId);
+  return i != free_.end() ? i->second.runners.size() : 0;
+}
+
+void RunnerPool::purge() {
+  for (auto i = free_.begin(); i != free_.end();) {
+    if (i->second.handle.expired()) {
+      for (Runner* runner: i->second.runners)
+        delete runner;
+      i = free_.erase(i);
+    } else {
+      ++i;
+    }
+  }
+}
+
+thread_local RunnerPool runnerPool;
+std::atomic<unsigned long> lastHandlerId(0);
+
+// no-op deleter of Handler::handle_, which does not own the handler
+void keepHandler(Handler*) {}
+
+#if defined(ENABLE_FLOW_JIT)
+//! number of interpreted runs before a handler gets compiled, which may be
+//! changed while handlers run on other threads
+std::atomic<unsigned> jitRunThreshold(100);
+#endif
+
+}  // namespace
+
+void RunnerRecycler::operator()(Runner* runner) const {
+  // the Runner may outlive its handler, or the code it was sized for
+  if (std::shared_ptr<Handler> h = handler.lock())
+    h->recycle(runner);
+  else
+    delete runner;
+}
+
+const size_t Handler::MaxPooledRunners;
+
+Handler::Handler()
+    : id_(++lastHandlerId),
+      handle_(this, &keepHandler)
+#if defined(ENABLE_FLOW_JIT)
+      ,
+      runCount_(0),
+      jitEntry_(nullptr)
+#endif
+{
 }
 
 Handler::Handler(Program* program, const std::string& name,
                  const std::vector<Instruction>& code)
-    : program_(program),
+    : id_(++lastHandlerId),
+      handle_(this, &keepHandler),
+      program_(program),
       name_(name),
       registerCount_(computeRegisterCount(code.data(), code.size())),
       code_(code)
+#if defined(ENABLE_FLOW_JIT)
+      ,
+      runCount_(0),
+      jitEntry_(nullptr)
+#endif
 #if defined(ENABLE_FLOW_DIRECT_THREADED_VM)
       ,
       directThreadedCode_()
@@ -31,10 +165,17 @@ Handler::Handler(Program* program, const std::string& name,
 }
 
 Handler::Handler(const Handler& v)
-    : program_(v.program_),
+    : id_(++lastHandlerId),
+      handle_(this, &keepHandler),
+      program_(v.program_),
       name_(v.name_),
       registerCount_(v.registerCount_),
       code_(v.code_)
+#if defined(ENABLE_FLOW_JIT)
+      ,
+      runCount_(0),
+      jitEntry_(nullptr)
+#endif
 #if defined(ENABLE_FLOW_DIRECT_THREADED_VM)
       ,
       directThreadedCode_(v.directThreadedCode_)
@@ -43,10 +184,17 @@ Handler::Handler(const Handler& v)
 }
 
 Handler::Handler(Handler&& v)
-    : program_(std::move(v.program_)),
+    : id_(++lastHandlerId),
+      handle_(this, &keepHandler),
+      program_(std::move(v.program_)),
       name_(std::move(v.name_)),
       registerCount_(std::move(v.registerCount_)),
       code_(std::move(v.code_))
+#if defined(ENABLE_FLOW_JIT)
+      ,
+      runCount_(0),
+      jitEntry_(nullptr)
+#endif
 #if defined(ENABLE_FLOW_DIRECT_THREADED_VM)
       ,
       directThreadedCode_(std::move(v.directThreadedCode_))
@@ -54,23 +202,101 @@ Handler::Handler(Handler&& v)
 {
 }
 
-Handler::~Handler() {}
+Handler::~Handler() {
+  // Runners pooled by other threads are never handed out again, as handler
+  // ids are unique, and get purged along with the expired handle.
+  runnerPool.clear(id_);
+}
 
 void Handler::setCode(const std::vector<Instruction>& code) {
+  // pooled Runners were sized for the previous code
+  runnerPool.clear(id_);
+  id_ = ++lastHandlerId;
+  handle_.reset(this, &keepHandler);
+
   code_ = code;
   registerCount_ = computeRegisterCount(code_.data(), code_.size());
+
+#if defined(ENABLE_FLOW_JIT)
+  resetJit();
+#endif
 }
 
 void Handler::setCode(std::vector<Instruction>&& code) {
+  runnerPool.clear(id_);
+  id_ = ++lastHandlerId;
+  handle_.reset(this, &keepHandler);
+
   code_ = std::move(code);
   registerCount_ = computeRegisterCount(code_.data(), code_.size());
 
 #if defined(ENABLE_FLOW_DIRECT_THREADED_VM)
   directThreadedCode_.clear();
 #endif
+#if defined(ENABLE_FLOW_JIT)
+  resetJit();
+#endif
+}
+
+RunnerPtr Handler::createRunner() {
+  RunnerRecycler recycler(handle_);
+
+  if (Runner* runner = runnerPool.acquire(id_))
+    return RunnerPtr(runner, recycler);
+
+  return RunnerPtr(Runner::create(this).release(), recycler);
+}
+
+void Handler::recycle(Runner* runner) {
+  if (runner->isInactive()) {
+    runner->reset();
+    if (runnerPool.release(id_, handle_, runner))
+      return;
+  }
+
+  delete runner;
 }
 
-std::unique_ptr<Runner> Handler::createRunner() { return Runner::create(this); }
+size_t Handler::pooledRunnerCount() const {
+  return runnerPool.size(id_);
+}
+
+#if defined(ENABLE_FLOW_JIT)
+JitCode::Entry Handler::jitEntry() {
+  if (JitCode::Entry entry = jitEntry_.load(std::memory_order_acquire))
+    return entry;
+
+  const unsigned threshold = jitRunThreshold.load(std::memory_order_relaxed);
+
+  // stop counting once compiled, or given up on
+  if (runCount_.load(std::memory_order_relaxed) > threshold)
+    return nullptr;
+
+  if (runCount_.fetch_add(1, std::memory_order_relaxed) != threshold)
+    return nullptr;
+
+  jitCode_ = JitCode::compile(this);
+  if (!jitCode_)
+    return nullptr;
+
+  jitEntry_.store(jitCode_->entry(), std::memory_order_release);
+  return jitCode_->entry();
+}
+
+void Handler::setJitThreshold(unsigned threshold) {
+  jitRunThreshold.store(threshold, std::memory_order_relaxed);
+}
+
+unsigned Handler::jitThreshold() {
+  return jitRunThreshold.load(std::memory_order_relaxed);
+}
+
+void Handler::resetJit() {
+  jitEntry_ = nullptr;
+  jitCode_.reset();
+  runCount_ = 0;
+}
+#endif
 
 bool Handler::run(void* userdata) {
   auto runner = createRunner();
@@ -9,7 +9,12 @@
 
 #include <xzero-flow/vm/Instruction.h>
 #include <xzero-flow/Api.h>
+#include <xzero-flow/sysconfig.h>
 #include <xzero-base/sysconfig.h>
+#if defined(ENABLE_FLOW_JIT)
+#include <xzero-flow/vm/JitCode.h>
+#include <atomic>
+#endif
 #include <string>
 #include <vector>
 #include <memory>
@@ -21,6 +26,26 @@ namespace vm {
 
 class Program;
 class Runner;
+class Handler;
+
+/**
+ * Deleter of Runners created by Handler::createRunner().
+ *
+ * Runners that finished are reset and kept for reuse by the same handler
+ * on the current thread. Runners released while suspended, or after their
+ * handler got destroyed or its code replaced, are destroyed.
+ */
+struct XZERO_FLOW_API RunnerRecycler {
+  RunnerRecycler() = default;
+  explicit RunnerRecycler(const std::weak_ptr<Handler>& h) : handler(h) {}
+
+  void operator()(Runner* runner) const;
+
+  //! expires along with the handler's code the Runner was created for
+  std::weak_ptr<Handler> handler;
+};
+
+typedef std::unique_ptr<Runner, RunnerRecycler> RunnerPtr;
 
 class XZERO_FLOW_API Handler {
  public:
@@ -49,12 +74,61 @@ class XZERO_FLOW_API Handler {
   std::vector<uint64_t>& directThreadedCode() { return directThreadedCode_; }
 #endif
 
-  std::unique_ptr<Runner> createRunner();
+  /**
+   * Retrieves a Runner for this handler, preferably a finished one that
+   * was released on the current thread before.
+   */
+  RunnerPtr createRunner();
   bool run(void* userdata = nullptr);
 
+  //! maximum number of finished Runners kept per handler and thread
+  static const size_t MaxPooledRunners = 64;
+
+  /**
+   * Retrieves the number of finished Runners cached on the calling thread
+   * for reuse by this handler.
+   */
+  size_t pooledRunnerCount() const;
+
+#if defined(ENABLE_FLOW_JIT)
+  /**
+   * Retrieves the native code of this handler.
+   *
+   * The code is compiled once this handler ran <i>threshold</i> times in
+   * the interpreter, and until then @c nullptr is returned.
+   *
+   * @return the entry point of the native code, or @c nullptr if the
+   *         handler should be interpreted.
+   */
+  JitCode::Entry jitEntry();
+
+  /**
+   * Sets the number of interpreted runs after which handlers get compiled
+   * to native code.
+   *
+   * With a threshold of 0, handlers get compiled on their first run.
+   */
+  static void setJitThreshold(unsigned threshold);
+
+  /** Retrieves the threshold set by setJitThreshold(). */
+  static unsigned jitThreshold();
+#endif
+
   void disassemble();
 
  private:
+  friend struct RunnerRecycler;
+  void recycle(Runner* runner);
+#if defined(ENABLE_FLOW_JIT)
+  void resetJit();
+#endif
+
+ private:
+  unsigned long id_;  //!< unique id, keying the thread-local Runner pools
+
+  //! non-owning handle on this handler, replaced along with the code, to
+  //! tell Runners and pools whether it is still around
+  std::shared_ptr<Handler> handle_;
   Program* program_;
   std::string name_;
   size_t registerCount_;
@@ -62,6 +136,11 @@ class XZERO_FLOW_API Handler {
 #if defined(ENABLE_FLOW_DIRECT_THREADED_VM)
   std::vector<uint64_t> directThreadedCode_;
 #endif
+#if defined(ENABLE_FLOW_JIT)
+  std::atomic<unsigned> runCount_;
+  std::atomic<JitCode::Entry> jitEntry_;
+  std::unique_ptr<JitCode> jitCode_;
+#endif
 };
 
 }  // namespace vm
@@ -25,6 +25,23 @@ InstructionSig operandSignature(Opcode opc) {
       {Opcode::JMP, InstructionSig::I},
       {Opcode::JN, InstructionSig::RI},
       {Opcode::JZ, InstructionSig::RI},
+      // compare and jump
+      {Opcode::NJEQ, InstructionSig::RRI},
+      {Opcode::NJNE, InstructionSig::RRI},
+      {Opcode::NJLE, InstructionSig::RRI},
+      {Opcode::NJGE, InstructionSig::RRI},
+      {Opcode::NJLT, InstructionSig::RRI},
+      {Opcode::NJGT, InstructionSig::RRI},
+      {Opcode::NIJEQ, InstructionSig::RII},
+      {Opcode::NIJNE, InstructionSig::RII},
+      {Opcode::NIJLE, InstructionSig::RII},
+      {Opcode::NIJGE, InstructionSig::RII},
+      {Opcode::NIJLT, InstructionSig::RII},
+      {Opcode::NIJGT, InstructionSig::RII},
+      {Opcode::SJEQ, InstructionSig::RRI},
+      {Opcode::SJNE, InstructionSig::RRI},
+      {Opcode::SIJEQ, InstructionSig::RII},
+      {Opcode::SIJNE, InstructionSig::RII},
       // copy
       {Opcode::MOV, InstructionSig::RR},
       // array
@@ -81,6 +98,7 @@ InstructionSig operandSignature(Opcode opc) {
       // string
       {Opcode::SCONST, InstructionSig::RI},
       {Opcode::SADD, InstructionSig::RRR},
+      {Opcode::SADDMULTI, InstructionSig::RRI},
       {Opcode::SSUBSTR, InstructionSig::RRR},
       {Opcode::SCMPEQ, InstructionSig::RRR},
       {Opcode::SCMPNE, InstructionSig::RRR},
@@ -129,6 +147,23 @@ const char* mnemonic(Opcode opc) {
       {Opcode::JMP, "JMP"},
       {Opcode::JN, "JN"},
       {Opcode::JZ, "JZ"},
+      // compare and jump
+      {Opcode::NJEQ, "NJEQ"},
+      {Opcode::NJNE, "NJNE"},
+      {Opcode::NJLE, "NJLE"},
+      {Opcode::NJGE, "NJGE"},
+      {Opcode::NJLT, "NJLT"},
+      {Opcode::NJGT, "NJGT"},
+      {Opcode::NIJEQ, "NIJEQ"},
+      {Opcode::NIJNE, "NIJNE"},
+      {Opcode::NIJLE, "NIJLE"},
+      {Opcode::NIJGE, "NIJGE"},
+      {Opcode::NIJLT, "NIJLT"},
+      {Opcode::NIJGT, "NIJGT"},
+      {Opcode::SJEQ, "SJEQ"},
+      {Opcode::SJNE, "SJNE"},
+      {Opcode::SIJEQ, "SIJEQ"},
+      {Opcode::SIJNE, "SIJNE"},
       // copy
       {Opcode::MOV, "MOV"},
       // array
@@ -185,6 +220,7 @@ const char* mnemonic(Opcode opc) {
       // string
       {Opcode::SCONST, "SCONST"},
       {Opcode::SADD, "SADD"},
+      {Opcode::SADDMULTI, "SADDMULTI"},
       {Opcode::SSUBSTR, "SSUBSTR"},
       {Opcode::SCMPEQ, "SCMPEQ"},
       {Opcode::SCMPNE, "SCMPNE"},
@@ -233,6 +269,23 @@ FlowType resultType(Opcode opc) {
       {Opcode::JMP, FlowType::Void},
       {Opcode::JN, FlowType::Void},
       {Opcode::JZ, FlowType::Void},
+      // compare and jump
+      {Opcode::NJEQ, FlowType::Void},
+      {Opcode::NJNE, FlowType::Void},
+      {Opcode::NJLE, FlowType::Void},
+      {Opcode::NJGE, FlowType::Void},
+      {Opcode::NJLT, FlowType::Void},
+      {Opcode::NJGT, FlowType::Void},
+      {Opcode::NIJEQ, FlowType::Void},
+      {Opcode::NIJNE, FlowType::Void},
+      {Opcode::NIJLE, FlowType::Void},
+      {Opcode::NIJGE, FlowType::Void},
+      {Opcode::NIJLT, FlowType::Void},
+      {Opcode::NIJGT, FlowType::Void},
+      {Opcode::SJEQ, FlowType::Void},
+      {Opcode::SJNE, FlowType::Void},
+      {Opcode::SIJEQ, FlowType::Void},
+      {Opcode::SIJNE, FlowType::Void},
       // copy
       {Opcode::MOV, FlowType::Void},
       // array
@@ -289,6 +342,7 @@ FlowType resultType(Opcode opc) {
       // string
       {Opcode::SCONST, FlowType::String},
       {Opcode::SADD, FlowType::String},
+      {Opcode::SADDMULTI, FlowType::String},
       {Opcode::SSUBSTR, FlowType::String},
       {Opcode::SCMPEQ, FlowType::Boolean},
       {Opcode::SCMPNE, FlowType::Boolean},
@@ -414,6 +468,11 @@ Buffer disassemble(const Instruction* program, size_t n) {
  */
 size_t registerMax(Instruction instr) {
   Operand result = 0;
+
+  // reads the C registers starting at B
+  if (opcode(instr) == Opcode::SADDMULTI)
+    result = operandB(instr) + operandC(instr);
+
   switch (operandSignature(opcode(instr))) {
     case InstructionSig::RRR:
       result = std::max(result, (Operand)(1 + operandC(instr)));
@@ -26,6 +26,24 @@ enum Opcode {
   JN,    // JN reg, imm         ; conditional jump (A != 0)
   JZ,    // JZ reg, imm         ; conditional jump (A == 0)
 
+  // compare and jump (superinstructions)
+  NJEQ,   // NJEQ reg, reg, imm  ; jump to C if A == B
+  NJNE,   // NJNE reg, reg, imm  ; jump to C if A != B
+  NJLE,   // NJLE reg, reg, imm  ; jump to C if A <= B
+  NJGE,   // NJGE reg, reg, imm  ; jump to C if A >= B
+  NJLT,   // NJLT reg, reg, imm  ; jump to C if A < B
+  NJGT,   // NJGT reg, reg, imm  ; jump to C if A > B
+  NIJEQ,  // NIJEQ reg, imm, imm ; jump to C if A == B
+  NIJNE,  // NIJNE reg, imm, imm ; jump to C if A != B
+  NIJLE,  // NIJLE reg, imm, imm ; jump to C if A <= B
+  NIJGE,  // NIJGE reg, imm, imm ; jump to C if A >= B
+  NIJLT,  // NIJLT reg, imm, imm ; jump to C if A < B
+  NIJGT,  // NIJGT reg, imm, imm ; jump to C if A > B
+  SJEQ,   // SJEQ reg, reg, imm  ; jump to C if A == B
+  SJNE,   // SJNE reg, reg, imm  ; jump to C if A != B
+  SIJEQ,  // SIJEQ reg, imm, imm ; jump to C if A == stringConstants[B]
+  SIJNE,  // SIJNE reg, imm, imm ; jump to C if A != stringConstants[B]
+
   // copy
   MOV,  // A = B
 
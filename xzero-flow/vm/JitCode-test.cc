@@ -0,0 +1,280 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#include <xzero-flow/sysconfig.h>
+
+#if defined(ENABLE_FLOW_JIT)
+
+#include <gtest/gtest.h>
+#include <xzero-flow/mock/MockRuntime.h>
+#include <xzero-flow/vm/Handler.h>
+#include <xzero-flow/vm/Program.h>
+#include <xzero-flow/vm/Runner.h>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace xzero;
+using namespace xzero::flow;
+
+// The outcome of running a handler.
+struct Outcome {
+  bool result;
+  std::vector<std::string> output;
+  size_t suspendCount;
+};
+
+// Runs the handler "main" of @p source, compiled at @p optimizationLevel,
+// either interpreted or, with @p jit, as native code compiled on its first
+// run.
+static Outcome run(const std::string& source, int optimizationLevel,
+                   bool jit) {
+  const unsigned threshold = vm::Handler::jitThreshold();
+  vm::Handler::setJitThreshold(jit ? 0 : std::numeric_limits<unsigned>::max());
+
+  Outcome outcome = {false, {}, 0};
+  MockRuntime runtime;
+  std::unique_ptr<vm::Program> program = runtime.compile(source,
+                                                         optimizationLevel);
+  if (!program) {
+    ADD_FAILURE() << "Could not compile:\n" << source;
+  } else {
+    outcome.result = runtime.run(program.get(), "main");
+    outcome.output = runtime.output();
+    outcome.suspendCount = runtime.suspendCount();
+
+    if (jit) {
+      EXPECT_TRUE(program->findHandler("main")->jitEntry() != nullptr)
+          << "Could not compile to native code:\n" << source;
+    }
+  }
+
+  vm::Handler::setJitThreshold(threshold);
+  return outcome;
+}
+
+// Tests that @p source results in @p result and @p output, with and without
+// optimizations, both interpreted and as native code.
+static void testJit(const std::string& source, bool result,
+                    const std::vector<std::string>& output,
+                    size_t suspendCount = 0) {
+  for (int level = 0; level <= 1; ++level) {
+    for (bool jit : {false, true}) {
+      Outcome outcome = run(source, level, jit);
+      EXPECT_EQ(result, outcome.result)
+          << (jit ? "native" : "interpreted") << " at -O" << level;
+      EXPECT_EQ(output, outcome.output)
+          << (jit ? "native" : "interpreted") << " at -O" << level;
+      EXPECT_EQ(suspendCount, outcome.suspendCount)
+          << (jit ? "native" : "interpreted") << " at -O" << level;
+    }
+  }
+}
+
+TEST(JitCode, arithmetic) {
+  testJit(
+      "handler main {\n"
+      "  var a = num(20);\n"
+      "  var b = num(6);\n"
+      "  emit(a + b);\n"
+      "  emit(a - b);\n"
+      "  emit(a * b);\n"
+      "  emit(a / b);\n"
+      "  emit(a % b);\n"
+      "  emit(b ** 3);\n"
+      "  emit(a shl 2);\n"
+      "  emit(a shr 2);\n"
+      "  emit(-a);\n"
+      "  emit(~b);\n"
+      "  emit(a + 100000);\n"
+      "  emit(a * 3 - 1);\n"
+      "  emit(a == b);\n"
+      "  emit(a > b and not boolean(false));\n"
+      "  emit(boolean(true) xor boolean(true));\n"
+      "}\n",
+      false,
+      {"26", "14", "120", "3", "2", "216", "80", "5", "-20", "-7", "100020",
+       "59", "false", "true", "false"});
+}
+
+TEST(JitCode, numberBranches) {
+  testJit(
+      "handler main {\n"
+      "  if num(3) < num(4) {\n"
+      "    emit('lt');\n"
+      "  }\n"
+      "  if num(4) >= 5 {\n"
+      "    emit('ge');\n"
+      "  } else {\n"
+      "    emit('not ge');\n"
+      "  }\n"
+      "  if boolean(true) {\n"
+      "    emit('true');\n"
+      "  }\n"
+      "}\n",
+      false, {"lt", "not ge", "true"});
+}
+
+TEST(JitCode, stringCompares) {
+  testJit(
+      "handler main {\n"
+      "  var a = str('abc');\n"
+      "  var b = str('abd');\n"
+      "  emit(a == b);\n"
+      "  emit(a != b);\n"
+      "  emit(a < b);\n"
+      "  emit(a <= b);\n"
+      "  emit(a > b);\n"
+      "  emit(a >= b);\n"
+      "  emit(a =^ 'ab');\n"
+      "  emit(a =$ 'bd');\n"
+      "  emit(a in 'bc');\n"
+      "  emit(a + '-' + b + '-' + string(num(7)));\n"
+      "  if a == 'abc' {\n"
+      "    emit('eq');\n"
+      "  }\n"
+      "  if a != b {\n"
+      "    emit('ne');\n"
+      "  }\n"
+      "}\n",
+      false,
+      {"false", "true", "true", "true", "false", "false", "true", "false",
+       "true", "abc-abd-7", "eq", "ne"});
+}
+
+TEST(JitCode, match) {
+  const std::string source =
+      "handler main {\n"
+      "  match str(PATH) {\n"
+      "    on '/a' emit('a');\n"
+      "    on '/b' emit('b');\n"
+      "    else emit('else');\n"
+      "  }\n"
+      "  match str(PATH) =^ {\n"
+      "    on '/a' emit('head a');\n"
+      "  }\n"
+      "  match str(PATH) =$ {\n"
+      "    on 'b' emit('tail b');\n"
+      "  }\n"
+      "}\n";
+  const std::vector<std::pair<std::string, std::vector<std::string>>> cases =
+      {{"'/a'", {"a", "head a"}},
+       {"'/b'", {"b", "tail b"}},
+       {"'/c'", {"else"}}};
+
+  for (const auto& one : cases) {
+    std::string program = source;
+    for (size_t i = program.find("PATH"); i != std::string::npos;
+         i = program.find("PATH"))
+      program.replace(i, 4, one.first);
+
+    testJit(program, false, one.second);
+  }
+}
+
+TEST(JitCode, ipAddresses) {
+  testJit(
+      "handler main {\n"
+      "  var a = ip(10.0.0.1);\n"
+      "  emit(a);\n"
+      "  emit(a == 10.0.0.1);\n"
+      "  emit(a in 10.0.0.0/8);\n"
+      "  emit(cidr(192.168.0.0/16));\n"
+      "  emit(string(a) + '!');\n"
+      "  emit([1, 2]);\n"
+      "  emit(['a', 'b']);\n"
+      "}\n",
+      false, {"10.0.0.1", "true", "true", "192.168.0.0/16", "10.0.0.1!",
+              "1,2", "a,b"});
+}
+
+TEST(JitCode, handlers) {
+  testJit(
+      "handler main {\n"
+      "  emit('before');\n"
+      "  handled boolean(false);\n"
+      "  emit('between');\n"
+      "  respond 200;\n"
+      "  emit('after');\n"
+      "}\n",
+      true, {"before", "between", "respond 200"});
+
+  testJit(
+      "handler main {\n"
+      "  handled boolean(false);\n"
+      "  emit('unhandled');\n"
+      "}\n",
+      false, {"unhandled"});
+}
+
+TEST(JitCode, suspendAndResume) {
+  // the native code returns when suspended and gets resumed in the
+  // interpreter
+  testJit(
+      "handler main {\n"
+      "  var s = str('a');\n"
+      "  var n = num(1);\n"
+      "  suspend;\n"
+      "  emit(s + string(n));\n"
+      "  suspend;\n"
+      "  if n == 1 {\n"
+      "    respond 200;\n"
+      "  }\n"
+      "}\n",
+      true, {"a1", "respond 200"}, 2);
+}
+
+TEST(JitCode, exceptions) {
+  // exceptions thrown by native callbacks pass the native code, leaving
+  // the Runner just like the interpreter does
+  const std::string source =
+      "handler main {\n"
+      "  emit('before');\n"
+      "  raise(str('failed'));\n"
+      "  emit('after');\n"
+      "}\n";
+  const unsigned threshold = vm::Handler::jitThreshold();
+
+  for (int level = 0; level <= 1; ++level) {
+    for (bool jit : {false, true}) {
+      vm::Handler::setJitThreshold(
+          jit ? 0 : std::numeric_limits<unsigned>::max());
+
+      MockRuntime runtime;
+      std::unique_ptr<vm::Program> program = runtime.compile(source, level);
+      if (!program) {
+        ADD_FAILURE() << "Could not compile:\n" << source;
+        continue;
+      }
+      vm::Handler* handler = program->findHandler("main");
+
+      // the native code remains usable afterwards
+      for (int i = 0; i != 2; ++i) {
+        vm::RunnerPtr runner = handler->createRunner();
+        try {
+          runner->run();
+          ADD_FAILURE() << "Exception expected.";
+        } catch (const std::runtime_error& e) {
+          EXPECT_EQ(std::string("failed"), e.what());
+        }
+        EXPECT_TRUE(runner->isRunning())
+            << (jit ? "native" : "interpreted") << " at -O" << level;
+      }
+
+      EXPECT_EQ(std::vector<std::string>({"before", "before"}),
+                runtime.output())
+          << (jit ? "native" : "interpreted") << " at -O" << level;
+      EXPECT_EQ(jit, handler->jitEntry() != nullptr);
+    }
+  }
+
+  vm::Handler::setJitThreshold(threshold);
+}
+
+#endif
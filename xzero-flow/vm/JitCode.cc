@@ -0,0 +1,781 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#include <xzero-flow/vm/JitCode.h>
+#include <xzero-flow/vm/Handler.h>
+#include <xzero-flow/vm/Runner.h>
+#include <xzero-flow/vm/Program.h>
+#include <xzero-flow/vm/ConstantPool.h>
+#include <xzero-flow/vm/NativeCallback.h>
+#include <xzero-flow/vm/Params.h>
+#include <xzero-flow/vm/Match.h>
+#include <xzero-flow/vm/Instruction.h>
+#include <xzero-base/RegExp.h>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <inttypes.h>
+#include <sys/mman.h>
+
+#if !defined(__x86_64__)
+#error "The Flow JIT compiler only supports x86-64."
+#endif
+
+namespace xzero {
+namespace flow {
+namespace vm {
+
+// {{{ helpers
+/**
+ * Implements the instructions that are not emitted inline.
+ *
+ * Each helper gets the Runner and the instruction's operands, just like
+ * the instruction's implementation in Runner::loop().
+ *
+ * The native code has no unwind information, so exceptions must not leave
+ * a helper. Helpers that may throw store the exception in the Runner
+ * instead and make the native code return, for Runner::run() to rethrow
+ * it.
+ */
+struct JitCode::Helpers {
+  typedef bool (*Function)(Runner* r, Operand a, Operand b, Operand c);
+  typedef int (*Call)(Runner* r, const NativeCallback* callback,
+                      Operand argc, Operand argv, uint32_t nextPC);
+
+  /**
+   * Runs the helper @p fn, catching any exception.
+   *
+   * @retval true the next instruction is to be run.
+   * @retval false an exception is pending in the Runner.
+   */
+  template <void (*fn)(Runner*, Operand, Operand, Operand)>
+  static bool guard(Runner* r, Operand a, Operand b, Operand c) {
+    try {
+      fn(r, a, b, c);
+      return true;
+    } catch (...) {
+      r->exception_ = std::current_exception();
+      return false;
+    }
+  }
+
+  static Register& reg(Runner* r, Operand i) { return r->data_[i]; }
+  static FlowNumber num(Runner* r, Operand i) {
+    return (FlowNumber)r->data_[i];
+  }
+  static FlowString& str(Runner* r, Operand i) {
+    return *(FlowString*)r->data_[i];
+  }
+
+  // numerical
+  static void NDIV(Runner* r, Operand a, Operand b, Operand c) {
+    reg(r, a) = static_cast<Register>(num(r, b) / num(r, c));
+  }
+  static void NREM(Runner* r, Operand a, Operand b, Operand c) {
+    reg(r, a) = static_cast<Register>(num(r, b) % num(r, c));
+  }
+  static void NPOW(Runner* r, Operand a, Operand b, Operand c) {
+    reg(r, a) = static_cast<Register>(powl(num(r, b), num(r, c)));
+  }
+  static void NIDIV(Runner* r, Operand a, Operand b, Operand c) {
+    reg(r, a) = static_cast<Register>(num(r, b) / c);
+  }
+  static void NIREM(Runner* r, Operand a, Operand b, Operand c) {
+    reg(r, a) = static_cast<Register>(num(r, b) % c);
+  }
+  static void NIPOW(Runner* r, Operand a, Operand b, Operand c) {
+    reg(r, a) = static_cast<Register>(powl(num(r, b), c));
+  }
+
+  // string
+  static void SADD(Runner* r, Operand a, Operand b, Operand c) {
+    reg(r, a) = (Register)r->catString(str(r, b), str(r, c));
+  }
+  static void SADDMULTI(Runner* r, Operand a, Operand b, Operand c) {
+    size_t length = 0;
+    for (Operand i = 0; i != c; ++i)
+      length += str(r, b + i).size();
+
+    FlowString* result = r->allocateString(length);
+    char* p = result->data();
+    for (Operand i = 0; i != c; ++i) {
+      const FlowString& s = str(r, b + i);
+      memcpy(p, s.data(), s.size());
+      p += s.size();
+    }
+
+    reg(r, a) = (Register)result;
+  }
+  static void SSUBSTR(Runner* r, Operand a, Operand b, Operand c) {
+    const FlowString& s = str(r, b);
+    const size_t offset = std::min<size_t>(reg(r, c), s.size());
+    const size_t count = std::min<size_t>(reg(r, c + 1), s.size() - offset);
+    reg(r, a) = (Register)r->newString(s.data() + offset, count);
+  }
+  static void SCMPEQ(Runner* r, Operand a, Operand b, Operand c) {
+    reg(r, a) = str(r, b) == str(r, c);
+  }
+  static void SCMPNE(Runner* r, Operand a, Operand b, Operand c) {
+    reg(r, a) = str(r, b) != str(r, c);
+  }
+  static void SCMPLE(Runner* r, Operand a, Operand b, Operand c) {
+    reg(r, a) = str(r, b) <= str(r, c);
+  }
+  static void SCMPGE(Runner* r, Operand a, Operand b, Operand c) {
+    reg(r, a) = str(r, b) >= str(r, c);
+  }
+  static void SCMPLT(Runner* r, Operand a, Operand b, Operand c) {
+    reg(r, a) = str(r, b) < str(r, c);
+  }
+  static void SCMPGT(Runner* r, Operand a, Operand b, Operand c) {
+    reg(r, a) = str(r, b) > str(r, c);
+  }
+  static void SCMPBEG(Runner* r, Operand a, Operand b, Operand c) {
+    reg(r, a) = str(r, b).begins(str(r, c));
+  }
+  static void SCMPEND(Runner* r, Operand a, Operand b, Operand c) {
+    reg(r, a) = str(r, b).ends(str(r, c));
+  }
+  static void SCONTAINS(Runner* r, Operand a, Operand b, Operand c) {
+    reg(r, a) = str(r, b).find(str(r, c)) != FlowString::npos;
+  }
+  static void SLEN(Runner* r, Operand a, Operand b, Operand c) {
+    reg(r, a) = str(r, b).size();
+  }
+  static void SISEMPTY(Runner* r, Operand a, Operand b, Operand c) {
+    reg(r, a) = str(r, b).empty();
+  }
+  // returns the target pc, or the end of the code if an exception is pending
+  static uint64_t SMATCH(Runner* r, Operand a, Operand b, Operand c) {
+    try {
+      return r->program_->match(b)->evaluate((FlowString*)reg(r, a), r);
+    } catch (...) {
+      r->exception_ = std::current_exception();
+      return r->handler_->code().size();
+    }
+  }
+  static bool SJEQ(Runner* r, Operand a, Operand b, Operand c) {
+    return str(r, a) == str(r, b);
+  }
+  static bool SJNE(Runner* r, Operand a, Operand b, Operand c) {
+    return str(r, a) != str(r, b);
+  }
+  // B is resolved to its string constant at compile time
+  static bool SIJEQ(Runner* r, Operand a, const FlowString* b) {
+    return str(r, a) == *b;
+  }
+  static bool SIJNE(Runner* r, Operand a, const FlowString* b) {
+    return str(r, a) != *b;
+  }
+
+  // ipaddr
+  static void PCMPEQ(Runner* r, Operand a, Operand b, Operand c) {
+    reg(r, a) = *(IPAddress*)reg(r, b) == *(IPAddress*)reg(r, c);
+  }
+  static void PCMPNE(Runner* r, Operand a, Operand b, Operand c) {
+    reg(r, a) = *(IPAddress*)reg(r, b) != *(IPAddress*)reg(r, c);
+  }
+  static void PINCIDR(Runner* r, Operand a, Operand b, Operand c) {
+    reg(r, a) = ((Cidr*)reg(r, c))->contains(*(IPAddress*)reg(r, b));
+  }
+
+  // regex
+  static void SREGMATCH(Runner* r, Operand a, Operand b, Operand c) {
+    RegExpContext* cx = (RegExpContext*)r->userdata();
+    reg(r, a) = r->program_->constants().getRegExp(c).match(
+        str(r, b), cx ? cx->regexMatch() : nullptr);
+  }
+  static void SREGGROUP(Runner* r, Operand a, Operand b, Operand c) {
+    FlowNumber position = num(r, b);
+    RegExpContext* cx = (RegExpContext*)r->userdata();
+    RegExp::Result* rr = cx->regexMatch();
+    const auto& match = rr->at(position);
+
+    reg(r, a) = (Register)r->newString(match.first, match.second);
+  }
+
+  // conversion
+  static void S2I(Runner* r, Operand a, Operand b, Operand c) {
+    reg(r, a) = str(r, b).toInt();
+  }
+  static void I2S(Runner* r, Operand a, Operand b, Operand c) {
+    char buf[64];
+    int n = snprintf(buf, sizeof(buf), "%" PRIi64 "", (int64_t)reg(r, b));
+    if (n > 0) {
+      reg(r, a) = (Register)r->newString(buf, n);
+    } else {
+      reg(r, a) = (Register)r->emptyString();
+    }
+  }
+  static void P2S(Runner* r, Operand a, Operand b, Operand c) {
+    reg(r, a) = (Register)r->newString(((IPAddress*)reg(r, b))->str());
+  }
+  static void C2S(Runner* r, Operand a, Operand b, Operand c) {
+    reg(r, a) = (Register)r->newString(((Cidr*)reg(r, b))->str());
+  }
+  static void R2S(Runner* r, Operand a, Operand b, Operand c) {
+    reg(r, a) = (Register)r->newString(((RegExp*)reg(r, b))->pattern());
+  }
+
+  // invokation
+  // The callback is resolved at compile time. Returns -1 to continue, or
+  // the handler's result to return.
+  static int CALL(Runner* r, const NativeCallback* callback, Operand argc,
+                  Operand argv, uint32_t nextPC) {
+    Params args(argc, &r->data_[argv], r);
+    try {
+      callback->invoke(args);
+    } catch (...) {
+      r->exception_ = std::current_exception();
+      return 0;
+    }
+
+    if (r->state_ == Runner::Suspended) {
+      r->pc_ = nextPC;
+      return 0;
+    }
+
+    return -1;
+  }
+  static int HANDLER(Runner* r, const NativeCallback* callback,
+                     Operand argc, Operand argv, uint32_t nextPC) {
+    Params args(argc, &r->data_[argv], r);
+    try {
+      callback->invoke(args);
+    } catch (...) {
+      r->exception_ = std::current_exception();
+      return 0;
+    }
+    const bool handled = (bool)r->data_[argv];
+
+    if (r->state_ == Runner::Suspended) {
+      r->pc_ = nextPC;
+      return 0;
+    }
+
+    return handled ? 1 : -1;
+  }
+};
+// }}}
+// {{{ x86-64 assembler
+namespace {
+
+// general purpose registers, by their encoding
+enum Reg { RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSI = 6, RDI = 7 };
+
+// condition codes of Jcc and SETcc
+enum Cond { E = 0x4, NE = 0x5, L = 0xC, GE = 0xD, LE = 0xE, G = 0xF };
+
+/**
+ * Retrieves the offset of the length within a FlowString, for comparing
+ * string lengths inline.
+ */
+struct StringLayout : public FlowString {
+  static int32_t sizeOffset() {
+    static const FlowString probe;
+    const size_t FlowString::*size = &StringLayout::size_;
+    return static_cast<int32_t>(reinterpret_cast<const char*>(&(probe.*size)) -
+                                reinterpret_cast<const char*>(&probe));
+  }
+};
+
+/**
+ * Minimal x86-64 machine code emitter.
+ *
+ * The Runner is kept in RBX and its registers in R12, which are callee-saved
+ * and hence survive helper calls. RAX and RCX are used as scratch registers.
+ */
+class Assembler {
+ public:
+  size_t offset() const { return code_.size(); }
+  const std::vector<uint8_t>& code() const { return code_; }
+
+  void emit(std::initializer_list<uint8_t> bytes) {
+    code_.insert(code_.end(), bytes);
+  }
+
+  void imm32(uint32_t value) {
+    for (int i = 0; i < 4; ++i)
+      code_.push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+
+  void imm64(uint64_t value) {
+    imm32(static_cast<uint32_t>(value));
+    imm32(static_cast<uint32_t>(value >> 32));
+  }
+
+  // push rbx; push r12; push r13; mov rbx, rdi; mov r12, rsi
+  void prologue() {
+    emit({0x53, 0x41, 0x54, 0x41, 0x55, 0x48, 0x89, 0xFB, 0x49, 0x89, 0xF4});
+  }
+
+  // pop r13; pop r12; pop rbx; ret
+  void epilogue() { emit({0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3}); }
+
+  // mov reg, [r12 + 8 * r]
+  void load(Reg reg, Operand r) {
+    emit({0x49, 0x8B, static_cast<uint8_t>(0x84 | (reg << 3)), 0x24});
+    imm32(8 * r);
+  }
+
+  // mov [r12 + 8 * r], reg
+  void store(Operand r, Reg reg) {
+    emit({0x49, 0x89, static_cast<uint8_t>(0x84 | (reg << 3)), 0x24});
+    imm32(8 * r);
+  }
+
+  // mov qword [r12 + 8 * r], imm32
+  void storeImm(Operand r, uint32_t value) {
+    emit({0x49, 0xC7, 0x84, 0x24});
+    imm32(8 * r);
+    imm32(value);
+  }
+
+  // mov reg, imm64
+  void movImm64(Reg reg, uint64_t value) {
+    emit({0x48, static_cast<uint8_t>(0xB8 + reg)});
+    imm64(value);
+  }
+
+  // mov reg32, imm32 (zero-extending)
+  void movImm32(Reg reg, uint32_t value) {
+    emit({static_cast<uint8_t>(0xB8 + reg)});
+    imm32(value);
+  }
+
+  // op rax, rcx
+  void add() { emit({0x48, 0x01, 0xC8}); }
+  void sub() { emit({0x48, 0x29, 0xC8}); }
+  void imul() { emit({0x48, 0x0F, 0xAF, 0xC1}); }
+  void bitAnd() { emit({0x48, 0x21, 0xC8}); }
+  void bitOr() { emit({0x48, 0x09, 0xC8}); }
+  void bitXor() { emit({0x48, 0x31, 0xC8}); }
+  void shl() { emit({0x48, 0xD3, 0xE0}); }
+  void sar() { emit({0x48, 0xD3, 0xF8}); }
+  void neg() { emit({0x48, 0xF7, 0xD8}); }
+  void bitNot() { emit({0x48, 0xF7, 0xD0}); }
+  void cmp() { emit({0x48, 0x39, 0xC8}); }
+
+  // test reg, reg
+  void test(Reg reg) {
+    emit({0x48, 0x85, static_cast<uint8_t>(0xC0 | (reg << 3) | reg)});
+  }
+
+  // test al, al
+  void testByte() { emit({0x84, 0xC0}); }
+
+  // setcc reg8
+  void set(Cond cc, Reg reg) {
+    emit({0x0F, static_cast<uint8_t>(0x90 | cc),
+          static_cast<uint8_t>(0xC0 | reg)});
+  }
+
+  // movzx eax, al
+  void zeroExtend() { emit({0x0F, 0xB6, 0xC0}); }
+
+  // cmp eax, imm8
+  void cmpImm8(int8_t value) {
+    emit({0x83, 0xF8, static_cast<uint8_t>(value)});
+  }
+
+  // cmp qword [rax + disp], imm32
+  void cmpMemory(int32_t disp, uint32_t value) {
+    emit({0x48, 0x81, 0xB8});
+    imm32(disp);
+    imm32(value);
+  }
+
+  // mov reg, imm (choosing the shortest form)
+  void movImm(Reg reg, uint64_t value) {
+    if (value <= UINT32_MAX)
+      movImm32(reg, static_cast<uint32_t>(value));
+    else
+      movImm64(reg, value);
+  }
+
+  /** Calls @p fn with the Runner and given immediate arguments. */
+  void call(const void* fn, uint64_t a, uint64_t b, uint64_t c) {
+    emit({0x48, 0x89, 0xDF});  // mov rdi, rbx
+    movImm(RSI, a);
+    movImm(RDX, b);
+    movImm(RCX, c);
+    movImm64(RAX, reinterpret_cast<uint64_t>(fn));
+    emit({0xFF, 0xD0});  // call rax
+  }
+
+  /** Calls @p fn like call(), passing @p d as fifth argument. */
+  void call(const void* fn, uint64_t a, uint64_t b, uint64_t c, uint32_t d) {
+    emit({0x41, 0xB8});  // mov r8d, imm32
+    imm32(d);
+    call(fn, a, b, c);
+  }
+
+  // jmp [rcx + rax * 8]
+  void jumpIndirect() { emit({0xFF, 0x24, 0xC1}); }
+
+  /** Emits a jcc with its target left to patch(), returning its offset. */
+  size_t jump(Cond cc) {
+    emit({0x0F, static_cast<uint8_t>(0x80 | cc)});
+    imm32(0);
+    return offset() - 4;
+  }
+
+  /** Emits a jmp with its target left to patch(), returning its offset. */
+  size_t jump() {
+    emit({0xE9});
+    imm32(0);
+    return offset() - 4;
+  }
+
+  /** Lets the jump at @p at go to @p target. */
+  void patch(size_t at, size_t target) {
+    const int32_t rel = static_cast<int32_t>(target - (at + 4));
+    memcpy(&code_[at], &rel, sizeof(rel));
+  }
+
+ private:
+  std::vector<uint8_t> code_;
+};
+
+Cond condition(Opcode opc) {
+  switch (opc) {
+    case NCMPEQ: case NICMPEQ: case NJEQ: case NIJEQ: return E;
+    case NCMPNE: case NICMPNE: case NJNE: case NIJNE: return NE;
+    case NCMPLE: case NICMPLE: case NJLE: case NIJLE: return LE;
+    case NCMPGE: case NICMPGE: case NJGE: case NIJGE: return GE;
+    case NCMPLT: case NICMPLT: case NJLT: case NIJLT: return L;
+    case NCMPGT: case NICMPGT: case NJGT: case NIJGT: return G;
+    default: return E;
+  }
+}
+
+}  // namespace
+// }}}
+
+JitCode::JitCode(void* memory, size_t size, std::vector<uint64_t>&& jumpTable)
+    : memory_(memory),
+      size_(size),
+      entry_(reinterpret_cast<Entry>(memory)),
+      jumpTable_(std::move(jumpTable)) {
+}
+
+JitCode::~JitCode() {
+  munmap(memory_, size_);
+}
+
+std::unique_ptr<JitCode> JitCode::compile(const Handler* handler) {
+  typedef Helpers H;
+  static const std::pair<Opcode, H::Function> functions[] = {
+      {NDIV, &H::guard<&H::NDIV>},
+      {NREM, &H::guard<&H::NREM>},
+      {NPOW, &H::guard<&H::NPOW>},
+      {NIDIV, &H::guard<&H::NIDIV>},
+      {NIREM, &H::guard<&H::NIREM>},
+      {NIPOW, &H::guard<&H::NIPOW>},
+      {SADD, &H::guard<&H::SADD>},
+      {SADDMULTI, &H::guard<&H::SADDMULTI>},
+      {SSUBSTR, &H::guard<&H::SSUBSTR>},
+      {SCMPEQ, &H::guard<&H::SCMPEQ>},
+      {SCMPNE, &H::guard<&H::SCMPNE>},
+      {SCMPLE, &H::guard<&H::SCMPLE>},
+      {SCMPGE, &H::guard<&H::SCMPGE>},
+      {SCMPLT, &H::guard<&H::SCMPLT>},
+      {SCMPGT, &H::guard<&H::SCMPGT>},
+      {SCMPBEG, &H::guard<&H::SCMPBEG>},
+      {SCMPEND, &H::guard<&H::SCMPEND>},
+      {SCONTAINS, &H::guard<&H::SCONTAINS>},
+      {SLEN, &H::guard<&H::SLEN>},
+      {SISEMPTY, &H::guard<&H::SISEMPTY>},
+      {PCMPEQ, &H::guard<&H::PCMPEQ>},
+      {PCMPNE, &H::guard<&H::PCMPNE>},
+      {PINCIDR, &H::guard<&H::PINCIDR>},
+      {SREGMATCH, &H::guard<&H::SREGMATCH>},
+      {SREGGROUP, &H::guard<&H::SREGGROUP>},
+      {S2I, &H::guard<&H::S2I>},
+      {I2S, &H::guard<&H::I2S>},
+      {P2S, &H::guard<&H::P2S>},
+      {C2S, &H::guard<&H::C2S>},
+      {R2S, &H::guard<&H::R2S>},
+  };
+
+  const std::vector<Instruction>& code = handler->code();
+  const ConstantPool& cp = handler->program()->constants();
+
+  // including the end of the code, where SMATCH goes on exceptions
+  std::vector<uint64_t> jumpTable(code.size() + 1);
+  std::vector<size_t> offsets(code.size() + 1);
+  std::vector<std::pair<size_t, size_t>> jumps;  // (patch offset, pc)
+  std::vector<size_t> exits;                     // patch offsets
+  Assembler as;
+
+  as.prologue();
+
+  for (size_t pc = 0, e = code.size(); pc != e; ++pc) {
+    const Instruction instr = code[pc];
+    const Opcode opc = opcode(instr);
+    const Operand A = operandA(instr);
+    const Operand B = operandB(instr);
+    const Operand C = operandC(instr);
+
+    offsets[pc] = as.offset();
+
+    switch (opc) {
+      case NOP:
+      case SURLENC:  // TODO, like in the interpreter
+      case SURLDEC:
+        break;
+
+      // control
+      case EXIT:
+        as.movImm32(RAX, A != 0);
+        exits.push_back(as.jump());
+        break;
+      case JMP:
+        jumps.emplace_back(as.jump(), A);
+        break;
+      case JN:
+      case JZ:
+        as.load(RAX, A);
+        as.test(RAX);
+        jumps.emplace_back(as.jump(opc == JN ? NE : E), B);
+        break;
+
+      // compare and jump
+      case NJEQ: case NJNE: case NJLE: case NJGE: case NJLT: case NJGT:
+        as.load(RAX, A);
+        as.load(RCX, B);
+        as.cmp();
+        jumps.emplace_back(as.jump(condition(opc)), C);
+        break;
+      case NIJEQ: case NIJNE: case NIJLE: case NIJGE: case NIJLT: case NIJGT:
+        as.load(RAX, A);
+        as.movImm32(RCX, B);
+        as.cmp();
+        jumps.emplace_back(as.jump(condition(opc)), C);
+        break;
+      case SJEQ:
+      case SJNE:
+        as.call(reinterpret_cast<const void*>(opc == SJEQ ? &H::SJEQ
+                                                          : &H::SJNE),
+                A, B, 0);
+        as.testByte();
+        jumps.emplace_back(as.jump(NE), C);
+        break;
+      case SIJEQ:
+      case SIJNE: {
+        // strings of different length differ, without comparing any data
+        const FlowString& constant = cp.getString(B);
+        if (constant.size() <= INT32_MAX) {
+          as.load(RAX, A);
+          as.cmpMemory(StringLayout::sizeOffset(), constant.size());
+          jumps.emplace_back(as.jump(NE), opc == SIJNE ? C : pc + 1);
+        }
+        as.call(reinterpret_cast<const void*>(opc == SIJEQ ? &H::SIJEQ
+                                                           : &H::SIJNE),
+                A, reinterpret_cast<uint64_t>(&constant), 0);
+        as.testByte();
+        jumps.emplace_back(as.jump(NE), C);
+        break;
+      }
+
+      // copy
+      case MOV:
+        as.load(RAX, B);
+        as.store(A, RAX);
+        break;
+
+      // constants
+      case ITCONST:
+        as.movImm64(RAX, reinterpret_cast<uint64_t>(&cp.getIntArray(B)));
+        as.store(A, RAX);
+        break;
+      case STCONST:
+        as.movImm64(RAX, reinterpret_cast<uint64_t>(&cp.getStringArray(B)));
+        as.store(A, RAX);
+        break;
+      case PTCONST:
+        as.movImm64(RAX,
+                    reinterpret_cast<uint64_t>(&cp.getIPAddressArray(B)));
+        as.store(A, RAX);
+        break;
+      case CTCONST:
+        as.movImm64(RAX, reinterpret_cast<uint64_t>(&cp.getCidrArray(B)));
+        as.store(A, RAX);
+        break;
+      case IMOV:
+        as.storeImm(A, B);
+        break;
+      case NCONST:
+        as.movImm64(RAX, static_cast<uint64_t>(cp.getInteger(B)));
+        as.store(A, RAX);
+        break;
+      case SCONST:
+        as.movImm64(RAX, reinterpret_cast<uint64_t>(&cp.getString(B)));
+        as.store(A, RAX);
+        break;
+      case PCONST:
+        as.movImm64(RAX, reinterpret_cast<uint64_t>(&cp.getIPAddress(B)));
+        as.store(A, RAX);
+        break;
+      case CCONST:
+        as.movImm64(RAX, reinterpret_cast<uint64_t>(&cp.getCidr(B)));
+        as.store(A, RAX);
+        break;
+
+      // numerical
+      case NNEG:
+      case NNOT:
+        as.load(RAX, B);
+        if (opc == NNEG)
+          as.neg();
+        else
+          as.bitNot();
+        as.store(A, RAX);
+        break;
+      case NADD: case NSUB: case NMUL: case NSHL: case NSHR:
+      case NAND: case NOR: case NXOR: case BXOR:
+      case NIADD: case NISUB: case NIMUL: case NISHL: case NISHR:
+      case NIAND: case NIOR: case NIXOR:
+        as.load(RAX, B);
+        if (operandSignature(opc) == InstructionSig::RRI)
+          as.movImm32(RCX, C);
+        else
+          as.load(RCX, C);
+
+        switch (opc) {
+          case NADD: case NIADD: as.add(); break;
+          case NSUB: case NISUB: as.sub(); break;
+          case NMUL: case NIMUL: as.imul(); break;
+          case NSHL: case NISHL: as.shl(); break;
+          case NSHR: case NISHR: as.sar(); break;
+          case NAND: case NIAND: as.bitAnd(); break;
+          case NOR: case NIOR: as.bitOr(); break;
+          default: as.bitXor(); break;
+        }
+        as.store(A, RAX);
+        break;
+      case NCMPZ:
+      case BNOT:
+        as.load(RAX, B);
+        as.test(RAX);
+        as.set(E, RAX);
+        as.zeroExtend();
+        as.store(A, RAX);
+        break;
+      case NCMPEQ: case NCMPNE: case NCMPLE: case NCMPGE: case NCMPLT:
+      case NCMPGT:
+      case NICMPEQ: case NICMPNE: case NICMPLE: case NICMPGE: case NICMPLT:
+      case NICMPGT:
+        as.load(RAX, B);
+        if (operandSignature(opc) == InstructionSig::RRI)
+          as.movImm32(RCX, C);
+        else
+          as.load(RCX, C);
+        as.cmp();
+        as.set(condition(opc), RAX);
+        as.zeroExtend();
+        as.store(A, RAX);
+        break;
+
+      // boolean
+      case BAND:
+      case BOR:
+        as.load(RAX, B);
+        as.load(RCX, C);
+        as.test(RAX);
+        as.set(NE, RAX);
+        as.test(RCX);
+        as.set(NE, RCX);
+        if (opc == BAND)
+          as.emit({0x20, 0xC8});  // and al, cl
+        else
+          as.emit({0x08, 0xC8});  // or al, cl
+        as.zeroExtend();
+        as.store(A, RAX);
+        break;
+
+      // match
+      case SMATCHEQ:
+      case SMATCHBEG:
+      case SMATCHEND:
+      case SMATCHR:
+        as.call(reinterpret_cast<const void*>(&H::SMATCH), A, B, 0);
+        as.movImm64(RCX, reinterpret_cast<uint64_t>(jumpTable.data()));
+        as.jumpIndirect();
+        break;
+
+      // invokation
+      case CALL:
+      case HANDLER: {
+        const Program* program = handler->program();
+        const NativeCallback* callback = opc == CALL
+                                             ? program->nativeFunction(A)
+                                             : program->nativeHandler(A);
+        H::Call fn = opc == CALL ? &H::CALL : &H::HANDLER;
+        as.call(reinterpret_cast<const void*>(fn),
+                reinterpret_cast<uint64_t>(callback), B, C, pc + 1);
+        as.cmpImm8(-1);
+        exits.push_back(as.jump(NE));
+        break;
+      }
+
+      default: {
+        auto i = std::find_if(std::begin(functions), std::end(functions),
+                              [&](const std::pair<Opcode, H::Function>& f) {
+          return f.first == opc;
+        });
+        if (i == std::end(functions))
+          return nullptr;
+
+        as.call(reinterpret_cast<const void*>(i->second), A, B, C);
+        as.testByte();
+        jumps.emplace_back(as.jump(E), code.size());
+        break;
+      }
+    }
+  }
+
+  // running past the end of the code, or bailing out on an exception
+  offsets[code.size()] = as.offset();
+  as.movImm32(RAX, 0);
+  const size_t epilogue = as.offset();
+  as.epilogue();
+
+  for (const auto& jump : jumps) {
+    if (jump.second > code.size())
+      return nullptr;
+
+    as.patch(jump.first, offsets[jump.second]);
+  }
+
+  for (size_t exit : exits)
+    as.patch(exit, epilogue);
+
+  const size_t size = as.code().size();
+  void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED)
+    return nullptr;
+
+  memcpy(memory, as.code().data(), size);
+
+  if (mprotect(memory, size, PROT_READ | PROT_EXEC) < 0) {
+    munmap(memory, size);
+    return nullptr;
+  }
+
+  for (size_t pc = 0, e = code.size(); pc <= e; ++pc)
+    jumpTable[pc] = reinterpret_cast<uint64_t>(memory) + offsets[pc];
+
+  return std::unique_ptr<JitCode>(
+      new JitCode(memory, size, std::move(jumpTable)));
+}
+
+}  // namespace vm
+}  // namespace flow
+}  // namespace xzero
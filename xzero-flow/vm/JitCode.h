@@ -0,0 +1,85 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <xzero-flow/Api.h>
+#include <xzero-flow/FlowType.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace xzero {
+namespace flow {
+namespace vm {
+
+class Handler;
+class Runner;
+
+/**
+ * Native x86-64 code of a handler, as compiled by compile().
+ *
+ * Every instruction is translated into machine code working on the
+ * Runner's registers in memory, which removes the instruction dispatch and
+ * operand decoding of Runner::loop(). Numeric, boolean and jump
+ * instructions are emitted inline. All other instructions call small
+ * helper functions implementing them.
+ *
+ * A native callback suspending the Runner makes the native code return,
+ * with the program counter saved in the Runner, so that Runner::resume()
+ * continues in the interpreter.
+ *
+ * Exceptions, e.g. thrown by native callbacks, are caught before they
+ * reach the native code, which has no unwind information. The native code
+ * returns then, and Runner::run() rethrows the exception.
+ */
+class XZERO_FLOW_API JitCode {
+ public:
+  /**
+   * Runs the handler from its start on @p data, the registers of
+   * @p runner.
+   *
+   * @return the handler's result, or @c false if it got suspended.
+   */
+  typedef bool (*Entry)(Runner* runner, Register* data);
+
+  JitCode(const JitCode&) = delete;
+  JitCode& operator=(const JitCode&) = delete;
+  ~JitCode();
+
+  /**
+   * Compiles the code of @p handler.
+   *
+   * The native code refers to the constants and native callbacks of the
+   * handler's program directly, which must be linked already.
+   *
+   * @return the compiled code, or @c nullptr if the code could not be
+   *         compiled, e.g. because it is too large.
+   */
+  static std::unique_ptr<JitCode> compile(const Handler* handler);
+
+  Entry entry() const { return entry_; }
+  size_t size() const { return size_; }
+
+ private:
+  struct Helpers;
+
+  JitCode(void* memory, size_t size, std::vector<uint64_t>&& jumpTable);
+
+ private:
+  void* memory_;
+  size_t size_;
+  Entry entry_;
+
+  //! native address of each instruction, for jumps to computed targets
+  std::vector<uint64_t> jumpTable_;
+};
+
+}  // namespace vm
+}  // namespace flow
+}  // namespace xzero
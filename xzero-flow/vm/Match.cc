@@ -43,6 +43,7 @@ MatchHead::MatchHead(const MatchDef& def, Program* program)
   for (const auto& one : def.cases) {
     map_.insert(program->constants().getString(one.label), one.pc);
   }
+  map_.build();
 }
 
 MatchHead::~MatchHead() {}
@@ -60,6 +61,7 @@ MatchTail::MatchTail(const MatchDef& def, Program* program)
   for (const auto& one : def.cases) {
     map_.insert(program->constants().getString(one.label), one.pc);
   }
+  map_.build();
 }
 
 MatchTail::~MatchTail() {}
@@ -73,11 +75,19 @@ uint64_t MatchTail::evaluate(const FlowString* condition, Runner* env) const {
 // }}}
 // {{{ MatchRegEx
 MatchRegEx::MatchRegEx(const MatchDef& def, Program* program)
-    : Match(def, program), map_() {
+    : Match(def, program), set_(patterns(def, program)), pcs_() {
+  for (const auto& one : def.cases) {
+    pcs_.push_back(one.pc);
+  }
+}
+
+std::vector<std::string> MatchRegEx::patterns(const MatchDef& def,
+                                              Program* program) {
+  std::vector<std::string> result;
   for (const auto& one : def.cases) {
-    map_.push_back(
-        std::make_pair(&program->constants().getRegExp(one.label), one.pc));
+    result.push_back(program->constants().getRegExp(one.label).pattern());
   }
+  return result;
 }
 
 MatchRegEx::~MatchRegEx() {}
@@ -85,11 +95,8 @@ MatchRegEx::~MatchRegEx() {}
 uint64_t MatchRegEx::evaluate(const FlowString* condition, Runner* env) const {
   RegExpContext* cx = (RegExpContext*)env->userdata();
   RegExp::Result* rs = cx ? cx->regexMatch() : nullptr;
-  for (const auto& one : map_) {
-    if (one.first->match(*condition, rs)) {
-      return one.second;
-    }
-  }
+  int index = set_.match(*condition, rs);
+  if (index >= 0) return pcs_[index];
 
   return def_.elsePC;  // no match found
 }
@@ -11,9 +11,8 @@
 #include <xzero-flow/vm/Instruction.h>
 #include <xzero-flow/vm/MatchClass.h>
 #include <xzero-flow/FlowType.h>
-#include <xzero-base/PrefixTree.h>
-#include <xzero-base/SuffixTree.h>
-#include <xzero-base/RegExp.h>
+#include <xzero-base/RadixTree.h>
+#include <xzero-base/RegExpSet.h>
 #include <sys/types.h>
 #include <cstdint>
 #include <vector>
@@ -85,10 +84,10 @@ class XZERO_FLOW_API MatchHead : public Match {
   virtual uint64_t evaluate(const FlowString* condition, Runner* env) const;
 
  private:
-  PrefixTree<FlowString, uint64_t> map_;
+  RadixTree<FlowString, uint64_t> map_;
 };
 
-/** Implements SMATCHBEG instruction. */
+/** Implements SMATCHEND instruction. */
 class XZERO_FLOW_API MatchTail : public Match {
  public:
   MatchTail(const MatchDef& def, Program* program);
@@ -97,10 +96,15 @@ class XZERO_FLOW_API MatchTail : public Match {
   virtual uint64_t evaluate(const FlowString* condition, Runner* env) const;
 
  private:
-  SuffixTree<FlowString, uint64_t> map_;
+  RadixTree<FlowString, uint64_t, true> map_;
 };
 
-/** Implements SMATCHR instruction. */
+/**
+ * Implements SMATCHR instruction.
+ *
+ * All case patterns are matched in a single pass by a RegExpSet, which
+ * preserves the first-match-wins order of the cases.
+ */
 class XZERO_FLOW_API MatchRegEx : public Match {
  public:
   MatchRegEx(const MatchDef& def, Program* program);
@@ -109,7 +113,12 @@ class XZERO_FLOW_API MatchRegEx : public Match {
   virtual uint64_t evaluate(const FlowString* condition, Runner* env) const;
 
  private:
-  std::vector<std::pair<const RegExp*, uint64_t>> map_;
+  static std::vector<std::string> patterns(const MatchDef& def,
+                                           Program* program);
+
+ private:
+  RegExpSet set_;
+  std::vector<uint64_t> pcs_;  //!< case code pointers, by pattern index
 };
 
 }  // namespace vm
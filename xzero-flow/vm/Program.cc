@@ -21,29 +21,7 @@ namespace xzero {
 namespace flow {
 namespace vm {
 
-/* {{{ possible binary file format
- * ----------------------------------------------
- * u32                  magic number (0xbeafbabe)
- * u32                  version
- * u64                  flags
- * u64                  register count
- * u64                  code start
- * u64                  code size
- * u64                  integer const-table start
- * u64                  integer const-table element count
- * u64                  string const-table start
- * u64                  string const-table element count
- * u64                  regex const-table start (stored as string)
- * u64                  regex const-table element count
- * u64                  debug source-lines-table start
- * u64                  debug source-lines-table element count
- *
- * u32[]                code segment
- * u64[]                integer const-table segment
- * u64[]                string const-table segment
- * {u32, u8[]}[]        strings
- * {u32, u32, u32}[]    debug source lines segment
- */  // }}}
+// The binary file format of compiled programs is implemented by ProgramImage.
 
 Program::Program(ConstantPool&& cp)
     : cp_(std::move(cp)),
@@ -0,0 +1,309 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#include <gtest/gtest.h>
+#include <xzero-flow/mock/MockRuntime.h>
+#include <xzero-flow/vm/ConstantPool.h>
+#include <xzero-flow/vm/Handler.h>
+#include <xzero-flow/vm/Instruction.h>
+#include <xzero-flow/vm/Match.h>
+#include <xzero-flow/vm/Program.h>
+#include <xzero-flow/vm/ProgramImage.h>
+#include <xzero-base/io/FileUtil.h>
+#include <xzero-base/net/Cidr.h>
+#include <xzero-base/net/IPAddress.h>
+#include <xzero-base/Buffer.h>
+#include <xzero-base/RegExp.h>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+using namespace xzero;
+using namespace xzero::flow;
+using namespace xzero::flow::vm;
+
+// positions of the section table entries, see ProgramImage
+static const size_t StringsSection = 1;
+static const size_t MatchDefsSection = 11;
+
+// Fills @p cp with a handler "main" of @p code, which may refer to one
+// string, one native function and one match definition, each of ID 0.
+static void makePool(ConstantPool* cp, const std::vector<Instruction>& code) {
+  cp->makeHandler("main");
+  cp->makeString("/");
+  cp->makeNativeFunction("emit(S)V");
+
+  MatchDef& def = cp->getMatchDef(cp->makeMatchDef());
+  def.handlerId = 0;
+  def.op = MatchClass::Same;
+  def.elsePC = 3;
+  def.cases.push_back(MatchCaseDef(0, 2));
+
+  cp->getHandler(0).second = code;
+}
+
+// A valid handler for makePool(): r1 = "/"; match r1 { on "/" emit(r1) }
+static const std::vector<Instruction> validCode = {
+    makeInstruction(SCONST, 1, 0),
+    makeInstruction(SMATCHEQ, 1, 0),
+    makeInstruction(CALL, 0, 1, 1),
+    makeInstruction(EXIT, 1),
+};
+
+static bool read(const Buffer& image, std::string* errorMessage) {
+  ConstantPool cp;
+  return ProgramImage::read(image.ref(), &cp, errorMessage);
+}
+
+static Buffer write(const std::vector<Instruction>& code) {
+  ConstantPool cp;
+  makePool(&cp, code);
+
+  Buffer image;
+  ProgramImage::write(cp, &image);
+  return image;
+}
+
+static uint64_t getWord(const Buffer& image, size_t offset) {
+  uint64_t value;
+  memcpy(&value, image.data() + offset, sizeof(value));
+  return value;
+}
+
+static void setWord(Buffer* image, size_t offset, uint64_t value) {
+  memcpy(image->data() + offset, &value, sizeof(value));
+}
+
+TEST(ProgramImage, saveAndLoad) {
+  const std::string source =
+      "handler greet {\n"
+      "  emit('hello, ' + str('world'));\n"
+      "}\n"
+      "handler main {\n"
+      "  greet;\n"
+      "  emit(num(40) + 2);\n"
+      "  emit(ip(10.0.0.1) in 10.0.0.0/8);\n"
+      "  emit(cidr(192.168.0.0/16));\n"
+      "  emit([1, 2, 3]);\n"
+      "  emit(['a', 'b']);\n"
+      "  emit([127.0.0.1, ::1]);\n"
+      "  emit([10.0.0.0/8, 172.16.0.0/12]);\n"
+      "  match str('/b') {\n"
+      "    on '/a' emit('a');\n"
+      "    on '/b' emit('b');\n"
+      "  }\n"
+      "  match str('/c/d') =^ {\n"
+      "    on '/c/' emit('c');\n"
+      "  }\n"
+      "  match str('x.php') =$ {\n"
+      "    on '.php' emit('php');\n"
+      "  }\n"
+      "  respond 200;\n"
+      "}\n";
+  const std::vector<std::string> expected = {
+      "hello, world", "42", "true", "192.168.0.0/16", "1,2,3", "a,b",
+      "127.0.0.1,::1", "10.0.0.0/8,172.16.0.0/12", "b", "c", "php",
+      "respond 200"};
+
+  MockRuntime runtime;
+  std::unique_ptr<Program> program = runtime.compile(source, 1);
+  ASSERT_TRUE(program != nullptr);
+  ASSERT_TRUE(runtime.run(program.get(), "main"));
+  ASSERT_EQ(expected, runtime.output());
+
+  std::string path;
+  int fd = FileUtil::createTempFileAt(FileUtil::tempDirectory(), &path);
+  ASSERT_LE(0, fd);
+  ::close(fd);
+
+  std::string errorMessage;
+  ASSERT_TRUE(ProgramImage::save(*program, path, &errorMessage))
+      << errorMessage;
+  std::unique_ptr<Program> loaded = ProgramImage::load(path, &errorMessage);
+  FileUtil::rm(path);
+  ASSERT_TRUE(loaded != nullptr) << errorMessage;
+  ASSERT_TRUE(loaded->link(&runtime));
+
+  const Handler* handler = program->findHandler("main");
+  const Handler* loadedHandler = loaded->findHandler("main");
+  ASSERT_TRUE(loadedHandler != nullptr);
+  EXPECT_EQ(handler->code(), loadedHandler->code());
+  EXPECT_EQ(handler->registerCount(), loadedHandler->registerCount());
+
+  runtime.clear();
+  EXPECT_TRUE(runtime.run(loaded.get(), "main"));
+  EXPECT_EQ(expected, runtime.output());
+}
+
+TEST(ProgramImage, readValid) {
+  std::string errorMessage;
+  EXPECT_TRUE(read(write(validCode), &errorMessage)) << errorMessage;
+}
+
+TEST(ProgramImage, readTruncated) {
+  Buffer image = write(validCode);
+
+  for (size_t size = 0; size < image.size(); size += 8) {
+    Buffer truncated(image.ref(0, size));
+    std::string errorMessage;
+    EXPECT_FALSE(read(truncated, &errorMessage)) << "at size " << size;
+  }
+}
+
+TEST(ProgramImage, readHugeCounts) {
+  // counts are checked against the image size before making room for them
+  Buffer image = write(validCode);
+  setWord(&image, 8 + StringsSection * 16 + 8, uint64_t(1) << 60);
+
+  std::string errorMessage;
+  EXPECT_FALSE(read(image, &errorMessage));
+  EXPECT_EQ("Unexpected end of image.", errorMessage);
+
+  image = write(validCode);
+  const size_t matchDefs = getWord(image, 8 + MatchDefsSection * 16);
+  setWord(&image, matchDefs + 24, uint64_t(1) << 60);
+
+  EXPECT_FALSE(read(image, &errorMessage));
+}
+
+TEST(ProgramImage, readInvalidMatchDef) {
+  for (int field = 0; field < 3; ++field) {
+    ConstantPool cp;
+    makePool(&cp, validCode);
+
+    MatchDef& def = cp.getMatchDef(0);
+    switch (field) {
+      case 0: def.elsePC = validCode.size(); break;
+      case 1: def.cases[0].label = 1; break;
+      case 2: def.cases[0].pc = validCode.size(); break;
+    }
+
+    Buffer image;
+    ProgramImage::write(cp, &image);
+
+    std::string errorMessage;
+    EXPECT_FALSE(read(image, &errorMessage)) << "field " << field;
+    EXPECT_EQ("Invalid match definition.", errorMessage);
+  }
+}
+
+TEST(ProgramImage, readInvalidCode) {
+  const std::vector<std::vector<Instruction>> invalidCodes = {
+      // jump targets beyond the code
+      {makeInstruction(JMP, 4)},
+      {makeInstruction(JZ, 1, 4), makeInstruction(EXIT, 0)},
+      {makeInstruction(NJEQ, 1, 2, 4), makeInstruction(EXIT, 0)},
+      {makeInstruction(SIJNE, 1, 0, 9), makeInstruction(EXIT, 0)},
+      // constant pool indices beyond the pools
+      {makeInstruction(SCONST, 1, 1), makeInstruction(EXIT, 0)},
+      {makeInstruction(SIJEQ, 1, 1, 0), makeInstruction(EXIT, 0)},
+      {makeInstruction(NCONST, 1, 0), makeInstruction(EXIT, 0)},
+      {makeInstruction(PCONST, 1, 0), makeInstruction(EXIT, 0)},
+      {makeInstruction(CCONST, 1, 0), makeInstruction(EXIT, 0)},
+      {makeInstruction(STCONST, 1, 0), makeInstruction(EXIT, 0)},
+      {makeInstruction(SREGMATCH, 1, 1, 0), makeInstruction(EXIT, 0)},
+      {makeInstruction(SMATCHBEG, 1, 1)},
+      {makeInstruction(CALL, 1, 0, 1), makeInstruction(EXIT, 0)},
+      {makeInstruction(HANDLER, 0, 0, 1), makeInstruction(EXIT, 0)},
+      // unknown opcode
+      {makeInstruction(static_cast<Opcode>(HANDLER + 1)),
+       makeInstruction(EXIT, 0)},
+  };
+
+  for (auto code : invalidCodes) {
+    // keep the PCs of the match definition within the code
+    code.resize(validCode.size(), makeInstruction(EXIT, 0));
+
+    std::string errorMessage;
+    EXPECT_FALSE(read(write(code), &errorMessage))
+        << disassemble(code.data(), code.size()).str();
+    EXPECT_EQ("Invalid instruction in handler main.", errorMessage);
+  }
+}
+
+TEST(ProgramImage, readCodeRunningPastEnd) {
+  const std::vector<std::vector<Instruction>> invalidCodes = {
+      {},
+      {makeInstruction(SCONST, 1, 0)},
+      {makeInstruction(EXIT, 0), makeInstruction(JZ, 1, 0)},
+  };
+
+  for (const auto& code : invalidCodes) {
+    std::string errorMessage;
+    EXPECT_FALSE(read(write(code), &errorMessage));
+    EXPECT_EQ("Handler code must not run past its end.", errorMessage);
+  }
+}
+
+// Replaces the first @p from within @p image by @p to of the same size.
+static void patch(Buffer* image, const std::string& from,
+                  const std::string& to) {
+  const std::string data = image->str();
+  const size_t offset = data.find(from);
+  ASSERT_NE(std::string::npos, offset) << from;
+  ASSERT_EQ(from.size(), to.size());
+  memcpy(image->data() + offset, to.data(), to.size());
+}
+
+TEST(ProgramImage, readInvalidConstants) {
+  // adds a constant to the pool, whose text in the image may get replaced
+  struct Corruption {
+    std::function<void(ConstantPool*)> make;
+    std::string from;
+    std::string to;
+    std::string errorMessage;
+  };
+
+  const std::vector<Corruption> corruptions = {
+      {[](ConstantPool* cp) { cp->makeIPAddress(IPAddress("10.0.0.1")); },
+       "10.0.0.1", "10.0.x.1", "Invalid IP address."},
+      {[](ConstantPool* cp) { cp->makeIPAddress(IPAddress("fe80::1")); },
+       "fe80::1", "fe80:?1", "Invalid IP address."},
+      {[](ConstantPool* cp) {
+         cp->makeIPaddrArray({IPAddress("10.0.0.1"), IPAddress("::1")});
+       }, "::1", ":?1", "Invalid IP address."},
+      {[](ConstantPool* cp) { cp->makeCidr(Cidr("10.0.0.0", 8)); },
+       "10.0.0.0", "10.0.0:0", "Invalid IP address."},
+      {[](ConstantPool* cp) { cp->makeCidr(Cidr("10.0.0.0", 33)); },
+       "", "", "Invalid CIDR prefix."},
+      {[](ConstantPool* cp) { cp->makeCidr(Cidr("::", 129)); },
+       "", "", "Invalid CIDR prefix."},
+      {[](ConstantPool* cp) { cp->makeCidrArray({Cidr("10.0.0.0", 40)}); },
+       "", "", "Invalid CIDR prefix."},
+      {[](ConstantPool* cp) { cp->makeRegExp(RegExp("a(b)")); },
+       "a(b)", "a(b(", "Invalid regular expression."},
+  };
+
+  for (const Corruption& corruption : corruptions) {
+    ConstantPool cp;
+    makePool(&cp, validCode);
+    corruption.make(&cp);
+
+    Buffer image;
+    ProgramImage::write(cp, &image);
+    if (!corruption.from.empty())
+      patch(&image, corruption.from, corruption.to);
+
+    std::string errorMessage;
+    EXPECT_FALSE(read(image, &errorMessage)) << corruption.errorMessage;
+    EXPECT_EQ(corruption.errorMessage, errorMessage);
+    EXPECT_FALSE(read(image, nullptr));
+  }
+}
+
+TEST(ProgramImage, withoutErrorMessage) {
+  EXPECT_TRUE(ProgramImage::load("/nonexistent/image", nullptr) == nullptr);
+
+  MockRuntime runtime;
+  std::unique_ptr<Program> program =
+      runtime.compile("handler main {\n  emit('x');\n}\n", 0);
+  ASSERT_TRUE(program != nullptr);
+  EXPECT_FALSE(ProgramImage::save(*program, "/nonexistent/image", nullptr));
+}
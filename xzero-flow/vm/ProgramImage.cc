@@ -0,0 +1,678 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#include <xzero-flow/vm/ProgramImage.h>
+#include <xzero-flow/vm/ConstantPool.h>
+#include <xzero-flow/vm/Program.h>
+#include <xzero-base/io/MemoryMap.h>
+#include <xzero-base/Buffer.h>
+#include <cstring>
+#include <cerrno>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace xzero {
+namespace flow {
+namespace vm {
+
+namespace {
+
+enum Section {
+  Numbers,
+  Strings,
+  IPAddrs,
+  Cidrs,
+  RegExps,
+  IntArrays,
+  StringArrays,
+  IPAddrArrays,
+  CidrArrays,
+  Modules,
+  Handlers,
+  MatchDefs,
+  NativeHandlers,
+  NativeFunctions,
+  SectionCount
+};
+
+const size_t HeaderSize = 8 + SectionCount * 16;
+
+class Writer {
+ public:
+  explicit Writer(Buffer* output) : output_(output), base_(output->size()) {}
+
+  size_t offset() const { return output_->size() - base_; }
+
+  void word(uint64_t value) { output_->push_back(&value, sizeof(value)); }
+
+  void string(const char* data, size_t length) {
+    word(length);
+    output_->push_back(data, length);
+    pad();
+  }
+
+  void string(const std::string& value) {
+    string(value.data(), value.size());
+  }
+
+  void pad() {
+    static const char zeros[8] = {0};
+    if (offset() % 8)
+      output_->push_back(zeros, 8 - offset() % 8);
+  }
+
+  void patch(size_t offset, uint64_t value) {
+    memcpy(output_->data() + base_ + offset, &value, sizeof(value));
+  }
+
+  /** Records where section @p s starts and how many elements it has. */
+  void section(Section s, size_t count) {
+    patch(8 + s * 16, offset());
+    patch(8 + s * 16 + 8, count);
+  }
+
+ private:
+  Buffer* output_;
+  size_t base_;
+};
+
+class Reader {
+ public:
+  Reader(const BufferRef& image, std::string* errorMessage)
+      : image_(image), offset_(0), errorMessage_(errorMessage) {}
+
+  bool fail(const std::string& message) {
+    if (errorMessage_)
+      *errorMessage_ = message;
+    return false;
+  }
+
+  /** Positions the reader at section @p s and reads its element count. */
+  bool section(Section s, size_t* count) {
+    uint64_t offset;
+    memcpy(&offset, image_.data() + 8 + s * 16, sizeof(offset));
+    memcpy(count, image_.data() + 8 + s * 16 + 8, sizeof(*count));
+
+    if (offset < HeaderSize || offset > image_.size() || offset % 8)
+      return fail("Invalid section offset.");
+
+    offset_ = offset;
+    return true;
+  }
+
+  /**
+   * Tests whether @p count elements of at least @p size bytes each can still
+   * follow, before making room for them.
+   */
+  bool fits(uint64_t count, size_t size) {
+    if (count > (image_.size() - offset_) / size)
+      return fail("Unexpected end of image.");
+
+    return true;
+  }
+
+  /** Retrieves the next @p count words in place. */
+  const uint64_t* words(size_t count) {
+    if (count > (image_.size() - offset_) / 8) {
+      fail("Unexpected end of image.");
+      return nullptr;
+    }
+
+    const uint64_t* result =
+        reinterpret_cast<const uint64_t*>(image_.data() + offset_);
+    offset_ += count * 8;
+    return result;
+  }
+
+  bool word(uint64_t* value) {
+    const uint64_t* p = words(1);
+    if (!p)
+      return false;
+
+    *value = *p;
+    return true;
+  }
+
+  bool string(BufferRef* value) {
+    uint64_t length;
+    if (!word(&length))
+      return false;
+
+    if (length > image_.size() - offset_)
+      return fail("Unexpected end of image.");
+
+    *value = image_.ref(offset_, length);
+    offset_ += (length + 7) & ~7llu;
+    return true;
+  }
+
+  bool string(std::string* value) {
+    BufferRef ref;
+    if (!string(&ref))
+      return false;
+
+    *value = ref.str();
+    return true;
+  }
+
+ private:
+  BufferRef image_;
+  size_t offset_;
+  std::string* errorMessage_;
+};
+
+void writeCidr(Writer& w, const Cidr& cidr) {
+  w.string(cidr.address().str());
+  w.word(cidr.prefix());
+}
+
+bool readIPAddress(Reader& r, IPAddress* ipaddr) {
+  std::string text;
+  if (!r.string(&text))
+    return false;
+
+  const int family = text.find(':') != std::string::npos ? IPAddress::V6
+                                                         : IPAddress::V4;
+  if (!ipaddr->set(text, family))
+    return r.fail("Invalid IP address.");
+
+  return true;
+}
+
+bool readCidr(Reader& r, Cidr* cidr) {
+  IPAddress address;
+  uint64_t prefix;
+  if (!readIPAddress(r, &address) || !r.word(&prefix))
+    return false;
+
+  if (prefix > (address.family() == IPAddress::V4 ? 32 : 128))
+    return r.fail("Invalid CIDR prefix.");
+
+  *cidr = Cidr(address, prefix);
+  return true;
+}
+
+/** Tests whether @p instr never continues with the instruction after it. */
+bool isTerminator(Instruction instr) {
+  switch (opcode(instr)) {
+    case Opcode::EXIT:
+    case Opcode::JMP:
+    case Opcode::SMATCHEQ:
+    case Opcode::SMATCHBEG:
+    case Opcode::SMATCHEND:
+    case Opcode::SMATCHR:
+      return true;
+    default:
+      return false;
+  }
+}
+
+}  // namespace
+
+/**
+ * Tests whether all operands of @p instr, an instruction of handler
+ * @p handlerId, refer to existing code and entries of @p cp.
+ */
+bool ProgramImage::isValidInstruction(const ConstantPool& cp,
+                                      size_t handlerId, Instruction instr) {
+  const size_t codeSize = cp.getHandler(handlerId).second.size();
+  const Operand A = operandA(instr);
+  const Operand B = operandB(instr);
+  const Operand C = operandC(instr);
+
+  switch (opcode(instr)) {
+    case Opcode::JMP:
+      return A < codeSize;
+    case Opcode::JN:
+    case Opcode::JZ:
+      return B < codeSize;
+    case Opcode::NJEQ:
+    case Opcode::NJNE:
+    case Opcode::NJLE:
+    case Opcode::NJGE:
+    case Opcode::NJLT:
+    case Opcode::NJGT:
+    case Opcode::NIJEQ:
+    case Opcode::NIJNE:
+    case Opcode::NIJLE:
+    case Opcode::NIJGE:
+    case Opcode::NIJLT:
+    case Opcode::NIJGT:
+    case Opcode::SJEQ:
+    case Opcode::SJNE:
+      return C < codeSize;
+    case Opcode::SIJEQ:
+    case Opcode::SIJNE:
+      return B < cp.strings_.size() && C < codeSize;
+    case Opcode::ITCONST:
+      return B < cp.intArrays_.size();
+    case Opcode::STCONST:
+      return B < cp.stringArrays_.size();
+    case Opcode::PTCONST:
+      return B < cp.ipaddrArrays_.size();
+    case Opcode::CTCONST:
+      return B < cp.cidrArrays_.size();
+    case Opcode::NCONST:
+      return B < cp.numbers_.size();
+    case Opcode::SCONST:
+      return B < cp.strings_.size();
+    case Opcode::SMATCHEQ:
+    case Opcode::SMATCHBEG:
+    case Opcode::SMATCHEND:
+    case Opcode::SMATCHR:
+      // the match definition's PCs are only checked against its own handler
+      return B < cp.matchDefs_.size() &&
+             cp.matchDefs_[B].handlerId == handlerId;
+    case Opcode::PCONST:
+      return B < cp.ipaddrs_.size();
+    case Opcode::CCONST:
+      return B < cp.cidrs_.size();
+    case Opcode::SREGMATCH:
+      return C < cp.regularExpressions_.size();
+    case Opcode::CALL:
+      return A < cp.nativeFunctionSignatures_.size();
+    case Opcode::HANDLER:
+      return A < cp.nativeHandlerSignatures_.size();
+    default:
+      return opcode(instr) <= Opcode::HANDLER;
+  }
+}
+
+void ProgramImage::write(const ConstantPool& cp, Buffer* output) {
+  Writer w(output);
+
+  uint32_t header[2] = {Magic, Version};
+  output->push_back(header, sizeof(header));
+  for (size_t i = 0; i < SectionCount * 2; ++i)
+    w.word(0);
+
+  w.section(Numbers, cp.numbers_.size());
+  for (FlowNumber number : cp.numbers_)
+    w.word(number);
+
+  w.section(Strings, cp.strings_.size());
+  for (const Buffer& string : cp.strings_)
+    w.string(string.data(), string.size());
+
+  w.section(IPAddrs, cp.ipaddrs_.size());
+  for (const IPAddress& ipaddr : cp.ipaddrs_)
+    w.string(ipaddr.str());
+
+  w.section(Cidrs, cp.cidrs_.size());
+  for (const Cidr& cidr : cp.cidrs_)
+    writeCidr(w, cidr);
+
+  w.section(RegExps, cp.regularExpressions_.size());
+  for (const RegExp& re : cp.regularExpressions_)
+    w.string(re.pattern());
+
+  w.section(IntArrays, cp.intArrays_.size());
+  for (const auto& array : cp.intArrays_) {
+    w.word(array.size());
+    for (FlowNumber number : array)
+      w.word(number);
+  }
+
+  w.section(StringArrays, cp.stringArrays_.size());
+  for (const auto& array : cp.stringArrays_) {
+    w.word(array.first.size());
+    for (const Buffer& string : array.first)
+      w.string(string.data(), string.size());
+  }
+
+  w.section(IPAddrArrays, cp.ipaddrArrays_.size());
+  for (const auto& array : cp.ipaddrArrays_) {
+    w.word(array.size());
+    for (const IPAddress& ipaddr : array)
+      w.string(ipaddr.str());
+  }
+
+  w.section(CidrArrays, cp.cidrArrays_.size());
+  for (const auto& array : cp.cidrArrays_) {
+    w.word(array.size());
+    for (const Cidr& cidr : array)
+      writeCidr(w, cidr);
+  }
+
+  w.section(Modules, cp.modules_.size());
+  for (const auto& module : cp.modules_) {
+    w.string(module.first);
+    w.string(module.second);
+  }
+
+  w.section(Handlers, cp.handlers_.size());
+  for (const auto& handler : cp.handlers_) {
+    w.string(handler.first);
+    w.word(handler.second.size());
+    for (Instruction instr : handler.second)
+      w.word(instr);
+  }
+
+  w.section(MatchDefs, cp.matchDefs_.size());
+  for (const MatchDef& def : cp.matchDefs_) {
+    w.word(def.handlerId);
+    w.word(static_cast<uint64_t>(def.op));
+    w.word(def.elsePC);
+    w.word(def.cases.size());
+    for (const MatchCaseDef& one : def.cases) {
+      w.word(one.label);
+      w.word(one.pc);
+    }
+  }
+
+  w.section(NativeHandlers, cp.nativeHandlerSignatures_.size());
+  for (const std::string& signature : cp.nativeHandlerSignatures_)
+    w.string(signature);
+
+  w.section(NativeFunctions, cp.nativeFunctionSignatures_.size());
+  for (const std::string& signature : cp.nativeFunctionSignatures_)
+    w.string(signature);
+}
+
+bool ProgramImage::read(const BufferRef& image, ConstantPool* cp,
+                        std::string* errorMessage) {
+  Reader r(image, errorMessage);
+  size_t count;
+
+  if (image.size() < HeaderSize ||
+      reinterpret_cast<uintptr_t>(image.data()) % 8)
+    return r.fail("Not a program image.");
+
+  uint32_t header[2];
+  memcpy(header, image.data(), sizeof(header));
+  if (header[0] != Magic)
+    return r.fail("Not a program image.");
+
+  if (header[1] != Version)
+    return r.fail("Unsupported program image version " +
+                  std::to_string(header[1]) + ".");
+
+  if (!r.section(Numbers, &count))
+    return false;
+  const uint64_t* numbers = r.words(count);
+  if (!numbers)
+    return false;
+  cp->numbers_.assign(numbers, numbers + count);
+
+  if (!r.section(Strings, &count))
+    return false;
+  if (!r.fits(count, 8))
+    return false;
+  cp->strings_.resize(count);
+  for (Buffer& string : cp->strings_) {
+    BufferRef ref;
+    if (!r.string(&ref))
+      return false;
+    string = ref;
+  }
+
+  if (!r.section(IPAddrs, &count))
+    return false;
+  if (!r.fits(count, 8))
+    return false;
+  cp->ipaddrs_.resize(count);
+  for (IPAddress& ipaddr : cp->ipaddrs_)
+    if (!readIPAddress(r, &ipaddr))
+      return false;
+
+  if (!r.section(Cidrs, &count))
+    return false;
+  if (!r.fits(count, 16))
+    return false;
+  cp->cidrs_.resize(count);
+  for (Cidr& cidr : cp->cidrs_)
+    if (!readCidr(r, &cidr))
+      return false;
+
+  if (!r.section(RegExps, &count))
+    return false;
+  if (!r.fits(count, 8))
+    return false;
+  for (size_t i = 0; i != count; ++i) {
+    std::string pattern;
+    if (!r.string(&pattern))
+      return false;
+
+    RegExp re(pattern);
+    if (!re.isValid())
+      return r.fail("Invalid regular expression.");
+    cp->regularExpressions_.push_back(std::move(re));
+  }
+
+  if (!r.section(IntArrays, &count))
+    return false;
+  if (!r.fits(count, 8))
+    return false;
+  cp->intArrays_.resize(count);
+  for (auto& array : cp->intArrays_) {
+    uint64_t size;
+    if (!r.word(&size))
+      return false;
+    const uint64_t* elements = r.words(size);
+    if (!elements)
+      return false;
+    array.assign(elements, elements + size);
+  }
+
+  if (!r.section(StringArrays, &count))
+    return false;
+  if (!r.fits(count, 8))
+    return false;
+  cp->stringArrays_.resize(count);
+  for (auto& array : cp->stringArrays_) {
+    uint64_t size;
+    if (!r.word(&size) || !r.fits(size, 8))
+      return false;
+    array.first.resize(size);
+    array.second.resize(size);
+    for (size_t i = 0; i != size; ++i) {
+      BufferRef ref;
+      if (!r.string(&ref))
+        return false;
+      array.first[i] = ref;
+      array.second[i] = array.first[i].ref();
+    }
+  }
+
+  if (!r.section(IPAddrArrays, &count))
+    return false;
+  if (!r.fits(count, 8))
+    return false;
+  cp->ipaddrArrays_.resize(count);
+  for (auto& array : cp->ipaddrArrays_) {
+    uint64_t size;
+    if (!r.word(&size))
+      return false;
+    if (!r.fits(size, 8))
+      return false;
+    array.resize(size);
+    for (IPAddress& ipaddr : array)
+      if (!readIPAddress(r, &ipaddr))
+        return false;
+  }
+
+  if (!r.section(CidrArrays, &count))
+    return false;
+  if (!r.fits(count, 8))
+    return false;
+  cp->cidrArrays_.resize(count);
+  for (auto& array : cp->cidrArrays_) {
+    uint64_t size;
+    if (!r.word(&size))
+      return false;
+    for (size_t i = 0; i != size; ++i) {
+      Cidr cidr;
+      if (!readCidr(r, &cidr))
+        return false;
+      array.push_back(cidr);
+    }
+  }
+
+  if (!r.section(Modules, &count))
+    return false;
+  if (!r.fits(count, 16))
+    return false;
+  cp->modules_.resize(count);
+  for (auto& module : cp->modules_)
+    if (!r.string(&module.first) || !r.string(&module.second))
+      return false;
+
+  if (!r.section(Handlers, &count))
+    return false;
+  if (!r.fits(count, 16))
+    return false;
+  cp->handlers_.resize(count);
+  for (auto& handler : cp->handlers_) {
+    uint64_t size;
+    if (!r.string(&handler.first) || !r.word(&size))
+      return false;
+    const uint64_t* code = r.words(size);
+    if (!code)
+      return false;
+    handler.second.assign(code, code + size);
+
+    if (handler.second.empty() || !isTerminator(handler.second.back()))
+      return r.fail("Handler code must not run past its end.");
+  }
+
+  if (!r.section(MatchDefs, &count))
+    return false;
+  if (!r.fits(count, 32))
+    return false;
+  cp->matchDefs_.resize(count);
+  for (MatchDef& def : cp->matchDefs_) {
+    uint64_t handlerId, op, cases;
+    if (!r.word(&handlerId) || !r.word(&op) || !r.word(&def.elsePC) ||
+        !r.word(&cases))
+      return false;
+
+    if (handlerId >= cp->handlers_.size() ||
+        op > static_cast<uint64_t>(MatchClass::RegExp))
+      return r.fail("Invalid match definition.");
+
+    const size_t codeSize = cp->handlers_[handlerId].second.size();
+    const size_t labelCount = op == static_cast<uint64_t>(MatchClass::RegExp)
+                                  ? cp->regularExpressions_.size()
+                                  : cp->strings_.size();
+
+    if (def.elsePC >= codeSize || !r.fits(cases, 16))
+      return r.fail("Invalid match definition.");
+
+    def.handlerId = handlerId;
+    def.op = static_cast<MatchClass>(op);
+    def.cases.resize(cases);
+    for (MatchCaseDef& one : def.cases) {
+      if (!r.word(&one.label) || !r.word(&one.pc))
+        return false;
+
+      if (one.label >= labelCount || one.pc >= codeSize)
+        return r.fail("Invalid match definition.");
+    }
+  }
+
+  if (!r.section(NativeHandlers, &count))
+    return false;
+  if (!r.fits(count, 8))
+    return false;
+  cp->nativeHandlerSignatures_.resize(count);
+  for (std::string& signature : cp->nativeHandlerSignatures_)
+    if (!r.string(&signature))
+      return false;
+
+  if (!r.section(NativeFunctions, &count))
+    return false;
+  if (!r.fits(count, 8))
+    return false;
+  cp->nativeFunctionSignatures_.resize(count);
+  for (std::string& signature : cp->nativeFunctionSignatures_)
+    if (!r.string(&signature))
+      return false;
+
+  // with all pools read, make sure the code cannot address beyond them
+  for (size_t id = 0, e = cp->handlers_.size(); id != e; ++id)
+    for (Instruction instr : cp->handlers_[id].second)
+      if (!isValidInstruction(*cp, id, instr))
+        return r.fail("Invalid instruction in handler " +
+                      cp->handlers_[id].first + ".");
+
+  return true;
+}
+
+bool ProgramImage::save(const Program& program, const std::string& path,
+                        std::string* errorMessage) {
+  Buffer image;
+  write(program.constants(), &image);
+
+  int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                  0644);
+  if (fd < 0) {
+    if (errorMessage)
+      *errorMessage = strerror(errno);
+    return false;
+  }
+
+  const char* p = image.data();
+  size_t remaining = image.size();
+  while (remaining > 0) {
+    ssize_t n = ::write(fd, p, remaining);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+
+      if (errorMessage)
+        *errorMessage = strerror(errno);
+      ::close(fd);
+      return false;
+    }
+    p += n;
+    remaining -= n;
+  }
+
+  ::close(fd);
+  return true;
+}
+
+std::unique_ptr<Program> ProgramImage::load(const std::string& path,
+                                            std::string* errorMessage) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    if (errorMessage)
+      *errorMessage = strerror(errno);
+    return nullptr;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    if (errorMessage)
+      *errorMessage = strerror(errno);
+    ::close(fd);
+    return nullptr;
+  }
+
+  if (static_cast<size_t>(st.st_size) < HeaderSize) {
+    if (errorMessage)
+      *errorMessage = "Not a program image.";
+    ::close(fd);
+    return nullptr;
+  }
+
+  MemoryMap mm(fd, 0, st.st_size, false);
+  ::close(fd);
+
+  ConstantPool cp;
+  BufferRef image(static_cast<const char*>(mm.data()), mm.size());
+  if (!read(image, &cp, errorMessage))
+    return nullptr;
+
+  return std::unique_ptr<Program>(new Program(std::move(cp)));
+}
+
+}  // namespace vm
+}  // namespace flow
+}  // namespace xzero
@@ -0,0 +1,110 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <xzero-flow/Api.h>
+#include <xzero-flow/vm/Instruction.h>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace xzero {
+
+class Buffer;
+class BufferRef;
+
+namespace flow {
+namespace vm {
+
+struct ConstantPool;
+class Program;
+
+/**
+ * Binary image of a compiled program, for loading it without compiling
+ * its Flow source again.
+ *
+ * The image contains everything Program is built from: handlers and
+ * their code, all constant pools, match definitions, imported modules and
+ * native callback signatures. Native callbacks are only referenced by
+ * signature, so a loaded program must still be linked by Program::link().
+ *
+ * <h3>Format</h3>
+ *
+ * All values are 64-bit words in host byte order, and every record is
+ * padded to a multiple of 8 bytes, so that code and integer tables can be
+ * read in place from a memory mapping.
+ *
+ * <pre>
+ * u32                  magic number, detecting foreign byte order
+ * u32                  format version
+ * u64[2 * N]           section table: {file offset, element count} for
+ *                      each of the N sections below
+ *
+ * i64[]                integer constants
+ * string[]             string constants
+ * string[]             IP address constants
+ * {string, u64}[]      CIDR constants (address, prefix)
+ * string[]             regular expression constants (patterns)
+ * {u64, i64[]}[]       integer arrays
+ * {u64, string[]}[]    string arrays
+ * {u64, string[]}[]    IP address arrays
+ * {u64, {string, u64}[]}[] CIDR arrays
+ * {string, string}[]   imported modules (name, path)
+ * {string, u64, u64[]}[] handlers (name, instruction count, code)
+ * {u64, u64, u64, u64, {u64, u64}[]}[]
+ *                      match definitions (handler, class, else-PC, case
+ *                      count, cases of {label, PC})
+ * string[]             native handler signatures
+ * string[]             native function signatures
+ *
+ * string:              {u64 length, u8[length], padding}
+ * </pre>
+ *
+ * The version must be increased whenever this layout or the instruction
+ * set changes.
+ */
+class XZERO_FLOW_API ProgramImage {
+ public:
+  static const uint32_t Magic = 0x57464c58;  // "XLFW" in little endian
+  static const uint32_t Version = 2;
+
+  /** Serializes the constant pool of a compiled program into @p output. */
+  static void write(const ConstantPool& cp, Buffer* output);
+
+  /**
+   * Deserializes a program image into @p cp.
+   *
+   * @retval true the image was loaded.
+   * @retval false the image is invalid, with @p errorMessage telling why.
+   */
+  static bool read(const BufferRef& image, ConstantPool* cp,
+                   std::string* errorMessage);
+
+  /** Writes a program image of @p program to the file at @p path. */
+  static bool save(const Program& program, const std::string& path,
+                   std::string* errorMessage);
+
+  /**
+   * Loads a program from an image file at @p path, which is mapped into
+   * memory for reading.
+   *
+   * @return the unlinked program, or @c nullptr on error, with
+   *         @p errorMessage telling why.
+   */
+  static std::unique_ptr<Program> load(const std::string& path,
+                                       std::string* errorMessage);
+
+ private:
+  static bool isValidInstruction(const ConstantPool& cp, size_t handlerId,
+                                 Instruction instr);
+};
+
+}  // namespace vm
+}  // namespace flow
+}  // namespace xzero
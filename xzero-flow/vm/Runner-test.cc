@@ -0,0 +1,142 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#include <gtest/gtest.h>
+#include <xzero-flow/mock/MockRuntime.h>
+#include <xzero-flow/vm/ConstantPool.h>
+#include <xzero-flow/vm/Handler.h>
+#include <xzero-flow/vm/Instruction.h>
+#include <xzero-flow/vm/Program.h>
+#include <xzero-flow/vm/Runner.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace xzero;
+using namespace xzero::flow;
+using namespace xzero::flow::vm;
+
+// Compiles an empty handler "main", to create Runners from.
+static std::unique_ptr<Program> emptyProgram(MockRuntime* runtime) {
+  std::unique_ptr<Program> program = runtime->compile("handler main {}\n", 0);
+  EXPECT_TRUE(program != nullptr);
+  return program;
+}
+
+// Returns the number of chunks @p runner released back to the pool.
+static size_t releasedChunks(Runner* runner) {
+  const size_t pooled = Runner::pooledChunkCount();
+  runner->reset();
+  return Runner::pooledChunkCount() - pooled;
+}
+
+TEST(Runner, reusesChunksAfterReset) {
+  MockRuntime runtime;
+  std::unique_ptr<Program> program = emptyProgram(&runtime);
+  std::unique_ptr<Runner> runner = Runner::create(program->findHandler("main"));
+
+  FlowString* first = runner->newString("hello");
+  for (int i = 0; i != 9; ++i)
+    runner->newString(std::string(100, 'a' + i));
+  EXPECT_EQ(1u, releasedChunks(runner.get()));
+
+  // the chunk released last is taken first
+  const size_t pooled = Runner::pooledChunkCount();
+  FlowString* again = runner->newString("world");
+  EXPECT_EQ(first, again);
+  EXPECT_EQ("world", again->str());
+  EXPECT_EQ(pooled - 1, Runner::pooledChunkCount());
+
+  for (int i = 0; i != 100; ++i)
+    runner->newString(std::string(100, 'x'));
+  EXPECT_LE(2u, releasedChunks(runner.get()));
+}
+
+TEST(Runner, largeStrings) {
+  MockRuntime runtime;
+  std::unique_ptr<Program> program = emptyProgram(&runtime);
+  std::unique_ptr<Runner> runner = Runner::create(program->findHandler("main"));
+
+  for (size_t size : {Runner::ArenaChunkSize / 2, Runner::ArenaChunkSize,
+                      Runner::ArenaChunkSize * 3 + 1}) {
+    FlowString* before = runner->newString("before");
+    FlowString* large = runner->newString(std::string(size, 'L'));
+    FlowString* after = runner->newString("after");
+
+    EXPECT_EQ(size, large->size());
+    EXPECT_EQ(std::string(size, 'L'), large->str());
+    EXPECT_EQ('\0', large->data()[size]);
+    EXPECT_EQ("before", before->str());
+    EXPECT_EQ("after", after->str());
+
+    // large strings get their own chunk, leaving the current one in use
+    const char* b = reinterpret_cast<const char*>(before);
+    const char* a = reinterpret_cast<const char*>(after);
+    EXPECT_LT(b, a);
+    EXPECT_GT(b + Runner::ArenaChunkSize, a);
+
+    // and are freed instead of being pooled
+    EXPECT_EQ(1u, releasedChunks(runner.get())) << size;
+  }
+}
+
+TEST(Runner, chunkPoolIsCapped) {
+  MockRuntime runtime;
+  std::unique_ptr<Program> program = emptyProgram(&runtime);
+  std::unique_ptr<Runner> runner = Runner::create(program->findHandler("main"));
+
+  // strings of a few hundred bytes share their chunks, filling more chunks
+  // than get pooled
+  std::vector<FlowString*> strings;
+  for (size_t i = 0; i != 5 * Runner::MaxPooledChunks; ++i)
+    strings.push_back(runner->newString(std::string(900, 'a' + i % 26)));
+
+  for (size_t i = 0; i != strings.size(); ++i)
+    ASSERT_EQ(std::string(900, 'a' + i % 26), strings[i]->str());
+
+  runner->reset();
+  EXPECT_EQ(Runner::MaxPooledChunks, Runner::pooledChunkCount());
+
+  runner->newString("x");
+  EXPECT_EQ(Runner::MaxPooledChunks - 1, Runner::pooledChunkCount());
+  runner->reset();
+  EXPECT_EQ(Runner::MaxPooledChunks, Runner::pooledChunkCount());
+}
+
+TEST(Runner, substr) {
+  // r3 = substr(r1, r2 /*offset*/, r2+1 /*count*/)
+  struct Case {
+    Operand offset;
+    Operand count;
+    std::string result;
+  };
+  const std::vector<Case> cases = {
+      {0, 5, "hello"}, {1, 3, "ell"}, {3, 100, "lo"}, {0, 0, ""},
+      {5, 1, ""},      {6, 1, ""},    {1000, 2, ""},
+  };
+
+  for (const Case& one : cases) {
+    ConstantPool cp;
+    cp.makeHandler("main");
+    cp.getHandler(0).second = {
+        makeInstruction(SCONST, 1, cp.makeString("hello")),
+        makeInstruction(IMOV, 2, one.offset),
+        makeInstruction(IMOV, 3, one.count),
+        makeInstruction(SSUBSTR, 4, 1, 2),
+        makeInstruction(EXIT, 0),
+    };
+
+    Program program(std::move(cp));
+    std::unique_ptr<Runner> runner = Runner::create(program.handler(0));
+    runner->run();
+
+    const FlowString* result =
+        reinterpret_cast<const FlowString*>(runner->data()[4]);
+    EXPECT_EQ(one.result, result->str())
+        << "substr(\"hello\", " << one.offset << ", " << one.count << ")";
+  }
+}
@@ -12,7 +12,9 @@
 #include <xzero-flow/vm/Program.h>
 #include <xzero-flow/vm/Match.h>
 #include <xzero-flow/vm/Instruction.h>
+#include <xzero-flow/sysconfig.h>
 #include <xzero-base/sysconfig.h>
+#include <algorithm>
 #include <vector>
 #include <utility>
 #include <memory>
@@ -33,6 +35,72 @@ namespace xzero {
 namespace flow {
 namespace vm {
 
+// {{{ string arena
+/**
+ * A block of string arena memory, directly followed by its data.
+ */
+struct Runner::Chunk {
+  Chunk* next;
+  size_t capacity;
+
+  char* data() { return reinterpret_cast<char*>(this + 1); }
+};
+
+namespace {
+
+/**
+ * Thread-local cache of string arena chunks.
+ *
+ * Chunks of finished Runners are handed to Runners created afterwards on
+ * the same thread, so that handlers usually run without allocating.
+ */
+class ChunkPool {
+ public:
+  static const size_t ChunkSize = Runner::ArenaChunkSize;
+  static const size_t MaxPoolSize = Runner::MaxPooledChunks;
+
+  ~ChunkPool();
+
+  void* acquire();
+  void release(void* chunk);
+  size_t size() const { return free_.size(); }
+
+ private:
+  std::vector<void*> free_;
+};
+
+ChunkPool::~ChunkPool() {
+  for (void* chunk: free_)
+    free(chunk);
+}
+
+void* ChunkPool::acquire() {
+  if (free_.empty())
+    return malloc(ChunkSize);
+
+  void* chunk = free_.back();
+  free_.pop_back();
+  return chunk;
+}
+
+void ChunkPool::release(void* chunk) {
+  if (free_.size() < MaxPoolSize) {
+    free_.push_back(chunk);
+  } else {
+    free(chunk);
+  }
+}
+
+thread_local ChunkPool chunkPool;
+
+const FlowString emptyFlowString;
+
+}  // namespace
+// }}}
+
+const size_t Runner::ArenaChunkSize;
+const size_t Runner::MaxPooledChunks;
+
 std::unique_ptr<Runner> Runner::create(Handler* handler) {
   Runner* p = (Runner*)malloc(sizeof(Runner) +
                               handler->registerCount() * sizeof(uint64_t));
@@ -40,44 +108,122 @@ std::unique_ptr<Runner> Runner::create(Handler* handler) {
   return std::unique_ptr<Runner>(p);
 }
 
-static FlowString* t = nullptr;
-
 Runner::Runner(Handler* handler)
     : handler_(handler),
       program_(handler->program()),
       userdata_(nullptr),
       state_(Inactive),
       pc_(0),
-      stringGarbage_() {
-  // initialize emptyString()
-  t = newString("");
-
+      chunks_(nullptr),
+      arenaPtr_(nullptr),
+      arenaEnd_(nullptr)
+#if defined(ENABLE_FLOW_JIT)
+      ,
+      exception_()
+#endif
+{
   // initialize registers
   memset(data_, 0, sizeof(Register) * handler_->registerCount());
 }
 
-Runner::~Runner() {}
+Runner::~Runner() {
+  releaseStrings();
+}
 
 void Runner::operator delete(void* p) { free(p); }
 
+void Runner::reset() {
+  assert(state_ == Inactive);
+
+  userdata_ = nullptr;
+  pc_ = 0;
+  memset(data_, 0, sizeof(Register) * handler_->registerCount());
+  releaseStrings();
+}
+
+void Runner::releaseStrings() {
+  const size_t pooledCapacity = ChunkPool::ChunkSize - sizeof(Chunk);
+
+  while (chunks_) {
+    Chunk* chunk = chunks_;
+    chunks_ = chunk->next;
+
+    if (chunk->capacity == pooledCapacity) {
+      chunkPool.release(chunk);
+    } else {
+      free(chunk);
+    }
+  }
+
+  arenaPtr_ = nullptr;
+  arenaEnd_ = nullptr;
+}
+
+void* Runner::allocate(size_t n) {
+  const size_t alignment = alignof(FlowString);
+  n = (n + alignment - 1) & ~(alignment - 1);
+
+  if (n > static_cast<size_t>(arenaEnd_ - arenaPtr_)) {
+    const size_t pooledCapacity = ChunkPool::ChunkSize - sizeof(Chunk);
+
+    if (n > pooledCapacity / 4) {
+      // large strings get a chunk of their own, keeping the current one
+      Chunk* chunk = static_cast<Chunk*>(malloc(sizeof(Chunk) + n));
+      chunk->capacity = n;
+      chunk->next = chunks_;
+      chunks_ = chunk;
+      return chunk->data();
+    }
+
+    Chunk* chunk = static_cast<Chunk*>(chunkPool.acquire());
+    chunk->capacity = pooledCapacity;
+    chunk->next = chunks_;
+    chunks_ = chunk;
+    arenaPtr_ = chunk->data();
+    arenaEnd_ = chunk->data() + pooledCapacity;
+  }
+
+  void* p = arenaPtr_;
+  arenaPtr_ += n;
+  return p;
+}
+
+/**
+ * Allocates a string of @p n bytes, along with its FlowString view, from
+ * the string arena.
+ *
+ * The caller fills in the string data. It is NUL-terminated already.
+ */
+FlowString* Runner::allocateString(size_t n) {
+  char* p = static_cast<char*>(allocate(sizeof(FlowString) + n + 1));
+  char* data = p + sizeof(FlowString);
+  data[n] = '\0';
+  return new (p) FlowString(data, n);
+}
+
 FlowString* Runner::newString(const std::string& value) {
-  stringGarbage_.push_back(Buffer(value.c_str(), value.size()));
-  return &stringGarbage_.back();
+  return newString(value.data(), value.size());
 }
 
 FlowString* Runner::newString(const char* p, size_t n) {
-  stringGarbage_.push_back(Buffer(p, n));
-  return &stringGarbage_.back();
+  FlowString* s = allocateString(n);
+  memcpy(s->data(), p, n);
+  return s;
 }
 
 FlowString* Runner::catString(const FlowString& a, const FlowString& b) {
-  Buffer s(a.size() + b.size() + 1);
-  s.push_back(a);
-  s.push_back(b);
+  FlowString* s = allocateString(a.size() + b.size());
+  memcpy(s->data(), a.data(), a.size());
+  memcpy(s->data() + a.size(), b.data(), b.size());
+  return s;
+}
 
-  stringGarbage_.push_back(std::move(s));
+const FlowString* Runner::emptyString() const {
+  return &emptyFlowString;
+}
 
-  return &stringGarbage_.back();
+size_t Runner::pooledChunkCount() {
+  return chunkPool.size();
 }
 
 void Runner::suspend() {
@@ -98,6 +244,25 @@ bool Runner::run() {
   assert(state_ == Inactive);
   TRACE(1, "Running handler %s.", handler_->name().c_str());
 
+#if defined(ENABLE_FLOW_JIT)
+  if (JitCode::Entry entry = handler_->jitEntry()) {
+    state_ = Running;
+    const bool result = entry(this, data_);
+
+    // native code cannot be unwound, so exceptions get passed around it,
+    // leaving the Runner running just like the interpreter does
+    if (exception_) {
+      std::exception_ptr e = exception_;
+      exception_ = nullptr;
+      std::rethrow_exception(e);
+    }
+
+    if (state_ == Running)
+      state_ = Inactive;
+    return result;
+  }
+#endif
+
   return loop();
 }
 
@@ -169,6 +334,12 @@ bool Runner::loop() {
       // control
       label(EXIT),      label(JMP),       label(JN),        label(JZ),
 
+      // compare and jump
+      label(NJEQ),      label(NJNE),      label(NJLE),      label(NJGE),
+      label(NJLT),      label(NJGT),      label(NIJEQ),     label(NIJNE),
+      label(NIJLE),     label(NIJGE),     label(NIJLT),     label(NIJGT),
+      label(SJEQ),      label(SJNE),      label(SIJEQ),     label(SIJNE),
+
       // copy
       label(MOV),
 
@@ -266,6 +437,135 @@ bool Runner::loop() {
     }
   }
   // }}}
+  // {{{ compare and jump
+  instr(NJEQ) {
+    if (toNumber(A) == toNumber(B)) {
+      jump_to(C);
+    } else {
+      next;
+    }
+  }
+
+  instr(NJNE) {
+    if (toNumber(A) != toNumber(B)) {
+      jump_to(C);
+    } else {
+      next;
+    }
+  }
+
+  instr(NJLE) {
+    if (toNumber(A) <= toNumber(B)) {
+      jump_to(C);
+    } else {
+      next;
+    }
+  }
+
+  instr(NJGE) {
+    if (toNumber(A) >= toNumber(B)) {
+      jump_to(C);
+    } else {
+      next;
+    }
+  }
+
+  instr(NJLT) {
+    if (toNumber(A) < toNumber(B)) {
+      jump_to(C);
+    } else {
+      next;
+    }
+  }
+
+  instr(NJGT) {
+    if (toNumber(A) > toNumber(B)) {
+      jump_to(C);
+    } else {
+      next;
+    }
+  }
+
+  instr(NIJEQ) {
+    if (toNumber(A) == B) {
+      jump_to(C);
+    } else {
+      next;
+    }
+  }
+
+  instr(NIJNE) {
+    if (toNumber(A) != B) {
+      jump_to(C);
+    } else {
+      next;
+    }
+  }
+
+  instr(NIJLE) {
+    if (toNumber(A) <= B) {
+      jump_to(C);
+    } else {
+      next;
+    }
+  }
+
+  instr(NIJGE) {
+    if (toNumber(A) >= B) {
+      jump_to(C);
+    } else {
+      next;
+    }
+  }
+
+  instr(NIJLT) {
+    if (toNumber(A) < B) {
+      jump_to(C);
+    } else {
+      next;
+    }
+  }
+
+  instr(NIJGT) {
+    if (toNumber(A) > B) {
+      jump_to(C);
+    } else {
+      next;
+    }
+  }
+
+  instr(SJEQ) {
+    if (toString(A) == toString(B)) {
+      jump_to(C);
+    } else {
+      next;
+    }
+  }
+
+  instr(SJNE) {
+    if (toString(A) != toString(B)) {
+      jump_to(C);
+    } else {
+      next;
+    }
+  }
+
+  instr(SIJEQ) {
+    if (toString(A) == program->constants().getString(B)) {
+      jump_to(C);
+    } else {
+      next;
+    }
+  }
+
+  instr(SIJNE) {
+    if (toString(A) != program->constants().getString(B)) {
+      jump_to(C);
+    } else {
+      next;
+    }
+  }
+  // }}}
   // {{{ copy
   instr(MOV) {
     data_[A] = data_[B];
@@ -523,11 +823,27 @@ bool Runner::loop() {
   }
 
   instr(SSUBSTR) {  // A = substr(B, C /*offset*/, C+1 /*count*/)
-    data_[A] = (Register)newString(toString(B).substr(data_[C], data_[C + 1]));
+    const FlowString& str = toString(B);
+    const size_t offset = std::min<size_t>(data_[C], str.size());
+    const size_t count = std::min<size_t>(data_[C + 1], str.size() - offset);
+    data_[A] = (Register)newString(str.data() + offset, count);
     next;
   }
 
-  instr(SADDMULTI) {  // TODO: A = concat(B /*rbase*/, C /*count*/)
+  instr(SADDMULTI) {  // A = concat(B /*rbase*/, C /*count*/)
+    size_t length = 0;
+    for (Operand i = 0; i != C; ++i)
+      length += toString(B + i).size();
+
+    FlowString* result = allocateString(length);
+    char* p = result->data();
+    for (Operand i = 0; i != C; ++i) {
+      const FlowString& s = toString(B + i);
+      memcpy(p, s.data(), s.size());
+      p += s.size();
+    }
+
+    data_[A] = (Register)result;
     next;
   }
 
@@ -668,8 +984,9 @@ bool Runner::loop() {
 
   instr(I2S) {  // A = itoa(B)
     char buf[64];
-    if (snprintf(buf, sizeof(buf), "%" PRIi64 "", (int64_t)data_[B]) > 0) {
-      data_[A] = (Register)newString(buf);
+    int n = snprintf(buf, sizeof(buf), "%" PRIi64 "", (int64_t)data_[B]);
+    if (n > 0) {
+      data_[A] = (Register)newString(buf, n);
     } else {
       data_[A] = (Register)emptyString();
     }
@@ -13,7 +13,7 @@
 #include <xzero-flow/vm/Instruction.h>
 #include <xzero-base/CustomDataMgr.h>
 #include <utility>
-#include <list>
+#include <exception>
 #include <memory>
 #include <new>
 #include <cstdint>
@@ -35,6 +35,12 @@ class XZERO_FLOW_API Runner : public CustomData {
     Suspended,  //!< Active handler is currently suspended.
   };
 
+  //! size of a pooled string arena chunk, including its header
+  static const size_t ArenaChunkSize = 4096;
+
+  //! maximum number of string arena chunks cached per thread
+  static const size_t MaxPooledChunks = 256;
+
  private:
   Handler* handler_;
   Program* program_;
@@ -43,7 +49,20 @@ class XZERO_FLOW_API Runner : public CustomData {
   State state_;     //!< current VM state
   size_t pc_;       //!< last saved program execution offset
 
-  std::list<Buffer> stringGarbage_;
+  //! @name string arena
+  //! Strings created while running a handler are bump-allocated from
+  //! chunks that are released all at once with the Runner.
+  //@{
+  struct Chunk;
+  Chunk* chunks_;    //!< chunks in use, most recently acquired first
+  char* arenaPtr_;   //!< next free byte in the current chunk
+  char* arenaEnd_;   //!< end of the current chunk
+  //@}
+
+#if defined(ENABLE_FLOW_JIT)
+  //! exception raised within native code, to be rethrown by run()
+  std::exception_ptr exception_;
+#endif
 
   Register data_[];
 
@@ -57,6 +76,13 @@ class XZERO_FLOW_API Runner : public CustomData {
   void suspend();
   bool resume();
 
+  /**
+   * Prepares this Runner for running its handler again from the start.
+   *
+   * Clears the registers and user data, and releases all strings.
+   */
+  void reset();
+
   State state() const { return state_; }
   bool isInactive() const { return state_ == Inactive; }
   bool isRunning() const { return state_ == Running; }
@@ -72,11 +98,23 @@ class XZERO_FLOW_API Runner : public CustomData {
   FlowString* newString(const std::string& value);
   FlowString* newString(const char* p, size_t n);
   FlowString* catString(const FlowString& a, const FlowString& b);
-  const FlowString* emptyString() const { return &*stringGarbage_.begin(); }
+  const FlowString* emptyString() const;
+
+  /**
+   * Retrieves the number of string arena chunks cached on the calling
+   * thread for Runners to reuse.
+   */
+  static size_t pooledChunkCount();
 
  private:
+  friend class JitCode;
+
   explicit Runner(Handler* handler);
 
+  void* allocate(size_t n);
+  void releaseStrings();
+  FlowString* allocateString(size_t n);
+
   inline bool loop();
 
   Runner(Runner&) = delete;
@@ -16,7 +16,13 @@
 #include <xzero-http/BadMessage.h>
 
 #include <xzero-base/executor/DirectExecutor.h>
+#include <xzero-base/io/FileUtil.h>
+#include <xzero-base/io/FileRef.h>
+#include <xzero-base/io/GzipFilter.h>
 #include <xzero-base/Buffer.h>
+#include <algorithm>
+#include <unistd.h>
+#include <zlib.h>
 
 #include <gtest/gtest.h>
 
@@ -154,3 +160,68 @@ TEST(HttpChannel, trailer1) {
   ASSERT_EQ("one", transport.responseInfo().trailers().get("Word-Count"));
   ASSERT_EQ("Happy", transport.responseInfo().trailers().get("Mood"));
 }
+
+/**
+ * Passes data through as is, keeping track of the largest chunk seen.
+ */
+class ChunkSizeFilter : public Filter {
+ public:
+  ChunkSizeFilter() : maxChunkSize(0), total(0) {}
+
+  void filter(const BufferRef& input, Buffer* output, bool last) override {
+    maxChunkSize = std::max(maxChunkSize, input.size());
+    total += input.size();
+    output->push_back(input);
+  }
+
+  size_t maxChunkSize;
+  size_t total;
+};
+
+TEST(HttpChannel, filteredFileStreamed) {
+  // a file body way larger than the filter window
+  Buffer content;
+  for (int i = 0; content.size() < 1024 * 1024; ++i) {
+    content.push_back(i);
+    content.push_back("\n");
+  }
+
+  std::string path;
+  int fd = FileUtil::createTempFileAt(FileUtil::tempDirectory(), &path);
+  FileUtil::rm(path);
+  ASSERT_EQ(content.size(), ::pwrite(fd, content.data(), content.size(), 0));
+
+  auto chunks = std::make_shared<ChunkSizeFilter>();
+  DirectExecutor executor;
+  MockTransport transport(&executor, [&](HttpRequest* request,
+                                         HttpResponse* response) {
+    response->setStatus(xzero::HttpStatus::Ok);
+    response->output()->addFilter(chunks);
+    response->output()->addFilter(std::make_shared<GzipFilter>(6));
+    response->output()->write(FileRef(fd, 0, content.size(), true),
+        std::bind(&HttpResponse::completed, response));
+  });
+
+  transport.run(HttpVersion::VERSION_1_1, "GET", "/", {{"Host", "test"}}, "");
+
+  ASSERT_EQ(content.size(), chunks->total);
+  ASSERT_GE(64 * 1024, chunks->maxChunkSize);
+
+  // the concatenated output is one valid gzip stream
+  Buffer inflated(content.size());
+  z_stream z;
+  z.zalloc = Z_NULL;
+  z.zfree = Z_NULL;
+  z.opaque = Z_NULL;
+  z.next_in = (Bytef*) transport.responseBody().data();
+  z.avail_in = transport.responseBody().size();
+  ASSERT_EQ(Z_OK, inflateInit2(&z, 15 + 16));
+  z.next_out = (Bytef*) inflated.data();
+  z.avail_out = inflated.capacity();
+  ASSERT_EQ(Z_STREAM_END, inflate(&z, Z_FINISH));
+  inflated.resize(inflated.capacity() - z.avail_out);
+  inflateEnd(&z);
+
+  ASSERT_EQ(content, inflated);
+}
+
@@ -21,6 +21,9 @@
 #include <xzero-base/io/Filter.h>
 #include <xzero-base/RuntimeError.h>
 #include <xzero-base/sysconfig.h>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
 
 namespace xzero {
 
@@ -32,6 +35,11 @@ namespace xzero {
 #define TRACE(msg...) do {} while (0)
 #endif
 
+/**
+ * Number of bytes of a file body to read and filter at a time.
+ */
+static const size_t FilterWindowSize = 64 * 1024;
+
 std::string to_string(HttpChannelState state) {
   switch (state) {
     case HttpChannelState::READING: return "READING";
@@ -155,15 +163,53 @@ void HttpChannel::send(FileRef&& file, CompletionHandler onComplete) {
       transport_->send(std::move(file), onComplete);
     }
   } else {
-    Buffer filtered;
-    Filter::applyFilters(outputFilters_, file, &filtered, false);
+    sendFiltered(std::make_shared<FileRef>(std::move(file)), 0, onComplete);
+  }
+}
 
-    if (!response_->isCommitted()) {
-      HttpResponseInfo info(commitInline());
-      transport_->send(std::move(info), std::move(filtered), onComplete);
-    } else {
-      transport_->send(std::move(filtered), onComplete);
-    }
+void HttpChannel::sendFiltered(std::shared_ptr<FileRef> file, size_t offset,
+                               CompletionHandler onComplete) {
+  const size_t n = std::min(FilterWindowSize, file->size() - offset);
+  const bool more = offset + n < file->size();
+
+  TRACE("sendFiltered: %zu bytes at %zu of %zu", n, offset, file->size());
+
+  Buffer input;
+  if (n > 0) {
+    FileRef window(file->handle(), file->offset() + offset, n, false);
+    window.fill(&input);
+
+    if (input.size() != n)
+      throw std::runtime_error("Could not read full input file.");
+  }
+
+  Buffer filtered;
+  Filter::applyFilters(outputFilters_, input.ref(), &filtered, false);
+
+  // the next window is read in once this one has been sent
+  CompletionHandler next = onComplete;
+  if (more) {
+    next = [this, file, offset, n, onComplete](bool succeed) {
+      if (!succeed) {
+        if (onComplete)
+          onComplete(false);
+        return;
+      }
+
+      try {
+        sendFiltered(file, offset + n, onComplete);
+      } catch (const std::exception& e) {
+        logError("HttpChannel", e);
+        transport_->abort();
+      }
+    };
+  }
+
+  if (!response_->isCommitted()) {
+    HttpResponseInfo info(commitInline());
+    transport_->send(std::move(info), std::move(filtered), next);
+  } else {
+    transport_->send(std::move(filtered), next);
   }
 }
 
@@ -233,6 +279,78 @@ void HttpChannel::send100Continue(CompletionHandler onComplete) {
   transport_->send(std::move(info), BufferRef(), onComplete);
 }
 
+/**
+ * Guesses the preload destination (@c as attribute) of a resource by its
+ * file extension.
+ */
+static const char* preloadDestination(const std::string& path) {
+  size_t dot = path.rfind('.');
+  if (dot == std::string::npos || path.find('/', dot) != std::string::npos)
+    return nullptr;
+
+  static const std::unordered_map<std::string, const char*> destinations = {
+    {"css", "style"},
+    {"js", "script"},
+    {"woff", "font"},
+    {"woff2", "font"},
+    {"ttf", "font"},
+    {"otf", "font"},
+    {"png", "image"},
+    {"jpg", "image"},
+    {"jpeg", "image"},
+    {"gif", "image"},
+    {"svg", "image"},
+    {"webp", "image"},
+    {"ico", "image"},
+  };
+
+  auto i = destinations.find(path.substr(dot + 1));
+  return i != destinations.end() ? i->second : nullptr;
+}
+
+void HttpChannel::pushResources(const std::vector<std::string>& paths) {
+  if (response_->isCommitted())
+    // "Illegal State. Resources must be pushed before the response."
+    RAISE(IllegalStateError);
+
+  for (const std::string& path: paths)
+    if (path.empty() || path[0] != '/')
+      RAISE(InvalidArgumentError);
+
+  std::string links;
+  for (const std::string& path: paths) {
+    if (transport_->push(path)) {
+      TRACE("pushResources: pushed %s", path.c_str());
+      continue;
+    }
+
+    if (!links.empty())
+      links += ", ";
+
+    links += "<";
+    links += path;
+    links += ">; rel=preload";
+
+    if (const char* as = preloadDestination(path)) {
+      links += "; as=";
+      links += as;
+    }
+  }
+
+  // informational responses are not understood by HTTP/1.0 clients
+  if (links.empty() || request_->version() != HttpVersion::VERSION_1_1)
+    return;
+
+  HeaderFieldList headers;
+  headers.push_back("Link", links);
+
+  HttpResponseInfo info(request_->version(), HttpStatus::EarlyHints,
+                        "Early Hints", false, 0, headers, {});
+
+  TRACE("pushResources: sending early hints: %s", links.c_str());
+  transport_->send(std::move(info), BufferRef(), nullptr);
+}
+
 bool HttpChannel::onMessageBegin(const BufferRef& method,
                                  const BufferRef& entity,
                                  HttpVersion version) {
@@ -14,6 +14,8 @@
 #include <xzero-base/io/Filter.h>
 #include <list>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace xzero {
 
@@ -100,6 +102,19 @@ class XZERO_HTTP_API HttpChannel : public HttpListener {
    */
   void send100Continue(CompletionHandler onComplete);
 
+  /**
+   * Announces resources the client is going to need along with the current
+   * response.
+   *
+   * Each resource is pushed to the client if the transport supports it
+   * (HTTP/2 server push). Resources not pushed are announced to HTTP/1.1
+   * clients by a single 103 (Early Hints) intermediate response carrying
+   * a preload @c Link header for each of them.
+   *
+   * @param paths absolute request paths of the resources to push.
+   */
+  void pushResources(const std::vector<std::string>& paths);
+
   /**
    * Retrieves the request object for the current request.
    */
@@ -156,6 +171,16 @@ class XZERO_HTTP_API HttpChannel : public HttpListener {
   void onBeforeSend();
   HttpResponseInfo commitInline();
 
+  /**
+   * Sends @p file through the output filters, starting at @p offset.
+   *
+   * The file is read and filtered one bounded window at a time, the next
+   * window not before the previous one has been sent, so that memory usage
+   * does not depend on the file size.
+   */
+  void sendFiltered(std::shared_ptr<FileRef> file, size_t offset,
+                    CompletionHandler onComplete);
+
  protected:
   size_t maxRequestUriLength_;
   size_t maxRequestBodyLength_;
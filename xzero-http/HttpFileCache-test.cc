@@ -0,0 +1,118 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#include <xzero-http/HttpFileCache.h>
+#include <xzero-base/io/LocalFileRepository.h>
+#include <xzero-base/io/FileUtil.h>
+#include <xzero-base/io/File.h>
+#include <xzero-base/MimeTypes.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+using namespace xzero;
+
+class HttpFileCacheTest : public ::testing::Test {
+ public:
+  HttpFileCacheTest()
+      : path_(FileUtil::createTempDirectory()),
+        mimetypes_("", "application/octet-stream"),
+        repo_(mimetypes_, "/", true, true, true) {
+  }
+
+  ~HttpFileCacheTest() {
+    FileUtil::ls(path_, [](const std::string& filename) -> bool {
+      FileUtil::rm(filename);
+      return true;
+    });
+    ::rmdir(path_.c_str());
+  }
+
+  void write(const std::string& name, size_t size) {
+    FileUtil::write(path_ + name, Buffer(std::string(size, name[1])));
+  }
+
+  std::shared_ptr<const HttpFileCache::Entry> get(HttpFileCache* cache,
+                                                  const std::string& name) {
+    auto file = repo_.getFile(name, path_);
+    return cache->get(*file, "text/plain");
+  }
+
+ protected:
+  std::string path_;
+  MimeTypes mimetypes_;
+  LocalFileRepository repo_;
+};
+
+TEST_F(HttpFileCacheTest, hit) {
+  HttpFileCache cache(1000, 100);
+  write("/a.txt", 10);
+
+  auto a = get(&cache, "/a.txt");
+  ASSERT_TRUE(a != nullptr);
+  ASSERT_EQ("aaaaaaaaaa", a->content.str());
+  ASSERT_EQ("text/plain", a->headers.get("Content-Type"));
+  ASSERT_FALSE(a->headers.get("ETag").empty());
+
+  ASSERT_EQ(a.get(), get(&cache, "/a.txt").get());
+  ASSERT_EQ(1, cache.stats().hits);
+  ASSERT_EQ(1, cache.stats().misses);
+  ASSERT_EQ(1, cache.stats().admissions);
+  ASSERT_EQ(10, cache.size());
+}
+
+TEST_F(HttpFileCacheTest, tooLarge) {
+  HttpFileCache cache(1000, 100);
+  write("/a.txt", 101);
+
+  ASSERT_TRUE(get(&cache, "/a.txt") == nullptr);
+  ASSERT_TRUE(get(&cache, "/missing.txt") == nullptr);
+  ASSERT_EQ(0, cache.count());
+}
+
+TEST_F(HttpFileCacheTest, outdated) {
+  HttpFileCache cache(1000, 100);
+  write("/a.txt", 10);
+  auto a = get(&cache, "/a.txt");
+
+  write("/a.txt", 20);
+  auto b = get(&cache, "/a.txt");
+  ASSERT_NE(a.get(), b.get());
+  ASSERT_EQ(20, b->content.size());
+  ASSERT_EQ(1, cache.stats().evictions);
+
+  // the replaced entry stays valid for whom still holds it
+  ASSERT_EQ(10, a->content.size());
+}
+
+TEST_F(HttpFileCacheTest, admission) {
+  HttpFileCache cache(100, 50);
+  write("/a.txt", 50);
+  write("/b.txt", 50);
+  write("/c.txt", 50);
+
+  // a and b are popular and fill the cache
+  for (int i = 0; i < 5; ++i) {
+    get(&cache, "/a.txt");
+    get(&cache, "/b.txt");
+  }
+  ASSERT_EQ(2, cache.count());
+
+  // a one-hit wonder does not get in
+  ASSERT_TRUE(get(&cache, "/c.txt") == nullptr);
+  ASSERT_EQ(1, cache.stats().rejections);
+  ASSERT_EQ(2, cache.count());
+
+  // until it becomes more popular than the least recently used one
+  std::shared_ptr<const HttpFileCache::Entry> c;
+  for (int i = 0; i < 10 && !c; ++i)
+    c = get(&cache, "/c.txt");
+
+  ASSERT_TRUE(c != nullptr);
+  ASSERT_EQ(2, cache.count());
+  ASSERT_EQ(1, cache.stats().evictions);
+  ASSERT_EQ(100, cache.size());
+}
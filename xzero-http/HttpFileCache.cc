@@ -0,0 +1,255 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#include <xzero-http/HttpFileCache.h>
+#include <xzero-base/io/File.h>
+#include <xzero-base/io/FileRef.h>
+#include <xzero-base/io/FileDescriptor.h>
+#include <xzero-base/hash/FNV.h>
+#include <xzero-base/logging.h>
+#include <algorithm>
+#include <vector>
+
+namespace xzero {
+
+#ifndef NDEBUG
+#define TRACE(msg...) logTrace("http.HttpFileCache", msg)
+#else
+#define TRACE(msg...) do {} while (0)
+#endif
+
+// {{{ HttpFileCache::Sketch
+/**
+ * Count-min sketch of 4-bit access counters.
+ *
+ * Once as many accesses have been counted as ten times its width, all
+ * counters are halved, so that the estimates reflect recent popularity.
+ */
+class HttpFileCache::Sketch {
+ public:
+  explicit Sketch(size_t width);
+
+  void increment(uint64_t hash);
+  unsigned estimate(uint64_t hash) const;
+
+ private:
+  size_t index(uint64_t hash, unsigned row) const;
+
+ private:
+  static const unsigned Depth = 4;
+  static const unsigned MaxCount = 15;
+
+  size_t width_;
+  size_t sampleSize_;
+  size_t additions_;
+  std::vector<uint8_t> counters_;
+};
+
+HttpFileCache::Sketch::Sketch(size_t width)
+    : width_(width),
+      sampleSize_(10 * width),
+      additions_(0),
+      counters_(Depth * width) {
+}
+
+size_t HttpFileCache::Sketch::index(uint64_t hash, unsigned row) const {
+  // double hashing derives the row hashes from the two halves of one
+  const uint32_t h1 = static_cast<uint32_t>(hash);
+  const uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1;
+  return row * width_ + ((h1 + row * h2) & (width_ - 1));
+}
+
+void HttpFileCache::Sketch::increment(uint64_t hash) {
+  // conservative update: only raise the counters holding the minimum
+  const unsigned min = estimate(hash);
+  if (min < MaxCount)
+    for (unsigned row = 0; row < Depth; ++row)
+      if (counters_[index(hash, row)] == min)
+        counters_[index(hash, row)]++;
+
+  if (++additions_ == sampleSize_) {
+    for (uint8_t& counter: counters_)
+      counter >>= 1;
+    additions_ /= 2;
+  }
+}
+
+unsigned HttpFileCache::Sketch::estimate(uint64_t hash) const {
+  unsigned min = MaxCount;
+  for (unsigned row = 0; row < Depth; ++row)
+    min = std::min(min, static_cast<unsigned>(counters_[index(hash, row)]));
+  return min;
+}
+// }}}
+
+/**
+ * Chooses the sketch width by the number of files (assumed to be 1 KB
+ * on average) the cache can hold.
+ */
+static size_t sketchWidth(size_t maxSize) {
+  size_t width = 256;
+  while (width < maxSize / 256 && width < (1 << 20))
+    width <<= 1;
+  return width;
+}
+
+HttpFileCache::HttpFileCache(size_t maxSize, size_t maxFileSize)
+    : maxSize_(maxSize),
+      maxFileSize_(std::min(maxFileSize, maxSize)),
+      lock_(),
+      sketch_(new Sketch(sketchWidth(maxSize))),
+      slots_(),
+      lru_(),
+      size_(0),
+      stats_() {
+}
+
+HttpFileCache::~HttpFileCache() {
+}
+
+size_t HttpFileCache::size() const {
+  std::lock_guard<std::mutex> _l(lock_);
+  return size_;
+}
+
+size_t HttpFileCache::count() const {
+  std::lock_guard<std::mutex> _l(lock_);
+  return slots_.size();
+}
+
+HttpFileCache::Stats HttpFileCache::stats() const {
+  std::lock_guard<std::mutex> _l(lock_);
+  return stats_;
+}
+
+std::shared_ptr<const HttpFileCache::Entry> HttpFileCache::get(
+    File& file, const std::string& mimetype) {
+  const uint64_t hash = hash::FNV<uint64_t>().hash(file.path());
+
+  {
+    std::lock_guard<std::mutex> _l(lock_);
+    sketch_->increment(hash);
+
+    auto i = slots_.find(file.path());
+    if (i != slots_.end()) {
+      if (isCurrent(*i->second.entry, file)) {
+        stats_.hits++;
+        lru_.splice(lru_.begin(), lru_, i->second.lru);
+        return i->second.entry;
+      }
+      evict(i);
+    }
+
+    stats_.misses++;
+
+    if (!file.isRegular() || file.size() > maxFileSize_)
+      return nullptr;
+
+    if (!admit(hash, file.size())) {
+      stats_.rejections++;
+      return nullptr;
+    }
+  }
+
+  // read in without holding the lock
+  std::shared_ptr<const Entry> entry = load(file, mimetype);
+  if (!entry)
+    return nullptr;
+
+  std::lock_guard<std::mutex> _l(lock_);
+
+  // another thread may have loaded it in the meantime
+  auto i = slots_.find(file.path());
+  if (i != slots_.end())
+    evict(i);
+
+  insert(hash, entry);
+  stats_.admissions++;
+  TRACE("admitted %s (%zu bytes)", entry->path.c_str(), entry->size);
+
+  return entry;
+}
+
+void HttpFileCache::clear() {
+  std::lock_guard<std::mutex> _l(lock_);
+  slots_.clear();
+  lru_.clear();
+  size_ = 0;
+}
+
+bool HttpFileCache::isCurrent(const Entry& entry, const File& file) {
+  return entry.mtime == file.mtime()
+      && entry.size == file.size()
+      && entry.inode == file.inode();
+}
+
+bool HttpFileCache::admit(uint64_t hash, size_t size) const {
+  if (size_ + size <= maxSize_)
+    return true;
+
+  // the candidate must be more popular than any file it would replace
+  const unsigned frequency = sketch_->estimate(hash);
+  size_t available = maxSize_ - size_;
+  for (auto i = lru_.rbegin(); i != lru_.rend() && available < size; ++i) {
+    const Slot& victim = slots_.find(*i)->second;
+    if (sketch_->estimate(victim.hash) >= frequency)
+      return false;
+
+    available += victim.entry->size;
+  }
+
+  return true;
+}
+
+void HttpFileCache::insert(uint64_t hash, std::shared_ptr<const Entry> entry) {
+  while (size_ + entry->size > maxSize_ && !lru_.empty())
+    evict(slots_.find(lru_.back()));
+
+  const std::string path = entry->path;
+  lru_.push_front(path);
+  size_ += entry->size;
+  slots_[path] = Slot{std::move(entry), hash, lru_.begin()};
+}
+
+void HttpFileCache::evict(SlotMap::iterator i) {
+  TRACE("evicting %s", i->first.c_str());
+  size_ -= i->second.entry->size;
+  lru_.erase(i->second.lru);
+  slots_.erase(i);
+  stats_.evictions++;
+}
+
+std::shared_ptr<const HttpFileCache::Entry> HttpFileCache::load(
+    File& file, const std::string& mimetype) {
+  std::shared_ptr<FileDescriptor> fd = file.sharedHandle();
+  if (!fd)
+    return nullptr;
+
+  std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+  entry->path = file.path();
+  entry->mtime = file.mtime();
+  entry->size = file.size();
+  entry->inode = file.inode();
+
+  try {
+    FileRef(fd, 0, entry->size).fill(&entry->content);
+  } catch (const std::exception& e) {
+    // the file changed while reading it in
+    TRACE("loading %s failed: %s", entry->path.c_str(), e.what());
+    return nullptr;
+  }
+
+  entry->headers.push_back("Allow", "GET, HEAD");
+  entry->headers.push_back("Last-Modified", file.lastModified());
+  entry->headers.push_back("ETag", file.etag());
+  entry->headers.push_back("Accept-Ranges", "bytes");
+  entry->headers.push_back("Content-Type", mimetype);
+
+  return entry;
+}
+
+} // namespace xzero
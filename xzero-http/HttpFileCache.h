@@ -0,0 +1,129 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <xzero-http/Api.h>
+#include <xzero-http/HeaderFieldList.h>
+#include <xzero-base/Buffer.h>
+#include <xzero-base/sysconfig.h>
+#include <unordered_map>
+#include <memory>
+#include <string>
+#include <list>
+#include <mutex>
+#include <stdint.h>
+#include <ctime>
+
+namespace xzero {
+
+class File;
+
+/**
+ * Size-bounded in-memory cache of small static files.
+ *
+ * Small files that are requested very often are cheaper to send from memory
+ * than by opening and @c sendfile()ing them each time. Cached files are kept
+ * as immutable buffers, along with the response headers describing them,
+ * and are written to the client by reference.
+ *
+ * Admission follows TinyLFU: the access frequency of every requested file
+ * is estimated by a count-min sketch that ages by halving all counters
+ * periodically. A file only enters a full cache if it has been requested
+ * more often than each of the least recently used files it would replace,
+ * so that one-hit wonders do not flush out the hot set.
+ *
+ * The cache may be shared by multiple handlers across threads.
+ */
+class XZERO_HTTP_API HttpFileCache {
+ public:
+  /**
+   * A cached file.
+   */
+  struct Entry {
+    std::string path;
+    time_t mtime;
+    size_t size;
+    size_t inode;
+    Buffer content;
+
+    /** Precomputed response headers describing the content. */
+    HeaderFieldList headers;
+  };
+
+  struct Stats {
+    size_t hits;        //!< lookups served from the cache
+    size_t misses;      //!< lookups not served from the cache
+    size_t admissions;  //!< files loaded into the cache
+    size_t rejections;  //!< files not admitted for being too rarely used
+    size_t evictions;   //!< files dropped for others or being outdated
+  };
+
+  /**
+   * @param maxSize maximum total number of content bytes to keep.
+   * @param maxFileSize maximum size of a single file to keep.
+   */
+  HttpFileCache(size_t maxSize, size_t maxFileSize);
+  ~HttpFileCache();
+
+  size_t maxSize() const XZERO_NOEXCEPT { return maxSize_; }
+  size_t maxFileSize() const XZERO_NOEXCEPT { return maxFileSize_; }
+
+  /** Total number of content bytes currently cached. */
+  size_t size() const;
+
+  /** Number of files currently cached. */
+  size_t count() const;
+
+  Stats stats() const;
+
+  /**
+   * Retrieves the cached contents of @p file, loading it into the cache if
+   * admitted.
+   *
+   * A cached entry is only used if it still matches the file's status.
+   *
+   * @param file the file to serve, as just retrieved from its repository.
+   * @param mimetype the value of the Content-Type response header.
+   *
+   * @return the entry, or @c nullptr if the file is not cached.
+   */
+  std::shared_ptr<const Entry> get(File& file, const std::string& mimetype);
+
+  /** Drops all cached files. */
+  void clear();
+
+ private:
+  class Sketch;
+
+  struct Slot {
+    std::shared_ptr<const Entry> entry;
+    uint64_t hash;
+    std::list<std::string>::iterator lru;
+  };
+
+  typedef std::unordered_map<std::string, Slot> SlotMap;
+
+  static bool isCurrent(const Entry& entry, const File& file);
+  bool admit(uint64_t hash, size_t size) const;
+  void insert(uint64_t hash, std::shared_ptr<const Entry> entry);
+  void evict(SlotMap::iterator i);
+  static std::shared_ptr<const Entry> load(File& file,
+                                           const std::string& mimetype);
+
+ private:
+  size_t maxSize_;
+  size_t maxFileSize_;
+  mutable std::mutex lock_;
+  std::unique_ptr<Sketch> sketch_;
+  SlotMap slots_;
+  std::list<std::string> lru_;  // most recently used first
+  size_t size_;
+  Stats stats_;
+};
+
+} // namespace xzero
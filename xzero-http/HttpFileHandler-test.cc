@@ -15,12 +15,14 @@
 #include <xzero-http/HttpOutput.h>
 #include <xzero-http/BadMessage.h>
 #include <xzero-http/HttpFileHandler.h>
+#include <xzero-http/HttpFileCache.h>
 #include <xzero-base/io/LocalFileRepository.h>
 #include <xzero-base/executor/DirectExecutor.h>
 #include <xzero-base/io/FileUtil.h>
 #include <xzero-base/MimeTypes.h>
 #include <xzero-base/Buffer.h>
 #include <gtest/gtest.h>
+#include <utime.h>
 
 using namespace xzero;
 
@@ -50,3 +52,191 @@ TEST(HttpFileHandler, GET_FileNotFound) {
   ASSERT_EQ(404, static_cast<int>(transport.responseInfo().status()));
 }
 
+/**
+ * A document root with a file and precompressed siblings of it.
+ */
+class PrecompressedDocroot { // {{{
+ public:
+  PrecompressedDocroot()
+      : path_(FileUtil::createTempDirectory()),
+        mimetypes_("", "application/octet-stream"),
+        repo_(mimetypes_, "/", true, true, true),
+        handler_(repo_, &generateBoundaryID) {
+    write("/mime.types", "application/javascript js\n"
+                         "application/gzip gz\n");
+    mimetypes_.loadFromLocal(path_ + "/mime.types");
+    handler_.setPrecompressed(true);
+    write("/app.js", "identity");
+    write("/app.js.gz", "gzip");
+    write("/app.js.br", "brotli");
+  }
+
+  ~PrecompressedDocroot() {
+    FileUtil::ls(path_, [](const std::string& filename) -> bool {
+      FileUtil::rm(filename);
+      return true;
+    });
+    ::rmdir(path_.c_str());
+  }
+
+  void write(const std::string& name, const std::string& content) {
+    FileUtil::write(path_ + name, Buffer(content));
+  }
+
+  void touch(const std::string& name, time_t mtime) {
+    struct utimbuf times = { mtime, mtime };
+    utime((path_ + name).c_str(), &times);
+  }
+
+  void setCache(HttpFileCache* cache) { handler_.setCache(cache); }
+
+  void handle(HttpRequest* request, HttpResponse* response) {
+    if (!handler_.handle(request, response, path_)) {
+      response->setStatus(HttpStatus::NotFound);
+      response->completed();
+    }
+  }
+
+ private:
+  std::string path_;
+  MimeTypes mimetypes_;
+  LocalFileRepository repo_;
+  HttpFileHandler handler_;
+};
+// }}}
+
+TEST(HttpFileHandler, GET_precompressedPreference) {
+  PrecompressedDocroot docroot;
+  DirectExecutor executor;
+  MockTransport transport(&executor,
+      std::bind(&PrecompressedDocroot::handle, &docroot,
+                std::placeholders::_1, std::placeholders::_2));
+
+  transport.run(HttpVersion::VERSION_1_1, "GET", "/app.js",
+      {{"Host", "test"}, {"Accept-Encoding", "gzip, br"}}, "");
+
+  const HeaderFieldList& headers = transport.responseInfo().headers();
+  ASSERT_EQ(200, static_cast<int>(transport.responseInfo().status()));
+  ASSERT_EQ("brotli", transport.responseBody().str());
+  ASSERT_EQ("br", headers.get("Content-Encoding"));
+  ASSERT_EQ("Accept-Encoding", headers.get("Vary"));
+  ASSERT_EQ("application/javascript", headers.get("Content-Type"));
+}
+
+TEST(HttpFileHandler, GET_precompressedQualityZero) {
+  PrecompressedDocroot docroot;
+  DirectExecutor executor;
+  MockTransport transport(&executor,
+      std::bind(&PrecompressedDocroot::handle, &docroot,
+                std::placeholders::_1, std::placeholders::_2));
+
+  transport.run(HttpVersion::VERSION_1_1, "GET", "/app.js",
+      {{"Host", "test"}, {"Accept-Encoding", "br;q=0, gzip;q=0.5"}}, "");
+
+  ASSERT_EQ("gzip", transport.responseBody().str());
+  ASSERT_EQ("gzip",
+            transport.responseInfo().headers().get("Content-Encoding"));
+}
+
+TEST(HttpFileHandler, GET_precompressedQualityOrder) {
+  PrecompressedDocroot docroot;
+  DirectExecutor executor;
+  MockTransport transport(&executor,
+      std::bind(&PrecompressedDocroot::handle, &docroot,
+                std::placeholders::_1, std::placeholders::_2));
+
+  // the client's weights go before the server's preference
+  transport.run(HttpVersion::VERSION_1_1, "GET", "/app.js",
+      {{"Host", "test"}, {"Accept-Encoding", "br;q=0.8, gzip"}}, "");
+
+  ASSERT_EQ("gzip", transport.responseBody().str());
+  ASSERT_EQ("gzip",
+            transport.responseInfo().headers().get("Content-Encoding"));
+}
+
+TEST(HttpFileHandler, GET_precompressedIdentity) {
+  PrecompressedDocroot docroot;
+  DirectExecutor executor;
+  MockTransport transport(&executor,
+      std::bind(&PrecompressedDocroot::handle, &docroot,
+                std::placeholders::_1, std::placeholders::_2));
+
+  transport.run(HttpVersion::VERSION_1_1, "GET", "/app.js",
+      {{"Host", "test"}}, "");
+
+  const HeaderFieldList& headers = transport.responseInfo().headers();
+  ASSERT_EQ("identity", transport.responseBody().str());
+  ASSERT_FALSE(headers.contains("Content-Encoding"));
+  ASSERT_EQ("Accept-Encoding", headers.get("Vary"));
+}
+
+TEST(HttpFileHandler, GET_precompressedStale) {
+  PrecompressedDocroot docroot;
+  docroot.touch("/app.js.br", 1000);
+  docroot.touch("/app.js.gz", 1000);
+
+  DirectExecutor executor;
+  MockTransport transport(&executor,
+      std::bind(&PrecompressedDocroot::handle, &docroot,
+                std::placeholders::_1, std::placeholders::_2));
+
+  transport.run(HttpVersion::VERSION_1_1, "GET", "/app.js",
+      {{"Host", "test"}, {"Accept-Encoding", "gzip, br"}}, "");
+
+  ASSERT_EQ("identity", transport.responseBody().str());
+  ASSERT_FALSE(transport.responseInfo().headers().contains("Content-Encoding"));
+}
+
+TEST(HttpFileHandler, GET_precompressedETag) {
+  PrecompressedDocroot docroot;
+  DirectExecutor executor;
+  MockTransport transport(&executor,
+      std::bind(&PrecompressedDocroot::handle, &docroot,
+                std::placeholders::_1, std::placeholders::_2));
+
+  transport.run(HttpVersion::VERSION_1_1, "GET", "/app.js",
+      {{"Host", "test"}, {"Accept-Encoding", "gzip"}}, "");
+  const std::string gzipTag = transport.responseInfo().headers().get("ETag");
+
+  transport.run(HttpVersion::VERSION_1_1, "GET", "/app.js",
+      {{"Host", "test"}}, "");
+  const std::string identityTag =
+      transport.responseInfo().headers().get("ETag");
+
+  ASSERT_FALSE(gzipTag.empty());
+  ASSERT_NE(gzipTag, identityTag);
+
+  // revalidating the encoded representation by its own entity tag
+  transport.run(HttpVersion::VERSION_1_1, "GET", "/app.js",
+      {{"Host", "test"}, {"Accept-Encoding", "gzip"},
+       {"If-None-Match", gzipTag}}, "");
+  ASSERT_EQ(304, static_cast<int>(transport.responseInfo().status()));
+}
+
+
+TEST(HttpFileHandler, GET_cached) {
+  PrecompressedDocroot docroot;
+  HttpFileCache cache(1024, 1024);
+  docroot.setCache(&cache);
+
+  for (int i = 0; i < 2; ++i) {
+    DirectExecutor executor;
+    MockTransport transport(&executor,
+        std::bind(&PrecompressedDocroot::handle, &docroot,
+                  std::placeholders::_1, std::placeholders::_2));
+
+    transport.run(HttpVersion::VERSION_1_1, "GET", "/app.js",
+        {{"Host", "test"}, {"Accept-Encoding", "gzip"}}, "");
+
+    const HeaderFieldList& headers = transport.responseInfo().headers();
+    ASSERT_EQ(200, static_cast<int>(transport.responseInfo().status()));
+    ASSERT_EQ("gzip", transport.responseBody().str());
+    ASSERT_EQ("gzip", headers.get("Content-Encoding"));
+    ASSERT_EQ("application/javascript", headers.get("Content-Type"));
+    ASSERT_EQ("bytes", headers.get("Accept-Ranges"));
+    ASSERT_EQ(4, transport.responseInfo().contentLength());
+  }
+
+  ASSERT_EQ(1, cache.stats().hits);
+  ASSERT_EQ(1, cache.count());
+}
@@ -6,19 +6,25 @@
 // the License at: http://opensource.org/licenses/MIT
 
 #include <xzero-http/HttpFileHandler.h>
+#include <xzero-http/HttpFileCache.h>
 #include <xzero-http/HttpRequest.h>
 #include <xzero-http/HttpResponse.h>
 #include <xzero-http/HttpOutput.h>
+#include <xzero-http/HttpOutputCompressor.h>
 #include <xzero-http/HttpRangeDef.h>
 #include <xzero-http/HeaderFieldList.h>
 #include <xzero-base/io/File.h>
 #include <xzero-base/io/FileRepository.h>
 #include <xzero-base/io/FileRef.h>
+#include <xzero-base/io/FileDescriptor.h>
 #include <xzero-base/DateTime.h>
 #include <xzero-base/Tokenizer.h>
 #include <xzero-base/Buffer.h>
 #include <xzero-base/sysconfig.h>
 #include <system_error>
+#include <algorithm>
+#include <vector>
+#include <cstdlib>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -69,6 +75,7 @@ static std::string generateDefaultBoundaryID() {
 
   return std::string(buf);
 }
+
 // }}}
 
 HttpFileHandler::HttpFileHandler(FileRepository& repo)
@@ -79,19 +86,83 @@ HttpFileHandler::HttpFileHandler(
     FileRepository& repo,
     std::function<std::string()> generateBoundaryID)
     : fileRepository_(repo),
-      generateBoundaryID_(generateBoundaryID) {
+      generateBoundaryID_(generateBoundaryID),
+      pushResources_(),
+      precompressed_(false),
+      cache_(nullptr) {
 }
 
 HttpFileHandler::~HttpFileHandler() {
 }
 
+void HttpFileHandler::addPushResource(const std::string& path,
+                                      const std::string& resource) {
+  pushResources_[path].push_back(resource);
+}
+
+std::shared_ptr<File> HttpFileHandler::selectPrecompressed(
+    const std::shared_ptr<File>& file,
+    HttpRequest* request,
+    HttpResponse* response,
+    const std::string& docroot) {
+  static const struct {
+    const char* coding;
+    const char* suffix;
+  } siblings[] = {
+    {"br", ".br"},
+    {"zstd", ".zst"},
+    {"gzip", ".gz"},
+  };
+
+  // the representation depends on Accept-Encoding, regardless of whether
+  // this client accepts any.
+  response->appendHeader("Vary", "Accept-Encoding", ",");
+
+  const std::string& acceptEncoding = request->headers().get("Accept-Encoding");
+  if (acceptEncoding.empty())
+    return file;
+
+  // most wanted coding first, ties broken by the order above
+  std::vector<std::pair<double, size_t>> candidates;
+  for (size_t i = 0; i < sizeof(siblings) / sizeof(*siblings); ++i) {
+    double quality = HttpOutputCompressor::qualityOf(acceptEncoding,
+                                                     siblings[i].coding);
+    if (quality > 0)
+      candidates.emplace_back(-quality, i);
+  }
+  std::sort(candidates.begin(), candidates.end());
+
+  for (const auto& candidate: candidates) {
+    const auto& sibling = siblings[candidate.second];
+    auto encoded = fileRepository_.getFile(request->path() + sibling.suffix,
+                                           docroot);
+
+    // stale siblings are ignored rather than serving outdated content
+    if (!encoded->isRegular() || encoded->errorCode() != 0 ||
+        encoded->mtime() < file->mtime())
+      continue;
+
+    TRACE(1, "serving %s%s", request->path().c_str(), sibling.suffix);
+    response->addHeader("Content-Encoding", sibling.coding);
+    return encoded;
+  }
+
+  return file;
+}
+
 bool HttpFileHandler::handle(HttpRequest* request, HttpResponse* response,
                              const std::string& docroot) {
-  auto transferFile = fileRepository_.getFile(request->path(), docroot);
+  auto file = fileRepository_.getFile(request->path(), docroot);
 
-  if (!transferFile->isRegular())
+  if (!file->isRegular())
     return false;
 
+  // the file to transfer, which is the requested one or a precompressed
+  // sibling of it.
+  std::shared_ptr<File> transferFile = file;
+  if (precompressed_ && file->errorCode() == 0)
+    transferFile = selectPrecompressed(file, request, response, docroot);
+
   if (handleClientCache(*transferFile, request, response))
     return true;
 
@@ -111,10 +182,35 @@ bool HttpFileHandler::handle(HttpRequest* request, HttpResponse* response,
       throw std::system_error(transferFile->errorCode(), std::system_category());
   }
 
-  int fd = -1;
+  if (cache_ && request->method() == HttpMethod::GET &&
+      !request->headers().contains("Range")) {
+    std::shared_ptr<const HttpFileCache::Entry> cached =
+        cache_->get(*transferFile, file->mimetype());
+
+    if (cached) {
+      response->setStatus(HttpStatus::Ok);
+      for (const HeaderField& field: cached->headers)
+        response->addHeader(field.name(), field.value());
+      response->setContentLength(cached->content.size());
+
+      auto pushes = pushResources_.find(request->path());
+      if (pushes != pushResources_.end())
+        response->pushResources(pushes->second);
+
+      // sent by reference, the entry is kept alive until completion
+      response->output()->write(cached->content.ref(),
+                                [cached, response](bool) {
+                                  response->completed();
+                                });
+      return true;
+    }
+  }
+
+  // shared with concurrent requests if the file repository caches it
+  std::shared_ptr<FileDescriptor> fd;
   if (request->method() == HttpMethod::GET) {
-    fd = transferFile->createPosixChannel(File::Read | File::NonBlocking);
-    if (fd < 0) {
+    fd = transferFile->sharedHandle();
+    if (!fd) {
       if (errno != EPERM && errno != EACCES)
         throw std::system_error(transferFile->errorCode(), std::system_category());
 
@@ -132,20 +228,25 @@ bool HttpFileHandler::handle(HttpRequest* request, HttpResponse* response,
   response->addHeader("Last-Modified", transferFile->lastModified());
   response->addHeader("ETag", transferFile->etag());
 
-  if (handleRangeRequest(*transferFile, fd, request, response))
+  if (handleRangeRequest(*transferFile, file->mimetype(), fd, request,
+                         response))
     return true;
 
   response->setStatus(HttpStatus::Ok);
   response->addHeader("Accept-Ranges", "bytes");
-  response->addHeader("Content-Type", transferFile->mimetype());
+  response->addHeader("Content-Type", file->mimetype());
 
   response->setContentLength(transferFile->size());
 
-  if (fd >= 0) {  // GET request
+  if (fd) {  // GET request
+    auto pushes = pushResources_.find(request->path());
+    if (pushes != pushResources_.end())
+      response->pushResources(pushes->second);
+
 #if defined(HAVE_POSIX_FADVISE)
-    posix_fadvise(fd, 0, transferFile->size(), POSIX_FADV_SEQUENTIAL);
+    posix_fadvise(*fd, 0, transferFile->size(), POSIX_FADV_SEQUENTIAL);
 #endif
-    response->output()->write(FileRef(fd, 0, transferFile->size(), true),
+    response->output()->write(FileRef(fd, 0, transferFile->size()),
         std::bind(&HttpResponse::completed, response));
   } else {
     response->completed();
@@ -232,10 +333,13 @@ static size_t numdigits(size_t number) {
   return result;
 }
 
-bool HttpFileHandler::handleRangeRequest(const File& transferFile, int fd,
-                                         HttpRequest* request,
-                                         HttpResponse* response) {
-  const bool isHeadReq = fd < 0;
+bool HttpFileHandler::handleRangeRequest(
+    const File& transferFile,
+    const std::string& mimetype,
+    const std::shared_ptr<FileDescriptor>& fd,
+    HttpRequest* request,
+    HttpResponse* response) {
+  const bool isHeadReq = !fd;
   BufferRef range_value(request->headers().get("Range"));
   HttpRangeDef range;
 
@@ -269,7 +373,7 @@ bool HttpFileHandler::handleRangeRequest(const File& transferFile, int fd,
       const size_t headerLen = sizeof("\r\n--") - 1
                              + boundary.size()
                              + sizeof("\r\nContent-Type: ") - 1
-                             + transferFile.mimetype().size()
+                             + mimetype.size()
                              + sizeof("\r\nContent-Range: bytes ") - 1
                              + numdigits(offsets.first)
                              + sizeof("-") - 1
@@ -309,7 +413,7 @@ bool HttpFileHandler::handleRangeRequest(const File& transferFile, int fd,
       buf.push_back("\r\n--");
       buf.push_back(boundary);
       buf.push_back("\r\nContent-Type: ");
-      buf.push_back(transferFile.mimetype());
+      buf.push_back(mimetype);
 
       buf.push_back("\r\nContent-Range: bytes ");
       buf.push_back(offsets.first);
@@ -320,9 +424,8 @@ bool HttpFileHandler::handleRangeRequest(const File& transferFile, int fd,
       buf.push_back("\r\n\r\n");
 
       if (!isHeadReq) {
-        bool last = i + 1 == numRanges;
         response->output()->write(std::move(buf));
-        response->output()->write(FileRef(fd, offsets.first, partLength, last));
+        response->output()->write(FileRef(fd, offsets.first, partLength));
       }
     }
 
@@ -341,7 +444,7 @@ bool HttpFileHandler::handleRangeRequest(const File& transferFile, int fd,
       return true;
     }
 
-    response->addHeader("Content-Type", transferFile.mimetype());
+    response->addHeader("Content-Type", mimetype);
 
     size_t length = 1 + offsets.second - offsets.first;
     response->setContentLength(length);
@@ -351,11 +454,11 @@ bool HttpFileHandler::handleRangeRequest(const File& transferFile, int fd,
              transferFile.size());
     response->addHeader("Content-Range", cr);
 
-    if (fd >= 0) {
+    if (fd) {
 #if defined(HAVE_POSIX_FADVISE)
-      posix_fadvise(fd, offsets.first, length, POSIX_FADV_SEQUENTIAL);
+      posix_fadvise(*fd, offsets.first, length, POSIX_FADV_SEQUENTIAL);
 #endif
-      response->output()->write(FileRef(fd, offsets.first, length, true));
+      response->output()->write(FileRef(fd, offsets.first, length));
     }
   }
 
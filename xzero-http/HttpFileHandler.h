@@ -12,14 +12,17 @@
 #include <memory>
 #include <functional>
 #include <unordered_map>
+#include <vector>
 
 namespace xzero {
 
 class HttpRequest;
 class HttpResponse;
 class File;
+class FileDescriptor;
 class FileRepository;
 class MimeTypes;
+class HttpFileCache;
 
 /**
  * Handles GET/HEAD requests to local files.
@@ -61,7 +64,51 @@ class XZERO_HTTP_API HttpFileHandler {
   bool handle(HttpRequest* request, HttpResponse* response,
               const std::string& docroot);
 
+  /**
+   * Pushes @p resource along with every full response to @p path.
+   *
+   * @param path request path of the file that refers to @p resource.
+   * @param resource request path of the resource to push, such as a
+   *                 stylesheet @p path links to.
+   *
+   * @see HttpResponse::pushResources(const std::vector<std::string>&)
+   */
+  void addPushResource(const std::string& path, const std::string& resource);
+
+  /**
+   * Enables serving precompressed siblings of requested files.
+   *
+   * When enabled, a request for @c /app.js accepting a content coding is
+   * served from @c /app.js.br, @c /app.js.zst or @c /app.js.gz (in that
+   * order of preference), if such a file exists and is not older than the
+   * file itself. The sibling is transferred as is, with its own ETag and a
+   * @c Content-Encoding header, so it is never compressed again.
+   */
+  void setPrecompressed(bool enable) { precompressed_ = enable; }
+  bool isPrecompressed() const { return precompressed_; }
+
+  /**
+   * Serves small files through an in-memory cache.
+   *
+   * Full (non-ranged) GET responses for files admitted to @p cache are
+   * sent from memory instead of the file system.
+   *
+   * @param cache the cache to use, or @c nullptr to disable. It must
+   *              outlive this handler and may be shared with other ones.
+   */
+  void setCache(HttpFileCache* cache) { cache_ = cache; }
+  HttpFileCache* cache() const { return cache_; }
+
  private:
+  /**
+   * Retrieves the precompressed sibling of @p file accepted by the client,
+   * or @p file itself if there is none.
+   */
+  std::shared_ptr<File> selectPrecompressed(const std::shared_ptr<File>& file,
+                                            HttpRequest* request,
+                                            HttpResponse* response,
+                                            const std::string& docroot);
+
   /**
    * Evaluates conditional requests to local file.
    *
@@ -81,7 +128,8 @@ class XZERO_HTTP_API HttpFileHandler {
    * Fully processes the ranged requests, if one, or does nothing.
    *
    * @param transferFile
-   * @param fd open file descriptor in case of a GET request.
+   * @param mimetype the media type of the file's content.
+   * @param fd open file handle in case of a GET request, null otherwise.
    * @param request HTTP request handle.
    * @param response HTTP response handle.
    *
@@ -91,15 +139,17 @@ class XZERO_HTTP_API HttpFileHandler {
    *
    * @note if this is no ranged request. nothing is done on it.
    */
-  bool handleRangeRequest(const File& transferFile, int fd,
+  bool handleRangeRequest(const File& transferFile,
+                          const std::string& mimetype,
+                          const std::shared_ptr<FileDescriptor>& fd,
                           HttpRequest* request, HttpResponse* response);
 
  private:
   FileRepository& fileRepository_;
   std::function<std::string()> generateBoundaryID_;
-
-  // TODO stat cache
-  // TODO fd cache
+  std::unordered_map<std::string, std::vector<std::string>> pushResources_;
+  bool precompressed_;
+  HttpFileCache* cache_;
 };
 
 } // namespace xzero
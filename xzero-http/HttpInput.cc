@@ -10,7 +10,8 @@
 namespace xzero {
 
 HttpInput::HttpInput()
-    : listener_(nullptr) {
+    : listener_(nullptr),
+      resumeHandler_() {
 }
 
 HttpInput::~HttpInput() {
@@ -20,4 +21,18 @@ void HttpInput::setListener(HttpInputListener* listener) {
   listener_ = listener;
 }
 
+bool HttpInput::isFull() const noexcept {
+  return false;
+}
+
+void HttpInput::setResumeHandler(std::function<void()> handler) {
+  resumeHandler_ = std::move(handler);
+}
+
+void HttpInput::resume() {
+  if (resumeHandler_) {
+    resumeHandler_();
+  }
+}
+
 } // namespace xzero
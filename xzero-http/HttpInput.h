@@ -9,6 +9,7 @@
 
 #include <xzero-http/Api.h>
 #include <xzero-base/sysconfig.h>
+#include <functional>
 
 namespace xzero {
 
@@ -39,6 +40,22 @@ class XZERO_HTTP_API HttpInput {
    */
   virtual bool empty() const noexcept = 0;
 
+  /**
+   * Tests whether the transport should pause reading further body data,
+   * because too much of it is pending to be consumed.
+   *
+   * The default implementation never pauses.
+   */
+  virtual bool isFull() const noexcept;
+
+  /**
+   * Registers a callback to be invoked once a full input is ready to
+   * receive more data again.
+   *
+   * @internal
+   */
+  void setResumeHandler(std::function<void()> handler);
+
   /**
    * Registers a callback interface to get notified when input data is
    * available.
@@ -68,8 +85,15 @@ class XZERO_HTTP_API HttpInput {
    */
   virtual void recycle() = 0;
 
+ protected:
+  /**
+   * Notifies the transport that this input is no longer full.
+   */
+  void resume();
+
  private:
   HttpInputListener* listener_;
+  std::function<void()> resumeHandler_;
 };
 
 }  // namespace xzero
@@ -0,0 +1,69 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#include <xzero-http/HttpOutputCompressor.h>
+#include <xzero-base/sysconfig.h>
+#include <gtest/gtest.h>
+
+using namespace xzero;
+
+TEST(HttpOutputCompressor, qualityOf) {
+  ASSERT_EQ(1.0, HttpOutputCompressor::qualityOf("gzip, br", "gzip"));
+  ASSERT_EQ(1.0, HttpOutputCompressor::qualityOf("GZIP", "gzip"));
+  ASSERT_EQ(0.5, HttpOutputCompressor::qualityOf("br;q=0.5", "br"));
+  ASSERT_EQ(0.0, HttpOutputCompressor::qualityOf("gzip;q=0", "gzip"));
+  ASSERT_EQ(0.0, HttpOutputCompressor::qualityOf("gzip", "br"));
+  ASSERT_EQ(0.0, HttpOutputCompressor::qualityOf("", "gzip"));
+
+  // wildcard, unless the coding is listed explicitly
+  ASSERT_EQ(0.3, HttpOutputCompressor::qualityOf("*;q=0.3", "zstd"));
+  ASSERT_EQ(0.0, HttpOutputCompressor::qualityOf("zstd;q=0, *", "zstd"));
+}
+
+TEST(HttpOutputCompressor, negotiateByQuality) {
+  HttpOutputCompressor compressor;
+  compressor.setPreferences({"br", "gzip"});
+
+  ASSERT_EQ("", compressor.negotiate("identity"));
+  ASSERT_EQ("gzip", compressor.negotiate("gzip;q=1.0, br;q=0.8"));
+  ASSERT_EQ("gzip", compressor.negotiate("gzip, br;q=0"));
+  ASSERT_EQ("gzip", compressor.negotiate("gzip;q=0.5, deflate"));
+}
+
+TEST(HttpOutputCompressor, negotiateByPreference) {
+  HttpOutputCompressor compressor;
+
+  compressor.setPreferences({"gzip", "br", "zstd"});
+  ASSERT_EQ("gzip", compressor.negotiate("br, gzip, zstd"));
+  ASSERT_EQ("gzip", compressor.negotiate("*"));
+
+#if defined(HAVE_BROTLI_ENCODE_H)
+  compressor.setPreferences({"br", "gzip"});
+  ASSERT_EQ("br", compressor.negotiate("gzip, br"));
+  ASSERT_EQ("gzip", compressor.negotiate("gzip, br;q=0.9"));
+#endif
+}
+
+TEST(HttpOutputCompressor, unsupportedPreferences) {
+  HttpOutputCompressor compressor;
+  compressor.setPreferences({"bzip2", "gzip"});
+
+  ASSERT_EQ(1, compressor.preferences().size());
+  ASSERT_EQ("gzip", compressor.preferences()[0]);
+  ASSERT_EQ("", compressor.negotiate("bzip2"));
+}
+
+TEST(HttpOutputCompressor, encodingLevel) {
+  HttpOutputCompressor compressor;
+  ASSERT_EQ(9, compressor.compressionLevel());
+
+  compressor.setCompressionLevel(6);
+  ASSERT_EQ(6, compressor.encodingLevel("gzip"));
+
+  compressor.setEncodingLevel("br", 11);
+  ASSERT_EQ(11, compressor.encodingLevel("br"));
+}
@@ -11,12 +11,14 @@
 #include <xzero-http/HttpResponse.h>
 #include <xzero-base/io/Filter.h>
 #include <xzero-base/io/GzipFilter.h>
-#include <xzero-base/Tokenizer.h>
+#include <xzero-base/io/BrotliFilter.h>
+#include <xzero-base/io/ZstdFilter.h>
 #include <xzero-base/Buffer.h>
 #include <algorithm>
 #include <system_error>
 #include <stdexcept>
 #include <cstdlib>
+#include <strings.h>
 
 #include <xzero-base/sysconfig.h>
 
@@ -25,8 +27,13 @@ namespace xzero {
 HttpOutputCompressor::HttpOutputCompressor()
     : minSize_(256),                // 256 byte
       maxSize_(128 * 1024 * 1024),  // 128 MB
-      level_(9),                    // best compression
+      preferences_(),
+      levels_(),
       contentTypes_() {             // no types
+  setPreferences({"zstd", "br", "gzip"});
+  setEncodingLevel("gzip", 9);      // best compression
+  setEncodingLevel("br", 5);        // good ratio at gzip-like speed
+  setEncodingLevel("zstd", 3);
   addMimeType("text/plain");
   addMimeType("text/html");
   addMimeType("text/css");
@@ -54,25 +61,109 @@ bool HttpOutputCompressor::containsMimeType(const std::string& value) const {
   return contentTypes_.find(value) != contentTypes_.end();
 }
 
-template<typename Encoder>
-bool tryEncode(const std::string& encoding,
-               int level,
-               const std::vector<BufferRef>& accepts,
-               HttpRequest* request,
-               HttpResponse* response) {
-  if (std::find(accepts.begin(), accepts.end(), encoding) == accepts.end())
-    return false;
+void HttpOutputCompressor::setEncodingLevel(const std::string& coding,
+                                            int level) {
+  levels_[coding] = level;
+}
 
-  // response might change according to Accept-Encoding
-  response->appendHeader("Vary", "Accept-Encoding", ",");
+int HttpOutputCompressor::encodingLevel(const std::string& coding) const {
+  auto i = levels_.find(coding);
+  return i != levels_.end() ? i->second : 0;
+}
 
-  // removing content-length implicitely enables chunked encoding
-  response->resetContentLength();
+void HttpOutputCompressor::setPreferences(
+    const std::vector<std::string>& codings) {
+  preferences_.clear();
+  for (const std::string& coding: codings)
+    if (isSupported(coding))
+      preferences_.push_back(coding);
+}
+
+bool HttpOutputCompressor::isSupported(const std::string& coding) {
+  if (coding == "gzip")
+    return true;
+
+#if defined(HAVE_BROTLI_ENCODE_H)
+  if (coding == "br")
+    return true;
+#endif
+
+#if defined(HAVE_ZSTD_H)
+  if (coding == "zstd")
+    return true;
+#endif
+
+  return false;
+}
+
+double HttpOutputCompressor::qualityOf(const std::string& acceptEncoding,
+                                       const std::string& coding) {
+  double wildcard = 0;
+  size_t i = 0;
+
+  while (i < acceptEncoding.size()) {
+    size_t end = acceptEncoding.find(',', i);
+    if (end == std::string::npos)
+      end = acceptEncoding.size();
+
+    size_t nameBegin = acceptEncoding.find_first_not_of(" \t", i);
+    size_t nameEnd = acceptEncoding.find_first_of(" \t;", nameBegin);
+    if (nameEnd > end)
+      nameEnd = end;
+
+    if (nameBegin < nameEnd) {
+      double quality = 1;
+      size_t q = acceptEncoding.find("q=", nameEnd);
+      if (q < end)
+        quality = std::min(1.0, std::max(0.0,
+            std::strtod(acceptEncoding.c_str() + q + 2, nullptr)));
+
+      const size_t n = nameEnd - nameBegin;
+      if (n == coding.size() &&
+          strncasecmp(acceptEncoding.c_str() + nameBegin, coding.c_str(),
+                      n) == 0)
+        return quality;
+
+      if (n == 1 && acceptEncoding[nameBegin] == '*')
+        wildcard = quality;
+    }
+
+    i = end + 1;
+  }
+
+  return wildcard;
+}
 
-  response->addHeader("Content-Encoding", encoding);
-  response->output()->addFilter(std::make_shared<Encoder>(level));
+std::string HttpOutputCompressor::negotiate(
+    const std::string& acceptEncoding) const {
+  std::string best;
+  double bestQuality = 0;
+
+  // strictly greater, so that the earlier preference wins ties
+  for (const std::string& coding: preferences_) {
+    double quality = qualityOf(acceptEncoding, coding);
+    if (quality > bestQuality) {
+      best = coding;
+      bestQuality = quality;
+    }
+  }
 
-  return true;
+  return best;
+}
+
+std::shared_ptr<Filter> HttpOutputCompressor::createFilter(
+    const std::string& coding) const {
+#if defined(HAVE_BROTLI_ENCODE_H)
+  if (coding == "br")
+    return std::make_shared<BrotliFilter>(encodingLevel(coding));
+#endif
+
+#if defined(HAVE_ZSTD_H)
+  if (coding == "zstd")
+    return std::make_shared<ZstdFilter>(encodingLevel(coding));
+#endif
+
+  return std::make_shared<GzipFilter>(encodingLevel(coding));
 }
 
 void HttpOutputCompressor::inject(HttpRequest* request,
@@ -95,16 +186,23 @@ void HttpOutputCompressor::postProcess(HttpRequest* request,
     return;
 
   const std::string& acceptEncoding = request->headers().get("Accept-Encoding");
-  BufferRef r(acceptEncoding);
-  if (!r.empty()) {
-    const auto items = Tokenizer<BufferRef, BufferRef>::tokenize(r, ", ");
+  if (acceptEncoding.empty())
+    return;
 
-    // if (tryEncode<Bzip2Filter>("bzip2", level_, items, request, response))
-    //   return;
+  const std::string coding = negotiate(acceptEncoding);
+  if (coding.empty())
+    return;
 
-    if (tryEncode<GzipFilter>("gzip", level_, items, request, response))
-      return;
-  }
+  // response might change according to Accept-Encoding
+  if (response->headers().get("Vary").find("Accept-Encoding") ==
+      std::string::npos)
+    response->appendHeader("Vary", "Accept-Encoding", ",");
+
+  // removing content-length implicitely enables chunked encoding
+  response->resetContentLength();
+
+  response->addHeader("Content-Encoding", coding);
+  response->output()->addFilter(createFilter(coding));
 }
 
 } // namespace xzero
@@ -10,15 +10,23 @@
 #include <xzero-http/Api.h>
 #include <xzero-base/sysconfig.h>
 #include <unordered_map>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace xzero {
 
+class Filter;
 class HttpRequest;
 class HttpResponse;
 
 /**
  * HTTP response output compression.
+ *
+ * The content coding is negotiated by the quality values of the client's
+ * @c Accept-Encoding, ties being broken by the server's preference order.
+ * Supported codings are @c gzip, and @c br and @c zstd if available at
+ * build time.
  */
 class XZERO_HTTP_API HttpOutputCompressor {
  public:
@@ -34,8 +42,45 @@ class XZERO_HTTP_API HttpOutputCompressor {
   void setMaxSize(size_t value);
   size_t maxSize() const XZERO_NOEXCEPT { return maxSize_; }
 
-  void setCompressionLevel(int value) { level_ = value; }
-  int compressionLevel() const XZERO_NOEXCEPT { return level_; }
+  /** Sets the gzip compression level. */
+  void setCompressionLevel(int value) { setEncodingLevel("gzip", value); }
+  int compressionLevel() const { return encodingLevel("gzip"); }
+
+  /**
+   * Sets the compression level (or quality) for given content coding.
+   */
+  void setEncodingLevel(const std::string& coding, int level);
+  int encodingLevel(const std::string& coding) const;
+
+  /**
+   * Sets the server's order of preference among equally weighted codings,
+   * most preferred first.
+   *
+   * Codings not supported by this build are dropped.
+   */
+  void setPreferences(const std::vector<std::string>& codings);
+  const std::vector<std::string>& preferences() const XZERO_NOEXCEPT {
+    return preferences_;
+  }
+
+  /** Tests whether content coding @p coding is supported by this build. */
+  static bool isSupported(const std::string& coding);
+
+  /**
+   * Retrieves the quality value an @c Accept-Encoding header value assigns
+   * to @p coding, either directly or via the @c * wildcard.
+   *
+   * @return the quality value from 0 (not acceptable) to 1.
+   */
+  static double qualityOf(const std::string& acceptEncoding,
+                          const std::string& coding);
+
+  /**
+   * Chooses the content coding to apply for given @c Accept-Encoding value.
+   *
+   * @return the coding name or an empty string if none is acceptable.
+   */
+  std::string negotiate(const std::string& acceptEncoding) const;
 
   /**
    * Injects a preCommit handler to automatically add output compression.
@@ -47,10 +92,14 @@ class XZERO_HTTP_API HttpOutputCompressor {
    */
   void postProcess(HttpRequest* request, HttpResponse* response);
 
+ private:
+  std::shared_ptr<Filter> createFilter(const std::string& coding) const;
+
  private:
   size_t minSize_;
   size_t maxSize_;
-  int level_;
+  std::vector<std::string> preferences_;
+  std::unordered_map<std::string, int> levels_;
   std::unordered_map<std::string, int> contentTypes_;
 };
 
@@ -158,6 +158,14 @@ void HttpResponse::send100Continue(CompletionHandler onComplete) {
   channel_->send100Continue(onComplete);
 }
 
+void HttpResponse::pushResource(const std::string& path) {
+  channel_->pushResources({path});
+}
+
+void HttpResponse::pushResources(const std::vector<std::string>& paths) {
+  channel_->pushResources(paths);
+}
+
 void HttpResponse::sendError(HttpStatus code, const std::string& message) {
   requireMutableInfo();
 
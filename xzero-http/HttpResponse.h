@@ -14,6 +14,8 @@
 #include <xzero-http/HttpOutput.h>
 #include <xzero-http/HeaderFieldList.h>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace xzero {
 
@@ -96,6 +98,25 @@ class XZERO_HTTP_API HttpResponse {
    */
   void send100Continue(CompletionHandler onComplete);
 
+  /**
+   * Pushes the resource at @p path to the client along with this response.
+   *
+   * Maps to HTTP/2 server push where the client permits it, and falls back
+   * to a 103 (Early Hints) response with a preload @c Link header on
+   * HTTP/1.1.
+   *
+   * Must be invoked before the response is committed.
+   *
+   * @see pushResources(const std::vector<std::string>&)
+   */
+  void pushResource(const std::string& path);
+
+  /**
+   * Pushes multiple resources to the client along with this response,
+   * announcing all that cannot be pushed in a single 103 response.
+   */
+  void pushResources(const std::vector<std::string>& paths);
+
   /**
    * Responds with an error response message.
    *
@@ -10,6 +10,7 @@
 #include <xzero-http/HttpResponse.h>
 #include <xzero-http/HttpInputListener.h>
 #include <xzero-http/http1/Http1ConnectionFactory.h>
+#include <xzero-http/http2/Http2ConnectionFactory.h>
 #include <xzero-base/net/LocalConnector.h>
 #include <xzero-base/net/InetConnector.h>
 #include <xzero-base/net/Server.h>
@@ -59,6 +60,7 @@ HttpService::HttpService()
     : server_(new Server()),
       localConnector_(nullptr),
       inetConnector_(nullptr),
+      http2_(false),
       handlers_() {
 }
 
@@ -73,6 +75,8 @@ LocalConnector* HttpService::configureLocal() {
   localConnector_ = server_->addConnector<LocalConnector>();
 
   enableHttp1(localConnector_);
+  if (http2_)
+    enableHttp2(localConnector_);
 
   return localConnector_;
 }
@@ -92,6 +96,8 @@ InetConnector* HttpService::configureInet(Executor* executor,
       ipaddress, port, backlog, true, false);
 
   enableHttp1(inetConnector_);
+  if (http2_)
+    enableHttp2(inetConnector_);
 
   return inetConnector_;
 }
@@ -115,6 +121,34 @@ void HttpService::enableHttp1(Connector* connector) {
                    std::placeholders::_1, std::placeholders::_2));
 }
 
+void HttpService::enableHttp2() {
+  if (http2_)
+    return;
+
+  http2_ = true;
+
+  if (localConnector_)
+    enableHttp2(localConnector_);
+
+  if (inetConnector_)
+    enableHttp2(inetConnector_);
+}
+
+void HttpService::enableHttp2(Connector* connector) {
+  // HTTP/2 with prior knowledge ("h2c"), taken over from HTTP/1 connections
+  WallClock* clock = WallClock::system();
+  size_t maxRequestUriLength = 1024;
+  size_t maxRequestBodyLength = 64 * 1024 * 1024;
+
+  auto http = connector->addConnectionFactory<xzero::http2::Http2ConnectionFactory>(
+      clock,
+      maxRequestUriLength,
+      maxRequestBodyLength);
+
+  http->setHandler(std::bind(&HttpService::handleRequest, this,
+                   std::placeholders::_1, std::placeholders::_2));
+}
+
 void HttpService::addHandler(Handler* handler) {
   handlers_.push_back(handler);
 }
@@ -65,6 +65,14 @@ class XZERO_HTTP_API HttpService {
   /** Configures a local connector. */
   LocalConnector* configureLocal();
 
+  /**
+   * Additionally accepts HTTP/2 with prior knowledge ("h2c") on all
+   * connectors, including those configured later on.
+   *
+   * HTTP/2 is disabled by default.
+   */
+  void enableHttp2();
+
   /** Registers a new @p handler. */
   void addHandler(Handler* handler);
 
@@ -79,6 +87,7 @@ class XZERO_HTTP_API HttpService {
 
  private:
   void enableHttp1(Connector* connector);
+  void enableHttp2(Connector* connector);
   void handleRequest(HttpRequest* request, HttpResponse* response);
   void onAllDataRead(HttpRequest* request, HttpResponse* response);
 
@@ -88,6 +97,7 @@ class XZERO_HTTP_API HttpService {
   Server* server_;
   LocalConnector* localConnector_;
   InetConnector* inetConnector_;
+  bool http2_;
   std::vector<Handler*> handlers_;
 };
 
@@ -16,6 +16,7 @@ const std::string& to_string(HttpStatus code) {
     case HttpStatus::ContinueRequest: SRET("Continue Request");
     case HttpStatus::SwitchingProtocols: SRET("Switching Protocols");
     case HttpStatus::Processing: SRET("Processing");
+    case HttpStatus::EarlyHints: SRET("Early Hints");
     case HttpStatus::Ok: SRET("Ok");
     case HttpStatus::Created: SRET("Created");
     case HttpStatus::Accepted: SRET("Accepted");
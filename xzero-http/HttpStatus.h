@@ -28,6 +28,7 @@ enum class HttpStatus  // {{{
   ContinueRequest = 100,
   SwitchingProtocols = 101,
   Processing = 102,  // WebDAV, RFC 2518
+  EarlyHints = 103,  // RFC 8297
 
   // successful
   Ok = 200,
@@ -0,0 +1,87 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#include <xzero-http/HttpStreamingInput.h>
+#include <xzero-base/io/LocalFileRepository.h>
+#include <xzero-base/MimeTypes.h>
+#include <xzero-base/Buffer.h>
+#include <gtest/gtest.h>
+
+using namespace xzero;
+
+TEST(HttpStreamingInput, read) {
+  HttpStreamingInput input(1024);
+
+  input.onContent(BufferRef("Hello, "));
+  input.onContent(BufferRef("World"));
+  ASSERT_FALSE(input.empty());
+  ASSERT_EQ(12, input.bufferedBytes());
+
+  Buffer result;
+  ASSERT_EQ(12, input.read(&result));
+  ASSERT_EQ("Hello, World", result);
+  ASSERT_TRUE(input.empty());
+}
+
+TEST(HttpStreamingInput, readLine) {
+  HttpStreamingInput input(1024);
+  input.onContent(BufferRef("foo\nbar"));
+
+  Buffer line;
+  input.readLine(&line);
+  ASSERT_EQ("foo", line);
+
+  line.clear();
+  input.readLine(&line);
+  ASSERT_EQ("bar", line);
+  ASSERT_TRUE(input.empty());
+}
+
+TEST(HttpStreamingInput, fullAndResume) {
+  HttpStreamingInput input(8);
+  int resumed = 0;
+  input.setResumeHandler([&]() { resumed++; });
+
+  input.onContent(BufferRef("1234"));
+  ASSERT_FALSE(input.isFull());
+
+  input.onContent(BufferRef("5678"));
+  ASSERT_TRUE(input.isFull());
+
+  Buffer result;
+  input.read(&result);
+  ASSERT_EQ("12345678", result);
+  ASSERT_FALSE(input.isFull());
+  ASSERT_EQ(1, resumed);
+
+  // consuming while not full must not resume again
+  input.onContent(BufferRef("ab"));
+  input.read(&result);
+  ASSERT_EQ(1, resumed);
+}
+
+TEST(HttpStreamingInput, spool) {
+  MimeTypes mimetypes;
+  LocalFileRepository repo(mimetypes, "/", true, true, true);
+  HttpStreamingInput input(4, &repo, 6);
+
+  input.onContent(BufferRef("abcd"));
+  ASSERT_FALSE(input.isSpooling());
+
+  input.onContent(BufferRef("efgh"));
+  ASSERT_TRUE(input.isSpooling());
+  ASSERT_FALSE(input.isFull());
+
+  input.onContent(BufferRef("ijkl"));
+  ASSERT_FALSE(input.isFull());
+
+  Buffer result;
+  while (!input.empty())
+    input.read(&result);
+
+  ASSERT_EQ("abcdefghijkl", result);
+}
@@ -0,0 +1,202 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#include <xzero-http/HttpStreamingInput.h>
+#include <xzero-http/HttpInputListener.h>
+#include <xzero-base/io/FileRepository.h>
+#include <xzero-base/io/FileUtil.h>
+#include <xzero-base/RuntimeError.h>
+#include <xzero-base/logging.h>
+#include <xzero-base/sysconfig.h>
+#include <algorithm>
+#include <unistd.h>
+
+namespace xzero {
+
+#ifndef NDEBUG
+#define TRACE(msg...) logTrace("http.HttpStreamingInput", msg)
+#else
+#define TRACE(msg...) do {} while (0)
+#endif
+
+HttpStreamingInput::HttpStreamingInput(size_t bufferSize,
+                                       FileRepository* spool,
+                                       size_t spoolThreshold)
+    : xzero::HttpInput(),
+      bufferSize_(bufferSize),
+      spoolRepository_(spool),
+      spoolThreshold_(spoolThreshold),
+      content_(),
+      offset_(0),
+      fd_(-1),
+      spoolWritten_(0),
+      spoolRead_(0) {
+  TRACE("%p ctor", this);
+}
+
+HttpStreamingInput::~HttpStreamingInput() {
+  TRACE("%p dtor", this);
+
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+}
+
+void HttpStreamingInput::recycle() {
+  TRACE("%p recycle", this);
+
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+
+  content_.clear();
+  offset_ = 0;
+  spoolWritten_ = 0;
+  spoolRead_ = 0;
+}
+
+int HttpStreamingInput::read(Buffer* result) {
+  const bool wasFull = isFull();
+
+  if (offset_ == content_.size())
+    fillFromSpool();
+
+  const size_t len = content_.size() - offset_;
+  result->push_back(content_.ref(offset_));
+  TRACE("%p read: %zu bytes", this, len);
+
+  content_.clear();
+  offset_ = 0;
+
+  consumed(wasFull);
+
+  return len;
+}
+
+size_t HttpStreamingInput::readLine(Buffer* result) {
+  const bool wasFull = isFull();
+
+  if (offset_ == content_.size())
+    fillFromSpool();
+
+  const size_t len = content_.size() - offset_;
+  TRACE("%p readLine: %zu bytes", this, len);
+
+  const size_t n = content_.find('\n', offset_);
+  if (n == Buffer::npos) {
+    result->push_back(content_.ref(offset_));
+    content_.clear();
+    offset_ = 0;
+    consumed(wasFull);
+    return len;
+  }
+
+  result->push_back(content_.ref(offset_, n - offset_));
+  offset_ = n + 1;
+
+  if (offset_ == content_.size()) {
+    content_.clear();
+    offset_ = 0;
+  }
+
+  consumed(wasFull);
+
+  return 0;
+}
+
+bool HttpStreamingInput::empty() const noexcept {
+  return offset_ == content_.size() && spoolRead_ == spoolWritten_;
+}
+
+bool HttpStreamingInput::isFull() const noexcept {
+  return fd_ < 0 && bufferedBytes() >= bufferSize_;
+}
+
+void HttpStreamingInput::onContent(const BufferRef& chunk) {
+  TRACE("%p onContent: %zu bytes", this, chunk.size());
+
+  if (fd_ >= 0) {
+    spool(chunk);
+  } else {
+    if (offset_ == content_.size()) {
+      content_.clear();
+      offset_ = 0;
+    }
+
+    content_.push_back(chunk);
+
+    if (spoolRepository_ && bufferedBytes() > spoolThreshold_) {
+      startSpooling();
+    }
+  }
+
+  if (listener())
+    listener()->onContentAvailable();
+}
+
+void HttpStreamingInput::startSpooling() {
+  std::string path;
+  fd_ = spoolRepository_->createTempFile(&path);
+
+  // the file is only accessed through its descriptor from now on
+  FileUtil::rm(path);
+
+  TRACE("%p startSpooling: %zu bytes", this, bufferedBytes());
+
+  spool(content_.ref(offset_));
+  content_.clear();
+  offset_ = 0;
+}
+
+void HttpStreamingInput::spool(const BufferRef& chunk) {
+  size_t nwritten = 0;
+
+  while (nwritten < chunk.size()) {
+    ssize_t rv = pwrite(fd_, chunk.data() + nwritten, chunk.size() - nwritten,
+                        spoolWritten_);
+    if (rv < 0) {
+      if (errno == EINTR)
+        continue;
+
+      RAISE_ERRNO(errno);
+    }
+
+    nwritten += rv;
+    spoolWritten_ += rv;
+  }
+}
+
+bool HttpStreamingInput::fillFromSpool() {
+  if (fd_ < 0 || spoolRead_ == spoolWritten_)
+    return false;
+
+  const size_t avail = static_cast<size_t>(spoolWritten_ - spoolRead_);
+  const size_t count = std::min(avail, std::max(bufferSize_, size_t(4096)));
+
+  content_.clear();
+  offset_ = 0;
+  content_.reserve(count);
+
+  ssize_t rv = pread(fd_, content_.data(), count, spoolRead_);
+  if (rv < 0)
+    RAISE_ERRNO(errno);
+
+  content_.resize(rv);
+  spoolRead_ += rv;
+
+  return rv > 0;
+}
+
+void HttpStreamingInput::consumed(bool wasFull) {
+  if (wasFull && !isFull()) {
+    TRACE("%p resume", this);
+    resume();
+  }
+}
+
+} // namespace xzero
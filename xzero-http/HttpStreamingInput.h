@@ -0,0 +1,83 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <xzero-http/HttpInput.h>
+#include <xzero-base/Buffer.h>
+#include <sys/types.h>
+
+namespace xzero {
+
+class FileRepository;
+
+/**
+ * HTTP message body consumer, passing body chunks on as they arrive.
+ *
+ * Unlike HttpBufferedInput, only the body data not yet consumed by the
+ * handler is held in memory. Once that reaches @c bufferSize bytes,
+ * the input reports itself as full, so that the transport pauses reading
+ * from the client until the handler caught up.
+ *
+ * Optionally, the unconsumed data is spooled into a temporary file
+ * (created via FileRepository::createTempFile()) as soon as it exceeds
+ * @c spoolThreshold bytes. A spooling input never gets full.
+ */
+class XZERO_HTTP_API HttpStreamingInput : public xzero::HttpInput {
+ public:
+  /**
+   * Initializes the streaming input.
+   *
+   * @param bufferSize number of unconsumed bytes to hold in memory before
+   *                   reads get paused.
+   * @param spool file repository to create temporary spool files with,
+   *              or @c nullptr to never spool.
+   * @param spoolThreshold number of unconsumed bytes to start spooling at.
+   */
+  HttpStreamingInput(size_t bufferSize,
+                     FileRepository* spool = nullptr,
+                     size_t spoolThreshold = 0);
+  ~HttpStreamingInput();
+
+  int read(Buffer* result) override;
+  size_t readLine(Buffer* result) override;
+  void onContent(const BufferRef& chunk) override;
+  bool empty() const noexcept override;
+  bool isFull() const noexcept override;
+
+  void recycle() override;
+
+  /**
+   * Tests whether the unconsumed body data is being spooled to disk.
+   */
+  bool isSpooling() const noexcept { return fd_ >= 0; }
+
+  /**
+   * Retrieves the number of unconsumed bytes held in memory.
+   */
+  size_t bufferedBytes() const noexcept { return content_.size() - offset_; }
+
+ private:
+  void startSpooling();
+  void spool(const BufferRef& chunk);
+  bool fillFromSpool();
+  void consumed(bool wasFull);
+
+ private:
+  size_t bufferSize_;
+  FileRepository* spoolRepository_;
+  size_t spoolThreshold_;
+
+  Buffer content_;
+  size_t offset_;
+
+  int fd_;
+  off_t spoolWritten_;
+  off_t spoolRead_;
+};
+
+}  // namespace xzero
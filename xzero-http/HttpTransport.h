@@ -13,6 +13,7 @@
 #include <xzero-base/CompletionHandler.h>
 #include <xzero-base/Buffer.h>
 #include <memory>
+#include <string>
 
 namespace xzero {
 
@@ -96,6 +97,17 @@ class XZERO_HTTP_API HttpTransport : public Connection {
    * @param onComplete callback invoked when sending chunk is succeed/failed.
    */
   virtual void send(const BufferRef& chunk, CompletionHandler onComplete) = 0;
+
+  /**
+   * Pushes the response to a GET request for @p path to the client on
+   * behalf of the current request (server push), before the client asks
+   * for it.
+   *
+   * @retval true the resource has been promised to the client.
+   * @retval false this transport does not support server push or the
+   *               client does not permit it.
+   */
+  virtual bool push(const std::string& path);
 };
 
 inline HttpTransport::HttpTransport(EndPoint* endpoint,
@@ -103,4 +115,8 @@ inline HttpTransport::HttpTransport(EndPoint* endpoint,
     : Connection(endpoint, executor) {
 }
 
+inline bool HttpTransport::push(const std::string& path) {
+  return false;
+}
+
 }  // namespace xzero2
@@ -8,8 +8,10 @@
 // HTTP/1 transport protocol tests
 
 #include <xzero-http/http1/Http1ConnectionFactory.h>
+#include <xzero-http/http1/HttpConnection.h>
 #include <xzero-http/HttpRequest.h>
 #include <xzero-http/HttpResponse.h>
+#include <xzero-http/HttpInput.h>
 #include <xzero-http/HttpOutput.h>
 #include <xzero-base/executor/DirectExecutor.h>
 #include <xzero-base/logging/LogTarget.h>
@@ -176,3 +178,328 @@ TEST(Http1, protocolErrorShouldRaise400) {
   xzero::Buffer output = ep->output();
   ASSERT_TRUE(output.contains("400 Bad Request"));
 }
+
+// memory-only responses must not toggle TCP_CORK
+TEST(Http1, corking_bufferedResponse) {
+  MOCK_HTTP1_SERVER(server, connector, executor);
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient("GET /one HTTP/1.1\r\nHost: test\r\n\r\n"
+                                 "GET /two HTTP/1.1\r\nHost: test\r\n\r\n");
+  });
+
+  auto http1 = dynamic_cast<xzero::http1::HttpConnection*>(ep->connection());
+  ASSERT_TRUE(http1 != nullptr);
+  ASSERT_TRUE(ep->isTcpNoDelay());
+  ASSERT_FALSE(ep->isCorking());
+  ASSERT_EQ(1, http1->sockoptCount()); // TCP_NODELAY only
+  ASSERT_EQ(0, http1->lastResponseSockoptCount());
+}
+
+// header + file body is corked, and uncorked once flushed
+TEST(Http1, corking_fileResponse) {
+  MOCK_HTTP1_SERVER(server, connector, executor);
+
+  FILE* fp = tmpfile();
+  fputs("hello", fp);
+  fflush(fp);
+
+  http->setHandler([&](HttpRequest* request, HttpResponse* response) {
+    response->setStatus(HttpStatus::Ok);
+    response->setContentLength(5);
+    response->output()->write(FileRef(fileno(fp), 0, 5, false),
+        std::bind(&HttpResponse::completed, response));
+  });
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient("GET / HTTP/1.1\r\nHost: test\r\n\r\n");
+  });
+  fclose(fp);
+
+  auto http1 = dynamic_cast<xzero::http1::HttpConnection*>(ep->connection());
+  ASSERT_TRUE(http1 != nullptr);
+  ASSERT_TRUE(ep->output().contains("\r\n\r\nhello"));
+  ASSERT_FALSE(ep->isCorking());
+  ASSERT_EQ(3, http1->sockoptCount()); // TCP_NODELAY, cork, uncork
+  ASSERT_EQ(3, http1->lastResponseSockoptCount());
+}
+
+TEST(Http1, chunkedResponse) {
+  MOCK_HTTP1_SERVER(server, connector, executor);
+
+  http->setHandler([&](HttpRequest* request, HttpResponse* response) {
+    response->setStatus(HttpStatus::Ok);
+    response->output()->write("Hello, ");
+    response->output()->write(Buffer("World!!!!!!!!!!!!"),
+        std::bind(&HttpResponse::completed, response));
+  });
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient("GET / HTTP/1.1\r\nHost: test\r\n\r\n");
+  });
+
+  ASSERT_TRUE(ep->output().contains("Transfer-Encoding: chunked\r\n"));
+  ASSERT_TRUE(ep->output().contains(
+      "\r\n\r\n7\r\nHello, \r\n11\r\nWorld!!!!!!!!!!!!\r\n0\r\n\r\n"));
+}
+
+// released connections are reused for the next accepted endpoint
+TEST(Http1, connectionPool) {
+  MOCK_HTTP1_SERVER(server, connector, executor);
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient("GET /one HTTP/1.0\r\n"
+                                 "\r\n");
+  });
+  ASSERT_TRUE(ep->output().contains("/one\n"));
+  xzero::Connection* first = ep->connection();
+  ep = nullptr;
+  ASSERT_EQ(1, http->pooledConnections());
+
+  executor.execute([&] {
+    ep = connector->createClient("GET /two HTTP/1.0\r\n"
+                                 "\r\n");
+  });
+  ASSERT_EQ(first, ep->connection());
+  ASSERT_EQ(0, http->pooledConnections());
+  ASSERT_TRUE(ep->output().contains("/two\n"));
+  ASSERT_FALSE(ep->output().contains("/one\n"));
+}
+
+TEST(Http1, connectionPool_disabled) {
+  MOCK_HTTP1_SERVER(server, connector, executor);
+  http->setConnectionPoolSize(0);
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient("GET / HTTP/1.0\r\n"
+                                 "\r\n");
+  });
+  ep = nullptr;
+  ASSERT_EQ(0, http->pooledConnections());
+}
+
+TEST(Http1, earlyHints) {
+  MOCK_HTTP1_SERVER(server, connector, executor);
+
+  http->setHandler([&](HttpRequest* request, HttpResponse* response) {
+    response->pushResources({"/style.css", "/app.js"});
+    response->setStatus(HttpStatus::Ok);
+    response->setContentLength(3);
+    response->output()->write("ok\n",
+        std::bind(&HttpResponse::completed, response));
+  });
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient("GET / HTTP/1.1\r\nHost: test\r\n\r\n");
+  });
+
+  ASSERT_TRUE(ep->output().contains(
+      "HTTP/1.1 103 Early Hints\r\n"
+      "Link: </style.css>; rel=preload; as=style, "
+      "</app.js>; rel=preload; as=script\r\n"
+      "\r\n"
+      "HTTP/1.1 200 Ok\r\n"));
+  ASSERT_TRUE(ep->output().contains("\r\n\r\nok\n"));
+}
+
+TEST(Http1, earlyHints_1_0) {
+  MOCK_HTTP1_SERVER(server, connector, executor);
+
+  http->setHandler([&](HttpRequest* request, HttpResponse* response) {
+    response->pushResource("/style.css");
+    response->setStatus(HttpStatus::Ok);
+    response->completed();
+  });
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient("GET / HTTP/1.0\r\n\r\n");
+  });
+
+  ASSERT_TRUE(ep->output().contains("HTTP/1.0 200 Ok\r\n"));
+  ASSERT_FALSE(ep->output().contains("103"));
+}
+
+// pipelined responses go out in one gathered write, in order
+TEST(Http1, pipelineBatch) {
+  MOCK_HTTP1_SERVER(server, connector, executor);
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient("GET /one HTTP/1.1\r\nHost: test\r\n\r\n"
+                                 "GET /two HTTP/1.1\r\nHost: test\r\n\r\n"
+                                 "GET /three HTTP/1.1\r\nHost: test\r\n\r\n"
+                                 "GET /four HTTP/1.1\r\nHost: test\r\n\r\n");
+  });
+
+  const std::string output = ep->output().str();
+  ASSERT_EQ(1, ep->writeCount());
+  ASSERT_LT(output.find("\r\n\r\n/one\n"), output.find("\r\n\r\n/two\n"));
+  ASSERT_LT(output.find("\r\n\r\n/two\n"), output.find("\r\n\r\n/three\n"));
+  ASSERT_LT(output.find("\r\n\r\n/three\n"), output.find("\r\n\r\n/four\n"));
+  ASSERT_NE(std::string::npos, output.find("\r\n\r\n/four\n"));
+}
+
+// a handler responding asynchronously does not hold back earlier responses
+TEST(Http1, pipelineBatch_asyncHandler) {
+  MOCK_HTTP1_SERVER(server, connector, executor);
+
+  HttpResponse* pending = nullptr;
+  http->setHandler([&](HttpRequest* request, HttpResponse* response) {
+    if (request->path() == "/two") {
+      pending = response;
+      return;
+    }
+    response->setStatus(HttpStatus::Ok);
+    response->setContentLength(request->path().size() + 1);
+    response->output()->write(Buffer(request->path() + "\n"),
+        std::bind(&HttpResponse::completed, response));
+  });
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient("GET /one HTTP/1.1\r\nHost: test\r\n\r\n"
+                                 "GET /two HTTP/1.1\r\nHost: test\r\n\r\n"
+                                 "GET /three HTTP/1.1\r\nHost: test\r\n\r\n"
+                                 "GET /four HTTP/1.1\r\nHost: test\r\n\r\n");
+  });
+
+  ASSERT_TRUE(pending != nullptr);
+  ASSERT_EQ(1, ep->writeCount());
+  ASSERT_TRUE(ep->output().contains("\r\n\r\n/one\n"));
+  ASSERT_FALSE(ep->output().contains("/two\n"));
+  ASSERT_FALSE(ep->output().contains("/three\n"));
+
+  executor.execute([&] {
+    pending->setStatus(HttpStatus::Ok);
+    pending->setContentLength(5);
+    pending->output()->write(Buffer("/two\n"),
+        std::bind(&HttpResponse::completed, pending));
+  });
+
+  // the late response is batched with the remaining ones
+  const std::string output = ep->output().str();
+  ASSERT_EQ(2, ep->writeCount());
+  ASSERT_LT(output.find("\r\n\r\n/one\n"), output.find("\r\n\r\n/two\n"));
+  ASSERT_LT(output.find("\r\n\r\n/two\n"), output.find("\r\n\r\n/three\n"));
+  ASSERT_LT(output.find("\r\n\r\n/three\n"), output.find("\r\n\r\n/four\n"));
+  ASSERT_NE(std::string::npos, output.find("\r\n\r\n/four\n"));
+}
+
+// data of a response still being streamed is not held back
+TEST(Http1, pipelineBatch_streamingResponse) {
+  MOCK_HTTP1_SERVER(server, connector, executor);
+
+  http->setHandler([&](HttpRequest* request, HttpResponse* response) {
+    response->setStatus(HttpStatus::Ok);
+    response->output()->write(Buffer("Hello, "), [response](bool) {
+      response->output()->write(Buffer("World"),
+          std::bind(&HttpResponse::completed, response));
+    });
+  });
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient("GET /one HTTP/1.1\r\nHost: test\r\n\r\n"
+                                 "GET /two HTTP/1.1\r\nHost: test\r\n\r\n");
+  });
+
+  // each chunk as written, the trailer of /one along with the head of /two
+  ASSERT_EQ(5, ep->writeCount());
+  ASSERT_TRUE(ep->output().contains(
+      "\r\n\r\n7\r\nHello, \r\n5\r\nWorld\r\n0\r\n\r\nHTTP/1.1 200 Ok"));
+}
+
+// a batch is flushed once it reaches its byte limit
+TEST(Http1, pipelineBatch_byteLimit) {
+  MOCK_HTTP1_SERVER(server, connector, executor);
+  http->setMaxPipelineBatchBytes(1);
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient("GET /one HTTP/1.1\r\nHost: test\r\n\r\n"
+                                 "GET /two HTTP/1.1\r\nHost: test\r\n\r\n"
+                                 "GET /three HTTP/1.1\r\nHost: test\r\n\r\n");
+  });
+
+  ASSERT_EQ(3, ep->writeCount());
+  ASSERT_TRUE(ep->output().contains("\r\n\r\n/three\n"));
+}
+
+// large referenced bodies are flushed right away rather than copied
+TEST(Http1, pipelineBatch_largeBufferRef) {
+  MOCK_HTTP1_SERVER(server, connector, executor);
+
+  const std::string body(64 * 1024, 'x');
+  http->setHandler([&](HttpRequest* request, HttpResponse* response) {
+    response->setStatus(HttpStatus::Ok);
+    response->setContentLength(body.size());
+    response->output()->write(BufferRef(body.data(), body.size()),
+        std::bind(&HttpResponse::completed, response));
+  });
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient("GET /one HTTP/1.1\r\nHost: test\r\n\r\n"
+                                 "GET /two HTTP/1.1\r\nHost: test\r\n\r\n");
+  });
+
+  ASSERT_EQ(2, ep->writeCount());
+  ASSERT_EQ(2 * body.size() + 2 * ep->output().str().find(body),
+            ep->output().size());
+}
+
+// reading a streamed request body pauses while the handler lags behind, and
+// resumes once it consumed the buffered body data
+TEST(Http1, streamingInput_pauseAndResume) {
+  MOCK_HTTP1_SERVER(server, connector, executor);
+  http->setStreamingInput(4);
+
+  HttpRequest* pendingRequest = nullptr;
+  HttpResponse* pendingResponse = nullptr;
+  http->setHandler([&](HttpRequest* request, HttpResponse* response) {
+    pendingRequest = request;
+    pendingResponse = response;
+  });
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient("POST / HTTP/1.1\r\n"
+                                 "Host: test\r\n"
+                                 "Content-Length: 8\r\n"
+                                 "\r\n"
+                                 "abcd");
+  });
+
+  // the input is full, so the connection must not have tried to read any
+  // further (which would have hit EOF and closed it)
+  ASSERT_TRUE(pendingRequest != nullptr);
+  ASSERT_TRUE(pendingRequest->input()->isFull());
+  ASSERT_EQ(1, connector->connectedEndPoints().size());
+
+  // the rest of the body arrives, but is not read until the handler
+  // consumed what is buffered
+  ep->setInput("efgh");
+
+  Buffer body;
+  executor.execute([&] {
+    pendingRequest->input()->read(&body);
+  });
+  ASSERT_EQ("abcd", body);
+
+  executor.execute([&] {
+    pendingRequest->input()->read(&body);
+    pendingResponse->setStatus(HttpStatus::Ok);
+    pendingResponse->setContentLength(body.size());
+    pendingResponse->output()->write(Buffer(body),
+        std::bind(&HttpResponse::completed, pendingResponse));
+  });
+
+  ASSERT_EQ("abcdefgh", body);
+  ASSERT_TRUE(ep->output().contains("\r\n\r\nabcdefgh"));
+}
@@ -7,11 +7,82 @@
 
 #include <xzero-http/http1/Http1ConnectionFactory.h>
 #include <xzero-http/http1/HttpConnection.h>
+#include <xzero-http/HttpBufferedInput.h>
+#include <xzero-http/HttpStreamingInput.h>
 #include <xzero-base/net/Connector.h>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
 
 namespace xzero {
 namespace http1 {
 
+namespace {
+
+/**
+ * Per-thread free-list of released connections, keyed by the id of the
+ * factory that created them.
+ */
+class ConnectionPool {
+ public:
+  ~ConnectionPool();
+
+  HttpConnection* acquire(unsigned long factoryId);
+  bool release(unsigned long factoryId, size_t maxSize, HttpConnection* c);
+  size_t size(unsigned long factoryId) const;
+  void clear(unsigned long factoryId);
+
+ private:
+  std::unordered_map<unsigned long, std::vector<HttpConnection*>> free_;
+};
+
+ConnectionPool::~ConnectionPool() {
+  for (auto& entry: free_)
+    for (HttpConnection* connection: entry.second)
+      delete connection;
+}
+
+HttpConnection* ConnectionPool::acquire(unsigned long factoryId) {
+  auto i = free_.find(factoryId);
+  if (i == free_.end() || i->second.empty())
+    return nullptr;
+
+  HttpConnection* connection = i->second.back();
+  i->second.pop_back();
+  return connection;
+}
+
+bool ConnectionPool::release(unsigned long factoryId, size_t maxSize,
+                             HttpConnection* connection) {
+  std::vector<HttpConnection*>& list = free_[factoryId];
+  if (list.size() >= maxSize)
+    return false;
+
+  list.push_back(connection);
+  return true;
+}
+
+size_t ConnectionPool::size(unsigned long factoryId) const {
+  auto i = free_.find(factoryId);
+  return i != free_.end() ? i->second.size() : 0;
+}
+
+void ConnectionPool::clear(unsigned long factoryId) {
+  auto i = free_.find(factoryId);
+  if (i == free_.end())
+    return;
+
+  for (HttpConnection* connection: i->second)
+    delete connection;
+
+  free_.erase(i);
+}
+
+thread_local ConnectionPool connectionPool;
+std::atomic<unsigned long> lastFactoryId(0);
+
+} // namespace
+
 Http1ConnectionFactory::Http1ConnectionFactory(
     WallClock* clock,
     size_t maxRequestUriLength,
@@ -20,26 +91,79 @@ Http1ConnectionFactory::Http1ConnectionFactory(
     TimeSpan maxKeepAlive)
     : HttpConnectionFactory("http/1.1", clock, maxRequestUriLength,
                             maxRequestBodyLength),
+      id_(++lastFactoryId),
       maxRequestCount_(maxRequestCount),
-      maxKeepAlive_(maxKeepAlive) {
+      maxKeepAlive_(maxKeepAlive),
+      maxPipelineBatch_(16),
+      maxPipelineBatchBytes_(64 * 1024),
+      streamingInput_(false),
+      streamingBufferSize_(0),
+      inputSpool_(nullptr),
+      inputSpoolThreshold_(0),
+      poolSize_(64) {
   setInputBufferSize(16 * 1024);
 }
 
 Http1ConnectionFactory::~Http1ConnectionFactory() {
+  // connections pooled by other threads are never handed out again, as
+  // factory ids are unique, and get freed once those threads exit.
+  connectionPool.clear(id_);
+}
+
+void Http1ConnectionFactory::setStreamingInput(size_t bufferSize,
+                                               FileRepository* spool,
+                                               size_t spoolThreshold) {
+  streamingInput_ = true;
+  streamingBufferSize_ = bufferSize;
+  inputSpool_ = spool;
+  inputSpoolThreshold_ = spoolThreshold;
+}
+
+std::unique_ptr<HttpInput> Http1ConnectionFactory::createInput() {
+  if (streamingInput_)
+    return std::unique_ptr<HttpInput>(new HttpStreamingInput(
+        streamingBufferSize_, inputSpool_, inputSpoolThreshold_));
+  else
+    return std::unique_ptr<HttpInput>(new HttpBufferedInput());
+}
+
+size_t Http1ConnectionFactory::pooledConnections() const {
+  return connectionPool.size(id_);
 }
 
 Connection* Http1ConnectionFactory::create(Connector* connector,
                                            EndPoint* endpoint) {
-  return configure(new http1::HttpConnection(endpoint,
-                                             connector->executor(),
-                                             handler(),
-                                             dateGenerator(),
-                                             outputCompressor(),
-                                             maxRequestUriLength(),
-                                             maxRequestBodyLength(),
-                                             maxRequestCount(),
-                                             maxKeepAlive()),
-                   connector);
+  HttpConnection* connection = connectionPool.acquire(id_);
+
+  if (connection) {
+    connection->reuse(endpoint, connector->executor());
+    connection->setConnector(connector);
+    return configure(connection, connector);
+  }
+
+  connection = new http1::HttpConnection(endpoint,
+                                         connector->executor(),
+                                         handler(),
+                                         dateGenerator(),
+                                         outputCompressor(),
+                                         maxRequestUriLength(),
+                                         maxRequestBodyLength(),
+                                         maxRequestCount(),
+                                         maxKeepAlive(),
+                                         maxPipelineBatch(),
+                                         maxPipelineBatchBytes(),
+                                         createInput());
+  connection->setConnector(connector);
+
+  if (poolSize_ > 0) {
+    const unsigned long id = id_;
+    const size_t maxSize = poolSize_;
+    connection->setReleaseHandler([id, maxSize](HttpConnection* c) {
+      return connectionPool.release(id, maxSize, c);
+    });
+  }
+
+  return configure(connection, connector);
 }
 
 }  // namespace http1
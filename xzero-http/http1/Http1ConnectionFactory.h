@@ -11,12 +11,22 @@
 #include <xzero-base/sysconfig.h>
 #include <xzero-base/TimeSpan.h>
 #include <xzero-http/HttpConnectionFactory.h>
+#include <memory>
 
 namespace xzero {
+
+class FileRepository;
+class HttpInput;
+
 namespace http1 {
 
 /**
  * Connection factory for HTTP/1 connections.
+ *
+ * Released connections are kept in a per-thread pool of at most
+ * connectionPoolSize() entries and reused for subsequently accepted
+ * endpoints on that thread. Pooled connections keep the settings they were
+ * created with, so configure the factory before accepting connections.
  */
 class XZERO_HTTP_API Http1ConnectionFactory : public HttpConnectionFactory {
  public:
@@ -35,11 +45,70 @@ class XZERO_HTTP_API Http1ConnectionFactory : public HttpConnectionFactory {
   TimeSpan maxKeepAlive() const XZERO_NOEXCEPT { return maxKeepAlive_; }
   void setMaxKeepAlive(TimeSpan value) { maxKeepAlive_ = value; }
 
+  /**
+   * Maximum number of pipelined responses to queue up before flushing them
+   * in one go. A value of 0 flushes each response individually.
+   */
+  size_t maxPipelineBatch() const XZERO_NOEXCEPT { return maxPipelineBatch_; }
+  void setMaxPipelineBatch(size_t value) { maxPipelineBatch_ = value; }
+
+  /**
+   * Number of bytes of queued pipelined responses at which they get flushed
+   * without waiting for further responses.
+   */
+  size_t maxPipelineBatchBytes() const XZERO_NOEXCEPT {
+    return maxPipelineBatchBytes_;
+  }
+  void setMaxPipelineBatchBytes(size_t value) {
+    maxPipelineBatchBytes_ = value;
+  }
+
+  /**
+   * Configures request bodies to be passed on to handlers as they arrive,
+   * instead of being fully buffered in memory.
+   *
+   * @param bufferSize number of unconsumed body bytes to hold in memory
+   *                   before reading from the client is paused.
+   * @param spool file repository to spool unconsumed body data into,
+   *              or @c nullptr to never spool.
+   * @param spoolThreshold number of unconsumed body bytes to start
+   *                       spooling at.
+   *
+   * @see HttpStreamingInput
+   */
+  void setStreamingInput(size_t bufferSize,
+                         FileRepository* spool = nullptr,
+                         size_t spoolThreshold = 0);
+
+  /**
+   * Maximum number of released connections to keep for reuse, per thread.
+   * A value of 0 disables connection pooling.
+   */
+  size_t connectionPoolSize() const XZERO_NOEXCEPT { return poolSize_; }
+  void setConnectionPoolSize(size_t value) { poolSize_ = value; }
+
+  /**
+   * Retrieves the number of connections pooled for reuse by the calling
+   * thread.
+   */
+  size_t pooledConnections() const;
+
   Connection* create(Connector* connector, EndPoint* endpoint) override;
 
  private:
+  std::unique_ptr<HttpInput> createInput();
+
+ private:
+  const unsigned long id_;
   size_t maxRequestCount_;
   TimeSpan maxKeepAlive_;
+  size_t maxPipelineBatch_;
+  size_t maxPipelineBatchBytes_;
+  bool streamingInput_;
+  size_t streamingBufferSize_;
+  FileRepository* inputSpool_;
+  size_t inputSpoolThreshold_;
+  size_t poolSize_;
 };
 
 }  // namespace http1
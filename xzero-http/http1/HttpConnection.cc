@@ -7,13 +7,17 @@
 
 #include <xzero-http/http1/HttpConnection.h>
 #include <xzero-http/http1/Http1Channel.h>
-#include <xzero-http/HttpBufferedInput.h>
+#include <xzero-http/HttpInput.h>
 #include <xzero-http/HttpDateGenerator.h>
 #include <xzero-http/HttpResponseInfo.h>
 #include <xzero-http/HttpResponse.h>
 #include <xzero-http/HttpRequest.h>
 #include <xzero-http/BadMessage.h>
+#include <xzero-http/http2/http2.h>
+#include <xzero-http/http2/Http2Connection.h>
 #include <xzero-base/net/Connection.h>
+#include <xzero-base/net/ConnectionFactory.h>
+#include <xzero-base/net/Connector.h>
 #include <xzero-base/net/EndPoint.h>
 #include <xzero-base/net/EndPointWriter.h>
 #include <xzero-base/executor/Executor.h>
@@ -23,6 +27,8 @@
 #include <xzero-base/sysconfig.h>
 #include <cassert>
 #include <cstdlib>
+#include <cstring>
+#include <algorithm>
 
 namespace xzero {
 namespace http1 {
@@ -35,6 +41,10 @@ namespace http1 {
 #define TRACE(msg...) do {} while (0)
 #endif
 
+// maximum number of referenced body bytes to copy in order to defer a
+// pipelined response, rather than flushing the batch right away
+static const size_t MaxPipelineCopy = 4096;
+
 HttpConnection::HttpConnection(EndPoint* endpoint,
                                Executor* executor,
                                const HttpHandler& handler,
@@ -43,22 +53,37 @@ HttpConnection::HttpConnection(EndPoint* endpoint,
                                size_t maxRequestUriLength,
                                size_t maxRequestBodyLength,
                                size_t maxRequestCount,
-                               TimeSpan maxKeepAlive)
+                               TimeSpan maxKeepAlive,
+                               size_t maxPipelineBatch,
+                               size_t maxPipelineBatchBytes,
+                               std::unique_ptr<HttpInput>&& input)
     : HttpTransport(endpoint, executor),
       parser_(HttpParser::REQUEST),
       inputBuffer_(),
       inputOffset_(0),
+      inputPaused_(false),
       writer_(),
       onComplete_(),
+      responseComplete_(false),
       generator_(dateGenerator, &writer_),
       channel_(new Http1Channel(
-          this, handler, std::unique_ptr<HttpInput>(new HttpBufferedInput()),
+          this, handler, std::move(input),
           maxRequestUriLength, maxRequestBodyLength, outputCompressor)),
       maxKeepAlive_(maxKeepAlive),
       requestCount_(0),
-      requestMax_(maxRequestCount) {
+      requestMax_(maxRequestCount),
+      pipelineBatchMax_(maxPipelineBatch),
+      pipelineBatchBytesMax_(maxPipelineBatchBytes),
+      pipelineBatchSize_(0),
+      sockoptCount_(0),
+      sockoptMark_(0),
+      lastResponseSockoptCount_(0),
+      releaseHandler_(),
+      connector_(nullptr) {
 
   parser_.setListener(channel_.get());
+  channel_->request()->input()->setResumeHandler(
+      std::bind(&HttpConnection::onInputResume, this));
   TRACE("%p ctor", this);
 }
 
@@ -66,10 +91,63 @@ HttpConnection::~HttpConnection() {
   TRACE("%p dtor", this);
 }
 
+void HttpConnection::setReleaseHandler(
+    std::function<bool(HttpConnection*)> handler) {
+  releaseHandler_ = std::move(handler);
+}
+
+void HttpConnection::reuse(EndPoint* endpoint, Executor* executor) {
+  TRACE("%p reuse: endpoint=%p", this, endpoint);
+  reattach(endpoint, executor);
+}
+
+void HttpConnection::release() {
+  if (releaseHandler_ && isReusable()) {
+    TRACE("%p release: recycling", this);
+    resetState();
+    reattach(nullptr, nullptr);
+
+    if (releaseHandler_(this)) {
+      return;
+    }
+  }
+
+  TRACE("%p release: deleting", this);
+  delete this;
+}
+
+bool HttpConnection::isReusable() const {
+  // a request handler might still be working on this connection's
+  // request or response objects otherwise.
+  return !onComplete_ && writer_.empty() &&
+         (channel_->state() == HttpChannelState::READING ||
+          channel_->state() == HttpChannelState::DONE);
+}
+
+void HttpConnection::resetState() {
+  parser_.reset();
+  inputBuffer_.clear();
+  inputOffset_ = 0;
+  inputPaused_ = false;
+  generator_.recycle();
+  channel_->reset();
+  requestCount_ = 0;
+  responseComplete_ = false;
+  pipelineBatchSize_ = 0;
+  sockoptCount_ = 0;
+  sockoptMark_ = 0;
+  lastResponseSockoptCount_ = 0;
+}
+
 void HttpConnection::onOpen() {
   TRACE("%p onOpen", this);
   HttpTransport::onOpen();
 
+  if (!endpoint()->isTcpNoDelay()) {
+    endpoint()->setTcpNoDelay(true);
+    sockoptCount_++;
+  }
+
   // TODO support TCP_DEFER_ACCEPT here
 #if 0
   if (connector()->deferAccept())
@@ -104,25 +182,33 @@ void HttpConnection::completed() {
 
   onComplete_ = std::bind(&HttpConnection::onResponseComplete, this,
                           std::placeholders::_1);
+  responseComplete_ = true;
 
   generator_.generateTrailer(channel_->response()->trailers());
   wantFlush();
 }
 
 void HttpConnection::onResponseComplete(bool succeed) {
+  responseComplete_ = false;
+
   if (!succeed) {
     // writing trailer failed. do not attempt to do anything on the wire.
     return;
   }
 
+  lastResponseSockoptCount_ = sockoptCount_ - sockoptMark_;
+  sockoptMark_ = sockoptCount_;
+
   if (channel_->isPersistent()) {
     TRACE("%p completed.onComplete", this);
     // re-use on keep-alive
     channel_->reset();
 
-    if (endpoint()->isCorking()) {
-      endpoint()->setCorking(false);
-    }
+    if (!writer_.empty())
+      // response got queued into the current pipeline batch
+      pipelineBatchSize_++;
+
+    setCorking(false);
 
     if (inputOffset_ < inputBuffer_.size()) {
       // have some request pipelined
@@ -131,9 +217,12 @@ void HttpConnection::onResponseComplete(bool succeed) {
     } else {
       // wait for next request
       TRACE("%p completed.onComplete: keep-alive read", this);
+      inputBuffer_.clear();
+      inputOffset_ = 0;
       wantFill();
     }
   } else {
+    channel_->setState(HttpChannelState::DONE);
     endpoint()->close();
   }
 }
@@ -151,10 +240,6 @@ void HttpConnection::send(HttpResponseInfo&& responseInfo,
 
   patchResponseInfo(responseInfo);
 
-  const bool corking_ = true;  // TODO(TCP_CORK): part of HttpResponseInfo?
-  if (corking_)
-    endpoint()->setCorking(true);
-
   generator_.generateResponse(responseInfo, chunk);
   onComplete_ = std::move(onComplete);
   wantFlush();
@@ -173,10 +258,6 @@ void HttpConnection::send(HttpResponseInfo&& responseInfo,
 
   patchResponseInfo(responseInfo);
 
-  const bool corking_ = true;  // TODO(TCP_CORK): part of HttpResponseInfo?
-  if (corking_)
-    endpoint()->setCorking(true);
-
   generator_.generateResponse(responseInfo, std::move(chunk));
   onComplete_ = std::move(onComplete);
   wantFlush();
@@ -195,9 +276,8 @@ void HttpConnection::send(HttpResponseInfo&& responseInfo,
 
   patchResponseInfo(responseInfo);
 
-  const bool corking_ = true;  // TODO(TCP_CORK): part of HttpResponseInfo?
-  if (corking_)
-    endpoint()->setCorking(true);
+  // let the response headers go out along with the first file bytes
+  setCorking(true);
 
   generator_.generateResponse(responseInfo, std::move(chunk));
   onComplete_ = std::move(onComplete);
@@ -257,11 +337,23 @@ void HttpConnection::send(FileRef&& chunk, CompletionHandler onComplete) {
 
   TRACE("%p send(FileRef, chunkSize=%zu)", this, chunk.size());
 
+  // data pending ahead of the file (e.g. response headers or chunk framing)
+  // is to be sent along with the first file bytes
+  if (!writer_.empty() || generator_.isChunked())
+    setCorking(true);
+
   generator_.generateBody(std::move(chunk));
   onComplete_ = std::move(onComplete);
   wantFlush();
 }
 
+void HttpConnection::setCorking(bool enable) {
+  if (endpoint()->isCorking() != enable) {
+    endpoint()->setCorking(enable);
+    sockoptCount_++;
+  }
+}
+
 void HttpConnection::setInputBufferSize(size_t size) {
   TRACE("%p setInputBufferSize(%zu)", this, size);
   inputBuffer_.reserve(size);
@@ -278,9 +370,50 @@ void HttpConnection::onFillable() {
     return;
   }
 
+  if (requestCount_ == 0 && inputOffset_ == 0 &&
+      channel_->state() == HttpChannelState::READING) {
+    const size_t n = std::min(inputBuffer_.size(),
+                              http2::ConnectionPrefaceLength);
+
+    if (std::memcmp(inputBuffer_.data(), http2::ConnectionPreface, n) == 0) {
+      if (n < http2::ConnectionPrefaceLength) {
+        wantFill();
+        return;
+      }
+
+      if (switchToHttp2()) {
+        return;
+      }
+    }
+  }
+
   parseFragment();
 }
 
+bool HttpConnection::switchToHttp2() {
+  std::shared_ptr<ConnectionFactory> factory =
+      connector_ ? connector_->connectionFactory("h2c") : nullptr;
+
+  if (!factory)
+    return false;
+
+  TRACE("%p switchToHttp2", this);
+
+  EndPoint* ep = endpoint();
+  ep->detachConnection();
+
+  Connection* connection = factory->create(connector_, ep);
+  if (auto h2 = dynamic_cast<http2::Http2Connection*>(connection))
+    h2->takeInput(inputBuffer_.ref());
+
+  HttpTransport::onClose();
+  connection->onOpen();
+
+  // nothing refers to this connection anymore.
+  release();
+  return true;
+}
+
 void HttpConnection::parseFragment() {
   try {
     TRACE("parseFragment: calling parseFragment (%zu into %zu)",
@@ -292,26 +425,125 @@ void HttpConnection::parseFragment() {
   } catch (const BadMessage& e) {
     TRACE("%p parseFragment: BadMessage caught. %s", this, e.what());
     channel_->response()->sendError(e.httpCode(), e.what());
+    return;
+  }
+
+  if (channel_->state() == HttpChannelState::READING &&
+      !channel_->response()->isCommitted()) {
+    // incomplete request message. flush what is left of the current
+    // pipeline batch before waiting for more input.
+    if (!writer_.empty()) {
+      TRACE("%p parseFragment: flushing pipeline batch", this);
+      onComplete_ = [this](bool succeed) {
+        if (succeed) {
+          wantFill();
+        }
+      };
+      wantFlush();
+    } else {
+      wantFill();
+    }
+  } else {
+    if (parser_.isProcessingBody()) {
+      // request body not yet fully received. the consumed body bytes have
+      // been passed on to the request's input already, so release them here.
+      if (inputOffset_ == inputBuffer_.size()) {
+        inputBuffer_.clear();
+        inputOffset_ = 0;
+      }
+    }
+
+    if (!writer_.empty() && !channel_->response()->isCommitted()) {
+      // the handler did not respond right away, e.g. as it waits for the
+      // request body or works asynchronously, so do not hold back the
+      // pipeline batch any longer. reading the body continues once flushed.
+      TRACE("%p parseFragment: flushing pipeline batch early", this);
+      wantFlush();
+    } else {
+      continueReadingBody();
+    }
   }
 }
 
+void HttpConnection::continueReadingBody() {
+  if (!parser_.isProcessingBody())
+    return;
+
+  if (channel_->request()->input()->isFull()) {
+    TRACE("%p continueReadingBody: input full, pausing reads", this);
+    inputPaused_ = true;
+    return;
+  }
+
+  // with output pending, reading gets re-armed once flushed
+  if (writer_.empty()) {
+    wantFill();
+  }
+}
+
+void HttpConnection::onInputResume() {
+  if (inputPaused_) {
+    TRACE("%p onInputResume", this);
+    inputPaused_ = false;
+    continueReadingBody();
+  }
+}
+
+bool HttpConnection::isPipelineDeferrable() {
+  // only fully generated responses may wait, as a handler streaming its
+  // response might wait for what it has written so far to be flushed.
+  const bool generated =
+      responseComplete_ ||
+      (channel_->response()->isCommitted() && !generator_.isChunked() &&
+       generator_.pendingContentLength() == 0);
+
+  return generated &&
+         pipelineBatchSize_ < pipelineBatchMax_ &&
+         inputOffset_ < inputBuffer_.size() &&
+         channel_->isPersistent() &&
+         writer_.size() < pipelineBatchBytesMax_ &&
+         writer_.detach(MaxPipelineCopy);
+}
+
 void HttpConnection::onFlushable() {
   TRACE("%p onFlushable", this);
 
   if (channel_->state() != HttpChannelState::SENDING)
     channel_->setState(HttpChannelState::SENDING);
 
+  if (isPipelineDeferrable()) {
+    // more requests are pipelined, so just queue up this response's data
+    // and let it go out with the batch.
+    TRACE("%p onFlushable: deferring flush (batch size %zu)",
+          this, pipelineBatchSize_);
+    channel_->setState(HttpChannelState::HANDLING);
+
+    if (onComplete_) {
+      auto callback = std::move(onComplete_);
+      callback(true);
+    }
+    return;
+  }
+
   const bool complete = writer_.flush(endpoint());
 
   if (complete) {
     TRACE("%p onFlushable: completed.", this);
     channel_->setState(HttpChannelState::HANDLING);
+    pipelineBatchSize_ = 0;
+
+    // everything is handed over to the kernel, so push it onto the wire
+    setCorking(false);
 
     if (onComplete_) {
       TRACE("%p onFlushable: invoking completion callback", this);
       auto callback = std::move(onComplete_);
       callback(true);
     }
+
+    if (endpoint()->isOpen() && !inputPaused_) {
+      continueReadingBody();
+    }
   } else {
     // continue flushing as we still have data pending
     wantFlush();
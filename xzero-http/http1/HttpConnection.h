@@ -19,7 +19,9 @@
 
 namespace xzero {
 
+class Connector;
 class HttpDateGenerator;
+class HttpInput;
 class HttpOutputCompressor;
 
 namespace http1 {
@@ -28,6 +30,31 @@ class Http1Channel;
 
 /**
  * @brief Implements a HTTP/1.1 transport connection.
+ *
+ * Pipelined requests are handled one after another, strictly in order.
+ * Completed responses to pipelined requests are not flushed individually
+ * but queued up until the last request of the received batch has been
+ * handled, and then flushed at once. A batch is flushed early once it
+ * holds @c maxPipelineBatch responses or @c maxPipelineBatchBytes bytes,
+ * or when a response refers to more body data than is worth copying.
+ *
+ * @c TCP_NODELAY is enabled once per connection. @c TCP_CORK is only used
+ * when in-memory data (response headers or chunk framing) is to be followed
+ * by a file body, and released as soon as the pending output is flushed.
+ * Responses fully held in memory go out in one gathered write and need no
+ * corking at all.
+ *
+ * Request body data is read as it arrives and passed on to the request's
+ * HttpInput. Reading is paused while that input reports itself full.
+ *
+ * Once its endpoint is gone, an idle connection may be handed over to a
+ * release handler (see setReleaseHandler()) to be reused for another
+ * endpoint via reuse(), keeping its channel, request, response, parser and
+ * buffers allocated.
+ *
+ * A connection that starts with the HTTP/2 connection preface is handed over
+ * to the @c "h2c" connection factory of its connector, if there is one
+ * (HTTP/2 with prior knowledge).
  */
 class XZERO_HTTP_API HttpConnection : public HttpTransport {
  public:
@@ -39,7 +66,10 @@ class XZERO_HTTP_API HttpConnection : public HttpTransport {
                  size_t maxRequestUriLength,
                  size_t maxRequestBodyLength,
                  size_t maxRequestCount,
-                 TimeSpan maxKeepAlive);
+                 TimeSpan maxKeepAlive,
+                 size_t maxPipelineBatch,
+                 size_t maxPipelineBatchBytes,
+                 std::unique_ptr<HttpInput>&& input);
   ~HttpConnection();
 
   void onOpen() override;
@@ -61,28 +91,81 @@ class XZERO_HTTP_API HttpConnection : public HttpTransport {
 
   void setInputBufferSize(size_t size) override;
 
+  /**
+   * Installs a handler that may take over this connection upon release().
+   *
+   * The handler returns @c true if it keeps the (detached and reset)
+   * connection for later reuse, or @c false to have it deleted.
+   */
+  void setReleaseHandler(std::function<bool(HttpConnection*)> handler);
+
+  /**
+   * Rebinds a previously released connection to a new @p endpoint.
+   */
+  void reuse(EndPoint* endpoint, Executor* executor);
+
+  void release() override;
+
+  /**
+   * Sets the connector this connection has been accepted by, used to look up
+   * the connection factory to switch protocols to.
+   */
+  void setConnector(Connector* connector) { connector_ = connector; }
+
+  /**
+   * Retrieves the number of socket option changes (@c TCP_CORK,
+   * @c TCP_NODELAY) issued for the last completed response, including
+   * connection setup for the first one.
+   */
+  size_t lastResponseSockoptCount() const XZERO_NOEXCEPT {
+    return lastResponseSockoptCount_;
+  }
+
+  /**
+   * Retrieves the total number of socket option changes issued on this
+   * connection.
+   */
+  size_t sockoptCount() const XZERO_NOEXCEPT { return sockoptCount_; }
+
  private:
   void patchResponseInfo(HttpResponseInfo& info);
   void onFillable() override;
+  bool switchToHttp2();
   void parseFragment();
   void onFlushable() override;
   void onInterestFailure(const std::exception& error) override;
   void onResponseComplete(bool succeed);
+  bool isPipelineDeferrable();
+  void setCorking(bool enable);
+  void continueReadingBody();
+  void onInputResume();
+  bool isReusable() const;
+  void resetState();
 
  private:
   HttpParser parser_;
 
   Buffer inputBuffer_;
   size_t inputOffset_;
+  bool inputPaused_;
 
   EndPointWriter writer_;
   CompletionHandler onComplete_;
+  bool responseComplete_;
   HttpGenerator generator_;
 
   std::unique_ptr<Http1Channel> channel_;
   TimeSpan maxKeepAlive_;
   size_t requestCount_;
   size_t requestMax_;
+  size_t pipelineBatchMax_;
+  size_t pipelineBatchBytesMax_;
+  size_t pipelineBatchSize_;
+  size_t sockoptCount_;
+  size_t sockoptMark_;
+  size_t lastResponseSockoptCount_;
+  std::function<bool(HttpConnection*)> releaseHandler_;
+  Connector* connector_;
 };
 
 }  // namespace http1
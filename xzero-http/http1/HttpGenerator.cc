@@ -78,20 +78,50 @@ void HttpGenerator::generateResponseInfo(const HttpResponseInfo& info) {
 
     generateHeaders(info);
   } else {
+    // informational responses carry header fields but no message body
+    for (const HeaderField& header: info.headers()) {
+      buffer_.push_back(header.name());
+      buffer_.push_back(": ");
+      buffer_.push_back(header.value());
+      buffer_.push_back("\r\n");
+    }
     buffer_.push_back("\r\n");
   }
 
   flushBuffer();
 }
 
+/**
+ * Formats the chunk header line for a chunk of @p size bytes into @p buf.
+ *
+ * @param buf output buffer of at least 2 * sizeof(size_t) + 2 bytes.
+ * @return number of bytes written to @p buf.
+ */
+static size_t formatChunkHeader(char* buf, size_t size) {
+  static const char hex[] = "0123456789abcdef";
+  char digits[2 * sizeof(size_t)];
+  size_t n = 0;
+
+  do {
+    digits[n++] = hex[size & 0x0f];
+    size >>= 4;
+  } while (size != 0);
+
+  for (size_t i = 0; i < n; ++i)
+    buf[i] = digits[n - i - 1];
+
+  buf[n++] = '\r';
+  buf[n++] = '\n';
+
+  return n;
+}
+
 void HttpGenerator::generateBody(const BufferRef& chunk) {
   if (chunked_) {
     if (chunk.size() > 0) {
-      Buffer buf(12);
-      buf.printf("%zx\r\n", chunk.size());
-      writer_->write(std::move(buf));
-      writer_->write(chunk);
-      writer_->write(BufferRef("\r\n"));
+      char buf[2 * sizeof(size_t) + 2];
+      size_t n = formatChunkHeader(buf, chunk.size());
+      writer_->write(BufferRef(buf, n), chunk, BufferRef("\r\n"));
     }
   } else {
     if (chunk.size() <= contentLength_) {
@@ -120,11 +150,9 @@ void HttpGenerator::generateTrailer(const HeaderFieldList& trailers) {
 void HttpGenerator::generateBody(Buffer&& chunk) {
   if (chunked_) {
     if (chunk.size() > 0) {
-      Buffer buf(12);
-      buf.printf("%zx\r\n", chunk.size());
-      writer_->write(std::move(buf));
-      writer_->write(std::move(chunk));
-      writer_->write(BufferRef("\r\n"));
+      char buf[2 * sizeof(size_t) + 2];
+      size_t n = formatChunkHeader(buf, chunk.size());
+      writer_->write(BufferRef(buf, n), std::move(chunk), BufferRef("\r\n"));
     }
   } else {
     if (chunk.size() <= contentLength_) {
@@ -138,12 +166,10 @@ void HttpGenerator::generateBody(Buffer&& chunk) {
 
 void HttpGenerator::generateBody(FileRef&& chunk) {
   if (chunked_) {
-    int n;
-    char buf[12];
-
     if (chunk.size() > 0) {
-      n = snprintf(buf, sizeof(buf), "%zx\r\n", chunk.size());
-      writer_->write(BufferRef(buf, static_cast<size_t>(n)));
+      char buf[2 * sizeof(size_t) + 2];
+      size_t n = formatChunkHeader(buf, chunk.size());
+      writer_->copy(BufferRef(buf, n));
       writer_->write(std::move(chunk));
       writer_->write(BufferRef("\r\n"));
     }
@@ -138,7 +138,7 @@ std::string to_string(HttpParser::State state) {
   return "UNKNOWN";
 }
 
-inline bool HttpParser::isProcessingHeader() const {
+bool HttpParser::isProcessingHeader() const {
   // XXX should we include request-line and status-line here, too?
   switch (state_) {
     case HEADER_NAME_BEGIN:
@@ -155,7 +155,7 @@ inline bool HttpParser::isProcessingHeader() const {
   }
 }
 
-inline bool HttpParser::isProcessingBody() const {
+bool HttpParser::isProcessingBody() const {
   switch (state_) {
     case CONTENT_BEGIN:
     case CONTENT:
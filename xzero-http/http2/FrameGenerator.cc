@@ -0,0 +1,229 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#include <xzero-http/http2/FrameGenerator.h>
+#include <xzero-base/net/EndPointWriter.h>
+#include <xzero-base/io/FileRef.h>
+#include <algorithm>
+
+namespace xzero {
+namespace http2 {
+
+FrameGenerator::FrameGenerator(EndPointWriter* writer)
+    : writer_(writer),
+      maxFrameSize_(DefaultMaxFrameSize) {
+}
+
+void FrameGenerator::generateData(unsigned streamID, Buffer&& data,
+                                  bool last) {
+  if (data.size() <= maxFrameSize_) {
+    char header[FrameHeaderSize];
+    FrameHeader::encode(header, data.size(), FrameType::DATA,
+                        last ? DataFrame::END_STREAM : 0, streamID);
+    writer_->write(BufferRef(header, sizeof(header)), std::move(data),
+                   BufferRef());
+    return;
+  }
+
+  size_t offset = 0;
+  do {
+    const size_t n = std::min(data.size() - offset, maxFrameSize_);
+    const bool end = offset + n == data.size();
+
+    char header[FrameHeaderSize];
+    FrameHeader::encode(header, n, FrameType::DATA,
+                        end && last ? DataFrame::END_STREAM : 0, streamID);
+    writer_->write(BufferRef(header, sizeof(header)),
+                   Buffer(data.ref(offset, n)), BufferRef());
+    offset += n;
+  } while (offset < data.size());
+}
+
+void FrameGenerator::generateData(unsigned streamID, const BufferRef& data,
+                                  bool last) {
+  size_t offset = 0;
+  do {
+    const size_t n = std::min(data.size() - offset, maxFrameSize_);
+    const bool end = offset + n == data.size();
+
+    char header[FrameHeaderSize];
+    FrameHeader::encode(header, n, FrameType::DATA,
+                        end && last ? DataFrame::END_STREAM : 0, streamID);
+    writer_->write(BufferRef(header, sizeof(header)), data.ref(offset, n),
+                   BufferRef());
+    offset += n;
+  } while (offset < data.size());
+}
+
+void FrameGenerator::generateData(unsigned streamID, FileRef&& file,
+                                  bool last) {
+  const size_t total = file.size();
+  const off_t start = file.offset();
+  size_t offset = 0;
+  do {
+    const size_t n = std::min(total - offset, maxFrameSize_);
+    const bool end = offset + n == total;
+
+    char header[FrameHeaderSize];
+    FrameHeader::encode(header, n, FrameType::DATA,
+                        end && last ? DataFrame::END_STREAM : 0, streamID);
+    writer_->write(Buffer(BufferRef(header, sizeof(header))));
+
+    if (end) {
+      file.setOffset(start + offset);
+      file.setSize(n);
+      writer_->write(std::move(file));
+    } else {
+      writer_->write(FileRef(file.handle(), start + offset, n, false));
+    }
+    offset += n;
+  } while (offset < total);
+}
+
+void FrameGenerator::generateHeaders(unsigned streamID,
+                                     const BufferRef& headerBlock,
+                                     bool last) {
+  generateHeaderBlock(FrameType::HEADERS,
+                      last ? HeadersFrame::END_STREAM : 0,
+                      streamID, BufferRef(), headerBlock);
+}
+
+void FrameGenerator::generateHeaders(unsigned streamID, Buffer&& headerBlock,
+                                     bool last) {
+  if (headerBlock.size() > maxFrameSize_) {
+    generateHeaders(streamID, headerBlock.ref(), last);
+    return;
+  }
+
+  char header[FrameHeaderSize];
+  FrameHeader::encode(header, headerBlock.size(), FrameType::HEADERS,
+                      HeadersFrame::END_HEADERS |
+                          (last ? HeadersFrame::END_STREAM : 0),
+                      streamID);
+  writer_->write(BufferRef(header, sizeof(header)), std::move(headerBlock),
+                 BufferRef());
+}
+
+void FrameGenerator::generatePriority(unsigned streamID, bool exclusive,
+                                      unsigned dependencyStreamID,
+                                      unsigned weight) {
+  char payload[5];
+  encodeUInt32(payload, (dependencyStreamID & 0x7fffffff) |
+                        (exclusive ? 0x80000000 : 0));
+  payload[4] = static_cast<char>(weight - 1);
+
+  generateFrame(FrameType::PRIORITY, 0, streamID,
+                BufferRef(payload, sizeof(payload)));
+}
+
+void FrameGenerator::generateResetStream(unsigned streamID,
+                                         ErrorCode errorCode) {
+  char payload[4];
+  encodeUInt32(payload, static_cast<uint32_t>(errorCode));
+
+  generateFrame(FrameType::RST_STREAM, 0, streamID,
+                BufferRef(payload, sizeof(payload)));
+}
+
+void FrameGenerator::generateSettings(
+    const std::vector<std::pair<SettingsParameter, uint32_t>>& params) {
+  Buffer payload(params.size() * 6);
+
+  for (const auto& param: params) {
+    const unsigned id = static_cast<unsigned>(param.first);
+    char value[4];
+    encodeUInt32(value, param.second);
+
+    payload.push_back(static_cast<char>((id >> 8) & 0xff));
+    payload.push_back(static_cast<char>(id & 0xff));
+    payload.push_back(value, sizeof(value));
+  }
+
+  generateFrame(FrameType::SETTINGS, 0, 0, payload.ref());
+}
+
+void FrameGenerator::generateSettingsAck() {
+  generateFrame(FrameType::SETTINGS, SettingsFrame::ACK, 0, BufferRef());
+}
+
+void FrameGenerator::generatePushPromise(unsigned streamID,
+                                         unsigned promisedStreamID,
+                                         const BufferRef& headerBlock) {
+  char promised[4];
+  encodeUInt32(promised, promisedStreamID & 0x7fffffff);
+
+  generateHeaderBlock(FrameType::PUSH_PROMISE, 0, streamID,
+                      BufferRef(promised, sizeof(promised)), headerBlock);
+}
+
+void FrameGenerator::generatePing(const BufferRef& data, bool ack) {
+  generateFrame(FrameType::PING, ack ? PingFrame::ACK : 0, 0, data);
+}
+
+void FrameGenerator::generateGoAway(unsigned lastStreamID,
+                                    ErrorCode errorCode,
+                                    const BufferRef& debugData) {
+  Buffer payload(8 + debugData.size());
+  char fields[8];
+  encodeUInt32(fields, lastStreamID & 0x7fffffff);
+  encodeUInt32(fields + 4, static_cast<uint32_t>(errorCode));
+  payload.push_back(fields, sizeof(fields));
+  payload.push_back(debugData);
+
+  generateFrame(FrameType::GOAWAY, 0, 0, payload.ref());
+}
+
+void FrameGenerator::generateWindowUpdate(unsigned streamID,
+                                          size_t increment) {
+  char payload[4];
+  encodeUInt32(payload, increment & 0x7fffffff);
+
+  generateFrame(FrameType::WINDOW_UPDATE, 0, streamID,
+                BufferRef(payload, sizeof(payload)));
+}
+
+void FrameGenerator::generateHeaderBlock(FrameType type, unsigned flags,
+                                         unsigned streamID,
+                                         const BufferRef& prefix,
+                                         const BufferRef& headerBlock) {
+  // both, HEADERS and PUSH_PROMISE, use the same END_HEADERS flag value
+  const size_t first = std::min(headerBlock.size(),
+                                maxFrameSize_ - prefix.size());
+  const bool complete = first == headerBlock.size();
+
+  Buffer frame(FrameHeaderSize + prefix.size() + first);
+  frame.resize(FrameHeaderSize);
+  FrameHeader::encode(frame.data(), prefix.size() + first, type,
+                      flags | (complete ? HeadersFrame::END_HEADERS : 0),
+                      streamID);
+  frame.push_back(prefix);
+  frame.push_back(headerBlock.ref(0, first));
+  writer_->write(std::move(frame));
+
+  for (size_t offset = first; offset < headerBlock.size(); ) {
+    const size_t n = std::min(headerBlock.size() - offset, maxFrameSize_);
+    const bool end = offset + n == headerBlock.size();
+
+    generateFrame(FrameType::CONTINUATION,
+                  end ? ContinuationFrame::END_HEADERS : 0,
+                  streamID, headerBlock.ref(offset, n));
+    offset += n;
+  }
+}
+
+void FrameGenerator::generateFrame(FrameType type, unsigned flags,
+                                   unsigned streamID,
+                                   const BufferRef& payload) {
+  Buffer frame(FrameHeaderSize + payload.size());
+  frame.resize(FrameHeaderSize);
+  FrameHeader::encode(frame.data(), payload.size(), type, flags, streamID);
+  frame.push_back(payload);
+  writer_->write(std::move(frame));
+}
+
+}  // namespace http2
+}  // namespace xzero
@@ -0,0 +1,93 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <xzero-http/Api.h>
+#include <xzero-http/http2/http2.h>
+#include <xzero-base/Buffer.h>
+#include <utility>
+#include <vector>
+
+namespace xzero {
+
+class EndPointWriter;
+class FileRef;
+
+namespace http2 {
+
+/**
+ * Generates HTTP/2 frames into an EndPointWriter.
+ *
+ * DATA payloads and header blocks larger than maxFrameSize() are split
+ * into multiple frames (DATA, or HEADERS followed by CONTINUATION frames).
+ * Flow control is up to the caller.
+ */
+class XZERO_HTTP_API FrameGenerator {
+ public:
+  explicit FrameGenerator(EndPointWriter* writer);
+
+  /**
+   * Maximum payload size of outgoing frames (the peer's
+   * @c SETTINGS_MAX_FRAME_SIZE).
+   */
+  size_t maxFrameSize() const XZERO_NOEXCEPT { return maxFrameSize_; }
+  void setMaxFrameSize(size_t value) { maxFrameSize_ = value; }
+
+  void generateData(unsigned streamID, Buffer&& data, bool last);
+
+  /**
+   * Generates DATA frames referencing @p data.
+   *
+   * @note @p data must remain valid until the writer has been flushed.
+   */
+  void generateData(unsigned streamID, const BufferRef& data, bool last);
+
+  /**
+   * Generates DATA frames carrying the contents of @p file, to be sent
+   * via sendfile.
+   *
+   * The last frame takes over @p file itself, the others refer to its file
+   * descriptor without owning it.
+   */
+  void generateData(unsigned streamID, FileRef&& file, bool last);
+
+  void generateHeaders(unsigned streamID, const BufferRef& headerBlock,
+                       bool last);
+
+  /**
+   * Generates a HEADERS frame, passing on @p headerBlock without copying it
+   * if it fits into a single frame.
+   */
+  void generateHeaders(unsigned streamID, Buffer&& headerBlock, bool last);
+  void generatePriority(unsigned streamID, bool exclusive,
+                        unsigned dependencyStreamID, unsigned weight);
+  void generateResetStream(unsigned streamID, ErrorCode errorCode);
+  void generateSettings(
+      const std::vector<std::pair<SettingsParameter, uint32_t>>& params);
+  void generateSettingsAck();
+  void generatePushPromise(unsigned streamID, unsigned promisedStreamID,
+                           const BufferRef& headerBlock);
+  void generatePing(const BufferRef& data, bool ack);
+  void generateGoAway(unsigned lastStreamID, ErrorCode errorCode,
+                      const BufferRef& debugData);
+  void generateWindowUpdate(unsigned streamID, size_t increment);
+
+ private:
+  void generateHeaderBlock(FrameType type, unsigned flags, unsigned streamID,
+                           const BufferRef& prefix,
+                           const BufferRef& headerBlock);
+  void generateFrame(FrameType type, unsigned flags, unsigned streamID,
+                     const BufferRef& payload);
+
+ private:
+  EndPointWriter* writer_;
+  size_t maxFrameSize_;
+};
+
+}  // namespace http2
+}  // namespace xzero
@@ -0,0 +1,102 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <xzero-http/Api.h>
+#include <xzero-http/http2/http2.h>
+#include <xzero-base/Buffer.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace xzero {
+namespace http2 {
+
+/**
+ * HTTP/2 frame observer.
+ *
+ * The interface methods get invoked by the FrameParser for every
+ * fully received frame.
+ *
+ * @see FrameParser
+ */
+class XZERO_HTTP_API FrameListener {
+ public:
+  virtual ~FrameListener() {}
+
+  /**
+   * DATA frame, with any padding already stripped off.
+   *
+   * @param streamID stream the data belongs to.
+   * @param data the data payload.
+   * @param flowControlled number of bytes accounted to flow control,
+   *                       including padding.
+   * @param last whether this is the last frame of the stream (END_STREAM).
+   */
+  virtual void onData(unsigned streamID, const BufferRef& data,
+                      size_t flowControlled, bool last) = 0;
+
+  /**
+   * Complete header block, assembled from a HEADERS frame and any
+   * CONTINUATION frames following it.
+   *
+   * @param streamID stream the header block belongs to.
+   * @param headerBlock HPACK encoded header block.
+   * @param last whether the stream ends with this header block (END_STREAM).
+   */
+  virtual void onHeaders(unsigned streamID, const BufferRef& headerBlock,
+                         bool last) = 0;
+
+  /**
+   * Stream priority information, given via a PRIORITY frame or
+   * a HEADERS frame with the PRIORITY flag set.
+   */
+  virtual void onPriority(unsigned streamID, bool exclusive,
+                          unsigned dependencyStreamID, unsigned weight) = 0;
+
+  /** RST_STREAM frame. */
+  virtual void onResetStream(unsigned streamID, ErrorCode errorCode) = 0;
+
+  /** SETTINGS frame (without ACK flag). */
+  virtual void onSettings(
+      const std::vector<std::pair<SettingsParameter, uint32_t>>& params) = 0;
+
+  /** SETTINGS frame with ACK flag. */
+  virtual void onSettingsAck() = 0;
+
+  /**
+   * Complete PUSH_PROMISE header block, assembled the same way as onHeaders().
+   */
+  virtual void onPushPromise(unsigned streamID, unsigned promisedStreamID,
+                             const BufferRef& headerBlock) = 0;
+
+  /** PING frame, with ACK flag set or not. */
+  virtual void onPing(const BufferRef& data, bool ack) = 0;
+
+  /** GOAWAY frame. */
+  virtual void onGoAway(unsigned lastStreamID, ErrorCode errorCode,
+                        const BufferRef& debugData) = 0;
+
+  /** WINDOW_UPDATE frame. */
+  virtual void onWindowUpdate(unsigned streamID, size_t increment) = 0;
+
+  /**
+   * Invoked on any error that renders the whole connection unusable.
+   */
+  virtual void onConnectionError(ErrorCode errorCode,
+                                 const std::string& message) = 0;
+
+  /**
+   * Invoked on any error that only affects the given stream.
+   */
+  virtual void onStreamError(unsigned streamID, ErrorCode errorCode,
+                             const std::string& message) = 0;
+};
+
+}  // namespace http2
+}  // namespace xzero
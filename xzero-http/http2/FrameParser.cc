@@ -0,0 +1,405 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#include <xzero-http/http2/FrameParser.h>
+#include <xzero-http/http2/FrameListener.h>
+#include <xzero-base/logging.h>
+#include <utility>
+#include <vector>
+
+namespace xzero {
+namespace http2 {
+
+#ifndef NDEBUG
+#define TRACE(msg...) logTrace("http2.FrameParser", msg)
+#else
+#define TRACE(msg...) do {} while (0)
+#endif
+
+FrameParser::FrameParser(FrameListener* listener)
+    : listener_(listener),
+      maxFrameSize_(DefaultMaxFrameSize),
+      maxHeaderBlockSize_(DefaultMaxHeaderListSize),
+      failed_(false),
+      headerBlockType_(FrameType::HEADERS),
+      headerBlockStreamID_(0),
+      promisedStreamID_(0),
+      headerBlockEndStream_(false),
+      headerBlockPending_(false),
+      headerBlock_() {
+}
+
+size_t FrameParser::parseFragment(const BufferRef& chunk) {
+  size_t offset = 0;
+
+  while (!failed_ && chunk.size() - offset >= FrameHeaderSize) {
+    FrameHeader header = FrameHeader::decode(chunk.data() + offset);
+
+    if (header.length > maxFrameSize_) {
+      connectionError(ErrorCode::FrameSizeError, "Frame too large.");
+      break;
+    }
+
+    if (chunk.size() - offset < FrameHeaderSize + header.length)
+      break;
+
+    BufferRef payload = chunk.ref(offset + FrameHeaderSize, header.length);
+    offset += FrameHeaderSize + header.length;
+
+    parseFrame(header, payload);
+  }
+
+  return offset;
+}
+
+void FrameParser::parseFrame(const FrameHeader& header,
+                             const BufferRef& payload) {
+  TRACE("parseFrame: %s, length=%zu, flags=0x%02x, stream=%u",
+        to_string(header.type).c_str(), header.length, header.flags,
+        header.streamID);
+
+  if (headerBlockPending_ && header.type != FrameType::CONTINUATION) {
+    connectionError(ErrorCode::ProtocolError,
+                    "Expected CONTINUATION frame.");
+    return;
+  }
+
+  switch (header.type) {
+    case FrameType::DATA:
+      parseData(header, payload);
+      break;
+    case FrameType::HEADERS:
+      parseHeaders(header, payload);
+      break;
+    case FrameType::PRIORITY:
+      parsePriority(header, payload);
+      break;
+    case FrameType::RST_STREAM:
+      parseResetStream(header, payload);
+      break;
+    case FrameType::SETTINGS:
+      parseSettings(header, payload);
+      break;
+    case FrameType::PUSH_PROMISE:
+      parsePushPromise(header, payload);
+      break;
+    case FrameType::PING:
+      parsePing(header, payload);
+      break;
+    case FrameType::GOAWAY:
+      parseGoAway(header, payload);
+      break;
+    case FrameType::WINDOW_UPDATE:
+      parseWindowUpdate(header, payload);
+      break;
+    case FrameType::CONTINUATION:
+      parseContinuation(header, payload);
+      break;
+    default:
+      // rfc7540, Section 4.1: unknown frame types must be ignored
+      break;
+  }
+}
+
+bool FrameParser::stripPadding(const FrameHeader& header, BufferRef* payload) {
+  if (payload->empty()) {
+    connectionError(ErrorCode::FrameSizeError, "Missing pad length.");
+    return false;
+  }
+
+  const size_t padLength = static_cast<uint8_t>((*payload)[0]);
+  if (padLength >= payload->size()) {
+    connectionError(ErrorCode::ProtocolError, "Padding too large.");
+    return false;
+  }
+
+  *payload = payload->ref(1, payload->size() - 1 - padLength);
+  return true;
+}
+
+void FrameParser::parseData(const FrameHeader& header, const BufferRef& frame) {
+  if (header.streamID == 0) {
+    connectionError(ErrorCode::ProtocolError, "DATA frame on stream 0.");
+    return;
+  }
+
+  BufferRef payload = frame;
+  if ((header.flags & DataFrame::PADDED) && !stripPadding(header, &payload))
+    return;
+
+  listener_->onData(header.streamID, payload, header.length,
+                    header.flags & DataFrame::END_STREAM);
+}
+
+void FrameParser::parseHeaders(const FrameHeader& header,
+                               const BufferRef& frame) {
+  if (header.streamID == 0) {
+    connectionError(ErrorCode::ProtocolError, "HEADERS frame on stream 0.");
+    return;
+  }
+
+  BufferRef payload = frame;
+  if ((header.flags & HeadersFrame::PADDED) && !stripPadding(header, &payload))
+    return;
+
+  if (header.flags & HeadersFrame::PRIORITY) {
+    if (payload.size() < 5) {
+      connectionError(ErrorCode::FrameSizeError, "HEADERS frame too small.");
+      return;
+    }
+
+    const uint32_t dependency = decodeUInt32(payload.data());
+    const unsigned weight = static_cast<uint8_t>(payload[4]) + 1;
+    payload = payload.ref(5);
+
+    listener_->onPriority(header.streamID, dependency & 0x80000000,
+                          dependency & 0x7fffffff, weight);
+  }
+
+  headerBlockType_ = FrameType::HEADERS;
+  headerBlockStreamID_ = header.streamID;
+  headerBlockEndStream_ = header.flags & HeadersFrame::END_STREAM;
+  headerBlock_.clear();
+  if (!appendHeaderBlock(payload))
+    return;
+
+  if (header.flags & HeadersFrame::END_HEADERS)
+    headerBlockEnd();
+  else
+    headerBlockPending_ = true;
+}
+
+void FrameParser::parsePriority(const FrameHeader& header,
+                                const BufferRef& payload) {
+  if (header.streamID == 0) {
+    connectionError(ErrorCode::ProtocolError, "PRIORITY frame on stream 0.");
+    return;
+  }
+
+  if (payload.size() != 5) {
+    listener_->onStreamError(header.streamID, ErrorCode::FrameSizeError,
+                             "Invalid PRIORITY frame size.");
+    return;
+  }
+
+  const uint32_t dependency = decodeUInt32(payload.data());
+  const unsigned weight = static_cast<uint8_t>(payload[4]) + 1;
+
+  listener_->onPriority(header.streamID, dependency & 0x80000000,
+                        dependency & 0x7fffffff, weight);
+}
+
+void FrameParser::parseResetStream(const FrameHeader& header,
+                                   const BufferRef& payload) {
+  if (header.streamID == 0) {
+    connectionError(ErrorCode::ProtocolError, "RST_STREAM frame on stream 0.");
+    return;
+  }
+
+  if (payload.size() != 4) {
+    connectionError(ErrorCode::FrameSizeError,
+                    "Invalid RST_STREAM frame size.");
+    return;
+  }
+
+  listener_->onResetStream(
+      header.streamID, static_cast<ErrorCode>(decodeUInt32(payload.data())));
+}
+
+void FrameParser::parseSettings(const FrameHeader& header,
+                                const BufferRef& payload) {
+  if (header.streamID != 0) {
+    connectionError(ErrorCode::ProtocolError, "SETTINGS frame on a stream.");
+    return;
+  }
+
+  if (header.flags & SettingsFrame::ACK) {
+    if (payload.size() != 0) {
+      connectionError(ErrorCode::FrameSizeError,
+                      "SETTINGS acknowledgement with payload.");
+      return;
+    }
+
+    listener_->onSettingsAck();
+    return;
+  }
+
+  if (payload.size() % 6 != 0) {
+    connectionError(ErrorCode::FrameSizeError, "Invalid SETTINGS frame size.");
+    return;
+  }
+
+  std::vector<std::pair<SettingsParameter, uint32_t>> params;
+
+  for (size_t i = 0; i < payload.size(); i += 6) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(payload.data() + i);
+    const auto param = static_cast<SettingsParameter>((p[0] << 8) | p[1]);
+    const uint32_t value = decodeUInt32(payload.data() + i + 2);
+
+    switch (param) {
+      case SettingsParameter::EnablePush:
+        if (value > 1) {
+          connectionError(ErrorCode::ProtocolError,
+                          "Invalid SETTINGS_ENABLE_PUSH value.");
+          return;
+        }
+        break;
+      case SettingsParameter::InitialWindowSize:
+        if (value > MaxWindowSize) {
+          connectionError(ErrorCode::FlowControlError,
+                          "Invalid SETTINGS_INITIAL_WINDOW_SIZE value.");
+          return;
+        }
+        break;
+      case SettingsParameter::MaxFrameSize:
+        if (value < DefaultMaxFrameSize || value > MaxFrameSizeLimit) {
+          connectionError(ErrorCode::ProtocolError,
+                          "Invalid SETTINGS_MAX_FRAME_SIZE value.");
+          return;
+        }
+        break;
+      default:
+        break;
+    }
+
+    params.push_back(std::make_pair(param, value));
+  }
+
+  listener_->onSettings(params);
+}
+
+void FrameParser::parsePushPromise(const FrameHeader& header,
+                                   const BufferRef& frame) {
+  if (header.streamID == 0) {
+    connectionError(ErrorCode::ProtocolError,
+                    "PUSH_PROMISE frame on stream 0.");
+    return;
+  }
+
+  BufferRef payload = frame;
+  if ((header.flags & PushPromiseFrame::PADDED) &&
+      !stripPadding(header, &payload))
+    return;
+
+  if (payload.size() < 4) {
+    connectionError(ErrorCode::FrameSizeError, "PUSH_PROMISE frame too small.");
+    return;
+  }
+
+  headerBlockType_ = FrameType::PUSH_PROMISE;
+  headerBlockStreamID_ = header.streamID;
+  promisedStreamID_ = decodeUInt32(payload.data()) & 0x7fffffff;
+  headerBlockEndStream_ = false;
+  headerBlock_.clear();
+  if (!appendHeaderBlock(payload.ref(4)))
+    return;
+
+  if (header.flags & PushPromiseFrame::END_HEADERS)
+    headerBlockEnd();
+  else
+    headerBlockPending_ = true;
+}
+
+void FrameParser::parsePing(const FrameHeader& header,
+                            const BufferRef& payload) {
+  if (header.streamID != 0) {
+    connectionError(ErrorCode::ProtocolError, "PING frame on a stream.");
+    return;
+  }
+
+  if (payload.size() != 8) {
+    connectionError(ErrorCode::FrameSizeError, "Invalid PING frame size.");
+    return;
+  }
+
+  listener_->onPing(payload, header.flags & PingFrame::ACK);
+}
+
+void FrameParser::parseGoAway(const FrameHeader& header,
+                              const BufferRef& payload) {
+  if (header.streamID != 0) {
+    connectionError(ErrorCode::ProtocolError, "GOAWAY frame on a stream.");
+    return;
+  }
+
+  if (payload.size() < 8) {
+    connectionError(ErrorCode::FrameSizeError, "GOAWAY frame too small.");
+    return;
+  }
+
+  listener_->onGoAway(decodeUInt32(payload.data()) & 0x7fffffff,
+                      static_cast<ErrorCode>(decodeUInt32(payload.data() + 4)),
+                      payload.ref(8));
+}
+
+void FrameParser::parseWindowUpdate(const FrameHeader& header,
+                                    const BufferRef& payload) {
+  if (payload.size() != 4) {
+    connectionError(ErrorCode::FrameSizeError,
+                    "Invalid WINDOW_UPDATE frame size.");
+    return;
+  }
+
+  const size_t increment = decodeUInt32(payload.data()) & 0x7fffffff;
+
+  if (increment == 0) {
+    if (header.streamID == 0)
+      connectionError(ErrorCode::ProtocolError, "Zero window increment.");
+    else
+      listener_->onStreamError(header.streamID, ErrorCode::ProtocolError,
+                               "Zero window increment.");
+    return;
+  }
+
+  listener_->onWindowUpdate(header.streamID, increment);
+}
+
+void FrameParser::parseContinuation(const FrameHeader& header,
+                                    const BufferRef& payload) {
+  if (!headerBlockPending_ || header.streamID != headerBlockStreamID_) {
+    connectionError(ErrorCode::ProtocolError,
+                    "Unexpected CONTINUATION frame.");
+    return;
+  }
+
+  if (!appendHeaderBlock(payload))
+    return;
+
+  if (header.flags & ContinuationFrame::END_HEADERS)
+    headerBlockEnd();
+}
+
+bool FrameParser::appendHeaderBlock(const BufferRef& fragment) {
+  // the block cannot be skipped without desynchronizing the HPACK decoder
+  if (fragment.size() > maxHeaderBlockSize_ - headerBlock_.size()) {
+    connectionError(ErrorCode::EnhanceYourCalm, "Header block too large.");
+    return false;
+  }
+
+  headerBlock_.push_back(fragment);
+  return true;
+}
+
+void FrameParser::headerBlockEnd() {
+  headerBlockPending_ = false;
+
+  if (headerBlockType_ == FrameType::PUSH_PROMISE)
+    listener_->onPushPromise(headerBlockStreamID_, promisedStreamID_,
+                             headerBlock_.ref());
+  else
+    listener_->onHeaders(headerBlockStreamID_, headerBlock_.ref(),
+                         headerBlockEndStream_);
+}
+
+void FrameParser::connectionError(ErrorCode ec, const std::string& message) {
+  TRACE("connectionError: %s: %s", to_string(ec).c_str(), message.c_str());
+  failed_ = true;
+  listener_->onConnectionError(ec, message);
+}
+
+}  // namespace http2
+}  // namespace xzero
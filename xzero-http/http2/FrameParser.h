@@ -0,0 +1,93 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <xzero-http/Api.h>
+#include <xzero-http/http2/http2.h>
+#include <xzero-base/Buffer.h>
+
+namespace xzero {
+namespace http2 {
+
+class FrameListener;
+
+/**
+ * Parses HTTP/2 frames and passes them on to a FrameListener.
+ *
+ * Header blocks spanning HEADERS (or PUSH_PROMISE) and CONTINUATION frames
+ * are assembled before being passed on.
+ */
+class XZERO_HTTP_API FrameParser {
+ public:
+  explicit FrameParser(FrameListener* listener);
+
+  /**
+   * Maximum payload size of incoming frames (our @c SETTINGS_MAX_FRAME_SIZE).
+   */
+  size_t maxFrameSize() const XZERO_NOEXCEPT { return maxFrameSize_; }
+  void setMaxFrameSize(size_t value) { maxFrameSize_ = value; }
+
+  /**
+   * Maximum size of an incoming header block, summed up over its HEADERS
+   * (or PUSH_PROMISE) and CONTINUATION frames.
+   *
+   * Larger header blocks fail the connection with @c ENHANCE_YOUR_CALM.
+   */
+  size_t maxHeaderBlockSize() const XZERO_NOEXCEPT {
+    return maxHeaderBlockSize_;
+  }
+  void setMaxHeaderBlockSize(size_t value) { maxHeaderBlockSize_ = value; }
+
+  /**
+   * Parses as many complete frames as available in @p chunk.
+   *
+   * Parsing stops after a connection error has been reported.
+   *
+   * @return number of bytes consumed, always a multiple of whole frames.
+   */
+  size_t parseFragment(const BufferRef& chunk);
+
+  /**
+   * Tests whether a connection error has been reported.
+   */
+  bool isFailed() const XZERO_NOEXCEPT { return failed_; }
+
+ private:
+  void parseFrame(const FrameHeader& header, const BufferRef& payload);
+  void parseData(const FrameHeader& header, const BufferRef& payload);
+  void parseHeaders(const FrameHeader& header, const BufferRef& payload);
+  void parsePriority(const FrameHeader& header, const BufferRef& payload);
+  void parseResetStream(const FrameHeader& header, const BufferRef& payload);
+  void parseSettings(const FrameHeader& header, const BufferRef& payload);
+  void parsePushPromise(const FrameHeader& header, const BufferRef& payload);
+  void parsePing(const FrameHeader& header, const BufferRef& payload);
+  void parseGoAway(const FrameHeader& header, const BufferRef& payload);
+  void parseWindowUpdate(const FrameHeader& header, const BufferRef& payload);
+  void parseContinuation(const FrameHeader& header, const BufferRef& payload);
+  bool stripPadding(const FrameHeader& header, BufferRef* payload);
+  bool appendHeaderBlock(const BufferRef& fragment);
+  void headerBlockEnd();
+  void connectionError(ErrorCode ec, const std::string& message);
+
+ private:
+  FrameListener* listener_;
+  size_t maxFrameSize_;
+  size_t maxHeaderBlockSize_;
+  bool failed_;
+
+  // header block currently being assembled
+  FrameType headerBlockType_;
+  unsigned headerBlockStreamID_;
+  unsigned promisedStreamID_;
+  bool headerBlockEndStream_;
+  bool headerBlockPending_;
+  Buffer headerBlock_;
+};
+
+}  // namespace http2
+}  // namespace xzero
@@ -0,0 +1,653 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+// HTTP/2 transport protocol tests
+
+#include <xzero-http/http2/Http2ConnectionFactory.h>
+#include <xzero-http/http2/FrameListener.h>
+#include <xzero-http/http2/FrameParser.h>
+#include <xzero-http/http2/hpack.h>
+#include <xzero-http/http2/http2.h>
+#include <xzero-http/http1/Http1ConnectionFactory.h>
+#include <xzero-http/HttpRequest.h>
+#include <xzero-http/HttpResponse.h>
+#include <xzero-http/HttpOutput.h>
+#include <xzero-base/executor/DirectExecutor.h>
+#include <xzero-base/net/Server.h>
+#include <xzero-base/net/LocalConnector.h>
+#include <xzero-base/io/FileRef.h>
+#include <xzero-base/Buffer.h>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace xzero;
+using namespace xzero::http2;
+
+static const size_t maxRequestUriLength = 64;
+static const size_t maxRequestBodyLength = 128;
+
+#define MOCK_HTTP2_SERVER(server, localConnector, executor)                    \
+  xzero::Server server;                                                        \
+  xzero::DirectExecutor executor(false);                                       \
+  xzero::WallClock* clock = nullptr;                                           \
+  auto localConnector = server.addConnector<xzero::LocalConnector>(&executor); \
+  auto http = localConnector->addConnectionFactory<xzero::http2::Http2ConnectionFactory>( \
+      clock, maxRequestUriLength, maxRequestBodyLength);                       \
+  http->setHandler([&](HttpRequest* request, HttpResponse* response) {         \
+      response->setStatus(HttpStatus::Ok);                                     \
+      response->setContentLength(request->path().size() + 1);                 \
+      response->setHeader("Content-Type", "text/plain");                       \
+      response->output()->write(Buffer(request->path() + "\n"),                \
+          std::bind(&HttpResponse::completed, response));                      \
+  });                                                                          \
+  server.start();
+
+/**
+ * Builds the raw byte stream a HTTP/2 client would send.
+ */
+class RequestBuilder { // {{{
+ public:
+  explicit RequestBuilder(bool preface = true) {
+    if (preface) {
+      data_.append(ConnectionPreface, ConnectionPrefaceLength);
+    }
+  }
+
+  RequestBuilder& frame(FrameType type, unsigned flags, unsigned streamID,
+                        const std::string& payload) {
+    char header[FrameHeaderSize];
+    FrameHeader::encode(header, payload.size(), type, flags, streamID);
+    data_.append(header, sizeof(header));
+    data_.append(payload);
+    return *this;
+  }
+
+  RequestBuilder& settings(SettingsParameter param, uint32_t value) {
+    std::string payload(6, '\0');
+    payload[0] = static_cast<char>((static_cast<unsigned>(param) >> 8) & 0xff);
+    payload[1] = static_cast<char>(static_cast<unsigned>(param) & 0xff);
+    encodeUInt32(&payload[2], value);
+    return frame(FrameType::SETTINGS, 0, 0, payload);
+  }
+
+  RequestBuilder& settings() {
+    return frame(FrameType::SETTINGS, 0, 0, "");
+  }
+
+  RequestBuilder& get(unsigned streamID, const std::string& path,
+                      const std::vector<std::pair<std::string, std::string>>&
+                          extra = {}) {
+    Buffer block;
+    encoder_.encode(":method", "GET", &block);
+    encoder_.encode(":scheme", "http", &block);
+    encoder_.encode(":authority", "localhost", &block);
+    encoder_.encode(":path", BufferRef(path), &block);
+    for (const auto& field: extra)
+      encoder_.encode(BufferRef(field.first), BufferRef(field.second), &block);
+
+    return frame(FrameType::HEADERS,
+                 HeadersFrame::END_HEADERS | HeadersFrame::END_STREAM,
+                 streamID, block.str());
+  }
+
+  RequestBuilder& windowUpdate(unsigned streamID, uint32_t increment) {
+    std::string payload(4, '\0');
+    encodeUInt32(&payload[0], increment);
+    return frame(FrameType::WINDOW_UPDATE, 0, streamID, payload);
+  }
+
+  RequestBuilder& priority(unsigned streamID, unsigned dependencyStreamID,
+                           unsigned weight, bool exclusive = false) {
+    std::string payload(5, '\0');
+    encodeUInt32(&payload[0],
+                 dependencyStreamID | (exclusive ? 0x80000000 : 0));
+    payload[4] = static_cast<char>(weight - 1);
+    return frame(FrameType::PRIORITY, 0, streamID, payload);
+  }
+
+  RequestBuilder& ping(const std::string& data) {
+    return frame(FrameType::PING, 0, 0, data);
+  }
+
+  const std::string& str() const { return data_; }
+
+ private:
+  std::string data_;
+  hpack::Encoder encoder_;
+};
+// }}}
+
+/**
+ * Parses the server's frames and collects the responses per stream.
+ */
+class ResponseParser : public FrameListener { // {{{
+ public:
+  struct Stream {
+    std::map<std::string, std::string> headers;
+    std::map<std::string, std::string> request;  //!< of pushed streams
+    unsigned promisedBy = 0;
+    std::string body;
+    bool ended = false;
+    bool reset = false;
+    ErrorCode resetCode = ErrorCode::NoError;
+  };
+
+  explicit ResponseParser(const Buffer& output,
+                          size_t maxFrameSize = DefaultMaxFrameSize)
+      : parser_(this), settings_(0), settingsAcks_(0),
+        goAway_(false), goAwayCode_(ErrorCode::NoError) {
+    parser_.setMaxFrameSize(maxFrameSize);
+    parser_.parseFragment(output.ref());
+  }
+
+  std::map<unsigned, Stream>& streams() { return streams_; }
+
+  /** Stream identifier and size of all non-empty DATA frames, in order. */
+  const std::vector<std::pair<unsigned, size_t>>& dataFrames() const {
+    return dataFrames_;
+  }
+
+  Stream& stream(unsigned id) { return streams_[id]; }
+  size_t settings() const { return settings_; }
+  size_t settingsAcks() const { return settingsAcks_; }
+
+  /** Last announced value of @p param, or 0 if never announced. */
+  uint32_t setting(SettingsParameter param) const {
+    auto i = settingValues_.find(param);
+    return i != settingValues_.end() ? i->second : 0;
+  }
+  const std::vector<std::string>& pings() const { return pings_; }
+  bool goAway() const { return goAway_; }
+  ErrorCode goAwayCode() const { return goAwayCode_; }
+
+  void onData(unsigned streamID, const BufferRef& data,
+              size_t flowControlled, bool last) override {
+    streams_[streamID].body += data.str();
+    if (!data.empty())
+      dataFrames_.emplace_back(streamID, data.size());
+    streams_[streamID].ended |= last;
+  }
+
+  void onHeaders(unsigned streamID, const BufferRef& headerBlock,
+                 bool last) override {
+    Stream& s = streams_[streamID];
+    decoder_.decode(headerBlock,
+        [&](const BufferRef& name, const BufferRef& value) {
+          s.headers[name.str()] = value.str();
+        });
+    s.ended |= last;
+  }
+
+  void onPriority(unsigned, bool, unsigned, unsigned) override {}
+
+  void onResetStream(unsigned streamID, ErrorCode errorCode) override {
+    streams_[streamID].reset = true;
+    streams_[streamID].resetCode = errorCode;
+  }
+
+  void onSettings(
+      const std::vector<std::pair<SettingsParameter, uint32_t>>& params)
+      override {
+    settings_++;
+    for (const auto& param: params)
+      settingValues_[param.first] = param.second;
+  }
+
+  void onSettingsAck() override { settingsAcks_++; }
+
+  void onPushPromise(unsigned streamID, unsigned promisedStreamID,
+                     const BufferRef& headerBlock) override {
+    Stream& s = streams_[promisedStreamID];
+    s.promisedBy = streamID;
+    decoder_.decode(headerBlock,
+        [&](const BufferRef& name, const BufferRef& value) {
+          s.request[name.str()] = value.str();
+        });
+  }
+
+  void onPing(const BufferRef& data, bool ack) override {
+    if (ack) {
+      pings_.push_back(data.str());
+    }
+  }
+
+  void onGoAway(unsigned lastStreamID, ErrorCode errorCode,
+                const BufferRef& debugData) override {
+    goAway_ = true;
+    goAwayCode_ = errorCode;
+  }
+
+  void onWindowUpdate(unsigned, size_t) override {}
+
+  void onConnectionError(ErrorCode errorCode,
+                         const std::string& message) override {
+    FAIL() << "connection error parsing server output: " << message;
+  }
+
+  void onStreamError(unsigned streamID, ErrorCode errorCode,
+                     const std::string& message) override {
+    FAIL() << "stream error parsing server output: " << message;
+  }
+
+ private:
+  FrameParser parser_;
+  hpack::Decoder decoder_;
+  std::map<unsigned, Stream> streams_;
+  std::vector<std::pair<unsigned, size_t>> dataFrames_;
+  size_t settings_;
+  size_t settingsAcks_;
+  std::map<SettingsParameter, uint32_t> settingValues_;
+  std::vector<std::string> pings_;
+  bool goAway_;
+  ErrorCode goAwayCode_;
+};
+// }}}
+
+TEST(Http2, SingleRequest) {
+  MOCK_HTTP2_SERVER(server, connector, executor);
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient(RequestBuilder().settings().get(1, "/hello")
+                                                 .str());
+  });
+
+  ResponseParser response(ep->output());
+  ASSERT_EQ(1, response.settings());
+  ASSERT_EQ(1, response.settingsAcks());
+
+  ResponseParser::Stream& s = response.stream(1);
+  ASSERT_EQ("200", s.headers[":status"]);
+  ASSERT_EQ("text/plain", s.headers["content-type"]);
+  ASSERT_EQ("7", s.headers["content-length"]);
+  ASSERT_EQ("/hello\n", s.body);
+  ASSERT_TRUE(s.ended);
+  ASSERT_FALSE(s.reset);
+}
+
+TEST(Http2, MultipleStreams) {
+  MOCK_HTTP2_SERVER(server, connector, executor);
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient(RequestBuilder().settings()
+                                                 .get(1, "/one")
+                                                 .get(3, "/two")
+                                                 .get(5, "/three")
+                                                 .str());
+  });
+
+  ResponseParser response(ep->output());
+  ASSERT_EQ("/one\n", response.stream(1).body);
+  ASSERT_EQ("/two\n", response.stream(3).body);
+  ASSERT_EQ("/three\n", response.stream(5).body);
+  ASSERT_TRUE(response.stream(1).ended);
+  ASSERT_TRUE(response.stream(3).ended);
+  ASSERT_TRUE(response.stream(5).ended);
+}
+
+TEST(Http2, FlowControlBlocked) {
+  MOCK_HTTP2_SERVER(server, connector, executor);
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient(
+        RequestBuilder().settings(SettingsParameter::InitialWindowSize, 4)
+                        .get(1, "/hello")
+                        .str());
+  });
+
+  ResponseParser response(ep->output());
+  ResponseParser::Stream& s = response.stream(1);
+  ASSERT_EQ("200", s.headers[":status"]);
+  ASSERT_EQ("/hel", s.body);
+  ASSERT_FALSE(s.ended);
+}
+
+TEST(Http2, FlowControlWindowUpdate) {
+  MOCK_HTTP2_SERVER(server, connector, executor);
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient(
+        RequestBuilder().settings(SettingsParameter::InitialWindowSize, 4)
+                        .get(1, "/hello")
+                        .windowUpdate(1, 10)
+                        .str());
+  });
+
+  ResponseParser response(ep->output());
+  ResponseParser::Stream& s = response.stream(1);
+  ASSERT_EQ("/hello\n", s.body);
+  ASSERT_TRUE(s.ended);
+}
+
+TEST(Http2, Ping) {
+  MOCK_HTTP2_SERVER(server, connector, executor);
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient(RequestBuilder().settings()
+                                                 .ping("12345678")
+                                                 .str());
+  });
+
+  ResponseParser response(ep->output());
+  ASSERT_EQ(1, response.pings().size());
+  ASSERT_EQ("12345678", response.pings()[0]);
+}
+
+TEST(Http2, InvalidPreface) {
+  MOCK_HTTP2_SERVER(server, connector, executor);
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient("GET / HTTP/1.1\r\n\r\n");
+  });
+
+  ResponseParser response(ep->output());
+  ASSERT_TRUE(response.goAway());
+  ASSERT_EQ(ErrorCode::ProtocolError, response.goAwayCode());
+}
+
+TEST(Http2, MalformedRequest) {
+  MOCK_HTTP2_SERVER(server, connector, executor);
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient(
+        RequestBuilder().settings()
+                        .get(1, "/", {{"Connection", "close"}})
+                        .str());
+  });
+
+  ResponseParser response(ep->output());
+  ASSERT_TRUE(response.stream(1).reset);
+  ASSERT_EQ(ErrorCode::ProtocolError, response.stream(1).resetCode);
+  ASSERT_TRUE(response.stream(1).headers.empty());
+}
+
+TEST(Http2, ContinuationFlood) {
+  MOCK_HTTP2_SERVER(server, connector, executor);
+
+  // a header block that never ends, 1 KiB at a time
+  RequestBuilder request;
+  request.settings()
+         .frame(FrameType::HEADERS, HeadersFrame::END_STREAM, 1, "\x82");
+  for (size_t i = 0; i != 2 * DefaultMaxHeaderListSize / 1024; ++i)
+    request.frame(FrameType::CONTINUATION, 0, 1, std::string(1024, 'x'));
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient(request.str());
+  });
+
+  ResponseParser response(ep->output());
+  ASSERT_EQ(DefaultMaxHeaderListSize,
+            response.setting(SettingsParameter::MaxHeaderListSize));
+  ASSERT_TRUE(response.goAway());
+  ASSERT_EQ(ErrorCode::EnhanceYourCalm, response.goAwayCode());
+  ASSERT_TRUE(response.stream(1).headers.empty());
+}
+
+TEST(Http2, HeaderListTooLarge) {
+  MOCK_HTTP2_SERVER(server, connector, executor);
+
+  // repeated fields get indexed, so the block itself stays small
+  std::vector<std::pair<std::string, std::string>> fields;
+  for (size_t i = 0; i != 2 * DefaultMaxHeaderListSize / 1024; ++i)
+    fields.emplace_back("x-large", std::string(1000, 'x'));
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient(RequestBuilder().settings()
+                                                 .get(1, "/large", fields)
+                                                 .get(3, "/small")
+                                                 .str());
+  });
+
+  ResponseParser response(ep->output());
+  ASSERT_FALSE(response.goAway());
+  ASSERT_EQ("431", response.stream(1).headers[":status"]);
+  ASSERT_TRUE(response.stream(1).ended);
+  ASSERT_EQ("200", response.stream(3).headers[":status"]);
+  ASSERT_EQ("/small\n", response.stream(3).body);
+}
+
+TEST(Http2, PushPromiseFromClient) {
+  MOCK_HTTP2_SERVER(server, connector, executor);
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient(
+        RequestBuilder().settings()
+                        .frame(FrameType::PUSH_PROMISE,
+                               PushPromiseFrame::END_HEADERS, 1,
+                               std::string("\0\0\0\2\x82", 5))
+                        .str());
+  });
+
+  ResponseParser response(ep->output());
+  ASSERT_TRUE(response.goAway());
+  ASSERT_EQ(ErrorCode::ProtocolError, response.goAwayCode());
+}
+
+TEST(Http2, PriorKnowledge) {
+  xzero::Server server;
+  xzero::DirectExecutor executor(false);
+  auto connector = server.addConnector<xzero::LocalConnector>(&executor);
+
+  auto http1 = connector->addConnectionFactory<http1::Http1ConnectionFactory>(
+      nullptr, maxRequestUriLength, maxRequestBodyLength, 5,
+      TimeSpan::fromSeconds(30));
+  auto h2c = connector->addConnectionFactory<Http2ConnectionFactory>(
+      nullptr, maxRequestUriLength, maxRequestBodyLength);
+
+  auto handler = [&](HttpRequest* request, HttpResponse* response) {
+    response->setStatus(HttpStatus::Ok);
+    response->setContentLength(request->path().size() + 1);
+    response->output()->write(Buffer(request->path() + "\n"),
+        std::bind(&HttpResponse::completed, response));
+  };
+  http1->setHandler(handler);
+  h2c->setHandler(handler);
+  server.start();
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient(RequestBuilder().settings().get(1, "/h2c")
+                                                 .str());
+  });
+
+  ResponseParser response(ep->output());
+  ASSERT_EQ("200", response.stream(1).headers[":status"]);
+  ASSERT_EQ("/h2c\n", response.stream(1).body);
+  ASSERT_TRUE(response.stream(1).ended);
+
+  // plain HTTP/1 requests are still served by the HTTP/1 connection
+  executor.execute([&] {
+    ep = connector->createClient("GET /h1 HTTP/1.0\r\n\r\n");
+  });
+  ASSERT_TRUE(ep->output().contains("HTTP/1.0 200"));
+  ASSERT_TRUE(ep->output().contains("/h1\n"));
+}
+
+TEST(Http2, PriorityDependency) {
+  MOCK_HTTP2_SERVER(server, connector, executor);
+
+  // stream 1 depends on stream 3, so 3 must be served first
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient(RequestBuilder().settings()
+                                                 .priority(1, 3, 16)
+                                                 .get(1, "/one")
+                                                 .get(3, "/three")
+                                                 .str());
+  });
+
+  ResponseParser response(ep->output());
+  ASSERT_EQ("/one\n", response.stream(1).body);
+  ASSERT_EQ("/three\n", response.stream(3).body);
+  ASSERT_EQ(2, response.dataFrames().size());
+  ASSERT_EQ(3, response.dataFrames()[0].first);
+  ASSERT_EQ(1, response.dataFrames()[1].first);
+}
+
+TEST(Http2, PrioritySelfDependency) {
+  MOCK_HTTP2_SERVER(server, connector, executor);
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient(RequestBuilder().settings()
+                                                 .get(1, "/one")
+                                                 .priority(1, 1, 16)
+                                                 .str());
+  });
+
+  ResponseParser response(ep->output());
+  ASSERT_TRUE(response.stream(1).reset);
+  ASSERT_EQ(ErrorCode::ProtocolError, response.stream(1).resetCode);
+}
+
+TEST(Http2, CoalescedWrites) {
+  MOCK_HTTP2_SERVER(server, connector, executor);
+
+  // many small writes end up in a single DATA frame
+  http->setHandler([&](HttpRequest* request, HttpResponse* response) {
+    response->setStatus(HttpStatus::Ok);
+    response->setContentLength(100);
+    for (int i = 0; i < 9; ++i)
+      response->output()->write(Buffer("0123456789"));
+    response->output()->write(Buffer("0123456789"),
+        std::bind(&HttpResponse::completed, response));
+  });
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient(RequestBuilder().settings().get(1, "/")
+                                                 .str());
+  });
+
+  ResponseParser response(ep->output());
+  ASSERT_EQ(100, response.stream(1).body.size());
+  ASSERT_TRUE(response.stream(1).ended);
+  ASSERT_EQ(1, response.dataFrames().size());
+}
+
+static void testFileResponse(size_t fileSize, uint32_t maxFrameSize,
+                             size_t expectedFrames) {
+  MOCK_HTTP2_SERVER(server, connector, executor);
+
+  std::string content;
+  for (size_t i = 0; i < fileSize; ++i)
+    content.push_back('a' + i % 26);
+
+  FILE* fp = tmpfile();
+  fwrite(content.data(), 1, content.size(), fp);
+  fflush(fp);
+
+  http->setHandler([&](HttpRequest* request, HttpResponse* response) {
+    response->setStatus(HttpStatus::Ok);
+    response->setContentLength(fileSize);
+    response->output()->write(FileRef(fileno(fp), 0, fileSize, false),
+        std::bind(&HttpResponse::completed, response));
+  });
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient(
+        RequestBuilder().settings(SettingsParameter::MaxFrameSize,
+                                  maxFrameSize)
+                        .settings(SettingsParameter::InitialWindowSize,
+                                  1024 * 1024)
+                        .windowUpdate(0, 1024 * 1024)
+                        .get(1, "/file")
+                        .str());
+  });
+  fclose(fp);
+
+  ResponseParser response(ep->output(), maxFrameSize);
+  ASSERT_EQ(content, response.stream(1).body);
+  ASSERT_TRUE(response.stream(1).ended);
+  ASSERT_EQ(expectedFrames, response.dataFrames().size());
+  ASSERT_FALSE(ep->isCorking());
+}
+
+TEST(Http2, FileResponseRead) {
+  // frames below sendfile size are read in frame by frame
+  testFileResponse(40000, DefaultMaxFrameSize, 3);
+}
+
+TEST(Http2, FileResponseSendfile) {
+  testFileResponse(300000, 128 * 1024, 3);
+}
+
+TEST(Http2, PushResource) {
+  MOCK_HTTP2_SERVER(server, connector, executor);
+
+  http->setHandler([&](HttpRequest* request, HttpResponse* response) {
+    if (request->path() == "/index.html")
+      response->pushResource("/style.css");
+
+    response->setStatus(HttpStatus::Ok);
+    response->setContentLength(request->path().size());
+    response->output()->write(Buffer(request->path()),
+        std::bind(&HttpResponse::completed, response));
+  });
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient(RequestBuilder().settings()
+                                                 .get(1, "/index.html",
+                                                      {{"accept-encoding",
+                                                        "gzip"}})
+                                                 .str());
+  });
+
+  ResponseParser response(ep->output());
+  ResponseParser::Stream& pushed = response.stream(2);
+  ASSERT_EQ(1, pushed.promisedBy);
+  ASSERT_EQ("GET", pushed.request[":method"]);
+  ASSERT_EQ("/style.css", pushed.request[":path"]);
+  ASSERT_EQ("localhost", pushed.request[":authority"]);
+  ASSERT_EQ("gzip", pushed.request["accept-encoding"]);
+  ASSERT_EQ("200", pushed.headers[":status"]);
+  ASSERT_EQ("/style.css", pushed.body);
+  ASSERT_TRUE(pushed.ended);
+
+  ASSERT_EQ("200", response.stream(1).headers[":status"]);
+  ASSERT_EQ("/index.html", response.stream(1).body);
+  ASSERT_TRUE(response.stream(1).ended);
+  ASSERT_FALSE(response.goAway());
+}
+
+TEST(Http2, PushDisabled) {
+  MOCK_HTTP2_SERVER(server, connector, executor);
+
+  http->setHandler([&](HttpRequest* request, HttpResponse* response) {
+    response->pushResource("/style.css");
+    response->setStatus(HttpStatus::Ok);
+    response->completed();
+  });
+
+  xzero::RefPtr<LocalEndPoint> ep;
+  executor.execute([&] {
+    ep = connector->createClient(
+        RequestBuilder().settings(SettingsParameter::EnablePush, 0)
+                        .get(1, "/index.html")
+                        .str());
+  });
+
+  // neither a promise nor an informational response
+  ResponseParser response(ep->output());
+  ASSERT_EQ(1, response.streams().size());
+  ASSERT_EQ("200", response.stream(1).headers[":status"]);
+  ASSERT_TRUE(response.stream(1).ended);
+}
@@ -0,0 +1,759 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#include <xzero-http/http2/Http2Connection.h>
+#include <xzero-http/http2/Http2Stream.h>
+#include <xzero-base/net/EndPoint.h>
+#include <xzero-base/executor/Executor.h>
+#include <xzero-base/logging.h>
+#include <algorithm>
+#include <cstring>
+
+namespace xzero {
+namespace http2 {
+
+#ifndef NDEBUG
+#define TRACE(msg...) logTrace("http2.Http2Connection", msg)
+#else
+#define TRACE(msg...) do {} while (0)
+#endif
+
+/**
+ * Number of DATA payload bytes to generate at most before flushing.
+ */
+static const size_t MaxOutputBatch = 64 * 1024;
+
+/**
+ * Number of idle streams the scheduler keeps track of in addition to the
+ * open ones, for clients that use them to group streams by priority.
+ */
+static const size_t MaxIdleStreams = 32;
+
+Http2Connection::Http2Connection(EndPoint* endpoint,
+                                 Executor* executor,
+                                 const HttpHandler& handler,
+                                 HttpDateGenerator* dateGenerator,
+                                 HttpOutputCompressor* outputCompressor,
+                                 size_t maxRequestUriLength,
+                                 size_t maxRequestBodyLength,
+                                 size_t maxConcurrentStreams,
+                                 size_t initialWindowSize,
+                                 size_t maxHeaderListSize)
+    : Connection(endpoint, executor),
+      handler_(handler),
+      dateGenerator_(dateGenerator),
+      outputCompressor_(outputCompressor),
+      maxRequestUriLength_(maxRequestUriLength),
+      maxRequestBodyLength_(maxRequestBodyLength),
+      maxConcurrentStreams_(maxConcurrentStreams),
+      initialWindowSize_(initialWindowSize),
+      maxHeaderListSize_(maxHeaderListSize),
+      inputBuffer_(),
+      inputOffset_(0),
+      prefaceReceived_(false),
+      inputClosed_(false),
+      parser_(this),
+      decoder_(DefaultHeaderTableSize),
+      writer_(),
+      generator_(&writer_),
+      encoder_(DefaultHeaderTableSize),
+      flushing_(false),
+      closing_(false),
+      scheduler_(maxConcurrentStreams + MaxIdleStreams),
+      completions_(),
+      retainedBuffers_(),
+      retainedFiles_(),
+      sendWindow_(DefaultInitialWindowSize),
+      recvWindow_(std::max(initialWindowSize, DefaultInitialWindowSize)),
+      peerInitialWindowSize_(DefaultInitialWindowSize),
+      streams_(),
+      closedStreams_(),
+      lastStreamID_(0),
+      goAwayReceived_(false),
+      pushEnabled_(true),
+      peerMaxConcurrentStreams_(static_cast<size_t>(-1)),
+      nextPushStreamID_(2),
+      pushedStreams_(0),
+      pendingPushes_() {
+  TRACE("%p ctor", this);
+  parser_.setMaxHeaderBlockSize(maxHeaderListSize);
+}
+
+Http2Connection::~Http2Connection() {
+  TRACE("%p dtor", this);
+}
+
+void Http2Connection::takeInput(const BufferRef& data) {
+  inputBuffer_.push_back(data);
+}
+
+void Http2Connection::onOpen() {
+  TRACE("%p onOpen", this);
+  Connection::onOpen();
+
+  std::vector<std::pair<SettingsParameter, uint32_t>> settings;
+  settings.emplace_back(SettingsParameter::MaxConcurrentStreams,
+                        maxConcurrentStreams_);
+  if (initialWindowSize_ != DefaultInitialWindowSize)
+    settings.emplace_back(SettingsParameter::InitialWindowSize,
+                          initialWindowSize_);
+  settings.emplace_back(SettingsParameter::MaxHeaderListSize,
+                        maxHeaderListSize_);
+
+  generator_.generateSettings(settings);
+
+  // the connection window can only be changed by WINDOW_UPDATE frames
+  if (recvWindow_ > DefaultInitialWindowSize)
+    generator_.generateWindowUpdate(0, recvWindow_ - DefaultInitialWindowSize);
+
+  wantOutput();
+
+  if (!inputBuffer_.empty()) {
+    processInput();
+  } else {
+    wantFill();
+  }
+}
+
+void Http2Connection::onClose() {
+  TRACE("%p onClose", this);
+  Connection::onClose();
+}
+
+void Http2Connection::setInputBufferSize(size_t size) {
+  TRACE("%p setInputBufferSize(%zu)", this, size);
+  inputBuffer_.reserve(size);
+}
+
+// {{{ input
+void Http2Connection::onFillable() {
+  TRACE("%p onFillable", this);
+
+  if (endpoint()->fill(&inputBuffer_) == 0) {
+    TRACE("%p onFillable: EOF", this);
+    inputClosed_ = true;
+    checkShutdown();
+    return;
+  }
+
+  processInput();
+}
+
+void Http2Connection::processInput() {
+  if (!prefaceReceived_) {
+    const size_t available = inputBuffer_.size() - inputOffset_;
+    const size_t n = std::min(available, ConnectionPrefaceLength);
+
+    if (std::memcmp(inputBuffer_.data() + inputOffset_, ConnectionPreface,
+                    n) != 0) {
+      onConnectionError(ErrorCode::ProtocolError,
+                        "Invalid connection preface.");
+      return;
+    }
+
+    if (n < ConnectionPrefaceLength) {
+      wantFill();
+      return;
+    }
+
+    inputOffset_ += ConnectionPrefaceLength;
+    prefaceReceived_ = true;
+  }
+
+  inputOffset_ += parser_.parseFragment(inputBuffer_.ref(inputOffset_));
+
+  // keep only the incomplete frame that is still to be parsed
+  if (inputOffset_ == inputBuffer_.size()) {
+    inputBuffer_.clear();
+    inputOffset_ = 0;
+  } else if (inputOffset_ > 0) {
+    Buffer rest(inputBuffer_.ref(inputOffset_));
+    inputBuffer_ = std::move(rest);
+    inputOffset_ = 0;
+  }
+
+  if (!closing_) {
+    wantFill();
+  }
+}
+
+void Http2Connection::onData(unsigned streamID, const BufferRef& data,
+                             size_t flowControlled, bool last) {
+  if (flowControlled > recvWindow_) {
+    onConnectionError(ErrorCode::FlowControlError,
+                      "Connection flow control window exceeded.");
+    return;
+  }
+
+  recvWindow_ -= flowControlled;
+
+  Http2Stream* stream = findStream(streamID);
+  if (!stream) {
+    if (isIdle(streamID)) {
+      onConnectionError(ErrorCode::ProtocolError, "DATA frame on idle stream.");
+      return;
+    }
+
+    // stream closed or reset by us already, so ignore its data.
+    replenishWindows(nullptr);
+    return;
+  }
+
+  if (stream->isRemoteClosed()) {
+    resetStream(stream, ErrorCode::StreamClosed);
+    replenishWindows(nullptr);
+    return;
+  }
+
+  if (flowControlled > stream->recvWindow()) {
+    resetStream(stream, ErrorCode::FlowControlError);
+    replenishWindows(nullptr);
+    return;
+  }
+
+  stream->setRecvWindow(stream->recvWindow() - flowControlled);
+  stream->onRequestData(data, last);
+  replenishWindows(stream);
+}
+
+void Http2Connection::replenishWindows(Http2Stream* stream) {
+  const size_t connectionWindow =
+      std::max(initialWindowSize_, DefaultInitialWindowSize);
+
+  if (recvWindow_ <= connectionWindow / 2) {
+    generator_.generateWindowUpdate(0, connectionWindow - recvWindow_);
+    recvWindow_ = connectionWindow;
+    wantOutput();
+  }
+
+  if (stream && !stream->isRemoteClosed() &&
+      stream->recvWindow() <= initialWindowSize_ / 2) {
+    generator_.generateWindowUpdate(stream->id(),
+                                    initialWindowSize_ - stream->recvWindow());
+    stream->setRecvWindow(initialWindowSize_);
+    wantOutput();
+  }
+}
+
+void Http2Connection::onHeaders(unsigned streamID,
+                                const BufferRef& headerBlock,
+                                bool last) {
+  auto ignore = [](const BufferRef&, const BufferRef&) {};
+
+  if (Http2Stream* stream = findStream(streamID)) {
+    // request trailers. these are not passed on.
+    if (!decoder_.decode(headerBlock, ignore)) {
+      onConnectionError(ErrorCode::CompressionError,
+                        "Invalid header block.");
+      return;
+    }
+
+    if (stream->isRemoteClosed()) {
+      resetStream(stream, ErrorCode::StreamClosed);
+    } else if (!last) {
+      resetStream(stream, ErrorCode::ProtocolError);
+    } else {
+      stream->onRequestData(BufferRef(), true);
+    }
+    return;
+  }
+
+  if ((streamID & 1) == 0 || streamID <= lastStreamID_) {
+    // keep the decoder's dynamic table in sync before bailing out
+    decoder_.decode(headerBlock, ignore);
+    onConnectionError((streamID & 1) == 0 ? ErrorCode::ProtocolError
+                                          : ErrorCode::StreamClosed,
+                      "Invalid stream identifier.");
+    return;
+  }
+
+  lastStreamID_ = streamID;
+
+  if (goAwayReceived_ || closing_ ||
+      streams_.size() - pushedStreams_ >= maxConcurrentStreams_) {
+    TRACE("%p onHeaders: refusing stream %u", this, streamID);
+    if (!decoder_.decode(headerBlock, ignore)) {
+      onConnectionError(ErrorCode::CompressionError,
+                        "Invalid header block.");
+      return;
+    }
+    generator_.generateResetStream(streamID, ErrorCode::RefusedStream);
+    wantOutput();
+    return;
+  }
+
+  Http2Stream* stream = new Http2Stream(streamID, this, executor(), handler_,
+                                        maxRequestUriLength_,
+                                        maxRequestBodyLength_,
+                                        maxHeaderListSize_,
+                                        outputCompressor_,
+                                        peerInitialWindowSize_,
+                                        initialWindowSize_);
+  streams_[streamID].reset(stream);
+  scheduler_.open(streamID);
+
+  bool decoded = decoder_.decode(
+      headerBlock,
+      [stream](const BufferRef& name, const BufferRef& value) {
+        stream->onRequestHeader(name, value);
+      });
+
+  if (!decoded) {
+    onConnectionError(ErrorCode::CompressionError, "Invalid header block.");
+    return;
+  }
+
+  if (!stream->onRequestHeadersEnd(last)) {
+    stream->localClosed_ = true;
+    resetStream(stream, ErrorCode::ProtocolError);
+  }
+}
+
+void Http2Connection::onPriority(unsigned streamID, bool exclusive,
+                                 unsigned dependencyStreamID,
+                                 unsigned weight) {
+  if (streamID == dependencyStreamID) {
+    // a stream cannot depend on itself (rfc7540, 5.3.1)
+    onStreamError(streamID, ErrorCode::ProtocolError,
+                  "Stream depends on itself.");
+    return;
+  }
+
+  TRACE("%p onPriority: stream %u depends on %u%s, weight %u", this,
+        streamID, dependencyStreamID, exclusive ? " exclusively" : "", weight);
+
+  scheduler_.setPriority(streamID, dependencyStreamID, weight, exclusive);
+}
+
+void Http2Connection::onResetStream(unsigned streamID, ErrorCode errorCode) {
+  TRACE("%p onResetStream: stream %u, %s", this, streamID,
+        to_string(errorCode).c_str());
+
+  Http2Stream* stream = findStream(streamID);
+  if (!stream) {
+    if (isIdle(streamID)) {
+      onConnectionError(ErrorCode::ProtocolError,
+                        "RST_STREAM frame on idle stream.");
+    }
+    return;
+  }
+
+  stream->onReset();
+
+  if (stream->isLocalClosed()) {
+    closeStream(stream);
+  }
+}
+
+void Http2Connection::onSettings(
+    const std::vector<std::pair<SettingsParameter, uint32_t>>& params) {
+  for (const auto& param: params) {
+    TRACE("%p onSettings: %s = %u", this, to_string(param.first).c_str(),
+          param.second);
+
+    switch (param.first) {
+      case SettingsParameter::HeaderTableSize:
+        encoder_.setMaxTableSize(
+            std::min(static_cast<size_t>(param.second),
+                     DefaultHeaderTableSize));
+        break;
+      case SettingsParameter::InitialWindowSize: {
+        // rfc7540, 6.9.2: adjust the windows of all open streams
+        const long delta = static_cast<long>(param.second) -
+                           static_cast<long>(peerInitialWindowSize_);
+        peerInitialWindowSize_ = param.second;
+
+        for (auto& entry: streams_) {
+          if (!entry.second->adjustSendWindow(delta)) {
+            onConnectionError(ErrorCode::FlowControlError,
+                              "Stream flow control window overflow.");
+            return;
+          }
+          if (entry.second->hasPendingOutput()) {
+            scheduleOutput(entry.second.get());
+          }
+        }
+        break;
+      }
+      case SettingsParameter::MaxFrameSize:
+        generator_.setMaxFrameSize(param.second);
+        break;
+      case SettingsParameter::EnablePush:
+        pushEnabled_ = param.second != 0;
+        break;
+      case SettingsParameter::MaxConcurrentStreams:
+        // limits the streams we initiate, that is, pushed ones
+        peerMaxConcurrentStreams_ = param.second;
+        break;
+      default:
+        break;
+    }
+  }
+
+  generator_.generateSettingsAck();
+  wantOutput();
+}
+
+void Http2Connection::onSettingsAck() {
+  TRACE("%p onSettingsAck", this);
+}
+
+void Http2Connection::onPushPromise(unsigned streamID,
+                                    unsigned promisedStreamID,
+                                    const BufferRef& headerBlock) {
+  onConnectionError(ErrorCode::ProtocolError,
+                    "PUSH_PROMISE frame sent by client.");
+}
+
+void Http2Connection::onPing(const BufferRef& data, bool ack) {
+  if (!ack) {
+    generator_.generatePing(data, true);
+    wantOutput();
+  }
+}
+
+void Http2Connection::onGoAway(unsigned lastStreamID, ErrorCode errorCode,
+                               const BufferRef& debugData) {
+  TRACE("%p onGoAway: lastStreamID=%u, %s", this, lastStreamID,
+        to_string(errorCode).c_str());
+
+  goAwayReceived_ = true;
+  checkShutdown();
+}
+
+void Http2Connection::onWindowUpdate(unsigned streamID, size_t increment) {
+  if (streamID == 0) {
+    if (sendWindow_ + static_cast<long>(increment) >
+        static_cast<long>(MaxWindowSize)) {
+      onConnectionError(ErrorCode::FlowControlError,
+                        "Connection flow control window overflow.");
+      return;
+    }
+
+    sendWindow_ += increment;
+
+    for (auto& entry: streams_) {
+      if (entry.second->hasPendingOutput()) {
+        scheduleOutput(entry.second.get());
+      }
+    }
+    return;
+  }
+
+  Http2Stream* stream = findStream(streamID);
+  if (!stream) {
+    if (isIdle(streamID)) {
+      onConnectionError(ErrorCode::ProtocolError,
+                        "WINDOW_UPDATE frame on idle stream.");
+    }
+    return;
+  }
+
+  if (!stream->adjustSendWindow(increment)) {
+    resetStream(stream, ErrorCode::FlowControlError);
+    return;
+  }
+
+  if (stream->hasPendingOutput()) {
+    scheduleOutput(stream);
+  }
+}
+
+void Http2Connection::onConnectionError(ErrorCode errorCode,
+                                        const std::string& message) {
+  TRACE("%p onConnectionError: %s: %s", this, to_string(errorCode).c_str(),
+        message.c_str());
+
+  if (closing_)
+    return;
+
+  closing_ = true;
+  generator_.generateGoAway(lastStreamID_, errorCode, BufferRef(message));
+  wantOutput();
+}
+
+void Http2Connection::onStreamError(unsigned streamID, ErrorCode errorCode,
+                                    const std::string& message) {
+  TRACE("%p onStreamError: stream %u, %s: %s", this, streamID,
+        to_string(errorCode).c_str(), message.c_str());
+
+  if (Http2Stream* stream = findStream(streamID)) {
+    resetStream(stream, errorCode);
+  } else {
+    generator_.generateResetStream(streamID, errorCode);
+    wantOutput();
+  }
+}
+// }}}
+// {{{ output
+void Http2Connection::sendHeaders(unsigned streamID, Buffer&& headerBlock,
+                                  bool last) {
+  generator_.generateHeaders(streamID, std::move(headerBlock), last);
+  wantOutput();
+}
+
+void Http2Connection::scheduleOutput(Http2Stream* stream) {
+  scheduler_.setReady(stream->id(), true);
+  wantOutput();
+}
+
+void Http2Connection::addCompletion(CompletionHandler&& onComplete) {
+  completions_.emplace_back(std::move(onComplete));
+  wantOutput();
+}
+
+void Http2Connection::retainUntilFlushed(Buffer&& data) {
+  retainedBuffers_.emplace_back(std::move(data));
+}
+
+void Http2Connection::retainUntilFlushed(FileRef&& file) {
+  retainedFiles_.emplace_back(std::move(file));
+}
+
+bool Http2Connection::pushPromise(Http2Stream* parent,
+                                  const std::string& path) {
+  if (!pushEnabled_ || closing_ || goAwayReceived_ ||
+      pushedStreams_ >= peerMaxConcurrentStreams_ ||
+      nextPushStreamID_ > MaxStreamID) {
+    TRACE("%p pushPromise: not pushing %s", this, path.c_str());
+    return false;
+  }
+
+  const unsigned promisedStreamID = nextPushStreamID_;
+  nextPushStreamID_ += 2;
+
+  TRACE("%p pushPromise: stream %u promises %u: %s", this, parent->id(),
+        promisedStreamID, path.c_str());
+
+  // the promised request, with the request header fields that affect the
+  // response's representation taken over from the parent request.
+  HeaderFieldList request;
+  request.push_back(":method", "GET");
+  request.push_back(":scheme", parent->scheme_);
+  request.push_back(":authority", !parent->authority_.empty()
+                                      ? parent->authority_
+                                      : parent->requestHeaders_.get("host"));
+  request.push_back(":path", path);
+
+  for (const char* name: {"accept-encoding", "accept-language", "user-agent"})
+    if (parent->requestHeaders_.contains(name))
+      request.push_back(name, parent->requestHeaders_.get(name));
+
+  Buffer headerBlock;
+  for (const HeaderField& field: request)
+    encoder_.encode(BufferRef(field.name()), BufferRef(field.value()),
+                    &headerBlock);
+
+  generator_.generatePushPromise(parent->id(), promisedStreamID,
+                                 headerBlock.ref());
+
+  // pushed streams are half-closed (remote) right away (rfc7540, 8.2.1)
+  Http2Stream* stream = new Http2Stream(promisedStreamID, this, executor(),
+                                        handler_,
+                                        maxRequestUriLength_,
+                                        maxRequestBodyLength_,
+                                        maxHeaderListSize_,
+                                        outputCompressor_,
+                                        peerInitialWindowSize_,
+                                        0);
+  streams_[promisedStreamID].reset(stream);
+  ++pushedStreams_;
+
+  scheduler_.open(promisedStreamID);
+  scheduler_.setPriority(promisedStreamID, parent->id(),
+                         StreamScheduler::DefaultWeight, false);
+
+  for (const HeaderField& field: request)
+    stream->onRequestHeader(BufferRef(field.name()), BufferRef(field.value()));
+
+  // dispatching the promised request right here would run the handler
+  // from within the one of the parent request.
+  pendingPushes_.push_back(promisedStreamID);
+  wantOutput();
+
+  return true;
+}
+
+void Http2Connection::dispatchPushes() {
+  std::vector<unsigned> pushes;
+  pushes.swap(pendingPushes_);
+
+  for (unsigned streamID: pushes) {
+    Http2Stream* stream = findStream(streamID);
+    if (!stream)
+      continue;
+
+    if (stream->isReset()) {
+      // cancelled by the client before it got dispatched
+      stream->localClosed_ = true;
+      closeStream(stream);
+    } else if (!stream->onRequestHeadersEnd(true)) {
+      stream->localClosed_ = true;
+      resetStream(stream, ErrorCode::InternalError);
+    }
+  }
+}
+
+void Http2Connection::setCorking(bool enable) {
+  if (endpoint()->isCorking() != enable) {
+    endpoint()->setCorking(enable);
+  }
+}
+
+void Http2Connection::resetStream(Http2Stream* stream, ErrorCode errorCode) {
+  TRACE("%p resetStream: stream %u, %s", this, stream->id(),
+        to_string(errorCode).c_str());
+
+  generator_.generateResetStream(stream->id(), errorCode);
+  stream->onReset();
+  wantOutput();
+
+  // otherwise the stream is closed once its response got completed
+  if (stream->isLocalClosed()) {
+    closeStream(stream);
+  }
+}
+
+void Http2Connection::closeStream(Http2Stream* stream) {
+  auto i = streams_.find(stream->id());
+  if (i == streams_.end())
+    return;
+
+  TRACE("%p closeStream: stream %u", this, stream->id());
+
+  if ((stream->id() & 1) == 0)
+    --pushedStreams_;
+
+  scheduler_.close(stream->id());
+
+  // streams are destroyed once all their completion handlers have been
+  // invoked, see onFlushable().
+  closedStreams_.emplace_back(std::move(i->second));
+  streams_.erase(i);
+
+  wantOutput();
+}
+
+Http2Stream* Http2Connection::findStream(unsigned streamID) const {
+  auto i = streams_.find(streamID);
+  return i != streams_.end() ? i->second.get() : nullptr;
+}
+
+bool Http2Connection::isIdle(unsigned streamID) const XZERO_NOEXCEPT {
+  return (streamID & 1) ? streamID > lastStreamID_
+                        : streamID >= nextPushStreamID_;
+}
+
+void Http2Connection::wantOutput() {
+  if (!flushing_) {
+    flushing_ = true;
+    wantFlush();
+  }
+}
+
+void Http2Connection::generateOutput() {
+  size_t generated = 0;
+
+  while (generated < MaxOutputBatch) {
+    const unsigned streamID = scheduler_.next();
+    if (streamID == 0)
+      break;
+
+    Http2Stream* stream = findStream(streamID);
+    if (!stream) {
+      scheduler_.setReady(streamID, false);
+      continue;
+    }
+
+    const size_t window = sendWindow_ > 0 ? sendWindow_ : 0;
+    const size_t n = stream->generateOutput(&generator_, window);
+    sendWindow_ -= n;
+    generated += n;
+    scheduler_.consumed(streamID, n);
+
+    // streams blocked by flow control get rescheduled on WINDOW_UPDATE
+    if (n == 0 || !stream->hasPendingOutput()) {
+      scheduler_.setReady(streamID, false);
+    }
+  }
+}
+
+void Http2Connection::onFlushable() {
+  TRACE("%p onFlushable", this);
+
+  if (!closing_ && !pendingPushes_.empty())
+    dispatchPushes();
+
+  // the next batch is generated once the previous one has been flushed,
+  // so that it reflects the priorities at that time.
+  if (!closing_ && writer_.empty())
+    generateOutput();
+
+  if (!writer_.flush(endpoint())) {
+    wantFlush();
+    return;
+  }
+
+  retainedBuffers_.clear();
+  retainedFiles_.clear();
+  setCorking(false);
+
+  std::vector<CompletionHandler> completions;
+  completions.swap(completions_);
+
+  std::vector<std::unique_ptr<Http2Stream>> closedStreams;
+  closedStreams.swap(closedStreams_);
+
+  for (CompletionHandler& completion: completions)
+    completion(true);
+
+  closedStreams.clear();
+
+  if (closing_) {
+    TRACE("%p onFlushable: closing", this);
+    endpoint()->close();
+    return;
+  }
+
+  if (!writer_.empty() || scheduler_.next() != 0 || !completions_.empty() ||
+      !closedStreams_.empty() || !pendingPushes_.empty()) {
+    wantFlush();
+    return;
+  }
+
+  flushing_ = false;
+  checkShutdown();
+}
+
+void Http2Connection::checkShutdown() {
+  if ((inputClosed_ || goAwayReceived_) && streams_.empty() && !flushing_ &&
+      !closing_) {
+    TRACE("%p checkShutdown: closing", this);
+    closing_ = true;
+    endpoint()->close();
+  }
+}
+
+void Http2Connection::onInterestFailure(const std::exception& error) {
+  TRACE("%p onInterestFailure(%s): %s", this, typeid(error).name(),
+        error.what());
+
+  logError("Http2Connection", error);
+
+  std::vector<CompletionHandler> completions;
+  completions.swap(completions_);
+
+  for (CompletionHandler& completion: completions)
+    completion(false);
+
+  closing_ = true;
+  endpoint()->close();
+}
+// }}}
+
+}  // namespace http2
+}  // namespace xzero
@@ -0,0 +1,202 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <xzero-http/Api.h>
+#include <xzero-http/HttpHandler.h>
+#include <xzero-http/http2/http2.h>
+#include <xzero-http/http2/hpack.h>
+#include <xzero-http/http2/FrameListener.h>
+#include <xzero-http/http2/FrameParser.h>
+#include <xzero-http/http2/FrameGenerator.h>
+#include <xzero-http/http2/Http2Stream.h>
+#include <xzero-http/http2/StreamScheduler.h>
+#include <xzero-base/net/Connection.h>
+#include <xzero-base/net/EndPointWriter.h>
+#include <xzero-base/CompletionHandler.h>
+#include <xzero-base/Buffer.h>
+#include <xzero-base/io/FileRef.h>
+#include <unordered_map>
+#include <memory>
+#include <vector>
+
+namespace xzero {
+
+class HttpDateGenerator;
+class HttpOutputCompressor;
+
+namespace http2 {
+
+/**
+ * Implements a HTTP/2 transport connection (RFC 7540).
+ *
+ * Each request is carried by its own Http2Stream. Response data of all
+ * streams is multiplexed onto the connection one frame at a time, in the
+ * order given by the StreamScheduler according to the stream priorities,
+ * within the limits of the stream and connection flow control windows.
+ * Frames of multiple streams are generated in batches, so that they go out
+ * with a single gathered write.
+ *
+ * Request body data is consumed right away, so receive windows are
+ * replenished as soon as half of them got used up.
+ */
+class XZERO_HTTP_API Http2Connection : public Connection, public FrameListener {
+ public:
+  Http2Connection(EndPoint* endpoint,
+                  Executor* executor,
+                  const HttpHandler& handler,
+                  HttpDateGenerator* dateGenerator,
+                  HttpOutputCompressor* outputCompressor,
+                  size_t maxRequestUriLength,
+                  size_t maxRequestBodyLength,
+                  size_t maxConcurrentStreams,
+                  size_t initialWindowSize,
+                  size_t maxHeaderListSize);
+  ~Http2Connection();
+
+  /**
+   * Passes on data that has already been read from the endpoint, such as
+   * a connection preface received by the HTTP/1 connection that handed
+   * over the endpoint. Must be invoked before onOpen().
+   */
+  void takeInput(const BufferRef& data);
+
+  /** Number of currently open streams. */
+  size_t streamCount() const XZERO_NOEXCEPT { return streams_.size(); }
+
+  void onOpen() override;
+  void onClose() override;
+  void setInputBufferSize(size_t size) override;
+
+ private:
+  friend class Http2Stream;
+
+  // Connection overrides
+  void onFillable() override;
+  void onFlushable() override;
+  void onInterestFailure(const std::exception& error) override;
+
+  // FrameListener overrides
+  void onData(unsigned streamID, const BufferRef& data,
+              size_t flowControlled, bool last) override;
+  void onHeaders(unsigned streamID, const BufferRef& headerBlock,
+                 bool last) override;
+  void onPriority(unsigned streamID, bool exclusive,
+                  unsigned dependencyStreamID, unsigned weight) override;
+  void onResetStream(unsigned streamID, ErrorCode errorCode) override;
+  void onSettings(
+      const std::vector<std::pair<SettingsParameter, uint32_t>>& params) override;
+  void onSettingsAck() override;
+  void onPushPromise(unsigned streamID, unsigned promisedStreamID,
+                     const BufferRef& headerBlock) override;
+  void onPing(const BufferRef& data, bool ack) override;
+  void onGoAway(unsigned lastStreamID, ErrorCode errorCode,
+                const BufferRef& debugData) override;
+  void onWindowUpdate(unsigned streamID, size_t increment) override;
+  void onConnectionError(ErrorCode errorCode,
+                         const std::string& message) override;
+  void onStreamError(unsigned streamID, ErrorCode errorCode,
+                     const std::string& message) override;
+
+  // stream API
+  HttpDateGenerator* dateGenerator() const XZERO_NOEXCEPT {
+    return dateGenerator_;
+  }
+  hpack::Encoder* headerEncoder() XZERO_NOEXCEPT { return &encoder_; }
+
+  /**
+   * Sends a header block, encoded by headerEncoder() right before.
+   *
+   * Header blocks must be sent in the order they got encoded, as each one
+   * updates the peer's dynamic table.
+   */
+  void sendHeaders(unsigned streamID, Buffer&& headerBlock, bool last);
+  void scheduleOutput(Http2Stream* stream);
+  void addCompletion(CompletionHandler&& onComplete);
+
+  /**
+   * Keeps response data that generated frames refer to until these have
+   * been flushed.
+   */
+  void retainUntilFlushed(Buffer&& data);
+  void retainUntilFlushed(FileRef&& file);
+
+  /**
+   * Promises the response to a GET request for @p path to the client, on
+   * behalf of the request carried by @p parent (rfc7540, 8.2).
+   *
+   * The promised request is dispatched to the handler once the
+   * PUSH_PROMISE frame is about to be sent.
+   *
+   * @retval false the client does not accept any further pushed streams.
+   */
+  bool pushPromise(Http2Stream* parent, const std::string& path);
+  void dispatchPushes();
+
+  void setCorking(bool enable);
+  void resetStream(Http2Stream* stream, ErrorCode errorCode);
+  void closeStream(Http2Stream* stream);
+
+  Http2Stream* findStream(unsigned streamID) const;
+  bool isIdle(unsigned streamID) const XZERO_NOEXCEPT;
+  void processInput();
+  void generateOutput();
+  void wantOutput();
+  void replenishWindows(Http2Stream* stream);
+  void checkShutdown();
+
+ private:
+  HttpHandler handler_;
+  HttpDateGenerator* dateGenerator_;
+  HttpOutputCompressor* outputCompressor_;
+  size_t maxRequestUriLength_;
+  size_t maxRequestBodyLength_;
+  size_t maxConcurrentStreams_;
+  size_t initialWindowSize_;
+  size_t maxHeaderListSize_;
+
+  // input
+  Buffer inputBuffer_;
+  size_t inputOffset_;
+  bool prefaceReceived_;
+  bool inputClosed_;
+  FrameParser parser_;
+  hpack::Decoder decoder_;
+
+  // output
+  EndPointWriter writer_;
+  FrameGenerator generator_;
+  hpack::Encoder encoder_;
+  bool flushing_;
+  bool closing_;
+  StreamScheduler scheduler_;
+  std::vector<CompletionHandler> completions_;
+  std::vector<Buffer> retainedBuffers_;
+  std::vector<FileRef> retainedFiles_;
+
+  // flow control
+  long sendWindow_;
+  size_t recvWindow_;
+  size_t peerInitialWindowSize_;
+
+  // streams
+  std::unordered_map<unsigned, std::unique_ptr<Http2Stream>> streams_;
+  std::vector<std::unique_ptr<Http2Stream>> closedStreams_;
+  unsigned lastStreamID_;
+  bool goAwayReceived_;
+
+  // server push
+  bool pushEnabled_;
+  size_t peerMaxConcurrentStreams_;
+  unsigned nextPushStreamID_;
+  size_t pushedStreams_;
+  std::vector<unsigned> pendingPushes_;
+};
+
+}  // namespace http2
+}  // namespace xzero
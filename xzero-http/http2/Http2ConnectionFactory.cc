@@ -0,0 +1,48 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#include <xzero-http/http2/Http2ConnectionFactory.h>
+#include <xzero-http/http2/Http2Connection.h>
+#include <xzero-http/http2/http2.h>
+#include <xzero-base/net/Connector.h>
+
+namespace xzero {
+namespace http2 {
+
+Http2ConnectionFactory::Http2ConnectionFactory(
+    WallClock* clock,
+    size_t maxRequestUriLength,
+    size_t maxRequestBodyLength,
+    const std::string& protocolName)
+    : HttpConnectionFactory(protocolName, clock, maxRequestUriLength,
+                            maxRequestBodyLength),
+      maxConcurrentStreams_(100),
+      initialWindowSize_(DefaultInitialWindowSize),
+      maxHeaderListSize_(DefaultMaxHeaderListSize) {
+  setInputBufferSize(16 * 1024);
+}
+
+Http2ConnectionFactory::~Http2ConnectionFactory() {
+}
+
+Connection* Http2ConnectionFactory::create(Connector* connector,
+                                           EndPoint* endpoint) {
+  return configure(new Http2Connection(endpoint,
+                                       connector->executor(),
+                                       handler(),
+                                       dateGenerator(),
+                                       outputCompressor(),
+                                       maxRequestUriLength(),
+                                       maxRequestBodyLength(),
+                                       maxConcurrentStreams(),
+                                       initialWindowSize(),
+                                       maxHeaderListSize()),
+                   connector);
+}
+
+}  // namespace http2
+}  // namespace xzero
@@ -0,0 +1,66 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <xzero-http/Api.h>
+#include <xzero-base/sysconfig.h>
+#include <xzero-http/HttpConnectionFactory.h>
+
+namespace xzero {
+namespace http2 {
+
+/**
+ * Connection factory for HTTP/2 connections.
+ *
+ * Register it as @c "h2" on TLS connectors to have it negotiated via ALPN,
+ * or as @c "h2c" next to a HTTP/1 factory to accept cleartext connections
+ * that start with the HTTP/2 connection preface (prior knowledge).
+ */
+class XZERO_HTTP_API Http2ConnectionFactory : public HttpConnectionFactory {
+ public:
+  Http2ConnectionFactory(
+      WallClock* clock,
+      size_t maxRequestUriLength,
+      size_t maxRequestBodyLength,
+      const std::string& protocolName = "h2c");
+
+  ~Http2ConnectionFactory();
+
+  /** Maximum number of concurrently open streams per connection. */
+  size_t maxConcurrentStreams() const XZERO_NOEXCEPT {
+    return maxConcurrentStreams_;
+  }
+  void setMaxConcurrentStreams(size_t value) { maxConcurrentStreams_ = value; }
+
+  /** Flow control window size advertised for request bodies. */
+  size_t initialWindowSize() const XZERO_NOEXCEPT {
+    return initialWindowSize_;
+  }
+  void setInitialWindowSize(size_t value) { initialWindowSize_ = value; }
+
+  /**
+   * Maximum size of request header lists, as announced to clients.
+   *
+   * It limits the HPACK encoded header blocks as well as the decoded
+   * header fields, counted as per @c SETTINGS_MAX_HEADER_LIST_SIZE.
+   */
+  size_t maxHeaderListSize() const XZERO_NOEXCEPT {
+    return maxHeaderListSize_;
+  }
+  void setMaxHeaderListSize(size_t value) { maxHeaderListSize_ = value; }
+
+  Connection* create(Connector* connector, EndPoint* endpoint) override;
+
+ private:
+  size_t maxConcurrentStreams_;
+  size_t initialWindowSize_;
+  size_t maxHeaderListSize_;
+};
+
+}  // namespace http2
+}  // namespace xzero
@@ -0,0 +1,583 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#include <xzero-http/http2/Http2Stream.h>
+#include <xzero-http/http2/Http2Connection.h>
+#include <xzero-http/http2/FrameGenerator.h>
+#include <xzero-http/HttpChannel.h>
+#include <xzero-http/HttpBufferedInput.h>
+#include <xzero-http/HttpDateGenerator.h>
+#include <xzero-http/HttpResponseInfo.h>
+#include <xzero-http/HttpResponse.h>
+#include <xzero-http/BadMessage.h>
+#include <xzero-base/io/FileRef.h>
+#include <xzero-base/RuntimeError.h>
+#include <xzero-base/logging.h>
+#include <algorithm>
+#include <cstdio>
+
+namespace xzero {
+namespace http2 {
+
+#ifndef NDEBUG
+#define TRACE(msg...) logTrace("http2.Http2Stream", msg)
+#else
+#define TRACE(msg...) do {} while (0)
+#endif
+
+/**
+ * Minimum size of a DATA frame carrying file-backed data to be sent via
+ * sendfile. Smaller frames are cheaper to read in than to pay the extra
+ * system calls for.
+ */
+static const size_t MinSendfileFrameSize = 64 * 1024;
+
+/**
+ * Small chunks are appended to the last pending one up to this size, so
+ * that they go out within a common DATA frame.
+ */
+static const size_t MaxCoalesceSize = DefaultMaxFrameSize;
+
+/**
+ * Tests whether given header field name is specific to HTTP/1 connections
+ * and thus not allowed in HTTP/2 (rfc7540, 8.1.2.2).
+ */
+static bool isConnectionSpecific(const BufferRef& name) {
+  return iequals(name, "connection") || iequals(name, "keep-alive") ||
+         iequals(name, "proxy-connection") ||
+         iequals(name, "transfer-encoding") || iequals(name, "upgrade");
+}
+
+Http2Stream::Http2Stream(unsigned id,
+                         Http2Connection* connection,
+                         Executor* executor,
+                         const HttpHandler& handler,
+                         size_t maxRequestUriLength,
+                         size_t maxRequestBodyLength,
+                         size_t maxHeaderListSize,
+                         HttpOutputCompressor* outputCompressor,
+                         size_t sendWindow,
+                         size_t recvWindow)
+    : HttpTransport(nullptr /*endpoint*/, executor),
+      id_(id),
+      connection_(connection),
+      channel_(new HttpChannel(this, handler,
+                               std::unique_ptr<HttpInput>(
+                                   new HttpBufferedInput()),
+                               maxRequestUriLength, maxRequestBodyLength,
+                               outputCompressor)),
+      method_(),
+      path_(),
+      scheme_(),
+      authority_(),
+      requestHeaders_(),
+      cookies_(),
+      headerListSize_(0),
+      maxHeaderListSize_(maxHeaderListSize),
+      malformed_(false),
+      remoteClosed_(false),
+      localClosed_(false),
+      reset_(false),
+      endPending_(false),
+      headResponse_(false),
+      sendWindow_(sendWindow),
+      recvWindow_(recvWindow),
+      output_(),
+      outputSize_(0),
+      onComplete_() {
+  TRACE("%p ctor: stream %u", this, id);
+}
+
+Http2Stream::~Http2Stream() {
+  TRACE("%p dtor: stream %u", this, id_);
+}
+
+void Http2Stream::onRequestHeader(const BufferRef& name,
+                                  const BufferRef& value) {
+  // each field counts with 32 octets of overhead (rfc7540, 6.5.2)
+  headerListSize_ += name.size() + value.size() + 32;
+  if (headerListSize_ > maxHeaderListSize_)
+    return;
+
+  if (name.empty()) {
+    malformed_ = true;
+    return;
+  }
+
+  if (name[0] == ':') {
+    // pseudo header fields must preceed regular ones (rfc7540, 8.1.2.1)
+    if (!requestHeaders_.empty() || !cookies_.empty()) {
+      malformed_ = true;
+      return;
+    }
+
+    std::string* target = nullptr;
+    if (name == ":method")
+      target = &method_;
+    else if (name == ":path")
+      target = &path_;
+    else if (name == ":scheme")
+      target = &scheme_;
+    else if (name == ":authority")
+      target = &authority_;
+
+    if (!target || !target->empty()) {
+      malformed_ = true;
+      return;
+    }
+
+    target->assign(value.data(), value.size());
+    return;
+  }
+
+  if (std::any_of(name.begin(), name.end(), ::isupper) ||
+      isConnectionSpecific(name) || (name == "te" && !(value == "trailers"))) {
+    malformed_ = true;
+    return;
+  }
+
+  // multiple cookie fields get concatenated (rfc7540, 8.1.2.5)
+  if (name == "cookie") {
+    if (!cookies_.empty())
+      cookies_ += "; ";
+    cookies_.append(value.data(), value.size());
+    return;
+  }
+
+  requestHeaders_.push_back(name.str(), value.str());
+}
+
+bool Http2Stream::onRequestHeadersEnd(bool last) {
+  if (malformed_ || method_.empty() ||
+      (method_ != "CONNECT" && (path_.empty() || scheme_.empty()))) {
+    TRACE("%p onRequestHeadersEnd: malformed request", this);
+    return false;
+  }
+
+  remoteClosed_ = last;
+
+  try {
+    if (!channel_->onMessageBegin(BufferRef(method_), BufferRef(path_),
+                                  HttpVersion::VERSION_2_0))
+      return true;
+
+    if (headerListSize_ > maxHeaderListSize_) {
+      channel_->setState(HttpChannelState::HANDLING);
+      throw BadMessage(HttpStatus::RequestHeaderFieldsTooLarge);
+    }
+
+    if (!authority_.empty() && !requestHeaders_.contains("host"))
+      channel_->onMessageHeader(BufferRef("host"), BufferRef(authority_));
+
+    for (const HeaderField& field: requestHeaders_)
+      channel_->onMessageHeader(BufferRef(field.name()),
+                                BufferRef(field.value()));
+
+    if (!cookies_.empty())
+      channel_->onMessageHeader(BufferRef("cookie"), BufferRef(cookies_));
+
+    channel_->onMessageHeaderEnd();
+
+    if (last) {
+      channel_->onMessageEnd();
+    }
+  } catch (const BadMessage& e) {
+    TRACE("%p onRequestHeadersEnd: BadMessage caught. %s", this, e.what());
+    channel_->response()->sendError(e.httpCode(), e.what());
+  }
+
+  return true;
+}
+
+void Http2Stream::onRequestData(const BufferRef& data, bool last) {
+  if (remoteClosed_)
+    return;
+
+  remoteClosed_ = last;
+
+  try {
+    if (!data.empty())
+      channel_->onMessageContent(data);
+
+    if (last)
+      channel_->onMessageEnd();
+  } catch (const BadMessage& e) {
+    TRACE("%p onRequestData: BadMessage caught. %s", this, e.what());
+    channel_->response()->sendError(e.httpCode(), e.what());
+  }
+}
+
+void Http2Stream::onReset() {
+  TRACE("%p onReset: stream %u", this, id_);
+
+  reset_ = true;
+  remoteClosed_ = true;
+  dropOutput();
+
+  if (onComplete_) {
+    CompletionHandler callback = std::move(onComplete_);
+    onComplete_ = nullptr;
+    connection_->addCompletion([callback](bool) { callback(false); });
+  }
+
+  // the response has been completed already, so nobody refers
+  // to this stream anymore.
+  if (endPending_)
+    localClosed_ = true;
+}
+
+bool Http2Stream::adjustSendWindow(long delta) {
+  if (sendWindow_ + delta > static_cast<long>(MaxWindowSize))
+    return false;
+
+  sendWindow_ += delta;
+  return true;
+}
+
+void Http2Stream::dropOutput() {
+  // frames pending in the connection's writer may still refer to the front
+  // chunk, so that one lives on until this stream gets destroyed, which is
+  // not before the connection flushed.
+  while (output_.size() > 1)
+    output_.pop_back();
+
+  if (!output_.empty() && output_.front().offset == 0)
+    output_.clear();
+
+  outputSize_ = 0;
+}
+
+bool Http2Stream::hasPendingOutput() const XZERO_NOEXCEPT {
+  return !reset_ && (outputSize_ > 0 || (endPending_ && !localClosed_));
+}
+
+size_t Http2Stream::generateOutput(FrameGenerator* generator,
+                                   size_t maxBytes) {
+  if (reset_)
+    return 0;
+
+  if (outputSize_ > 0) {
+    const size_t window = sendWindow_ > 0 ? sendWindow_ : 0;
+    const size_t n = std::min(std::min(outputSize_, maxBytes),
+                              std::min(window, generator->maxFrameSize()));
+    if (n == 0)
+      return 0;
+
+    return generateData(generator, n);
+  }
+
+  if (endPending_ && !localClosed_) {
+    const HeaderFieldList& trailers = channel_->response()->trailers();
+
+    if (!trailers.empty()) {
+      hpack::Encoder* encoder = connection_->headerEncoder();
+      Buffer headerBlock;
+      for (const HeaderField& field: trailers)
+        encoder->encode(BufferRef(field.name()), BufferRef(field.value()),
+                        &headerBlock);
+
+      connection_->sendHeaders(id_, std::move(headerBlock), true);
+    } else {
+      generator->generateData(id_, BufferRef(), true);
+    }
+
+    closeLocal();
+  }
+
+  return 0;
+}
+
+size_t Http2Stream::generateData(FrameGenerator* generator, size_t maxBytes) {
+  OutputChunk& chunk = output_.front();
+  const size_t n = std::min(maxBytes, chunk.size() - chunk.offset);
+  const bool consumed = chunk.offset + n == chunk.size();
+  const bool last = endPending_ && n == outputSize_ &&
+                    channel_->response()->trailers().empty();
+
+  if (chunk.file) {
+    FileRef slice(chunk.file->handle(), chunk.file->offset() + chunk.offset,
+                  n, false);
+
+    if (n >= MinSendfileFrameSize) {
+      generator->generateData(id_, std::move(slice), last);
+      connection_->setCorking(true);
+    } else {
+      Buffer data(n);
+      try {
+        slice.fill(&data);
+      } catch (const std::exception& e) {
+        logError("Http2Stream", e);
+        connection_->resetStream(this, ErrorCode::InternalError);
+        return 0;
+      }
+      generator->generateData(id_, std::move(data), last);
+    }
+
+    chunk.offset += n;
+    if (consumed) {
+      connection_->retainUntilFlushed(std::move(*chunk.file));
+      output_.pop_front();
+    }
+  } else if (chunk.offset == 0 && consumed) {
+    generator->generateData(id_, std::move(chunk.buffer), last);
+    output_.pop_front();
+  } else {
+    generator->generateData(id_, chunk.buffer.ref(chunk.offset, n), last);
+
+    chunk.offset += n;
+    if (consumed) {
+      connection_->retainUntilFlushed(std::move(chunk.buffer));
+      output_.pop_front();
+    }
+  }
+
+  outputSize_ -= n;
+  sendWindow_ -= n;
+
+  if (outputSize_ == 0 && onComplete_) {
+    connection_->addCompletion(std::move(onComplete_));
+    onComplete_ = nullptr;
+  }
+
+  if (last)
+    closeLocal();
+
+  return n;
+}
+
+void Http2Stream::closeLocal() {
+  TRACE("%p closeLocal: stream %u", this, id_);
+  localClosed_ = true;
+
+  if (!remoteClosed_) {
+    // response completed before the request did (rfc7540, 8.1)
+    connection_->resetStream(this, ErrorCode::NoError);
+  } else {
+    connection_->closeStream(this);
+  }
+}
+
+void Http2Stream::abort() {
+  TRACE("%p abort: stream %u", this, id_);
+
+  localClosed_ = true;
+
+  if (!reset_) {
+    connection_->resetStream(this, ErrorCode::InternalError);
+  } else {
+    connection_->closeStream(this);
+  }
+}
+
+void Http2Stream::completed() {
+  TRACE("%p completed: stream %u", this, id_);
+
+  endPending_ = true;
+
+  if (reset_) {
+    localClosed_ = true;
+    connection_->closeStream(this);
+    return;
+  }
+
+  connection_->scheduleOutput(this);
+}
+
+bool Http2Stream::push(const std::string& path) {
+  // pushed responses cannot push any further (rfc7540, 8.2.1)
+  if (reset_ || localClosed_ || (id_ & 1) == 0)
+    return false;
+
+  return connection_->pushPromise(this, path);
+}
+
+void Http2Stream::sendResponseInfo(const HttpResponseInfo& info) {
+  if (reset_)
+    return;
+
+  const bool final = static_cast<int>(info.status()) >= 200;
+  hpack::Encoder* encoder = connection_->headerEncoder();
+  Buffer headerBlock;
+  char number[32];
+
+  int n = snprintf(number, sizeof(number), "%d",
+                   static_cast<int>(info.status()));
+  encoder->encode(":status", BufferRef(number, n), &headerBlock);
+
+  if (final) {
+    headResponse_ = info.isHeadResponse();
+
+    if (HttpDateGenerator* dateGenerator = connection_->dateGenerator()) {
+      Buffer date;
+      dateGenerator->fill(&date);
+      encoder->encode("date", date.ref(), &headerBlock);
+    }
+  }
+
+  for (const HeaderField& field: info.headers()) {
+    const BufferRef name(field.name());
+    if (!isConnectionSpecific(name)) {
+      encoder->encode(name, BufferRef(field.value()), &headerBlock);
+    }
+  }
+
+  if (final && info.hasContentLength()) {
+    n = snprintf(number, sizeof(number), "%zu", info.contentLength());
+    encoder->encode("content-length", BufferRef(number, n), &headerBlock);
+  }
+
+  connection_->sendHeaders(id_, std::move(headerBlock), false);
+}
+
+void Http2Stream::queueOutput(const BufferRef& chunk) {
+  if (reset_ || headResponse_ || chunk.empty())
+    return;
+
+  // append to the last chunk, unless a frame refers to it already
+  if (output_.empty() || output_.back().file || output_.back().offset != 0 ||
+      output_.back().buffer.size() + chunk.size() > MaxCoalesceSize) {
+    output_.emplace_back();
+    output_.back().offset = 0;
+  }
+
+  output_.back().buffer.push_back(chunk);
+  outputSize_ += chunk.size();
+  connection_->scheduleOutput(this);
+}
+
+void Http2Stream::queueOutput(Buffer&& chunk) {
+  if (chunk.size() <= MaxCoalesceSize / 4) {
+    queueOutput(chunk.ref());
+    return;
+  }
+
+  if (reset_ || headResponse_)
+    return;
+
+  outputSize_ += chunk.size();
+  output_.emplace_back();
+  output_.back().buffer = std::move(chunk);
+  output_.back().offset = 0;
+  connection_->scheduleOutput(this);
+}
+
+void Http2Stream::queueOutput(FileRef&& chunk) {
+  if (reset_ || headResponse_ || chunk.size() == 0)
+    return;
+
+  outputSize_ += chunk.size();
+  output_.emplace_back();
+  output_.back().file.reset(new FileRef(std::move(chunk)));
+  output_.back().offset = 0;
+  connection_->scheduleOutput(this);
+}
+
+void Http2Stream::setCompletion(CompletionHandler&& onComplete) {
+  if (!onComplete)
+    return;
+
+  if (reset_) {
+    CompletionHandler callback = std::move(onComplete);
+    connection_->addCompletion([callback](bool) { callback(false); });
+    return;
+  }
+
+  if (outputSize_ > 0) {
+    // invoked once the pending data has been flushed
+    onComplete_ = std::move(onComplete);
+  } else {
+    connection_->addCompletion(std::move(onComplete));
+  }
+}
+
+void Http2Stream::send(HttpResponseInfo&& responseInfo,
+                       const BufferRef& chunk,
+                       CompletionHandler onComplete) {
+  if (onComplete && onComplete_)
+    // "there is still another completion hook."
+    RAISE(IllegalStateError);
+
+  TRACE("%p send(BufferRef, status=%d, chunkSize=%zu)",
+        this, responseInfo.status(), chunk.size());
+
+  sendResponseInfo(responseInfo);
+  queueOutput(chunk);
+  setCompletion(std::move(onComplete));
+}
+
+void Http2Stream::send(HttpResponseInfo&& responseInfo,
+                       Buffer&& chunk,
+                       CompletionHandler onComplete) {
+  if (onComplete && onComplete_)
+    // "there is still another completion hook."
+    RAISE(IllegalStateError);
+
+  TRACE("%p send(Buffer, status=%d, chunkSize=%zu)",
+        this, responseInfo.status(), chunk.size());
+
+  sendResponseInfo(responseInfo);
+  queueOutput(std::move(chunk));
+  setCompletion(std::move(onComplete));
+}
+
+void Http2Stream::send(HttpResponseInfo&& responseInfo,
+                       FileRef&& chunk,
+                       CompletionHandler onComplete) {
+  if (onComplete && onComplete_)
+    // "there is still another completion hook."
+    RAISE(IllegalStateError);
+
+  TRACE("%p send(FileRef, status=%d, chunkSize=%zu)",
+        this, responseInfo.status(), chunk.size());
+
+  sendResponseInfo(responseInfo);
+  send(std::move(chunk), std::move(onComplete));
+}
+
+void Http2Stream::send(const BufferRef& chunk, CompletionHandler onComplete) {
+  if (onComplete && onComplete_)
+    // "there is still another completion hook."
+    RAISE(IllegalStateError);
+
+  TRACE("%p send(BufferRef, chunkSize=%zu)", this, chunk.size());
+
+  queueOutput(chunk);
+  setCompletion(std::move(onComplete));
+}
+
+void Http2Stream::send(Buffer&& chunk, CompletionHandler onComplete) {
+  if (onComplete && onComplete_)
+    // "there is still another completion hook."
+    RAISE(IllegalStateError);
+
+  TRACE("%p send(Buffer, chunkSize=%zu)", this, chunk.size());
+
+  queueOutput(std::move(chunk));
+  setCompletion(std::move(onComplete));
+}
+
+void Http2Stream::send(FileRef&& chunk, CompletionHandler onComplete) {
+  if (onComplete && onComplete_)
+    // "there is still another completion hook."
+    RAISE(IllegalStateError);
+
+  TRACE("%p send(FileRef, chunkSize=%zu)", this, chunk.size());
+
+  queueOutput(std::move(chunk));
+  setCompletion(std::move(onComplete));
+}
+
+void Http2Stream::onFillable() {
+  // request data is passed in by the connection
+}
+
+void Http2Stream::onFlushable() {
+  // response data is flushed by the connection
+}
+
+}  // namespace http2
+}  // namespace xzero
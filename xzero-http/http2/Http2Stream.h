@@ -0,0 +1,198 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <xzero-http/Api.h>
+#include <xzero-http/HttpTransport.h>
+#include <xzero-http/HttpHandler.h>
+#include <xzero-http/HeaderFieldList.h>
+#include <xzero-http/http2/http2.h>
+#include <xzero-base/Buffer.h>
+#include <xzero-base/io/FileRef.h>
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace xzero {
+
+class HttpChannel;
+class HttpOutputCompressor;
+
+namespace http2 {
+
+class Http2Connection;
+class FrameGenerator;
+
+/**
+ * A single HTTP/2 stream, carrying one request/response exchange.
+ *
+ * The stream is the HttpTransport of its own HttpChannel. It has no
+ * EndPoint of its own; request frames are passed in by its Http2Connection,
+ * and response data is queued up here until the connection's scheduler and
+ * flow control allow sending it.
+ *
+ * Queued data is framed without copying where possible: DATA frames refer
+ * to the queued buffers, and file-backed chunks are either sent via
+ * sendfile, if the frame is large enough, or read in frame by frame.
+ */
+class XZERO_HTTP_API Http2Stream : public HttpTransport {
+ public:
+  Http2Stream(unsigned id,
+              Http2Connection* connection,
+              Executor* executor,
+              const HttpHandler& handler,
+              size_t maxRequestUriLength,
+              size_t maxRequestBodyLength,
+              size_t maxHeaderListSize,
+              HttpOutputCompressor* outputCompressor,
+              size_t sendWindow,
+              size_t recvWindow);
+  ~Http2Stream();
+
+  unsigned id() const XZERO_NOEXCEPT { return id_; }
+  HttpChannel* channel() const XZERO_NOEXCEPT { return channel_.get(); }
+
+  /**
+   * Passes on a decoded request header field.
+   *
+   * Fields beyond the maximum header list size are dropped, and the request
+   * gets answered with @c 431.
+   */
+  void onRequestHeader(const BufferRef& name, const BufferRef& value);
+
+  /**
+   * Completes the request header block and starts handling the request.
+   *
+   * @retval true success.
+   * @retval false malformed request, the stream is to be reset with
+   *               @c PROTOCOL_ERROR.
+   */
+  bool onRequestHeadersEnd(bool last);
+
+  /** Passes on request body data. */
+  void onRequestData(const BufferRef& data, bool last);
+
+  /** Invoked when the peer reset this stream. */
+  void onReset();
+
+  /** Whether the peer will not send anymore frames on this stream. */
+  bool isRemoteClosed() const XZERO_NOEXCEPT { return remoteClosed_; }
+
+  /** Whether this end will not send anymore frames on this stream. */
+  bool isLocalClosed() const XZERO_NOEXCEPT { return localClosed_; }
+
+  bool isReset() const XZERO_NOEXCEPT { return reset_; }
+
+  /** Current send window, may become negative by a SETTINGS change. */
+  long sendWindow() const XZERO_NOEXCEPT { return sendWindow_; }
+
+  /**
+   * Adjusts the send window by @p delta.
+   *
+   * @retval false the window would exceed its maximum size.
+   */
+  bool adjustSendWindow(long delta);
+
+  /** Number of request body bytes the peer may still send. */
+  size_t recvWindow() const XZERO_NOEXCEPT { return recvWindow_; }
+  void setRecvWindow(size_t value) { recvWindow_ = value; }
+
+  /**
+   * Tests whether there is response data or the end of the response pending
+   * to be generated.
+   */
+  bool hasPendingOutput() const XZERO_NOEXCEPT;
+
+  /**
+   * Generates at most one DATA frame of at most @p maxBytes payload bytes,
+   * or the end of the stream.
+   *
+   * A frame carries data of a single queued chunk only.
+   *
+   * @return number of flow controlled bytes generated.
+   */
+  size_t generateOutput(FrameGenerator* generator, size_t maxBytes);
+
+  // HttpTransport overrides
+  void abort() override;
+  void completed() override;
+  void send(HttpResponseInfo&& responseInfo, const BufferRef& chunk,
+            CompletionHandler onComplete) override;
+  void send(HttpResponseInfo&& responseInfo, Buffer&& chunk,
+            CompletionHandler onComplete) override;
+  void send(HttpResponseInfo&& responseInfo, FileRef&& chunk,
+            CompletionHandler onComplete) override;
+  void send(const BufferRef& chunk, CompletionHandler onComplete) override;
+  void send(Buffer&& chunk, CompletionHandler onComplete) override;
+  void send(FileRef&& chunk, CompletionHandler onComplete) override;
+  bool push(const std::string& path) override;
+
+  // Connection overrides
+  void onFillable() override;
+  void onFlushable() override;
+
+ private:
+  friend class Http2Connection;
+
+  /** A chunk of response body data, pending to be framed. */
+  struct OutputChunk {
+    Buffer buffer;
+    std::unique_ptr<FileRef> file;  //!< set for file-backed chunks
+    size_t offset;                  //!< number of bytes framed already
+
+    size_t size() const XZERO_NOEXCEPT {
+      return file ? file->size() : buffer.size();
+    }
+  };
+
+  void sendResponseInfo(const HttpResponseInfo& info);
+  void queueOutput(const BufferRef& chunk);
+  void queueOutput(Buffer&& chunk);
+  void queueOutput(FileRef&& chunk);
+  size_t generateData(FrameGenerator* generator, size_t n);
+  void dropOutput();
+  void setCompletion(CompletionHandler&& onComplete);
+  void closeLocal();
+
+ private:
+  unsigned id_;
+  Http2Connection* connection_;
+  std::unique_ptr<HttpChannel> channel_;
+
+  // request header block
+  std::string method_;
+  std::string path_;
+  std::string scheme_;
+  std::string authority_;
+  HeaderFieldList requestHeaders_;
+  std::string cookies_;
+  size_t headerListSize_;  //!< decoded size of the request header list
+  size_t maxHeaderListSize_;
+  bool malformed_;
+
+  // stream state
+  bool remoteClosed_;
+  bool localClosed_;
+  bool reset_;
+  bool endPending_;
+  bool headResponse_;
+
+  // flow control
+  long sendWindow_;
+  size_t recvWindow_;
+
+  // pending response data. frames may refer to the front chunk.
+  std::deque<OutputChunk> output_;
+  size_t outputSize_;
+  CompletionHandler onComplete_;
+};
+
+}  // namespace http2
+}  // namespace xzero
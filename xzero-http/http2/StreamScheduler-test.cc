@@ -0,0 +1,164 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#include <xzero-http/http2/StreamScheduler.h>
+#include <map>
+#include <gtest/gtest.h>
+
+using namespace xzero;
+using namespace xzero::http2;
+
+/**
+ * Lets the scheduler pick @p rounds times, each pick sending @p frameSize
+ * bytes, and counts the picks per stream.
+ */
+static std::map<unsigned, size_t> run(StreamScheduler* scheduler,
+                                      size_t rounds, size_t frameSize) {
+  std::map<unsigned, size_t> picks;
+  for (size_t i = 0; i < rounds; ++i) {
+    unsigned id = scheduler->next();
+    if (id == 0)
+      break;
+    picks[id]++;
+    scheduler->consumed(id, frameSize);
+  }
+  return picks;
+}
+
+TEST(StreamScheduler, empty) {
+  StreamScheduler scheduler(16);
+  ASSERT_EQ(0, scheduler.next());
+
+  scheduler.open(1);
+  ASSERT_EQ(0, scheduler.next());
+
+  scheduler.setReady(1, true);
+  ASSERT_EQ(1, scheduler.next());
+
+  scheduler.setReady(1, false);
+  ASSERT_EQ(0, scheduler.next());
+}
+
+TEST(StreamScheduler, weights) {
+  StreamScheduler scheduler(16);
+  scheduler.open(1);
+  scheduler.open(3);
+  scheduler.setPriority(1, 0, 200, false);
+  scheduler.setPriority(3, 0, 100, false);
+  scheduler.setReady(1, true);
+  scheduler.setReady(3, true);
+
+  auto picks = run(&scheduler, 300, 16384);
+  ASSERT_EQ(200, picks[1]);
+  ASSERT_EQ(100, picks[3]);
+}
+
+TEST(StreamScheduler, parentFirst) {
+  StreamScheduler scheduler(16);
+  scheduler.open(1);
+  scheduler.open(3);
+  scheduler.setPriority(3, 1, 16, false);
+  scheduler.setReady(1, true);
+  scheduler.setReady(3, true);
+
+  ASSERT_EQ(1, scheduler.dependencyOf(3));
+  ASSERT_EQ(1, scheduler.next());
+
+  scheduler.setReady(1, false);
+  ASSERT_EQ(3, scheduler.next());
+
+  // dependants take over once the parent is gone
+  scheduler.setReady(1, true);
+  scheduler.close(1);
+  ASSERT_EQ(0, scheduler.dependencyOf(3));
+  ASSERT_EQ(3, scheduler.next());
+}
+
+TEST(StreamScheduler, exclusive) {
+  StreamScheduler scheduler(16);
+  scheduler.open(1);
+  scheduler.open(3);
+  scheduler.open(5);
+  scheduler.setPriority(5, 0, 16, true);
+
+  ASSERT_EQ(0, scheduler.dependencyOf(5));
+  ASSERT_EQ(5, scheduler.dependencyOf(1));
+  ASSERT_EQ(5, scheduler.dependencyOf(3));
+}
+
+TEST(StreamScheduler, dependencyOnDependant) {
+  // rfc7540, 5.3.3: 1 <- 3 <- 5, then 1 is made dependent on 5
+  StreamScheduler scheduler(16);
+  scheduler.open(1);
+  scheduler.open(3);
+  scheduler.open(5);
+  scheduler.setPriority(3, 1, 16, false);
+  scheduler.setPriority(5, 3, 16, false);
+  scheduler.setPriority(1, 5, 16, false);
+
+  ASSERT_EQ(0, scheduler.dependencyOf(5));
+  ASSERT_EQ(5, scheduler.dependencyOf(1));
+  ASSERT_EQ(1, scheduler.dependencyOf(3));
+}
+
+TEST(StreamScheduler, idleStreams) {
+  StreamScheduler scheduler(4);
+
+  // priority groups on idle streams, like some clients build them
+  scheduler.setPriority(3, 0, 201, false);
+  scheduler.setPriority(5, 0, 1, false);
+  ASSERT_EQ(2, scheduler.size());
+
+  scheduler.open(7);
+  scheduler.setPriority(7, 3, 16, false);
+  scheduler.open(9);
+  scheduler.setPriority(9, 5, 16, false);
+  scheduler.setReady(7, true);
+  scheduler.setReady(9, true);
+
+  auto picks = run(&scheduler, 202, 1000);
+  ASSERT_EQ(201, picks[7]);
+  ASSERT_EQ(1, picks[9]);
+
+  // no room left for further idle streams
+  scheduler.setPriority(11, 0, 32, false);
+  ASSERT_FALSE(scheduler.contains(11));
+
+  // while opened streams replace idle ones
+  ASSERT_TRUE(scheduler.open(11));
+  ASSERT_TRUE(scheduler.contains(11));
+  ASSERT_EQ(4, scheduler.size());
+}
+
+TEST(StreamScheduler, closeRedistributesWeight) {
+  StreamScheduler scheduler(16);
+  scheduler.open(1);
+  scheduler.open(3);
+  scheduler.open(5);
+  scheduler.setPriority(1, 0, 64, false);
+  scheduler.setPriority(3, 1, 30, false);
+  scheduler.setPriority(5, 1, 10, false);
+
+  scheduler.close(1);
+  ASSERT_EQ(48, scheduler.weightOf(3));
+  ASSERT_EQ(16, scheduler.weightOf(5));
+}
+
+TEST(StreamScheduler, lateJoinerDoesNotStarve) {
+  StreamScheduler scheduler(16);
+  scheduler.open(1);
+  scheduler.open(3);
+  scheduler.setReady(1, true);
+  run(&scheduler, 100, 16384);
+
+  // equally weighted stream 3 becomes ready and gets its fair share from
+  // now on, but not the share it missed out on.
+  scheduler.setReady(3, true);
+  auto picks = run(&scheduler, 10, 16384);
+  ASSERT_EQ(5, picks[1]);
+  ASSERT_EQ(5, picks[3]);
+}
@@ -0,0 +1,277 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#include <xzero-http/http2/StreamScheduler.h>
+#include <algorithm>
+
+namespace xzero {
+namespace http2 {
+
+/**
+ * Scales the bytes sent through a node to its virtual time, so that the
+ * maximum weight advances it by one per byte.
+ */
+static const uint64_t MaxWeight = 256;
+
+const unsigned StreamScheduler::DefaultWeight;
+
+struct StreamScheduler::Node {
+  unsigned id;
+  unsigned weight;
+  Node* parent;
+  std::vector<Node*> children;
+  bool opened;       //!< whether the stream has been opened (not idle)
+  bool ready;        //!< whether the stream has data pending
+  bool active;       //!< whether this node or any descendant is ready
+  uint64_t cycle;    //!< virtual time among its siblings
+  uint64_t lastCycle;  //!< virtual time of the child that was sent last
+
+  explicit Node(unsigned streamID)
+      : id(streamID),
+        weight(DefaultWeight),
+        parent(nullptr),
+        children(),
+        opened(false),
+        ready(false),
+        active(false),
+        cycle(0),
+        lastCycle(0) {}
+};
+
+StreamScheduler::StreamScheduler(size_t maxNodes)
+    : maxNodes_(maxNodes),
+      root_(new Node(0)),
+      nodes_() {
+}
+
+StreamScheduler::~StreamScheduler() {
+}
+
+bool StreamScheduler::contains(unsigned streamID) const {
+  return find(streamID) != nullptr;
+}
+
+bool StreamScheduler::open(unsigned streamID) {
+  if (Node* node = find(streamID)) {
+    node->opened = true;
+    return true;
+  }
+
+  if (nodes_.size() >= maxNodes_) {
+    // make room by dropping an idle stream
+    for (const auto& entry: nodes_) {
+      if (!entry.second->opened) {
+        close(entry.first);
+        break;
+      }
+    }
+  }
+
+  Node* node = create(streamID);
+  if (!node)
+    return false;
+
+  node->opened = true;
+  attach(node, root_.get());
+  return true;
+}
+
+void StreamScheduler::setPriority(unsigned streamID,
+                                  unsigned dependencyStreamID,
+                                  unsigned weight,
+                                  bool exclusive) {
+  Node* node = find(streamID);
+  if (!node) {
+    node = create(streamID);
+    if (!node)
+      return;
+
+    attach(node, root_.get());
+  }
+
+  Node* parent = dependencyStreamID ? find(dependencyStreamID) : root_.get();
+  if (!parent) {
+    // a dependency on a stream not in the tree gives that one the default
+    // priority (rfc7540, 5.3.1), or makes this one default if out of room.
+    parent = create(dependencyStreamID);
+    if (parent) {
+      attach(parent, root_.get());
+    } else {
+      parent = root_.get();
+      weight = DefaultWeight;
+      exclusive = false;
+    }
+  }
+
+  // depending on one of its own dependants moves that dependant up first
+  // (rfc7540, 5.3.3)
+  if (isDescendant(parent, node)) {
+    Node* formerParent = node->parent;
+    detach(parent);
+    attach(parent, formerParent);
+  }
+
+  detach(node);
+  node->weight = std::max(1u, std::min(weight, 256u));
+
+  if (exclusive) {
+    std::vector<Node*> children = parent->children;
+    for (Node* child: children) {
+      detach(child);
+      attach(child, node);
+    }
+  }
+
+  attach(node, parent);
+}
+
+void StreamScheduler::close(unsigned streamID) {
+  auto i = nodes_.find(streamID);
+  if (i == nodes_.end())
+    return;
+
+  Node* node = i->second.get();
+  Node* parent = node->parent;
+
+  // dependants take over the share of the closed stream (rfc7540, 5.3.4)
+  unsigned total = 0;
+  for (const Node* child: node->children)
+    total += child->weight;
+
+  std::vector<Node*> children = node->children;
+  for (Node* child: children) {
+    detach(child);
+    child->weight = std::max(1u, node->weight * child->weight / total);
+    attach(child, parent);
+  }
+
+  detach(node);
+  nodes_.erase(i);
+}
+
+void StreamScheduler::setReady(unsigned streamID, bool ready) {
+  Node* node = find(streamID);
+  if (!node || node->ready == ready)
+    return;
+
+  node->ready = ready;
+  updateActive(node);
+}
+
+bool StreamScheduler::isReady(unsigned streamID) const {
+  const Node* node = find(streamID);
+  return node && node->ready;
+}
+
+unsigned StreamScheduler::next() const {
+  const Node* node = root_.get();
+
+  while (node->active) {
+    if (node->ready)
+      return node->id;
+
+    const Node* best = nullptr;
+    for (const Node* child: node->children)
+      if (child->active && (!best || child->cycle < best->cycle))
+        best = child;
+
+    if (!best)
+      break;
+
+    node = best;
+  }
+
+  return 0;
+}
+
+void StreamScheduler::consumed(unsigned streamID, size_t bytes) {
+  Node* node = find(streamID);
+  if (!node)
+    return;
+
+  for (; node->parent != nullptr; node = node->parent) {
+    node->parent->lastCycle = node->cycle;
+    node->cycle += bytes * MaxWeight / node->weight;
+  }
+}
+
+unsigned StreamScheduler::dependencyOf(unsigned streamID) const {
+  const Node* node = find(streamID);
+  return node && node->parent ? node->parent->id : 0;
+}
+
+unsigned StreamScheduler::weightOf(unsigned streamID) const {
+  const Node* node = find(streamID);
+  return node ? node->weight : DefaultWeight;
+}
+
+StreamScheduler::Node* StreamScheduler::find(unsigned streamID) const {
+  auto i = nodes_.find(streamID);
+  return i != nodes_.end() ? i->second.get() : nullptr;
+}
+
+StreamScheduler::Node* StreamScheduler::create(unsigned streamID) {
+  if (nodes_.size() >= maxNodes_)
+    return nullptr;
+
+  Node* node = new Node(streamID);
+  nodes_[streamID].reset(node);
+  return node;
+}
+
+bool StreamScheduler::isDescendant(const Node* node,
+                                   const Node* ancestor) const {
+  for (const Node* p = node->parent; p != nullptr; p = p->parent)
+    if (p == ancestor)
+      return true;
+
+  return false;
+}
+
+void StreamScheduler::attach(Node* node, Node* parent) {
+  node->parent = parent;
+  node->cycle = parent->lastCycle;
+  parent->children.push_back(node);
+  updateActive(parent);
+}
+
+void StreamScheduler::detach(Node* node) {
+  Node* parent = node->parent;
+  if (!parent)
+    return;
+
+  auto i = std::find(parent->children.begin(), parent->children.end(), node);
+  if (i != parent->children.end())
+    parent->children.erase(i);
+
+  node->parent = nullptr;
+  updateActive(parent);
+}
+
+void StreamScheduler::updateActive(Node* node) {
+  for (; node != nullptr; node = node->parent) {
+    bool active = node->ready;
+    for (const Node* child: node->children) {
+      if (child->active) {
+        active = true;
+        break;
+      }
+    }
+
+    if (active == node->active)
+      break;
+
+    node->active = active;
+
+    // a node joining in again must not make up for the time it was idle
+    if (active && node->parent)
+      node->cycle = std::max(node->cycle, node->parent->lastCycle);
+  }
+}
+
+}  // namespace http2
+}  // namespace xzero
@@ -0,0 +1,120 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <xzero-http/Api.h>
+#include <xzero-base/sysconfig.h>
+#include <unordered_map>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace xzero {
+namespace http2 {
+
+/**
+ * Decides which stream's response data is to be sent next, honoring the
+ * stream dependencies and weights announced by the peer (rfc7540, 5.3).
+ *
+ * Streams are kept in a dependency tree. A stream that is ready to send
+ * always takes precedence over its descendants, and siblings share the
+ * bandwidth proportionally to their weights: each node carries a virtual
+ * time that advances by the number of bytes sent through it divided by its
+ * weight, and the ready sibling with the lowest virtual time goes next.
+ *
+ * Streams that only appear as a dependency, or in a PRIORITY frame before
+ * being opened, are kept as idle nodes, so that priority groups built by
+ * clients keep their shape. The total number of nodes is bounded, further
+ * idle streams get the default priority instead.
+ */
+class XZERO_HTTP_API StreamScheduler {
+ public:
+  /** The weight of streams without explicit priority. */
+  static const unsigned DefaultWeight = 16;
+
+  /**
+   * @param maxNodes maximum number of streams (open and idle) to keep track
+   *                 of.
+   */
+  explicit StreamScheduler(size_t maxNodes);
+  ~StreamScheduler();
+
+  /** Number of streams in the tree, open or idle. */
+  size_t size() const XZERO_NOEXCEPT { return nodes_.size(); }
+
+  bool contains(unsigned streamID) const;
+
+  /**
+   * Adds a newly opened stream.
+   *
+   * A stream that is in the tree already, by means of a preceeding PRIORITY
+   * information, keeps its position.
+   *
+   * @retval false the stream could not be added, because too many streams
+   *               are in the tree already.
+   */
+  bool open(unsigned streamID);
+
+  /**
+   * Changes the priority of a stream, as received by a PRIORITY frame or a
+   * HEADERS frame with priority information.
+   *
+   * A stream that is not in the tree yet gets added as idle stream.
+   * A stream must not depend on itself, which is up to the caller to check.
+   */
+  void setPriority(unsigned streamID, unsigned dependencyStreamID,
+                   unsigned weight, bool exclusive);
+
+  /**
+   * Removes a stream, passing its dependants on to its own parent,
+   * with their weights distributed by the weight of the removed stream.
+   */
+  void close(unsigned streamID);
+
+  /** Marks a stream as having data pending to be sent or not. */
+  void setReady(unsigned streamID, bool ready);
+
+  bool isReady(unsigned streamID) const;
+
+  /**
+   * Retrieves the stream to send data for next.
+   *
+   * @return the stream identifier or 0 if no stream is ready.
+   */
+  unsigned next() const;
+
+  /**
+   * Accounts @p bytes as being sent on behalf of @p streamID.
+   */
+  void consumed(unsigned streamID, size_t bytes);
+
+  /** Retrieves the stream @p streamID depends on, or 0 for the root. */
+  unsigned dependencyOf(unsigned streamID) const;
+
+  /** Retrieves the weight of @p streamID. */
+  unsigned weightOf(unsigned streamID) const;
+
+ private:
+  struct Node;
+
+  Node* find(unsigned streamID) const;
+  Node* create(unsigned streamID);
+  bool isDescendant(const Node* node, const Node* ancestor) const;
+  void attach(Node* node, Node* parent);
+  void detach(Node* node);
+  void updateActive(Node* node);
+
+ private:
+  size_t maxNodes_;
+  std::unique_ptr<Node> root_;
+  std::unordered_map<unsigned, std::unique_ptr<Node>> nodes_;
+};
+
+}  // namespace http2
+}  // namespace xzero
@@ -0,0 +1,506 @@
+// This file is part of the "x0" project, http://xzero.io/
+//   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this
+// file except in compliance with the License. You may obtain a copy of
+// the License at: http://opensource.org/licenses/MIT
+
+#include <xzero-http/http2/hpack.h>
+#include <xzero-base/Buffer.h>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+
+using namespace xzero;
+using namespace xzero::http2;
+
+typedef std::vector<std::pair<std::string, std::string>> Fields;
+
+static Buffer fromHex(const std::string& hex) {
+  Buffer out;
+  int hi = -1;
+  for (char ch: hex) {
+    int v;
+    if (ch >= '0' && ch <= '9') v = ch - '0';
+    else if (ch >= 'a' && ch <= 'f') v = ch - 'a' + 10;
+    else continue;
+
+    if (hi < 0) {
+      hi = v;
+    } else {
+      out.push_back(static_cast<char>((hi << 4) | v));
+      hi = -1;
+    }
+  }
+  return out;
+}
+
+static bool decode(hpack::Decoder* decoder, const Buffer& block,
+                   Fields* fields) {
+  fields->clear();
+  return decoder->decode(block.ref(),
+      [&](const BufferRef& name, const BufferRef& value) {
+        fields->emplace_back(name.str(), value.str());
+      });
+}
+
+TEST(hpack, encodeInt) {
+  // rfc7541, C.1.1 - C.1.3
+  Buffer out;
+  hpack::Encoder::encodeInt(0, 5, 10, &out);
+  ASSERT_EQ(fromHex("0a"), out);
+
+  out.clear();
+  hpack::Encoder::encodeInt(0, 5, 1337, &out);
+  ASSERT_EQ(fromHex("1f9a0a"), out);
+
+  out.clear();
+  hpack::Encoder::encodeInt(0, 8, 42, &out);
+  ASSERT_EQ(fromHex("2a"), out);
+}
+
+TEST(hpack, decodeInt) {
+  Buffer in = fromHex("1f9a0a");
+  const uint8_t* pos = (const uint8_t*) in.data();
+  uint64_t value = 0;
+
+  ASSERT_TRUE(hpack::Decoder::decodeInt(&pos, pos + in.size(), 5, &value));
+  ASSERT_EQ(1337, value);
+  ASSERT_EQ((const uint8_t*) in.data() + in.size(), pos);
+
+  // truncated
+  pos = (const uint8_t*) in.data();
+  ASSERT_FALSE(hpack::Decoder::decodeInt(&pos, pos + 2, 5, &value));
+}
+
+TEST(hpack, huffmanDecode) {
+  std::string out;
+  ASSERT_TRUE(hpack::Huffman::decode(
+      fromHex("f1e3c2e5f23a6ba0ab90f4ff").ref(), &out));
+  ASSERT_EQ("www.example.com", out);
+
+  out.clear();
+  ASSERT_TRUE(hpack::Huffman::decode(fromHex("a8eb10649cbf").ref(), &out));
+  ASSERT_EQ("no-cache", out);
+
+  // padding must be all ones and shorter than 8 bits
+  out.clear();
+  ASSERT_FALSE(hpack::Huffman::decode(fromHex("a8eb10649cbe").ref(), &out));
+  out.clear();
+  ASSERT_FALSE(hpack::Huffman::decode(fromHex("a8eb10649cbfff").ref(), &out));
+}
+
+TEST(hpack, huffmanEncode) {
+  // rfc7541, C.4.1
+  Buffer out;
+  ASSERT_EQ(12, hpack::Huffman::encodedLength("www.example.com"));
+  hpack::Huffman::encode("www.example.com", &out);
+  ASSERT_EQ(fromHex("f1e3c2e5f23a6ba0ab90f4ff"), out);
+
+  std::string all;
+  for (int i = 0; i < 256; ++i)
+    all.push_back(static_cast<char>(i));
+
+  out.clear();
+  hpack::Huffman::encode(BufferRef(all), &out);
+  ASSERT_EQ(out.size(), hpack::Huffman::encodedLength(BufferRef(all)));
+
+  std::string decoded;
+  ASSERT_TRUE(hpack::Huffman::decode(out.ref(), &decoded));
+  ASSERT_EQ(all, decoded);
+}
+
+TEST(hpack, staticTable) {
+  ASSERT_EQ(61, hpack::StaticTable::length());
+  ASSERT_EQ(":authority", hpack::StaticTable::name(1).str());
+  ASSERT_EQ("www-authenticate", hpack::StaticTable::name(61).str());
+  ASSERT_EQ("gzip, deflate", hpack::StaticTable::value(16).str());
+
+  bool nameOnly = false;
+  ASSERT_EQ(2, hpack::StaticTable::find(":method", "GET", &nameOnly));
+  ASSERT_FALSE(nameOnly);
+
+  ASSERT_EQ(3, hpack::StaticTable::find(":method", "POST", &nameOnly));
+  ASSERT_FALSE(nameOnly);
+
+  ASSERT_EQ(2, hpack::StaticTable::find(":method", "PUT", &nameOnly));
+  ASSERT_TRUE(nameOnly);
+
+  ASSERT_EQ(13, hpack::StaticTable::find(":status", "404", &nameOnly));
+  ASSERT_FALSE(nameOnly);
+
+  // "accept" is not in alphabetical order within the static table
+  ASSERT_EQ(19, hpack::StaticTable::find("accept", "*/*", &nameOnly));
+  ASSERT_TRUE(nameOnly);
+
+  ASSERT_EQ(0, hpack::StaticTable::find("x-custom", "", &nameOnly));
+  ASSERT_EQ(0, hpack::StaticTable::find("", "", &nameOnly));
+
+  // every name maps to its first entry
+  for (size_t i = 1; i <= hpack::StaticTable::length(); ++i) {
+    size_t index = hpack::StaticTable::find(hpack::StaticTable::name(i),
+                                            hpack::StaticTable::value(i),
+                                            &nameOnly);
+    ASSERT_EQ(i, index);
+    ASSERT_FALSE(nameOnly);
+  }
+}
+
+TEST(hpack, dynamicTableEviction) {
+  hpack::DynamicTable table(100);
+  table.add("custom-key", "custom-value");  // 54 bytes
+  table.add("custom-key", "custom-valu2");  // 54 bytes, evicts the first
+
+  ASSERT_EQ(1, table.length());
+  ASSERT_EQ(54, table.size());
+  ASSERT_EQ("custom-valu2", table.at(0).value);
+
+  table.setMaxSize(0);
+  ASSERT_EQ(0, table.length());
+  ASSERT_EQ(0, table.size());
+}
+
+TEST(hpack, dynamicTableRingBuffer) {
+  hpack::DynamicTable table(4096, true);
+
+  // wraps around and grows the ring buffer a few times
+  for (int i = 0; i < 500; ++i) {
+    std::string value = std::to_string(i);
+    table.add("x-n", BufferRef(value));
+  }
+
+  // 4096 / (3 + 3 + 32) entries fit
+  ASSERT_EQ(107, table.length());
+  ASSERT_EQ("499", table.at(0).value);
+  ASSERT_EQ("393", table.at(106).value);
+
+  bool nameOnly = false;
+  ASSERT_EQ(6, table.find("x-n", "493", &nameOnly));
+  ASSERT_FALSE(nameOnly);
+
+  // evicted
+  ASSERT_EQ(0, table.find("x-n", "392", &nameOnly));
+  ASSERT_TRUE(nameOnly);
+
+  ASSERT_EQ(hpack::DynamicTable::npos, table.find("x-m", "1", &nameOnly));
+  ASSERT_FALSE(nameOnly);
+
+  table.clear();
+  ASSERT_EQ(hpack::DynamicTable::npos, table.find("x-n", "499", &nameOnly));
+}
+
+TEST(hpack, decodeLiteralWithIndexing) {
+  // rfc7541, C.2.1
+  hpack::Decoder decoder;
+  Fields fields;
+
+  ASSERT_TRUE(decode(&decoder, fromHex(
+      "400a 6375 7374 6f6d 2d6b 6579 0d63 7573 746f 6d2d 6865 6164 6572"),
+      &fields));
+
+  ASSERT_EQ(1, fields.size());
+  ASSERT_EQ("custom-key", fields[0].first);
+  ASSERT_EQ("custom-header", fields[0].second);
+  ASSERT_EQ(55, decoder.dynamicTable().size());
+}
+
+TEST(hpack, decodeRequestsWithoutHuffman) {
+  // rfc7541, C.3
+  hpack::Decoder decoder;
+  Fields fields;
+
+  ASSERT_TRUE(decode(&decoder, fromHex(
+      "8286 8441 0f77 7777 2e65 7861 6d70 6c65 2e63 6f6d"), &fields));
+  ASSERT_EQ(4, fields.size());
+  ASSERT_EQ(":method", fields[0].first);
+  ASSERT_EQ("GET", fields[0].second);
+  ASSERT_EQ(":authority", fields[3].first);
+  ASSERT_EQ("www.example.com", fields[3].second);
+  ASSERT_EQ(57, decoder.dynamicTable().size());
+
+  ASSERT_TRUE(decode(&decoder, fromHex(
+      "8286 84be 5808 6e6f 2d63 6163 6865"), &fields));
+  ASSERT_EQ(5, fields.size());
+  ASSERT_EQ("www.example.com", fields[3].second);
+  ASSERT_EQ("cache-control", fields[4].first);
+  ASSERT_EQ("no-cache", fields[4].second);
+  ASSERT_EQ(110, decoder.dynamicTable().size());
+
+  ASSERT_TRUE(decode(&decoder, fromHex(
+      "8287 85bf 400a 6375 7374 6f6d 2d6b 6579 0c63 7573 746f 6d2d 7661"
+      "6c75 65"), &fields));
+  ASSERT_EQ(5, fields.size());
+  ASSERT_EQ("https", fields[1].second);
+  ASSERT_EQ("/index.html", fields[2].second);
+  ASSERT_EQ("www.example.com", fields[3].second);
+  ASSERT_EQ("custom-key", fields[4].first);
+  ASSERT_EQ("custom-value", fields[4].second);
+  ASSERT_EQ(164, decoder.dynamicTable().size());
+}
+
+TEST(hpack, decodeRequestsWithHuffman) {
+  // rfc7541, C.4
+  hpack::Decoder decoder;
+  Fields fields;
+
+  ASSERT_TRUE(decode(&decoder, fromHex(
+      "8286 8441 8cf1 e3c2 e5f2 3a6b a0ab 90f4 ff"), &fields));
+  ASSERT_EQ(4, fields.size());
+  ASSERT_EQ("www.example.com", fields[3].second);
+
+  ASSERT_TRUE(decode(&decoder, fromHex(
+      "8286 84be 5886 a8eb 1064 9cbf"), &fields));
+  ASSERT_EQ(5, fields.size());
+  ASSERT_EQ("no-cache", fields[4].second);
+
+  ASSERT_TRUE(decode(&decoder, fromHex(
+      "8287 85bf 4088 25a8 49e9 5ba9 7d7f 8925 a849 e95b b8e8 b4bf"),
+      &fields));
+  ASSERT_EQ(5, fields.size());
+  ASSERT_EQ("custom-key", fields[4].first);
+  ASSERT_EQ("custom-value", fields[4].second);
+  ASSERT_EQ(164, decoder.dynamicTable().size());
+}
+
+TEST(hpack, decodeInvalid) {
+  hpack::Decoder decoder;
+  Fields fields;
+
+  // index 0
+  ASSERT_FALSE(decode(&decoder, fromHex("80"), &fields));
+
+  // index beyond static and dynamic table
+  ASSERT_FALSE(decode(&decoder, fromHex("be"), &fields));
+
+  // truncated string literal
+  ASSERT_FALSE(decode(&decoder, fromHex("400a 6375"), &fields));
+
+  // size update beyond the announced maximum
+  ASSERT_FALSE(decode(&decoder, fromHex("3fe21f"), &fields));
+}
+
+TEST(hpack, dynamicTableSizeUpdate) {
+  hpack::Decoder decoder;
+  Fields fields;
+
+  ASSERT_TRUE(decode(&decoder, fromHex(
+      "400a 6375 7374 6f6d 2d6b 6579 0d63 7573 746f 6d2d 6865 6164 6572"),
+      &fields));
+  ASSERT_EQ(1, decoder.dynamicTable().length());
+
+  // size update to 0 followed by an indexed field
+  ASSERT_TRUE(decode(&decoder, fromHex("20 82"), &fields));
+  ASSERT_EQ(0, decoder.dynamicTable().length());
+  ASSERT_EQ(1, fields.size());
+
+  // size updates are only allowed at the beginning of a header block
+  ASSERT_FALSE(decode(&decoder, fromHex("82 20"), &fields));
+}
+
+TEST(hpack, roundTrip) {
+  hpack::Encoder encoder;
+  hpack::Decoder decoder;
+  Fields input = {
+    {":status", "200"},
+    {"content-type", "text/html"},
+    {"server", "x0d"},
+    {"set-cookie", "secret"},
+    {"content-length", "42"},
+  };
+
+  for (int round = 0; round < 3; ++round) {
+    Buffer block;
+    for (const auto& field: input)
+      encoder.encode(BufferRef(field.first), BufferRef(field.second), &block);
+
+    Fields output;
+    ASSERT_TRUE(decode(&decoder, block, &output));
+    ASSERT_EQ(input, output);
+
+    // subsequent blocks reference the dynamic table and become smaller
+    if (round > 0) {
+      ASSERT_GT(30, block.size());
+    }
+  }
+
+  // sensitive and volatile fields are not indexed
+  bool nameOnly = false;
+  ASSERT_EQ(hpack::DynamicTable::npos,
+            encoder.dynamicTable().find("set-cookie", "secret", &nameOnly));
+  ASSERT_EQ(hpack::DynamicTable::npos,
+            encoder.dynamicTable().find("content-length", "42", &nameOnly));
+  ASSERT_NE(hpack::DynamicTable::npos,
+            encoder.dynamicTable().find("server", "x0d", &nameOnly));
+}
+
+TEST(hpack, encodeRequestsWithHuffman) {
+  // rfc7541, C.4
+  hpack::Encoder encoder;
+  Buffer block;
+
+  encoder.encode(":method", "GET", &block);
+  encoder.encode(":scheme", "http", &block);
+  encoder.encode(":path", "/", &block);
+  encoder.encode(":authority", "www.example.com", &block);
+  ASSERT_EQ(fromHex("8286 8441 8cf1 e3c2 e5f2 3a6b a0ab 90f4 ff"), block);
+
+  block.clear();
+  encoder.encode(":method", "GET", &block);
+  encoder.encode(":scheme", "http", &block);
+  encoder.encode(":path", "/", &block);
+  encoder.encode(":authority", "www.example.com", &block);
+  encoder.encode("Cache-Control", "no-cache", &block);
+  ASSERT_EQ(fromHex("8286 84be 5886 a8eb 1064 9cbf"), block);
+
+  block.clear();
+  encoder.encode(":method", "GET", &block);
+  encoder.encode(":scheme", "https", &block);
+  encoder.encode(":path", "/index.html", &block);
+  encoder.encode(":authority", "www.example.com", &block);
+  encoder.encode("custom-key", "custom-value", &block);
+  ASSERT_EQ(fromHex("8287 85bf 4088 25a8 49e9 5ba9 7d7f 8925 a849 e95b b8e8"
+                    "b4bf"), block);
+  ASSERT_EQ(164, encoder.dynamicTable().size());
+}
+
+TEST(hpack, encoderTableSizeUpdate) {
+  hpack::Encoder encoder;
+  hpack::Decoder decoder;
+  Fields output;
+
+  Buffer block;
+  encoder.encode("server", "x0d", &block);
+  ASSERT_TRUE(decode(&decoder, block, &output));
+  ASSERT_EQ(1, decoder.dynamicTable().length());
+
+  encoder.setMaxTableSize(0);
+
+  block.clear();
+  encoder.encode("server", "x0d", &block);
+  ASSERT_TRUE(decode(&decoder, block, &output));
+  ASSERT_EQ(0, decoder.dynamicTable().length());
+  ASSERT_EQ(1, output.size());
+  ASSERT_EQ("x0d", output[0].second);
+}
+
+// Benchmarks. Run explicitly with --gtest_also_run_disabled_tests --gtest_filter=hpack.*
+
+static const Fields& requestHeaders() {
+  static const Fields fields = {
+    {":method", "GET"},
+    {":scheme", "https"},
+    {":authority", "www.example.com"},
+    {":path", "/assets/css/main.css?v=1418736273"},
+    {"user-agent", "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 "
+                   "(KHTML, like Gecko) Chrome/39.0.2171.95 Safari/537.36"},
+    {"accept", "text/css,*/*;q=0.1"},
+    {"accept-encoding", "gzip, deflate, sdch"},
+    {"accept-language", "en-US,en;q=0.8,de;q=0.6"},
+    {"referer", "https://www.example.com/"},
+    {"cookie", "sid=31d4d96e407aad42; lang=en-US"},
+    {"cache-control", "max-age=0"},
+  };
+  return fields;
+}
+
+static const Fields& responseHeaders() {
+  static const Fields fields = {
+    {":status", "200"},
+    {"date", "Tue, 16 Dec 2014 13:37:42 GMT"},
+    {"server", "x0d"},
+    {"content-type", "text/css"},
+    {"content-length", "18243"},
+    {"last-modified", "Mon, 15 Dec 2014 21:12:03 GMT"},
+    {"etag", "\"5473-50a4b8d3a2e00\""},
+    {"cache-control", "public, max-age=31536000"},
+    {"vary", "Accept-Encoding"},
+  };
+  return fields;
+}
+
+static void benchmarkHeaders(const char* label, const Fields& fields) {
+  const int rounds = 200000;
+  hpack::Encoder encoder;
+  hpack::Decoder decoder;
+  Buffer block;
+  size_t blockBytes = 0;
+  size_t decodedFields = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; ++i) {
+    block.clear();
+    for (const auto& field: fields)
+      encoder.encode(BufferRef(field.first), BufferRef(field.second), &block);
+    blockBytes += block.size();
+  }
+  auto encoded = std::chrono::steady_clock::now();
+
+  // a fresh pair with a realistic mix: first block literal, then indexed
+  hpack::Encoder encoder2;
+  std::vector<Buffer> blocks(2);
+  for (Buffer& b: blocks)
+    for (const auto& field: fields)
+      encoder2.encode(BufferRef(field.first), BufferRef(field.second), &b);
+
+  auto decodeStart = std::chrono::steady_clock::now();
+  decoder.decode(blocks[0].ref(), [&](const BufferRef&, const BufferRef&) {
+    ++decodedFields;
+  });
+  for (int i = 0; i < rounds; ++i) {
+    decoder.decode(blocks[1].ref(), [&](const BufferRef&, const BufferRef&) {
+      ++decodedFields;
+    });
+  }
+  auto decoded = std::chrono::steady_clock::now();
+
+  typedef std::chrono::nanoseconds ns;
+  printf("%s: encode %.1f ns/block (%.1f bytes/block), "
+         "decode %.1f ns/block (%zu fields)\n",
+         label,
+         (double) std::chrono::duration_cast<ns>(encoded - start).count() /
+             rounds,
+         (double) blockBytes / rounds,
+         (double) std::chrono::duration_cast<ns>(decoded - decodeStart)
+                  .count() / rounds,
+         decodedFields);
+}
+
+static void benchmarkLiterals(const char* label, const Fields& fields) {
+  // header blocks without any indexing, dominated by (Huffman) strings
+  const int rounds = 200000;
+  Buffer block;
+  for (const auto& field: fields) {
+    block.push_back(static_cast<char>(0));
+    hpack::Encoder::encodeString(BufferRef(field.first), &block);
+    hpack::Encoder::encodeString(BufferRef(field.second), &block);
+  }
+
+  hpack::Decoder decoder;
+  size_t decodedFields = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; ++i) {
+    decoder.decode(block.ref(), [&](const BufferRef&, const BufferRef&) {
+      ++decodedFields;
+    });
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  double nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      end - start).count();
+  printf("%s: decode literals %.1f ns/block, %.1f MB/s (%zu fields)\n",
+         label, nanos / rounds, block.size() * rounds / nanos * 1000.0,
+         decodedFields);
+}
+
+TEST(hpack, DISABLED_benchmarkRequestHeaders) {
+  benchmarkHeaders("request", requestHeaders());
+  benchmarkLiterals("request", requestHeaders());
+}
+
+TEST(hpack, DISABLED_benchmarkResponseHeaders) {
+  benchmarkHeaders("response", responseHeaders());
+  benchmarkLiterals("response", responseHeaders());
+}
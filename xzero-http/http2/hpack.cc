@@ -1,395 +1,1226 @@
-// This file is part of the "x0" project
+// This file is part of the "x0" project, http://xzero.io/
 //   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
 //
 // Licensed under the MIT License (the "License"); you may not use this
 // file except in compliance with the License. You may obtain a copy of
 // the License at: http://opensource.org/licenses/MIT
 
-#include <xzero-base/hpack.h>
-#include <algorithm>
-#include <inttypes.h>
+#include <xzero-http/http2/hpack.h>
+#include <xzero-base/RuntimeError.h>
+#include <cstring>
+#include <vector>
 
 namespace xzero {
+namespace http2 {
 namespace hpack {
 
 // {{{ StaticTable
-StaticTable::StaticTable()
-    : entries_({/*  0 */ {"", ""},
-                /*  1 */ {":authority", ""},
-                /*  2 */ {":method", "GET"},
-                /*  3 */ {":method", "POST"},
-                /*  4 */ {":path", "/"},
-                /*  5 */ {":path", "/index.html"},
-                /*  6 */ {":scheme", "http"},
-                /*  7 */ {":scheme", "https"},
-                /*  8 */ {":status", "200"},
-                /*  9 */ {":status", "204"},
-
-                /* 10 */ {":status", "206"},
-                /* 11 */ {":status", "304"},
-                /* 12 */ {":status", "400"},
-                /* 13 */ {":status", "404"},
-                /* 14 */ {":status", "500"},
-                /* 15 */ {"accept-charset", ""},
-                /* 16 */ {"accept-encoding", "gzip, deflate"},
-                /* 17 */ {"accept-language", ""},
-                /* 18 */ {"accept-ranges", ""},
-                /* 19 */ {"accept", ""},
-
-                /* 20 */ {"access-control-allow-origin", ""},
-                /* 21 */ {"age", ""},
-                /* 22 */ {"allow", ""},
-                /* 23 */ {"authorization", ""},
-                /* 24 */ {"cache-control", ""},
-                /* 25 */ {"content-disposition", ""},
-                /* 26 */ {"content-encoding", ""},
-                /* 27 */ {"content-language", ""},
-                /* 28 */ {"content-length", ""},
-                /* 29 */ {"content-location", ""},
-
-                /* 30 */ {"content-range", ""},
-                /* 31 */ {"content-type", ""},
-                /* 32 */ {"cookie", ""},
-                /* 33 */ {"date", ""},
-                /* 34 */ {"etag", ""},
-                /* 35 */ {"expect", ""},
-                /* 36 */ {"expires", ""},
-                /* 37 */ {"from", ""},
-                /* 38 */ {"host", ""},
-                /* 39 */ {"if-match", ""},
-
-                /* 40 */ {"if-modified-since", ""},
-                /* 41 */ {"if-none-match", ""},
-                /* 42 */ {"if-range", ""},
-                /* 43 */ {"if-unmodified-since", ""},
-                /* 44 */ {"last-modified", ""},
-                /* 45 */ {"link", ""},
-                /* 46 */ {"location", ""},
-                /* 47 */ {"max-forwards", ""},
-
-                /* 48 */ {"proxy-authenticate", ""},
-                /* 49 */ {"proxy-authorization", ""},
-                /* 50 */ {"range", ""},
-                /* 51 */ {"referer", ""},
-                /* 52 */ {"refresh", ""},
-                /* 53 */ {"retry-after", ""},
-                /* 54 */ {"server", ""},
-                /* 55 */ {"set-cookie", ""},
-                /* 56 */ {"strict-transport-security", ""},
-                /* 57 */ {"transfer-encoding", ""},
-                /* 58 */ {"user-agent", ""},
-                /* 59 */ {"vary", ""},
-                /* 60 */ {"via", ""},
-                /* 61 */ {"www-authenticate", ""}}) {}
-
-StaticTable::~StaticTable() {}
-
-StaticTable* StaticTable::get() {
-  static StaticTable table;
-  return &table;
+namespace {
+
+struct StaticEntry {
+  const char* name;
+  size_t nameLength;
+  const char* value;
+  size_t valueLength;
+};
+
+#define STATIC_ENTRY(name, value) \
+  { name, sizeof(name) - 1, value, sizeof(value) - 1 }
+
+constexpr StaticEntry staticTable[] = {
+  STATIC_ENTRY(":authority", ""),
+  STATIC_ENTRY(":method", "GET"),
+  STATIC_ENTRY(":method", "POST"),
+  STATIC_ENTRY(":path", "/"),
+  STATIC_ENTRY(":path", "/index.html"),
+  STATIC_ENTRY(":scheme", "http"),
+  STATIC_ENTRY(":scheme", "https"),
+  STATIC_ENTRY(":status", "200"),
+  STATIC_ENTRY(":status", "204"),
+  STATIC_ENTRY(":status", "206"),
+  STATIC_ENTRY(":status", "304"),
+  STATIC_ENTRY(":status", "400"),
+  STATIC_ENTRY(":status", "404"),
+  STATIC_ENTRY(":status", "500"),
+  STATIC_ENTRY("accept-charset", ""),
+  STATIC_ENTRY("accept-encoding", "gzip, deflate"),
+  STATIC_ENTRY("accept-language", ""),
+  STATIC_ENTRY("accept-ranges", ""),
+  STATIC_ENTRY("accept", ""),
+  STATIC_ENTRY("access-control-allow-origin", ""),
+  STATIC_ENTRY("age", ""),
+  STATIC_ENTRY("allow", ""),
+  STATIC_ENTRY("authorization", ""),
+  STATIC_ENTRY("cache-control", ""),
+  STATIC_ENTRY("content-disposition", ""),
+  STATIC_ENTRY("content-encoding", ""),
+  STATIC_ENTRY("content-language", ""),
+  STATIC_ENTRY("content-length", ""),
+  STATIC_ENTRY("content-location", ""),
+  STATIC_ENTRY("content-range", ""),
+  STATIC_ENTRY("content-type", ""),
+  STATIC_ENTRY("cookie", ""),
+  STATIC_ENTRY("date", ""),
+  STATIC_ENTRY("etag", ""),
+  STATIC_ENTRY("expect", ""),
+  STATIC_ENTRY("expires", ""),
+  STATIC_ENTRY("from", ""),
+  STATIC_ENTRY("host", ""),
+  STATIC_ENTRY("if-match", ""),
+  STATIC_ENTRY("if-modified-since", ""),
+  STATIC_ENTRY("if-none-match", ""),
+  STATIC_ENTRY("if-range", ""),
+  STATIC_ENTRY("if-unmodified-since", ""),
+  STATIC_ENTRY("last-modified", ""),
+  STATIC_ENTRY("link", ""),
+  STATIC_ENTRY("location", ""),
+  STATIC_ENTRY("max-forwards", ""),
+  STATIC_ENTRY("proxy-authenticate", ""),
+  STATIC_ENTRY("proxy-authorization", ""),
+  STATIC_ENTRY("range", ""),
+  STATIC_ENTRY("referer", ""),
+  STATIC_ENTRY("refresh", ""),
+  STATIC_ENTRY("retry-after", ""),
+  STATIC_ENTRY("server", ""),
+  STATIC_ENTRY("set-cookie", ""),
+  STATIC_ENTRY("strict-transport-security", ""),
+  STATIC_ENTRY("transfer-encoding", ""),
+  STATIC_ENTRY("user-agent", ""),
+  STATIC_ENTRY("vary", ""),
+  STATIC_ENTRY("via", ""),
+  STATIC_ENTRY("www-authenticate", ""),
+};
+
+/**
+ * Maps a lower-case header field name to the 0-based index of its first
+ * static table entry, or -1 if it has none.
+ */
+static int findStaticName(const char* name, size_t length) {
+  switch (length) {
+    case 3:
+      switch (name[2]) {
+        case 'a':
+          if (std::memcmp(name, "via", 3) == 0) return 59;
+          break;
+        case 'e':
+          if (std::memcmp(name, "age", 3) == 0) return 20;
+          break;
+      }
+      break;
+    case 4:
+      switch (name[3]) {
+        case 'e':
+          if (std::memcmp(name, "date", 4) == 0) return 32;
+          break;
+        case 'g':
+          if (std::memcmp(name, "etag", 4) == 0) return 33;
+          break;
+        case 'k':
+          if (std::memcmp(name, "link", 4) == 0) return 44;
+          break;
+        case 'm':
+          if (std::memcmp(name, "from", 4) == 0) return 36;
+          break;
+        case 't':
+          if (std::memcmp(name, "host", 4) == 0) return 37;
+          break;
+        case 'y':
+          if (std::memcmp(name, "vary", 4) == 0) return 58;
+          break;
+      }
+      break;
+    case 5:
+      switch (name[4]) {
+        case 'e':
+          if (std::memcmp(name, "range", 5) == 0) return 49;
+          break;
+        case 'h':
+          if (std::memcmp(name, ":path", 5) == 0) return 3;
+          break;
+        case 'w':
+          if (std::memcmp(name, "allow", 5) == 0) return 21;
+          break;
+      }
+      break;
+    case 6:
+      switch (name[5]) {
+        case 'e':
+          if (std::memcmp(name, "cookie", 6) == 0) return 31;
+          break;
+        case 'r':
+          if (std::memcmp(name, "server", 6) == 0) return 53;
+          break;
+        case 't':
+          if (std::memcmp(name, "accept", 6) == 0) return 18;
+          if (std::memcmp(name, "expect", 6) == 0) return 34;
+          break;
+      }
+      break;
+    case 7:
+      switch (name[6]) {
+        case 'd':
+          if (std::memcmp(name, ":method", 7) == 0) return 1;
+          break;
+        case 'e':
+          if (std::memcmp(name, ":scheme", 7) == 0) return 5;
+          break;
+        case 'h':
+          if (std::memcmp(name, "refresh", 7) == 0) return 51;
+          break;
+        case 'r':
+          if (std::memcmp(name, "referer", 7) == 0) return 50;
+          break;
+        case 's':
+          if (std::memcmp(name, ":status", 7) == 0) return 7;
+          if (std::memcmp(name, "expires", 7) == 0) return 35;
+          break;
+      }
+      break;
+    case 8:
+      switch (name[7]) {
+        case 'e':
+          if (std::memcmp(name, "if-range", 8) == 0) return 41;
+          break;
+        case 'h':
+          if (std::memcmp(name, "if-match", 8) == 0) return 38;
+          break;
+        case 'n':
+          if (std::memcmp(name, "location", 8) == 0) return 45;
+          break;
+      }
+      break;
+    case 10:
+      switch (name[9]) {
+        case 'e':
+          if (std::memcmp(name, "set-cookie", 10) == 0) return 54;
+          break;
+        case 't':
+          if (std::memcmp(name, "user-agent", 10) == 0) return 57;
+          break;
+        case 'y':
+          if (std::memcmp(name, ":authority", 10) == 0) return 0;
+          break;
+      }
+      break;
+    case 11:
+      switch (name[10]) {
+        case 'r':
+          if (std::memcmp(name, "retry-after", 11) == 0) return 52;
+          break;
+      }
+      break;
+    case 12:
+      switch (name[11]) {
+        case 'e':
+          if (std::memcmp(name, "content-type", 12) == 0) return 30;
+          break;
+        case 's':
+          if (std::memcmp(name, "max-forwards", 12) == 0) return 46;
+          break;
+      }
+      break;
+    case 13:
+      switch (name[12]) {
+        case 'd':
+          if (std::memcmp(name, "last-modified", 13) == 0) return 43;
+          break;
+        case 'e':
+          if (std::memcmp(name, "content-range", 13) == 0) return 29;
+          break;
+        case 'h':
+          if (std::memcmp(name, "if-none-match", 13) == 0) return 40;
+          break;
+        case 'l':
+          if (std::memcmp(name, "cache-control", 13) == 0) return 23;
+          break;
+        case 'n':
+          if (std::memcmp(name, "authorization", 13) == 0) return 22;
+          break;
+        case 's':
+          if (std::memcmp(name, "accept-ranges", 13) == 0) return 17;
+          break;
+      }
+      break;
+    case 14:
+      switch (name[13]) {
+        case 'h':
+          if (std::memcmp(name, "content-length", 14) == 0) return 27;
+          break;
+        case 't':
+          if (std::memcmp(name, "accept-charset", 14) == 0) return 14;
+          break;
+      }
+      break;
+    case 15:
+      switch (name[14]) {
+        case 'e':
+          if (std::memcmp(name, "accept-language", 15) == 0) return 16;
+          break;
+        case 'g':
+          if (std::memcmp(name, "accept-encoding", 15) == 0) return 15;
+          break;
+      }
+      break;
+    case 16:
+      switch (name[15]) {
+        case 'e':
+          if (std::memcmp(name, "content-language", 16) == 0) return 26;
+          if (std::memcmp(name, "www-authenticate", 16) == 0) return 60;
+          break;
+        case 'g':
+          if (std::memcmp(name, "content-encoding", 16) == 0) return 25;
+          break;
+        case 'n':
+          if (std::memcmp(name, "content-location", 16) == 0) return 28;
+          break;
+      }
+      break;
+    case 17:
+      switch (name[16]) {
+        case 'e':
+          if (std::memcmp(name, "if-modified-since", 17) == 0) return 39;
+          break;
+        case 'g':
+          if (std::memcmp(name, "transfer-encoding", 17) == 0) return 56;
+          break;
+      }
+      break;
+    case 18:
+      switch (name[17]) {
+        case 'e':
+          if (std::memcmp(name, "proxy-authenticate", 18) == 0) return 47;
+          break;
+      }
+      break;
+    case 19:
+      switch (name[18]) {
+        case 'e':
+          if (std::memcmp(name, "if-unmodified-since", 19) == 0) return 42;
+          break;
+        case 'n':
+          if (std::memcmp(name, "content-disposition", 19) == 0) return 24;
+          if (std::memcmp(name, "proxy-authorization", 19) == 0) return 48;
+          break;
+      }
+      break;
+    case 25:
+      switch (name[24]) {
+        case 'y':
+          if (std::memcmp(name, "strict-transport-security", 25) == 0) return 55;
+          break;
+      }
+      break;
+    case 27:
+      switch (name[26]) {
+        case 'n':
+          if (std::memcmp(name, "access-control-allow-origin", 27) == 0) return 19;
+          break;
+      }
+      break;
+  }
+  return -1;
 }
-// }}}
-// {{{ HeaderTable
-HeaderTable::HeaderTable(size_t maxEntries)
-    : maxEntries_(maxEntries), entries_(), referenceSets_() {}
 
-HeaderTable::~HeaderTable() {
-  assert(referenceSets_.empty() &&
-         "There shall be no reference set at header table destruction.");
+constexpr size_t staticTableLength = sizeof(staticTable) / sizeof(*staticTable);
+
+static_assert(staticTableLength == StaticTable::length(),
+              "Static table length mismatch.");
+
+} // namespace
+
+BufferRef StaticTable::name(size_t index) {
+  if (index == 0 || index > staticTableLength)
+    RAISE(IndexError);
+
+  const StaticEntry& entry = staticTable[index - 1];
+  return BufferRef(entry.name, entry.nameLength);
 }
 
-void HeaderTable::setMaxEntries(size_t limit) {
-  maxEntries_ = limit;
+BufferRef StaticTable::value(size_t index) {
+  if (index == 0 || index > staticTableLength)
+    RAISE(IndexError);
 
-  while (size() > limit) {
-    entries_.pop_back();
-  }
+  const StaticEntry& entry = staticTable[index - 1];
+  return BufferRef(entry.value, entry.valueLength);
 }
 
-void HeaderTable::add(const HeaderField& field) {
-  while (size() >= maxEntries()) {
-    entries_.pop_back();
+size_t StaticTable::find(const BufferRef& name, const BufferRef& value,
+                         bool* nameOnly) {
+  const int first = findStaticName(name.data(), name.size());
+  if (first < 0) {
+    *nameOnly = false;
+    return 0;
+  }
+
+  // entries of the same name are adjacent
+  for (size_t i = first;
+       i < staticTableLength &&
+       staticTable[i].nameLength == name.size() &&
+       std::memcmp(staticTable[i].name, name.data(), name.size()) == 0;
+       ++i) {
+    if (staticTable[i].valueLength == value.size() &&
+        std::memcmp(staticTable[i].value, value.data(), value.size()) == 0) {
+      *nameOnly = false;
+      return i + 1;
+    }
   }
 
-  entries_.push_front(field);
+  *nameOnly = true;
+  return first + 1;
 }
+// }}}
+// {{{ DynamicTable
+const size_t DynamicTable::npos;
 
-HeaderTable::iterator HeaderTable::find(const HeaderFieldName& name) {
-  return std::find_if(entries_.begin(), entries_.end(),
-                      [&](const HeaderField& f) {
-    // just test on header name
-    return f.name == name;
-  });
+DynamicTable::DynamicTable(size_t maxSize, bool indexed)
+    : slots_(),
+      head_(0),
+      length_(0),
+      size_(0),
+      maxSize_(maxSize),
+      indexed_(indexed),
+      inserted_(0),
+      index_() {
 }
 
-HeaderTable::const_iterator HeaderTable::find(
-    const HeaderFieldName& name) const {
-  return std::find_if(entries_.cbegin(), entries_.cend(),
-                      [&](const HeaderField& f) {
-    // just test on header name
-    return f.name == name;
-  });
+void DynamicTable::setMaxSize(size_t maxSize) {
+  maxSize_ = maxSize;
+  evict(0);
 }
 
-bool HeaderTable::contains(const HeaderField* field) const {
-  auto i = std::find_if(entries_.cbegin(), entries_.cend(),
-                        [&](const HeaderField& f) { return &f == field; });
+void DynamicTable::add(const BufferRef& name, const BufferRef& value) {
+  const size_t required = name.size() + value.size() + 32;
+
+  if (required > maxSize_) {
+    // rfc7541, 4.4: not an error, but empties the table
+    clear();
+    return;
+  }
+
+  evict(required);
+
+  if (length_ == slots_.size())
+    grow();
 
-  return i != cend();
+  head_ = (head_ + 1) & (slots_.size() - 1);
+
+  // assign() keeps the capacity of the evicted entry that used this slot
+  HeaderField& slot = slots_[head_];
+  slot.name.assign(name.data(), name.size());
+  slot.value.assign(value.data(), value.size());
+
+  length_++;
+  size_ += required;
+
+  if (indexed_)
+    index_.emplace(hashName(name), inserted_);
+
+  inserted_++;
 }
 
-void HeaderTable::remove(const HeaderFieldName& name) {
-  auto i = find(name);
+size_t DynamicTable::find(const BufferRef& name, const BufferRef& value,
+                          bool* nameOnly) const {
+  size_t nameIndex = npos;
+
+  auto range = index_.equal_range(hashName(name));
+  for (auto i = range.first; i != range.second; ++i) {
+    const size_t index = inserted_ - 1 - i->second;
+    const HeaderField& field = at(index);
 
-  if (i != entries_.end()) {
-    for (ReferenceSet* rs : referenceSets_) {
-      rs->remove(&*i);
+    if (!(name == field.name))
+      continue;
+
+    if (value == field.value) {
+      *nameOnly = false;
+      return index;
+    }
+
+    if (index < nameIndex) {
+      nameIndex = index;
     }
-    entries_.erase(i);
   }
+
+  *nameOnly = nameIndex != npos;
+  return nameIndex;
 }
 
-void HeaderTable::remove(const HeaderField* field) {
-  auto i = std::find_if(begin(), end(),
-                        [&](const HeaderField& f) { return &f == field; });
+void DynamicTable::clear() {
+  length_ = 0;
+  size_ = 0;
+  index_.clear();
+}
 
-  if (i != entries_.end()) {
-    for (ReferenceSet* rs : referenceSets_) {
-      rs->remove(&*i);
-    }
-    entries_.erase(i);
+uint64_t DynamicTable::hashName(const BufferRef& name) XZERO_NOEXCEPT {
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ull;
+  for (char ch: name) {
+    hash ^= static_cast<uint8_t>(ch);
+    hash *= 1099511628211ull;
   }
+  return hash;
 }
 
-void HeaderTable::clear() {
-  for (const HeaderField& entry : entries_) {
-    for (ReferenceSet* rs : referenceSets_) {
-      rs->remove(&entry);
+void DynamicTable::evict(size_t required) {
+  while (length_ > 0 && size_ + required > maxSize_) {
+    evictOldest();
+  }
+}
+
+void DynamicTable::evictOldest() {
+  const HeaderField& oldest = at(length_ - 1);
+
+  if (indexed_) {
+    const uint64_t seq = inserted_ - length_;
+    auto range = index_.equal_range(hashName(BufferRef(oldest.name)));
+    for (auto i = range.first; i != range.second; ++i) {
+      if (i->second == seq) {
+        index_.erase(i);
+        break;
+      }
     }
   }
 
-  entries_.clear();
+  size_ -= oldest.size();
+  length_--;
 }
 
-void HeaderTable::link(ReferenceSet* ref) { referenceSets_.push_back(ref); }
+void DynamicTable::grow() {
+  const size_t capacity = slots_.empty() ? 8 : slots_.size() * 2;
+  std::vector<HeaderField> slots(capacity);
 
-void HeaderTable::unlink(ReferenceSet* ref) {
-  auto i = std::find(referenceSets_.begin(), referenceSets_.end(), ref);
-  if (i != referenceSets_.end()) {
-    referenceSets_.erase(i);
-  }
+  // lay out the entries oldest first
+  for (size_t i = 0; i < length_; ++i)
+    slots[length_ - 1 - i] = std::move(slots_[(head_ + slots_.size() - i) &
+                                              (slots_.size() - 1)]);
+
+  slots_.swap(slots);
+  head_ = (length_ + capacity - 1) & (capacity - 1);
 }
 // }}}
-// {{{ ReferenceSet
-ReferenceSet::ReferenceSet(HeaderTable* headerTable)
-    : headerTable_(headerTable), references_() {
+// {{{ Huffman
+namespace {
 
-  headerTable_->link(this);
-}
+struct HuffmanCode {
+  uint32_t code;
+  unsigned bits;
+};
 
-ReferenceSet::~ReferenceSet() {
-  //.
-  headerTable_->unlink(this);
-}
+static const HuffmanCode huffmanCodes[257] = {
+  {0x00001ff8, 13},  // 0
+  {0x007fffd8, 23},  // 1
+  {0x0fffffe2, 28},  // 2
+  {0x0fffffe3, 28},  // 3
+  {0x0fffffe4, 28},  // 4
+  {0x0fffffe5, 28},  // 5
+  {0x0fffffe6, 28},  // 6
+  {0x0fffffe7, 28},  // 7
+  {0x0fffffe8, 28},  // 8
+  {0x00ffffea, 24},  // 9
+  {0x3ffffffc, 30},  // 10
+  {0x0fffffe9, 28},  // 11
+  {0x0fffffea, 28},  // 12
+  {0x3ffffffd, 30},  // 13
+  {0x0fffffeb, 28},  // 14
+  {0x0fffffec, 28},  // 15
+  {0x0fffffed, 28},  // 16
+  {0x0fffffee, 28},  // 17
+  {0x0fffffef, 28},  // 18
+  {0x0ffffff0, 28},  // 19
+  {0x0ffffff1, 28},  // 20
+  {0x0ffffff2, 28},  // 21
+  {0x3ffffffe, 30},  // 22
+  {0x0ffffff3, 28},  // 23
+  {0x0ffffff4, 28},  // 24
+  {0x0ffffff5, 28},  // 25
+  {0x0ffffff6, 28},  // 26
+  {0x0ffffff7, 28},  // 27
+  {0x0ffffff8, 28},  // 28
+  {0x0ffffff9, 28},  // 29
+  {0x0ffffffa, 28},  // 30
+  {0x0ffffffb, 28},  // 31
+  {0x00000014,  6},  // ' '
+  {0x000003f8, 10},  // '!'
+  {0x000003f9, 10},  // '"'
+  {0x00000ffa, 12},  // '#'
+  {0x00001ff9, 13},  // '$'
+  {0x00000015,  6},  // '%'
+  {0x000000f8,  8},  // '&'
+  {0x000007fa, 11},  // "'"
+  {0x000003fa, 10},  // '('
+  {0x000003fb, 10},  // ')'
+  {0x000000f9,  8},  // '*'
+  {0x000007fb, 11},  // '+'
+  {0x000000fa,  8},  // ','
+  {0x00000016,  6},  // '-'
+  {0x00000017,  6},  // '.'
+  {0x00000018,  6},  // '/'
+  {0x00000000,  5},  // '0'
+  {0x00000001,  5},  // '1'
+  {0x00000002,  5},  // '2'
+  {0x00000019,  6},  // '3'
+  {0x0000001a,  6},  // '4'
+  {0x0000001b,  6},  // '5'
+  {0x0000001c,  6},  // '6'
+  {0x0000001d,  6},  // '7'
+  {0x0000001e,  6},  // '8'
+  {0x0000001f,  6},  // '9'
+  {0x0000005c,  7},  // ':'
+  {0x000000fb,  8},  // ';'
+  {0x00007ffc, 15},  // '<'
+  {0x00000020,  6},  // '='
+  {0x00000ffb, 12},  // '>'
+  {0x000003fc, 10},  // '?'
+  {0x00001ffa, 13},  // '@'
+  {0x00000021,  6},  // 'A'
+  {0x0000005d,  7},  // 'B'
+  {0x0000005e,  7},  // 'C'
+  {0x0000005f,  7},  // 'D'
+  {0x00000060,  7},  // 'E'
+  {0x00000061,  7},  // 'F'
+  {0x00000062,  7},  // 'G'
+  {0x00000063,  7},  // 'H'
+  {0x00000064,  7},  // 'I'
+  {0x00000065,  7},  // 'J'
+  {0x00000066,  7},  // 'K'
+  {0x00000067,  7},  // 'L'
+  {0x00000068,  7},  // 'M'
+  {0x00000069,  7},  // 'N'
+  {0x0000006a,  7},  // 'O'
+  {0x0000006b,  7},  // 'P'
+  {0x0000006c,  7},  // 'Q'
+  {0x0000006d,  7},  // 'R'
+  {0x0000006e,  7},  // 'S'
+  {0x0000006f,  7},  // 'T'
+  {0x00000070,  7},  // 'U'
+  {0x00000071,  7},  // 'V'
+  {0x00000072,  7},  // 'W'
+  {0x000000fc,  8},  // 'X'
+  {0x00000073,  7},  // 'Y'
+  {0x000000fd,  8},  // 'Z'
+  {0x00001ffb, 13},  // '['
+  {0x0007fff0, 19},  // '\\'
+  {0x00001ffc, 13},  // ']'
+  {0x00003ffc, 14},  // '^'
+  {0x00000022,  6},  // '_'
+  {0x00007ffd, 15},  // '`'
+  {0x00000003,  5},  // 'a'
+  {0x00000023,  6},  // 'b'
+  {0x00000004,  5},  // 'c'
+  {0x00000024,  6},  // 'd'
+  {0x00000005,  5},  // 'e'
+  {0x00000025,  6},  // 'f'
+  {0x00000026,  6},  // 'g'
+  {0x00000027,  6},  // 'h'
+  {0x00000006,  5},  // 'i'
+  {0x00000074,  7},  // 'j'
+  {0x00000075,  7},  // 'k'
+  {0x00000028,  6},  // 'l'
+  {0x00000029,  6},  // 'm'
+  {0x0000002a,  6},  // 'n'
+  {0x00000007,  5},  // 'o'
+  {0x0000002b,  6},  // 'p'
+  {0x00000076,  7},  // 'q'
+  {0x0000002c,  6},  // 'r'
+  {0x00000008,  5},  // 's'
+  {0x00000009,  5},  // 't'
+  {0x0000002d,  6},  // 'u'
+  {0x00000077,  7},  // 'v'
+  {0x00000078,  7},  // 'w'
+  {0x00000079,  7},  // 'x'
+  {0x0000007a,  7},  // 'y'
+  {0x0000007b,  7},  // 'z'
+  {0x00007ffe, 15},  // '{'
+  {0x000007fc, 11},  // '|'
+  {0x00003ffd, 14},  // '}'
+  {0x00001ffd, 13},  // '~'
+  {0x0ffffffc, 28},  // 127
+  {0x000fffe6, 20},  // 128
+  {0x003fffd2, 22},  // 129
+  {0x000fffe7, 20},  // 130
+  {0x000fffe8, 20},  // 131
+  {0x003fffd3, 22},  // 132
+  {0x003fffd4, 22},  // 133
+  {0x003fffd5, 22},  // 134
+  {0x007fffd9, 23},  // 135
+  {0x003fffd6, 22},  // 136
+  {0x007fffda, 23},  // 137
+  {0x007fffdb, 23},  // 138
+  {0x007fffdc, 23},  // 139
+  {0x007fffdd, 23},  // 140
+  {0x007fffde, 23},  // 141
+  {0x00ffffeb, 24},  // 142
+  {0x007fffdf, 23},  // 143
+  {0x00ffffec, 24},  // 144
+  {0x00ffffed, 24},  // 145
+  {0x003fffd7, 22},  // 146
+  {0x007fffe0, 23},  // 147
+  {0x00ffffee, 24},  // 148
+  {0x007fffe1, 23},  // 149
+  {0x007fffe2, 23},  // 150
+  {0x007fffe3, 23},  // 151
+  {0x007fffe4, 23},  // 152
+  {0x001fffdc, 21},  // 153
+  {0x003fffd8, 22},  // 154
+  {0x007fffe5, 23},  // 155
+  {0x003fffd9, 22},  // 156
+  {0x007fffe6, 23},  // 157
+  {0x007fffe7, 23},  // 158
+  {0x00ffffef, 24},  // 159
+  {0x003fffda, 22},  // 160
+  {0x001fffdd, 21},  // 161
+  {0x000fffe9, 20},  // 162
+  {0x003fffdb, 22},  // 163
+  {0x003fffdc, 22},  // 164
+  {0x007fffe8, 23},  // 165
+  {0x007fffe9, 23},  // 166
+  {0x001fffde, 21},  // 167
+  {0x007fffea, 23},  // 168
+  {0x003fffdd, 22},  // 169
+  {0x003fffde, 22},  // 170
+  {0x00fffff0, 24},  // 171
+  {0x001fffdf, 21},  // 172
+  {0x003fffdf, 22},  // 173
+  {0x007fffeb, 23},  // 174
+  {0x007fffec, 23},  // 175
+  {0x001fffe0, 21},  // 176
+  {0x001fffe1, 21},  // 177
+  {0x003fffe0, 22},  // 178
+  {0x001fffe2, 21},  // 179
+  {0x007fffed, 23},  // 180
+  {0x003fffe1, 22},  // 181
+  {0x007fffee, 23},  // 182
+  {0x007fffef, 23},  // 183
+  {0x000fffea, 20},  // 184
+  {0x003fffe2, 22},  // 185
+  {0x003fffe3, 22},  // 186
+  {0x003fffe4, 22},  // 187
+  {0x007ffff0, 23},  // 188
+  {0x003fffe5, 22},  // 189
+  {0x003fffe6, 22},  // 190
+  {0x007ffff1, 23},  // 191
+  {0x03ffffe0, 26},  // 192
+  {0x03ffffe1, 26},  // 193
+  {0x000fffeb, 20},  // 194
+  {0x0007fff1, 19},  // 195
+  {0x003fffe7, 22},  // 196
+  {0x007ffff2, 23},  // 197
+  {0x003fffe8, 22},  // 198
+  {0x01ffffec, 25},  // 199
+  {0x03ffffe2, 26},  // 200
+  {0x03ffffe3, 26},  // 201
+  {0x03ffffe4, 26},  // 202
+  {0x07ffffde, 27},  // 203
+  {0x07ffffdf, 27},  // 204
+  {0x03ffffe5, 26},  // 205
+  {0x00fffff1, 24},  // 206
+  {0x01ffffed, 25},  // 207
+  {0x0007fff2, 19},  // 208
+  {0x001fffe3, 21},  // 209
+  {0x03ffffe6, 26},  // 210
+  {0x07ffffe0, 27},  // 211
+  {0x07ffffe1, 27},  // 212
+  {0x03ffffe7, 26},  // 213
+  {0x07ffffe2, 27},  // 214
+  {0x00fffff2, 24},  // 215
+  {0x001fffe4, 21},  // 216
+  {0x001fffe5, 21},  // 217
+  {0x03ffffe8, 26},  // 218
+  {0x03ffffe9, 26},  // 219
+  {0x0ffffffd, 28},  // 220
+  {0x07ffffe3, 27},  // 221
+  {0x07ffffe4, 27},  // 222
+  {0x07ffffe5, 27},  // 223
+  {0x000fffec, 20},  // 224
+  {0x00fffff3, 24},  // 225
+  {0x000fffed, 20},  // 226
+  {0x001fffe6, 21},  // 227
+  {0x003fffe9, 22},  // 228
+  {0x001fffe7, 21},  // 229
+  {0x001fffe8, 21},  // 230
+  {0x007ffff3, 23},  // 231
+  {0x003fffea, 22},  // 232
+  {0x003fffeb, 22},  // 233
+  {0x01ffffee, 25},  // 234
+  {0x01ffffef, 25},  // 235
+  {0x00fffff4, 24},  // 236
+  {0x00fffff5, 24},  // 237
+  {0x03ffffea, 26},  // 238
+  {0x007ffff4, 23},  // 239
+  {0x03ffffeb, 26},  // 240
+  {0x07ffffe6, 27},  // 241
+  {0x03ffffec, 26},  // 242
+  {0x03ffffed, 26},  // 243
+  {0x07ffffe7, 27},  // 244
+  {0x07ffffe8, 27},  // 245
+  {0x07ffffe9, 27},  // 246
+  {0x07ffffea, 27},  // 247
+  {0x07ffffeb, 27},  // 248
+  {0x0ffffffe, 28},  // 249
+  {0x07ffffec, 27},  // 250
+  {0x07ffffed, 27},  // 251
+  {0x07ffffee, 27},  // 252
+  {0x07ffffef, 27},  // 253
+  {0x07fffff0, 27},  // 254
+  {0x03ffffee, 26},  // 255
+  {0x3fffffff, 30},  // 256
+};
 
-bool ReferenceSet::empty() const {
-  //.
-  return references_.empty();
-}
+const unsigned EOS = 256;
 
-size_t ReferenceSet::size() const {
-  //.
-  return references_.size();
-}
+/**
+ * Huffman decoding state machine, consuming four bits per transition.
+ *
+ * The states are the inner nodes of the Huffman code tree, state 0 being its
+ * root. As no code is shorter than five bits, a transition emits at most one
+ * symbol.
+ */
+class HuffmanDecodeTable {
+ public:
+  enum Flags {
+    /** The bits consumed since the last symbol are valid padding. */
+    Accept = 1,
+    /** The transition emits a symbol. */
+    Symbol = 2,
+    /** The transition hits EOS or an invalid code. */
+    Fail = 4,
+  };
+
+  struct Transition {
+    uint16_t state;
+    uint8_t flags;
+    uint8_t symbol;
+  };
 
-void ReferenceSet::add(const HeaderField* field) {
-  if (headerTable_->contains(field)) {
-    if (!contains(field)) {
-      references_.push_back(field);
+  HuffmanDecodeTable();
+
+  const Transition& next(unsigned state, unsigned nibble) const {
+    return transitions_[state * 16 + nibble];
+  }
+
+ private:
+  std::vector<Transition> transitions_;
+};
+
+HuffmanDecodeTable::HuffmanDecodeTable()
+    : transitions_() {
+  // build the binary code tree first
+  struct Node {
+    int next[2];
+    int symbol;
+    int state;
+    bool accept;
+  };
+  std::vector<Node> nodes;
+  nodes.push_back(Node{{-1, -1}, -1, 0, true});
+
+  for (unsigned symbol = 0; symbol <= EOS; ++symbol) {
+    const HuffmanCode& hc = huffmanCodes[symbol];
+    size_t current = 0;
+
+    for (unsigned i = hc.bits; i > 0; --i) {
+      const unsigned bit = (hc.code >> (i - 1)) & 1;
+      if (nodes[current].next[bit] < 0) {
+        nodes[current].next[bit] = nodes.size();
+        nodes.push_back(Node{{-1, -1}, -1, -1, false});
+      }
+      current = nodes[current].next[bit];
     }
+
+    nodes[current].symbol = symbol;
   }
-}
 
-bool ReferenceSet::contains(const HeaderField* field) const {
-  auto i = std::find(references_.begin(), references_.end(), field);
-  return i != references_.end();
-}
+  // number the inner nodes, and mark those valid to end at.
+  // rfc7541, 5.2: padding is the most significant bits of EOS (all ones),
+  // and less than 8 bits long.
+  unsigned states = 0;
+  for (Node& node: nodes)
+    if (node.symbol < 0)
+      node.state = states++;
 
-void ReferenceSet::remove(const HeaderField* field) {
-  auto i = std::find(references_.begin(), references_.end(), field);
-  if (i != references_.end()) {
-    references_.erase(i);
+  size_t current = 0;
+  for (unsigned depth = 1; depth < 8; ++depth) {
+    current = nodes[current].next[1];
+    nodes[current].accept = true;
   }
-}
 
-ReferenceSet::iterator ReferenceSet::begin() {
-  return iterator(this, references_.begin());
+  transitions_.resize(states * 16);
+
+  for (const Node& node: nodes) {
+    if (node.symbol >= 0)
+      continue;
+
+    for (unsigned nibble = 0; nibble < 16; ++nibble) {
+      Transition& t = transitions_[node.state * 16 + nibble];
+      t = Transition{0, 0, 0};
+      int current = &node - &nodes[0];
+
+      for (int k = 3; k >= 0; --k) {
+        current = nodes[current].next[(nibble >> k) & 1];
+
+        if (current < 0 || nodes[current].symbol == static_cast<int>(EOS)) {
+          t.flags = Fail;
+          break;
+        }
+
+        if (nodes[current].symbol >= 0) {
+          t.flags |= Symbol;
+          t.symbol = static_cast<uint8_t>(nodes[current].symbol);
+          current = 0;
+        }
+      }
+
+      if (!(t.flags & Fail)) {
+        t.state = nodes[current].state;
+        if (nodes[current].accept) {
+          t.flags |= Accept;
+        }
+      }
+    }
+  }
 }
 
-ReferenceSet::iterator ReferenceSet::end() {
-  return iterator(this, references_.end());
+const HuffmanDecodeTable& huffmanDecodeTable() {
+  static const HuffmanDecodeTable table;
+  return table;
 }
-// }}}
-// {{{ ReferenceSet::iterator
-ReferenceSet::iterator::iterator()
-    : referenceSet_(nullptr), current_(), end_() {}
 
-ReferenceSet::iterator::iterator(ReferenceSet* rs,
-                                 std::list<const HeaderField*>::iterator init)
-    : referenceSet_(rs), current_(init), end_(rs->references_.end()) {}
+} // namespace
 
-ReferenceSet::iterator& ReferenceSet::iterator::operator++() {
-  if (current_ != end_) {
-    ++current_;
+bool Huffman::decode(const BufferRef& data, std::string* output) {
+  const HuffmanDecodeTable& table = huffmanDecodeTable();
+  unsigned state = 0;
+  bool accept = true;
+
+  // the shortest code is 5 bits long
+  output->reserve(output->size() + data.size() * 8 / 5);
+
+  for (char ch: data) {
+    const uint8_t byte = static_cast<uint8_t>(ch);
+
+    const HuffmanDecodeTable::Transition& hi = table.next(state, byte >> 4);
+    if (hi.flags & HuffmanDecodeTable::Fail)
+      return false;
+    if (hi.flags & HuffmanDecodeTable::Symbol)
+      output->push_back(static_cast<char>(hi.symbol));
+
+    const HuffmanDecodeTable::Transition& lo = table.next(hi.state, byte & 0xf);
+    if (lo.flags & HuffmanDecodeTable::Fail)
+      return false;
+    if (lo.flags & HuffmanDecodeTable::Symbol)
+      output->push_back(static_cast<char>(lo.symbol));
+
+    state = lo.state;
+    accept = lo.flags & HuffmanDecodeTable::Accept;
   }
 
-  return *this;
+  return accept;
 }
 
-bool ReferenceSet::iterator::operator==(const iterator& other) const {
-  return referenceSet_ == other.referenceSet_ && current_ == other.current_;
-}
+size_t Huffman::encodedLength(const BufferRef& data) XZERO_NOEXCEPT {
+  size_t bits = 0;
 
-bool ReferenceSet::iterator::operator!=(const iterator& other) const {
-  return !(*this == other);
-}
+  for (char ch: data)
+    bits += huffmanCodes[static_cast<uint8_t>(ch)].bits;
 
-const HeaderField& ReferenceSet::iterator::operator*() const {
-  return **current_;
-  // return *referenceSet_->headerTable()->find(*current_);
+  return (bits + 7) / 8;
 }
-// }}}
-// {{{ EncoderHelper
-/**
- * Encodes an integer.
- *
- * @param output     The output buffer to encode to.
- * @param value      The integer value to encode.
- * @param prefixBits Number of bits for the first bytes that the encoder
- *                   is allowed to use (between 1 and 8).
- */
-void EncoderHelper::encodeInt(Buffer* output, uint64_t value,
-                              unsigned prefixBits) {
-  assert(prefixBits >= 1 && prefixBits <= 8);
 
-  const unsigned maxValue = (1 << prefixBits) - 1;
+void Huffman::encode(const BufferRef& data, Buffer* output) {
+  uint64_t bits = 0;
+  unsigned pending = 0;
 
-  if (value < maxValue) {
-    output->push_back(static_cast<char>(value));
-  } else {
-    output->push_back(static_cast<char>(maxValue));
-    value -= maxValue;
+  output->reserve(output->size() + encodedLength(data));
+
+  for (char ch: data) {
+    const HuffmanCode& hc = huffmanCodes[static_cast<uint8_t>(ch)];
+    bits = (bits << hc.bits) | hc.code;
+    pending += hc.bits;
 
-    while (value >= 128) {
-      const uint8_t byte = (1 << 7) | (value & 0x7f);
-      output->push_back(static_cast<char>(byte));
-      value /= 128;
+    while (pending >= 8) {
+      pending -= 8;
+      output->push_back(static_cast<char>(bits >> pending));
     }
-    output->push_back(static_cast<char>(value));
   }
-}
 
+  // pad with the most significant bits of EOS
+  if (pending > 0) {
+    output->push_back(static_cast<char>((bits << (8 - pending)) |
+                                        (0xff >> pending)));
+  }
+}
+// }}}
+// {{{ Encoder
 /**
- * @brief Encodes an indexed header.
- *
- * @param output   target buffer to write to
- * @param index    header index
+ * Tests whether the given header field must never be put into any
+ * compression table (rfc7541, 7.1.3).
  */
-void EncoderHelper::encodeIndexed(Buffer* output, unsigned index) {
-  size_t n = output->size();
-  encodeInt(output, index, 7);
-  output->data()[n] |= 0x80;
+static bool isSensitive(const std::string& name) {
+  return name == "authorization" || name == "proxy-authorization" ||
+         name == "set-cookie" || name == "cookie";
 }
 
 /**
- * @brief Encodes a header field with literal name and literal value.
- *
- * @param output   target buffer to write to
- * @param name     header field's name
- * @param value    header field's value
- * @param indexing whether or not given header-field should be persisted in
- *                 the header table.
- * @param huffman  whether or not to Huffman-encode
+ * Tests whether the given header field's value is very likely to differ
+ * from message to message, and thus not worth indexing.
  */
-void EncoderHelper::encodeLiteral(Buffer* output, const BufferRef& name,
-                                  const BufferRef& value, bool indexing,
-                                  bool huffman) {
+static bool isVolatile(const std::string& name) {
+  return name == ":path" || name == "content-length" || name == "date" ||
+         name == "etag" || name == "last-modified" || name == "expires" ||
+         name == "age" || name == "content-range" || name == "location";
+}
+
+Encoder::Encoder(size_t maxTableSize)
+    : table_(maxTableSize, true),
+      sizeUpdatePending_(false),
+      name_() {
+}
 
-  // if (huffman) {
-  //   name = huffman_encode(name)
-  //   value = huffman_encode(value)
-  // }
+void Encoder::setMaxTableSize(size_t value) {
+  if (value != table_.maxSize()) {
+    table_.setMaxSize(value);
+    sizeUpdatePending_ = true;
+  }
+}
+
+void Encoder::encode(const BufferRef& name, const BufferRef& value,
+                     Buffer* output) {
+  if (sizeUpdatePending_) {
+    encodeInt(0x20, 5, table_.maxSize(), output);
+    sizeUpdatePending_ = false;
+  }
+
+  name_.assign(name.data(), name.size());
+  for (char& ch: name_)
+    if (ch >= 'A' && ch <= 'Z')
+      ch += 'a' - 'A';
+
+  const BufferRef lname(name_);
+
+  bool nameOnly = false;
+  size_t nameIndex = StaticTable::find(lname, value, &nameOnly);
+
+  if (nameIndex && !nameOnly) {
+    encodeInt(0x80, 7, nameIndex, output);
+    return;
+  }
+
+  const bool sensitive = isSensitive(name_);
+
+  if (!sensitive) {
+    const size_t i = table_.find(lname, value, &nameOnly);
+    if (i != DynamicTable::npos) {
+      if (!nameOnly) {
+        encodeInt(0x80, 7, StaticTable::length() + 1 + i, output);
+        return;
+      }
+      if (!nameIndex) {
+        nameIndex = StaticTable::length() + 1 + i;
+      }
+    }
+  }
 
-  if (indexing) {
-    output->push_back('\0x40');
+  if (sensitive) {
+    // literal header field never indexed
+    encodeInt(0x10, 4, nameIndex, output);
+  } else if (isVolatile(name_)) {
+    // literal header field without indexing
+    encodeInt(0x00, 4, nameIndex, output);
   } else {
-    output->push_back('\0x00');
+    // literal header field with incremental indexing
+    encodeInt(0x40, 6, nameIndex, output);
+    table_.add(lname, value);
   }
 
-  encodeInt(output, name.size(), 7);
-  output->push_back(name);
+  if (!nameIndex)
+    encodeString(lname, output);
 
-  encodeInt(output, value.size(), 7);
-  output->push_back(value);
+  encodeString(value, output);
 }
 
-/**
- * @brief Encodes header field with indexed name and literal value.
- *
- * @param output output buffer to encode to
- * @param name name index
- * @param value value literal
- * @param huffman whether or not to huffman-encode the value literal
- */
-void EncoderHelper::encodeIndexedLiteral(Buffer* output, unsigned name,
-                                         const BufferRef& value, bool huffman) {
-  // if (huffman) {
-  //   value = huffman_encode(value);
-  // }
-
-  encodeInt(output, name, 4);
-  encodeInt(output, value.size(), 7);
-  output->push_back(value);
+void Encoder::encodeInt(uint8_t flags, unsigned prefixBits, uint64_t value,
+                        Buffer* output) {
+  const uint64_t mask = (1 << prefixBits) - 1;
+
+  if (value < mask) {
+    output->push_back(static_cast<char>(flags | value));
+    return;
+  }
+
+  output->push_back(static_cast<char>(flags | mask));
+  value -= mask;
+
+  while (value >= 128) {
+    output->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+
+  output->push_back(static_cast<char>(value));
 }
 
-void EncoderHelper::encodeTableSizeChange(Buffer* output, unsigned newSize) {
-  size_t n = output->size();
-  encodeInt(output, newSize, 4);
-  output->data()[n] |= 0x20;
+void Encoder::encodeString(const BufferRef& value, Buffer* output) {
+  const size_t huffmanLength = Huffman::encodedLength(value);
+
+  if (huffmanLength < value.size()) {
+    encodeInt(0x80, 7, huffmanLength, output);
+    Huffman::encode(value, output);
+  } else {
+    encodeInt(0x00, 7, value.size(), output);
+    output->push_back(value);
+  }
 }
 // }}}
-// {{{ DecoderHelper
-uint64_t DecoderHelper::decodeInt(const BufferRef& data, unsigned prefixBits,
-                                  unsigned* bytesConsumed) {
-
-  assert(prefixBits >= 1 && prefixBits <= 8);
-
-  const uint8_t mask = 0xFF >> (8 - prefixBits);
-  unsigned index = 0;
-  uint64_t result = data[index] & mask;
-
-  if (result >= (1 << prefixBits) - 1) {
-    unsigned M = 0;
-    while (true) {
-      index++;
-      const uint8_t byte = data[index];
-      result += (byte & 127) * (1 << M);
-      if ((byte & 128) != 128) {
-        break;
+// {{{ Decoder
+Decoder::Decoder(size_t maxTableSize)
+    : table_(maxTableSize),
+      maxTableSize_(maxTableSize),
+      name_(),
+      value_() {
+}
+
+void Decoder::setMaxTableSize(size_t value) {
+  maxTableSize_ = value;
+
+  if (table_.maxSize() > value) {
+    table_.setMaxSize(value);
+  }
+}
+
+bool Decoder::decode(const BufferRef& headerBlock,
+                     const HeaderFieldHandler& onField) {
+  const uint8_t* pos = reinterpret_cast<const uint8_t*>(headerBlock.data());
+  const uint8_t* end = pos + headerBlock.size();
+  bool fieldSeen = false;
+
+  while (pos != end) {
+    const uint8_t type = *pos;
+
+    if (type & 0x80) {
+      // indexed header field
+      uint64_t index;
+      BufferRef name;
+      BufferRef value;
+      if (!decodeInt(&pos, end, 7, &index) || !lookup(index, &name, &value))
+        return false;
+
+      onField(name, value);
+      fieldSeen = true;
+    } else if ((type & 0xe0) == 0x20) {
+      // dynamic table size update, only allowed at the beginning
+      uint64_t size;
+      if (fieldSeen || !decodeInt(&pos, end, 5, &size) ||
+          size > maxTableSize_)
+        return false;
+
+      table_.setMaxSize(size);
+    } else {
+      // literal header field with incremental indexing (01xxxxxx),
+      // without indexing (0000xxxx) or never indexed (0001xxxx)
+      const bool indexing = (type & 0xc0) == 0x40;
+      uint64_t nameIndex;
+      if (!decodeInt(&pos, end, indexing ? 6 : 4, &nameIndex))
+        return false;
+
+      if (nameIndex) {
+        // copied, as adding to the table may evict the referenced entry
+        BufferRef name;
+        BufferRef value;
+        if (!lookup(nameIndex, &name, &value))
+          return false;
+        name_.assign(name.data(), name.size());
+      } else if (!decodeString(&pos, end, &name_)) {
+        return false;
       }
-      M = M + 7;
+
+      if (!decodeString(&pos, end, &value_))
+        return false;
+
+      if (indexing)
+        table_.add(BufferRef(name_), BufferRef(value_));
+
+      onField(BufferRef(name_), BufferRef(value_));
+      fieldSeen = true;
     }
   }
 
-  if (bytesConsumed) {
-    *bytesConsumed = index + 1;
+  return true;
+}
+
+bool Decoder::lookup(uint64_t index, BufferRef* name, BufferRef* value) const {
+  if (index == 0)
+    return false;
+
+  if (index <= StaticTable::length()) {
+    *name = StaticTable::name(index);
+    *value = StaticTable::value(index);
+    return true;
   }
 
-  return result;
+  index -= StaticTable::length() + 1;
+  if (index >= table_.length())
+    return false;
+
+  const HeaderField& field = table_.at(index);
+  *name = BufferRef(field.name);
+  *value = BufferRef(field.value);
+  return true;
+}
+
+bool Decoder::decodeInt(const uint8_t** pos, const uint8_t* end,
+                        unsigned prefixBits, uint64_t* value) {
+  if (*pos == end)
+    return false;
+
+  const uint64_t mask = (1 << prefixBits) - 1;
+  uint64_t result = **pos & mask;
+  ++*pos;
+
+  if (result < mask) {
+    *value = result;
+    return true;
+  }
+
+  for (unsigned shift = 0; ; shift += 7) {
+    if (*pos == end || shift > 56)
+      return false;
+
+    const uint8_t byte = **pos;
+    ++*pos;
+    result += static_cast<uint64_t>(byte & 0x7f) << shift;
+
+    if (!(byte & 0x80))
+      break;
+  }
+
+  *value = result;
+  return true;
+}
+
+bool Decoder::decodeString(const uint8_t** pos, const uint8_t* end,
+                           std::string* value) {
+  if (*pos == end)
+    return false;
+
+  const bool huffman = **pos & 0x80;
+  uint64_t length;
+  if (!decodeInt(pos, end, 7, &length))
+    return false;
+
+  if (length > static_cast<uint64_t>(end - *pos))
+    return false;
+
+  const char* data = reinterpret_cast<const char*>(*pos);
+  *pos += length;
+
+  value->clear();
+
+  if (huffman)
+    return Huffman::decode(BufferRef(data, length), value);
+
+  value->assign(data, length);
+  return true;
 }
 // }}}
 
 }  // namespace hpack
+}  // namespace http2
 }  // namespace xzero
-
-// vim:ts=2:sw=2
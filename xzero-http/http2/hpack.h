@@ -1,4 +1,4 @@
-// This file is part of the "x0" project
+// This file is part of the "x0" project, http://xzero.io/
 //   (c) 2009-2014 Christian Parpart <trapni@gmail.com>
 //
 // Licensed under the MIT License (the "License"); you may not use this
@@ -8,235 +8,261 @@
 #pragma once
 
 #include <xzero-http/Api.h>
-#include <base/Buffer.h>
-#include <map>
-#include <list>
-#include <deque>
-#include <vector>
-#include <utility>
+#include <xzero-http/http2/http2.h>
+#include <xzero-base/Buffer.h>
+#include <xzero-base/sysconfig.h>
+#include <functional>
+#include <unordered_map>
 #include <string>
-#include <assert.h>
+#include <vector>
 #include <stdint.h>
 
 namespace xzero {
+namespace http2 {
 
-using namespace base;
-
+/**
+ * HPACK, header compression for HTTP/2 (RFC 7541).
+ */
 namespace hpack {
 
-typedef std::string HeaderFieldName;
-typedef std::string HeaderFieldValue;
-
 /**
- * A name-value pair.
- *
- * Both the name and value are treated as opaque sequences of octets.
+ * A name-value pair, as stored in the dynamic table.
  */
-struct HeaderField {
- public:
-  HeaderField() = default;
-  HeaderField(HeaderField&&) = default;
-  HeaderField(const HeaderField&) = default;
-  HeaderField& operator=(const HeaderField&) = default;
-  HeaderField(const HeaderFieldName& nam, const HeaderFieldValue& val)
-      : name(nam), value(val) {}
-
-  bool operator==(const HeaderField& other) const {
-    return name == other.name && value == other.value;
-  }
+struct XZERO_HTTP_API HeaderField {
+  std::string name;
+  std::string value;
 
-  bool operator!=(const HeaderField& other) const {
-    //.
-    return !(*this == other);
-  }
+  HeaderField() = default;
+  HeaderField(const std::string& n, const std::string& v)
+      : name(n), value(v) {}
 
- public:
-  HeaderFieldName name;
-  HeaderFieldValue value;
+  /**
+   * Size of this entry as accounted by the dynamic table (rfc7541, 4.1).
+   */
+  size_t size() const XZERO_NOEXCEPT { return name.size() + value.size() + 32; }
 };
 
 /**
- * Unordered group of header fields.
+ * The predefined static table (rfc7541, Appendix A).
  *
- * A header set is an unordered group of header fields that
- * are encoded jointly. It can contain duplicate header fields.  A
- * complete set of key-value pairs contained in a HTTP request or
- * response is a header set.
- */
-typedef std::list<HeaderField> HeaderSet;
-
-/**
- * The static table (see Appendix B) is a component used
- * to associate static header fields to index values. 
- *
- * This data is ordered, read-only, always accessible,
- * and may be shared amongst
- * all encoding contexts.
+ * The table is a compile-time constant. Indices are 1-based, as on the wire.
  */
 class XZERO_HTTP_API StaticTable {
  public:
-  StaticTable();
-  ~StaticTable();
-
-  static StaticTable* get();
-
- private:
-  std::vector<HeaderField> entries_;
+  /** Number of entries in the static table. */
+  static constexpr size_t length() { return 61; }
+
+  /** Retrieves the name of the entry at given 1-based @p index. */
+  static BufferRef name(size_t index);
+
+  /** Retrieves the value of the entry at given 1-based @p index. */
+  static BufferRef value(size_t index);
+
+  /**
+   * Finds the best matching entry for given header field.
+   *
+   * @param name header field name (lower case).
+   * @param value header field value.
+   * @param nameOnly receives whether only the name did match.
+   *
+   * @return matching 1-based index or 0 if not found.
+   */
+  static size_t find(const BufferRef& name, const BufferRef& value,
+                     bool* nameOnly);
 };
 
-class ReferenceSet;
-
 /**
- * List of headers.
+ * The dynamic table (rfc7541, Section 2.3.2).
+ *
+ * Entries are kept in a ring buffer and indexed from 0 (most recently added)
+ * onwards. Slots of evicted entries are reused including their string
+ * storage, so a table in steady state does not allocate.
  *
- * The header table (see Section 3.2) is a component used
- * to associate stored header fields to index values.
+ * An encoder's table additionally maintains a hash index over its entries
+ * to make find() independent of the number of entries.
  */
-class XZERO_HTTP_API HeaderTable {
+class XZERO_HTTP_API DynamicTable {
  public:
-  explicit HeaderTable(size_t maxEntries);
-  ~HeaderTable();
-
-  size_t maxEntries() const { return maxEntries_; }
-  void setMaxEntries(size_t value);
-
-  bool empty() const { return entries_.empty(); }
-  size_t size() const { return entries_.size(); }
-
-  void add(const HeaderField& field);
-  bool contains(const HeaderFieldName& name) const;
-  bool contains(const HeaderField* name) const;
-  void remove(const HeaderFieldName& name);
-  void remove(const HeaderField* field);
-  void clear();
-
-  const HeaderField* entry(unsigned index) const {
-    assert(index >= 1 && index <= size());
-    return &entries_[index - 1];
-  }
-
-  const HeaderField& first() const {
-    assert(!empty());
-    return *entry(1);
+  /**
+   * @param maxSize maximum table size in bytes, as accounted by rfc7541.
+   * @param indexed whether to maintain the hash index used by find().
+   */
+  explicit DynamicTable(size_t maxSize, bool indexed = false);
+
+  /** Number of entries currently in the table. */
+  size_t length() const XZERO_NOEXCEPT { return length_; }
+
+  /** Sum of the size of all entries. */
+  size_t size() const XZERO_NOEXCEPT { return size_; }
+
+  size_t maxSize() const XZERO_NOEXCEPT { return maxSize_; }
+
+  /** Changes the maximum table size, evicting entries as needed. */
+  void setMaxSize(size_t maxSize);
+
+  /**
+   * Adds a new entry, evicting old entries as needed.
+   *
+   * An entry larger than maxSize() just empties the table.
+   * Neither @p name nor @p value may refer to an entry of this table.
+   */
+  void add(const BufferRef& name, const BufferRef& value);
+
+  /** Retrieves the entry at given 0-based @p index. */
+  const HeaderField& at(size_t index) const {
+    return slots_[(head_ + slots_.size() - index) & (slots_.size() - 1)];
   }
 
-  const HeaderField& last() const {
-    assert(!empty());
-    return *entry(size());
-  }
-
-  typedef std::deque<HeaderField>::iterator iterator;
-  typedef std::deque<HeaderField>::const_iterator const_iterator;
+  /**
+   * Finds the best matching entry for given header field.
+   *
+   * Requires the table to be @c indexed.
+   *
+   * @return matching 0-based index or @c npos if not found.
+   */
+  size_t find(const BufferRef& name, const BufferRef& value,
+              bool* nameOnly) const;
 
-  iterator begin() { return entries_.begin(); }
-  iterator end() { return entries_.end(); }
+  void clear();
 
-  const_iterator cbegin() const { return entries_.cbegin(); }
-  const_iterator cend() const { return entries_.cend(); }
+  static const size_t npos = static_cast<size_t>(-1);
 
-  iterator find(const HeaderFieldName& name);
-  const_iterator find(const HeaderFieldName& name) const;
+  /** Hash function used by the index, over the header field name. */
+  static uint64_t hashName(const BufferRef& name) XZERO_NOEXCEPT;
 
  private:
-  friend class ReferenceSet;
-
-  void link(ReferenceSet* ref);
-  void unlink(ReferenceSet* ref);
+  void evict(size_t required);
+  void evictOldest();
+  void grow();
 
  private:
-  size_t maxEntries_;
-  std::deque<HeaderField> entries_;
-  std::list<ReferenceSet*> referenceSets_;
+  std::vector<HeaderField> slots_;  //!< ring buffer, power of 2 sized
+  size_t head_;                     //!< slot of the newest entry
+  size_t length_;                   //!< number of entries
+  size_t size_;
+  size_t maxSize_;
+
+  // hash index, mapping the name hash to the insertion sequence numbers of
+  // all entries with that name. an entry at index i has the sequence number
+  // inserted_ - 1 - i.
+  bool indexed_;
+  uint64_t inserted_;
+  std::unordered_multimap<uint64_t, uint64_t> index_;
 };
 
 /**
- * used for differential encoding of a new header set.
+ * Huffman code (rfc7541, Appendix B).
  */
-class XZERO_HTTP_API ReferenceSet {
+class XZERO_HTTP_API Huffman {
  public:
-  explicit ReferenceSet(HeaderTable* headerTable);
-  ~ReferenceSet();
-
-  bool empty() const;
-  size_t size() const;
-
-  void add(const HeaderField* field);
-  bool contains(const HeaderField* field) const;
-  void remove(const HeaderField* field);
-
-  struct iterator;
-
-  iterator begin();
-  iterator end();
-
-  HeaderTable* headerTable() const { return headerTable_; }
-
- private:
-  HeaderTable* headerTable_;
-  std::list<const HeaderField*> references_;
-};
-
-class XZERO_HTTP_API ReferenceSet::iterator {
- public:
-  iterator();
-  iterator(ReferenceSet* rs, std::list<const HeaderField*>::iterator init);
-  iterator(iterator&& other) = default;
-  iterator(const iterator& other) = default;
-  iterator& operator=(const iterator& other) = default;
-
-  iterator& operator++();
-  bool operator==(const iterator& other) const;
-  bool operator!=(const iterator& other) const;
-
-  const HeaderField& operator*() const;
-
- private:
-  ReferenceSet* referenceSet_;
-  std::list<const HeaderField*>::iterator current_;
-  std::list<const HeaderField*>::iterator end_;
+  /**
+   * Decodes the Huffman encoded @p data, appending to @p output.
+   *
+   * Decoding is table-driven, consuming four bits per step.
+   *
+   * @retval true decoded successfully.
+   * @retval false invalid encoding.
+   */
+  static bool decode(const BufferRef& data, std::string* output);
+
+  /** Computes the number of bytes @p data takes up Huffman encoded. */
+  static size_t encodedLength(const BufferRef& data) XZERO_NOEXCEPT;
+
+  /** Huffman encodes @p data, appending to @p output. */
+  static void encode(const BufferRef& data, Buffer* output);
 };
 
 /**
- * Helper methods for encoding header fragments. 
+ * HPACK header block encoder.
+ *
+ * Header fields are encoded one after another into the header block
+ * being built. Fields found in the static or dynamic table are referenced
+ * by index, others are emitted literally and added to the dynamic table
+ * unless they are known to change frequently or are sensitive.
+ *
+ * Names are lower-cased while being encoded, string literals get Huffman
+ * encoded whenever that is shorter.
  */
-class XZERO_HTTP_API EncoderHelper {
- public:
-  static void encodeInt(Buffer* output, uint64_t i, unsigned prefixBits);
-  static void encodeIndexed(Buffer* output, unsigned index);
-  static void encodeLiteral(Buffer* output, const BufferRef& name,
-                            const BufferRef& value, bool indexing,
-                            bool huffman);
-  static void encodeIndexedLiteral(Buffer* output, unsigned index,
-                                   const BufferRef& value, bool huffman);
-  static void encodeTableSizeChange(Buffer* output, unsigned newSize);
-};
-
-class XZERO_HTTP_API Encoder : private EncoderHelper {
+class XZERO_HTTP_API Encoder {
  public:
-  Encoder();
-  ~Encoder();
+  explicit Encoder(size_t maxTableSize = DefaultHeaderTableSize);
+
+  /**
+   * Changes the maximum dynamic table size, as announced by the
+   * decoder's @c SETTINGS_HEADER_TABLE_SIZE.
+   *
+   * The change gets signaled at the start of the next header block.
+   */
+  void setMaxTableSize(size_t value);
+
+  /**
+   * Encodes a single header field into @p output.
+   *
+   * @param name header field name, in any case.
+   * @param value header field value.
+   * @param output target header block.
+   */
+  void encode(const BufferRef& name, const BufferRef& value, Buffer* output);
+
+  const DynamicTable& dynamicTable() const XZERO_NOEXCEPT { return table_; }
+
+  static void encodeInt(uint8_t flags, unsigned prefixBits, uint64_t value,
+                        Buffer* output);
+  static void encodeString(const BufferRef& value, Buffer* output);
 
-  void encode(const HeaderSet& headerBlock);
+ private:
+  DynamicTable table_;
+  bool sizeUpdatePending_;
+  std::string name_;  //!< scratch space for the lower-cased name
 };
 
 /**
- * Helper methods for decoding header fragments. 
+ * HPACK header block decoder.
  */
-class XZERO_HTTP_API DecoderHelper {
+class XZERO_HTTP_API Decoder {
  public:
-  static uint64_t decodeInt(const BufferRef& input, unsigned prefixBits,
-                            unsigned* bytesConsumed);
-};
+  /**
+   * Receives a decoded header field. The references are only valid for
+   * the duration of the call.
+   */
+  typedef std::function<void(const BufferRef&, const BufferRef&)>
+      HeaderFieldHandler;
+
+  explicit Decoder(size_t maxTableSize = DefaultHeaderTableSize);
+
+  /**
+   * Changes the upper bound of the dynamic table size, as announced by our
+   * @c SETTINGS_HEADER_TABLE_SIZE.
+   */
+  void setMaxTableSize(size_t value);
+
+  /**
+   * Decodes a complete header block, invoking @p onField for each header
+   * field, in order.
+   *
+   * @retval true success.
+   * @retval false malformed header block, to be treated as a connection
+   *               error of type @c COMPRESSION_ERROR.
+   */
+  bool decode(const BufferRef& headerBlock, const HeaderFieldHandler& onField);
+
+  const DynamicTable& dynamicTable() const XZERO_NOEXCEPT { return table_; }
+
+  static bool decodeInt(const uint8_t** pos, const uint8_t* end,
+                        unsigned prefixBits, uint64_t* value);
+  static bool decodeString(const uint8_t** pos, const uint8_t* end,
+                           std::string* value);
 
-class XZERO_HTTP_API Decoder : private DecoderHelper {
- public:
-  Decoder();
-  ~Decoder();
+ private:
+  bool lookup(uint64_t index, BufferRef* name, BufferRef* value) const;
 
-  void decode(const BufferRef& headerBlock);
+ private:
+  DynamicTable table_;
+  size_t maxTableSize_;
+  std::string name_;   //!< scratch space for literal names
+  std::string value_;  //!< scratch space for literal values
 };
 
 }  // namespace hpack
+}  // namespace http2
 }  // namespace xzero
-
-// vim:ts=2:sw=2
@@ -9,22 +9,45 @@
 #pragma once
 
 #include <xzero-http/Api.h>
-#include <base/Buffer.h>
-
-#include <memory>
-#include <vector>
-#include <utility>
+#include <xzero-base/sysconfig.h>
+#include <string>
 #include <stdint.h>
-#include <unordered_map>
-#include <map>
-#include <arpa/inet.h>
+#include <stddef.h>
 
 namespace xzero {
+namespace http2 {
+
+// {{{ constants
+/** The client connection preface, "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n". */
+XZERO_HTTP_API extern const char ConnectionPreface[];
+
+/** Length of the client connection preface. */
+const size_t ConnectionPrefaceLength = 24;
+
+/** Length of a frame header. */
+const size_t FrameHeaderSize = 9;
+
+/** Default (and minimum) value of @c SETTINGS_MAX_FRAME_SIZE. */
+const size_t DefaultMaxFrameSize = 16384;
+
+/** Maximum value of @c SETTINGS_MAX_FRAME_SIZE. */
+const size_t MaxFrameSizeLimit = 16777215;
+
+/** Initial flow control window size for streams and connections. */
+const size_t DefaultInitialWindowSize = 65535;
 
-using namespace base;
+/** Maximum size of a flow control window. */
+const size_t MaxWindowSize = 0x7fffffff;
 
-namespace framing {
+/** Highest stream identifier. */
+const unsigned MaxStreamID = 0x7fffffff;
 
+/** Default value of @c SETTINGS_HEADER_TABLE_SIZE. */
+const size_t DefaultHeaderTableSize = 4096;
+
+/** Default request header list limit, our @c SETTINGS_MAX_HEADER_LIST_SIZE. */
+const size_t DefaultMaxHeaderListSize = 16384;
+// }}}
 // {{{ enum types
 enum class FrameType {
   DATA = 0,
@@ -112,419 +135,109 @@ enum class ErrorCode {
    * it to refuse to process further frames.
    */
   EnhanceYourCalm = 11,
-};
-// }}}
-// {{{ free functions
-XZERO_HTTP_API std::string to_string(FrameType type);
-XZERO_HTTP_API std::string to_string(ErrorCode ec);
-XZERO_HTTP_API std::string to_string(uint8_t flags, FrameType type);
-// }}}
-struct XZERO_HTTP_API BASE_PACKED Frame {  // {{{
-                                 /*
-*  0                   1                   2                   3
-*  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
-* +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-* | R |     Length (14)           |   Type (8)    |   Flags (8)   |
-* +-+-+-----------+---------------+-------------------------------+
-* |R|                 Stream Identifier (31)                      |
-* +=+=============================================================+
-*/
- public:
-  FrameType type() const { return static_cast<FrameType>(type_); }
-  uint8_t flags() const { return flags_; }
-  unsigned streamID() const { return ntohl(streamID_); }
-
-  uint8_t* payloadData() { return ((uint8_t*)this) + sizeof(*this); }
-  const uint8_t* payloadData() const {
-    return ((uint8_t*)this) + sizeof(*this);
-  }
-  size_t payloadLength() const { return ntohs(length_); }
-
-  BufferRef payload() const {
-    return BufferRef(((const char*)this) + sizeof(*this), payloadLength());
-  };
-  BufferRef payload() {
-    return BufferRef(((char*)this) + sizeof(*this), payloadLength());
-  };
-
-  void dumpHeader() const;
-  void dump() const;
 
-  static void encodeHeader(Buffer* out, size_t payloadLength, FrameType type,
-                           unsigned flags, unsigned streamID);
+  /**
+   * The underlying transport has properties that do not meet minimum
+   * security requirements.
+   */
+  InadequateSecurity = 12,
 
- protected:
-  void setHeader(size_t payloadLength, FrameType type, unsigned flags,
-                 unsigned streamID);
+  /**
+   * The endpoint requires that HTTP/1.1 be used instead of HTTP/2.
+   */
+  Http11Required = 13,
+};
 
- protected:
-  unsigned reserved1_ : 2;
-  unsigned length_ : 14;
-  unsigned type_ : 8;
-  unsigned flags_ : 8;
-  unsigned reserved2_ : 1;
-  unsigned streamID_ : 31;
+enum class SettingsParameter {
+  HeaderTableSize = 1,
+  EnablePush = 2,
+  MaxConcurrentStreams = 3,
+  InitialWindowSize = 4,
+  MaxFrameSize = 5,
+  MaxHeaderListSize = 6,
 };
 // }}}
-struct XZERO_HTTP_API BASE_PACKED HeadersFrame : public Frame {  // {{{
-                                                       /*
-*  0                   1                   2                   3
-*  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
-* +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-* |Pad Length? (8)|
-* +-+-------------+-----------------------------------------------+
-* |E|                 Stream Dependency? (31)                     |
-* +-+-------------+-----------------------------------------------+
-* |  Weight? (8)  |
-* +-+-------------+-----------------------------------------------+
-* |                   Header Block Fragment (*)                 ...
-* +---------------------------------------------------------------+
-* |                           Padding (*)                       ...
-* +---------------------------------------------------------------+
-*/
- public:
+// {{{ frame flags
+struct DataFrame {
+  enum Flags { END_STREAM = 0x01, PADDED = 0x08 };
+};
+
+struct HeadersFrame {
   enum Flags {
     END_STREAM = 0x01,
-    END_SEGMENT = 0x02,
     END_HEADERS = 0x04,
     PADDED = 0x08,
     PRIORITY = 0x20,
   };
-
-  // flag tests
-  bool isEndStream() const { return flags() & END_STREAM; }
-  bool isEndSegment() const { return flags() & END_STREAM; }
-  bool isEndHeaders() const { return flags() & END_HEADERS; }
-  bool isPadded() const { return flags() & PADDED; }
-  bool isPriorized() const { return flags() & PRIORITY; }
-
-  // priority extensions
-  bool isExclusiveStreamDependency() const {
-    return isExclusiveStreamDependency_;
-  }
-  size_t streamDependencyID() const { return streamDependencyID_; }
-  uint8_t weight() const { return weight_; }
-
-  // data
-  BufferRef headerBlockFragment() const {
-    return payload().ref(12, payloadLength() - 12 - padLength_);
-  }
-  BufferRef padding() const {
-    return payload().ref(payloadLength() - padLength_);
-  }
-
-  void dump() const;
-
-  // static void encode(Buffer* out,
-  //    bool exclusive, unsigned depID, uint8_t weight, const HeaderTable&
-  // headers);
-
- protected:
-  uint8_t padLength_;
-  unsigned unused1_ : 24;
-  unsigned isExclusiveStreamDependency_ : 1;
-  unsigned streamDependencyID_ : 31;
-  uint8_t weight_;
-  unsigned unused2_ : 24;
-};
-// }}}
-struct XZERO_HTTP_API BASE_PACKED ContinuationFrame : public Frame {  // {{{
-                                                            /*
-*  0                   1                   2                   3
-*  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
-* +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-* |                   Header Block Fragment (*)                 ...
-* +---------------------------------------------------------------+
-*/
- public:
-  enum Flags { END_HEADERS = 0x04, };
-
-  // flag tests
-  bool isEndHeaders() const { return flags() & END_HEADERS; }
-
-  // data
-  BufferRef headerBlockFragment() const {
-    return payload().ref(12, payloadLength() - 12 - padLength_);
-  }
-
-  void dump() const;
-
- protected:
-  uint8_t padLength_;
-  unsigned unused1_ : 24;
-  unsigned isExclusiveStreamDependency_ : 1;
-  unsigned streamDependencyID_ : 31;
-  uint8_t weight_;
-  unsigned unused2_ : 24;
 };
-// }}}
-struct XZERO_HTTP_API BASE_PACKED PriorityFrame : public Frame {  // {{{
-                                                        /*
-*  0                   1                   2                   3
-*  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
-* +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-* |E|                  Stream Dependency (31)                     |
-* +-+-------------+-----------------------------------------------+
-* |   Weight (8)  |
-* +-+-------------+
-*/
- public:
-  bool isExclusive() const { return isExclusive_; }
-  unsigned dependantStreamID() const { return ntohl(dependantStreamID_); }
-  uint8_t weight() const { return weight_; }
-
-  void dump() const;
-
-  static void encode(Buffer* out, bool exclusive, unsigned dependantStreamID,
-                     uint8_t weight, unsigned streamID);
-
- private:
-  unsigned isExclusive_ : 1;
-  unsigned dependantStreamID_ : 31;
-  unsigned weight_ : 8;
-  unsigned unused_ : 24;
-};
-// }}}
-struct XZERO_HTTP_API BASE_PACKED DataFrame : public Frame {  // {{{
-                                                    /*
-*  0                   1                   2                   3
-*  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
-* +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-* |Pad Length? (8)|
-* +---------------+-----------------------------------------------+
-* |                            Data (*)                         ...
-* +---------------------------------------------------------------+
-* |                           Padding (*)                       ...
-* +---------------------------------------------------------------+
-*/
- public:
-  enum Flags { END_STREAM = 0x01, END_SEGMENT = 0x02, PADDED = 0x08, };
-
-  uint8_t padLength() const { return padLength_; }
-  BufferRef data() const {
-    return payload().ref(4, payloadLength() - 4 - padLength());
-  }
-  BufferRef padding() const {
-    return payload().ref(payloadLength() - padLength());
-  }
-
-  void dump() const;
-
-  static void encode(Buffer* out, bool endStream, bool endSegment,
-                     unsigned streamID, const BufferRef& data);
-  static void encode(Buffer* out, bool endStream, bool endSegment,
-                     unsigned streamID, const BufferRef& data,
-                     const BufferRef& padding);
-
- private:
-  uint8_t padLength_;
-};
-// }}}
-struct XZERO_HTTP_API BASE_PACKED PingFrame : public Frame {  // {{{
- public:
-  enum Flags { ACK = 0x01, };
-
-  bool isAcknowledgement() const { return flags() & ACK; }
-  uint64_t data() const { return opaqueData_; }
 
-  void dump() const;
+struct SettingsFrame {
+  enum Flags { ACK = 0x01 };
+};
 
-  static void encode(Buffer* out, uint64_t data);
-  static void encodeAck(Buffer* out, uint64_t data);
+struct PushPromiseFrame {
+  enum Flags { END_HEADERS = 0x04, PADDED = 0x08 };
+};
 
- private:
-  uint64_t opaqueData_;
+struct PingFrame {
+  enum Flags { ACK = 0x01 };
 };
-// }}}
-struct XZERO_HTTP_API BASE_PACKED GoAwayFrame : public Frame {  // {{{
-                                                      /*
-*  0                   1                   2                   3
-*  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
-* +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-* |R|                  Last-Stream-ID (31)                        |
-* +-+-------------------------------------------------------------+
-* |                      Error Code (32)                          |
-* +---------------------------------------------------------------+
-* |                  Additional Debug Data (*)                    |
-* +---------------------------------------------------------------+
-*/
- public:
-  uint32_t lastStreamID() const {
-    return static_cast<uint32_t>(ntohl(lastStreamID_));
-  }
-  ErrorCode errorCode() const {
-    return static_cast<ErrorCode>(ntohl(errorCode_));
-  }
-  BufferRef debugData() const { return payload().ref(8); }
-
-  void dump() const;
-
-  static void encode(Buffer* out, unsigned lastStreamID, ErrorCode ec);
-
-  static void encode(Buffer* out, unsigned lastStreamID, ErrorCode ec,
-                     const BufferRef& debugData);
-
- private:
-  unsigned reserved_ : 1;
-  unsigned lastStreamID_ : 31;
-  unsigned errorCode_ : 32;
+
+struct ContinuationFrame {
+  enum Flags { END_HEADERS = 0x04 };
 };
 // }}}
-struct XZERO_HTTP_API BASE_PACKED ResetStreamFrame : public Frame {  // {{{
- public:
-  ErrorCode errorCode() const {
-    return static_cast<ErrorCode>(ntohl(errorCode_));
-  }
-
-  void dump() const;
+// {{{ FrameHeader
+/**
+ * Frame header, common to all frame types.
+ *
+ * <pre>
+ *  +-----------------------------------------------+
+ *  |                 Length (24)                   |
+ *  +---------------+---------------+---------------+
+ *  |   Type (8)    |   Flags (8)   |
+ *  +-+-------------+---------------+-------------------------------+
+ *  |R|                 Stream Identifier (31)                      |
+ *  +=+=============================================================+
+ * </pre>
+ */
+struct XZERO_HTTP_API FrameHeader {
+  size_t length;
+  FrameType type;
+  unsigned flags;
+  unsigned streamID;
 
-  static void encode(Buffer* out, ErrorCode ec, unsigned streamID);
+  /**
+   * Decodes the frame header from the first FrameHeaderSize bytes at @p data.
+   */
+  static FrameHeader decode(const char* data);
 
- private:
-  uint32_t errorCode_;
+  /**
+   * Encodes a frame header into the first FrameHeaderSize bytes at @p out.
+   */
+  static void encode(char* out, size_t length, FrameType type,
+                     unsigned flags, unsigned streamID);
 };
 // }}}
-struct XZERO_HTTP_API BASE_PACKED SettingsFrame : public Frame {  // {{{
- public:
-  enum Flags { ACK = 0x01 };
-
-  struct BASE_PACKED Parameter {  // {{{
-                                /*
-*  0                   1                   2                   3
-*  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
-* +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-* |       Identifier (16)         |
-* +-------------------------------+-------------------------------+
-* |                        Value (32)                             |
-* +---------------------------------------------------------------+
-*/
-    enum Type {
-      HeaderTableSize = 1,
-      EnablePush = 2,
-      MaxConcurrentStreams = 3,
-      InitialWindowSize = 4
-    };
-
-    Type type() const { return static_cast<Type>(ntohs(type_)); }
-
-    const char* name() const {
-      switch (type()) {
-        case HeaderTableSize:
-          return "HeaderTableSize";
-        case EnablePush:
-          return "EnablePush";
-        case MaxConcurrentStreams:
-          return "MaxConcurrentStreams";
-        case InitialWindowSize:
-          return "InitialWindowSize";
-        default: {
-          return "UNKNOWN_PARAM";
-          // abort();
-        }
-      }
-    }
-
-    uint32_t value() const { return ntohl(static_cast<uint32_t>(value_)); }
-
-    static Parameter encode(Type type, uint32_t value);
-
-   private:
-    unsigned type_ : 16;
-    unsigned unused_ : 16;
-    unsigned value_ : 32;
-  };                 // }}}
-  struct iterator {  // {{{
-   public:
-    iterator() = default;
-    iterator(const iterator& other) = default;
-    iterator(const SettingsFrame* frame, size_t offset)
-        : frame_(frame), offset_(offset) {}
-
-    bool operator==(const iterator& other) const {
-      return offset_ == other.offset_;
-    }
-    bool operator!=(const iterator& other) const {
-      return offset_ != other.offset_;
-    }
-
-    iterator& operator++() {
-      if (offset_ < frame_->parameterCount()) {
-        ++offset_;
-      }
-      return *this;
-    }
-
-    Parameter operator*() const { return frame_->parameter(offset_); }
-
-   private:
-    const SettingsFrame* frame_;
-    size_t offset_;
-  };  // }}}
-
-  // flags
-  bool isAcknowledgement() const { return flags() & ACK; }
-
-  size_t parameterCount() const { return payloadLength() / 8; }
-
-  Parameter parameter(size_t offset) const {
-    return *reinterpret_cast<const Parameter*>(payloadData() + 8 * offset);
-  }
-
-  void dump() const;
-
-  iterator begin() const { return iterator(this, 0); }
-  iterator end() const { return iterator(this, parameterCount()); }
-
-  static void encode(
-      Buffer* out,
-      const std::vector<std::pair<Parameter::Type, uint32_t>>& params);
-  static void encodeAck(Buffer* out);
-};                                                         // }}}
-struct XZERO_HTTP_API BASE_PACKED PushPromiseFrame : public Frame {  // {{{
-                                                           /*
-*  0                   1                   2                   3
-*  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
-* +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-* |Pad Length? (8)|
-* +-+-------------+-----------------------------------------------+
-* |R|                  Promised Stream ID (31)                    |
-* +-+-----------------------------+-------------------------------+
-* |                   Header Block Fragment (*)                 ...
-* +---------------------------------------------------------------+
-* |                           Padding (*)                       ...
-* +---------------------------------------------------------------+
-*/
- public:
-  enum Flags { END_HEADERS = 0x04, PADDED = 0x08, };
-
-  size_t promisedStreamID() const { return promisedStreamID_; }
-  BufferRef headerBlockFragment() const {
-    return payload().ref(8, payloadLength() - 8 - padLength_);
-  }
-
-  void dump() const;
-
- private:
-  unsigned padLength_ : 8;
-  unsigned unused_ : 24;
-  unsigned reserved_ : 1;
-  unsigned promisedStreamID_ : 31;
-};
+// {{{ wire helpers
+inline uint32_t decodeUInt32(const char* data) {
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+  return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) |
+         (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+inline void encodeUInt32(char* out, uint32_t value) {
+  out[0] = static_cast<char>((value >> 24) & 0xff);
+  out[1] = static_cast<char>((value >> 16) & 0xff);
+  out[2] = static_cast<char>((value >> 8) & 0xff);
+  out[3] = static_cast<char>(value & 0xff);
+}
+// }}}
+// {{{ free functions
+XZERO_HTTP_API std::string to_string(FrameType type);
+XZERO_HTTP_API std::string to_string(ErrorCode ec);
+XZERO_HTTP_API std::string to_string(SettingsParameter parameter);
 // }}}
-struct XZERO_HTTP_API BASE_PACKED WindowUpdateFrame : public Frame {  // {{{
- public:
-  unsigned windowSizeIncrement() const {
-    return static_cast<size_t>(ntohl(windowSizeIncrement_));
-  }
-
-  void dump() const;
-
-  static void encode(Buffer* out, unsigned windowSizeIncrement);
-
- private:
-  unsigned reserved_ : 1;
-  unsigned windowSizeIncrement_ : 31;
-};  // }}}
 
-}  // namespace framing
+}  // namespace http2
 }  // namespace xzero